@@ -0,0 +1,315 @@
+/************************************************
+ *  concurrent_text_index.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_CONCURRENT_TEXT_INDEX_HPP_
+#define DICT_CONCURRENT_TEXT_INDEX_HPP_
+
+#include <cstddef>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <utility>
+
+namespace dict {
+
+/************************************************
+ * Declaration: class concurrent_text_index<TI>
+ ************************************************/
+
+// Lets any number of threads query a text index while one thread at a time
+// modifies it. Two replicas of the index are kept: a writer updates the one
+// that is not published, publishes it, and then replays the same update on
+// the other one. read() is lock-free: it only retries when a writer
+// publishes in between, and it bumps a counter of the replica it is about
+// to take, so that a writer waits for such calls only, never for snapshots.
+//
+// A snapshot shares the ownership of its replica. A replica that snapshots
+// still hold when the update is replayed is left to them, and the next
+// update starts from a copy of the published one instead. Copies are deep,
+// in time linear in the size of the index. An update that throws before it
+// is published is rolled back that way and rethrown; one that throws while
+// it is replayed is already published, and it is rethrown once the replica
+// is repaired.
+template <typename TextIndex>
+class concurrent_text_index {
+ public:  // Public Type(s)
+    using index_type = TextIndex;
+    using size_type = typename TextIndex::size_type;
+    using term_type = typename TextIndex::term_type;
+
+    class snapshot;
+
+ public:  // Public Method(s)
+    concurrent_text_index();
+    concurrent_text_index(concurrent_text_index const &) = delete;
+    concurrent_text_index &operator=(concurrent_text_index const &) = delete;
+
+    template <typename Sequence>
+    void insert(Sequence const &s);
+    template <typename Sequences>
+    void insert_batch(Sequences const &seqs);
+    size_type erase(size_type i);
+
+    template <typename Function>
+    void modify(Function f);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
+    snapshot read() const;
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type NUM_STRIPES = 16;
+    static constexpr size_type CACHE_LINE_SIZE = 64;
+
+ private:  // Private Type(s)
+    struct counter;
+    using counters = std::array<counter, NUM_STRIPES>;
+
+ private:  // Private Static Method(s)
+    static size_type stripe();
+
+ private:  // Private Method(s)
+    void wait_for_readers(size_type k) const;
+    bool is_held(size_type k) const;
+    TextIndex &standby(size_type k);
+
+ private:  // Private Property(ies)
+    std::array<std::shared_ptr<TextIndex>, 2> replicas_;
+    mutable std::array<counters, 2> readers_;
+    std::atomic<size_type> active_;
+    std::mutex writer_mutex_;
+
+    // whether the replica that is not published misses the last update
+    bool is_stale_;
+};  // class concurrent_text_index<TI>
+
+/************************************************
+ * Declaration: class concurrent_text_index<TI>::snapshot
+ ************************************************/
+
+// A consistent version of the index, which stays valid and unchanged as
+// long as the handle lives, whatever is updated meanwhile.
+template <typename TextIndex>
+class concurrent_text_index<TextIndex>::snapshot {
+ public:  // Public Method(s)
+    TextIndex const &operator*() const;
+    TextIndex const *operator->() const;
+
+ private:  // Private Method(s)
+    explicit snapshot(std::shared_ptr<TextIndex const> index);
+
+ private:  // Private Property(ies)
+    std::shared_ptr<TextIndex const> index_;
+
+    friend concurrent_text_index;
+};  // class concurrent_text_index<TI>::snapshot
+
+/************************************************
+ * Declaration: struct concurrent_text_index<TI>::counter
+ ************************************************/
+
+// Readers are spread over several counters, each in its own cache line,
+// so that they do not contend on a single one.
+template <typename TextIndex>
+struct concurrent_text_index<TextIndex>::counter {
+    counter()
+        : value(0) {
+        // do nothing
+    }
+
+    std::atomic<size_type> value;
+    char padding[CACHE_LINE_SIZE - sizeof(std::atomic<size_type>)];
+};  // struct concurrent_text_index<TI>::counter
+
+/************************************************
+ * Implementation: class concurrent_text_index<TI>
+ ************************************************/
+
+template <typename TI>
+inline concurrent_text_index<TI>::concurrent_text_index()
+    : replicas_{{std::make_shared<TI>(), std::make_shared<TI>()}}, active_(0),
+      is_stale_(false) {
+    // do nothing
+}
+
+template <typename TI>
+template <typename Sequence>
+inline void concurrent_text_index<TI>::insert(Sequence const &s) {
+    modify([&s](TI &ti) { ti.insert(s); });
+}
+
+template <typename TI>
+template <typename Sequences>
+inline void concurrent_text_index<TI>::insert_batch(Sequences const &seqs) {
+    modify([&seqs](TI &ti) { ti.insert_batch(seqs); });
+}
+
+template <typename TI>
+inline typename concurrent_text_index<TI>::size_type
+concurrent_text_index<TI>::erase(size_type i) {
+    size_type pos = 0;
+    modify([i, &pos](TI &ti) { pos = ti.erase(i); });
+    return pos;
+}
+
+template <typename TI>
+template <typename Function>
+void concurrent_text_index<TI>::modify(Function f) {
+    // f is applied to both replicas, so it has to be deterministic
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+
+    auto k = active_.load();
+    auto &next = standby(k);
+    try {
+        f(next);
+    } catch (...) {
+        // roll back to the published version, which readers never left
+        is_stale_ = true;
+        throw;
+    }
+
+    active_.store(1 - k);
+
+    // snapshots of the previous version keep it until they are released
+    wait_for_readers(k);
+    if (is_held(k)) {
+        is_stale_ = true;
+        return;
+    }
+
+    try {
+        f(*replicas_[k]);
+    } catch (...) {
+        // the update has already been published, and the replica is
+        // repaired from it before the caller learns of the failure
+        is_stale_ = true;
+        standby(1 - k);
+        throw;
+    }
+}
+
+template <typename TI>
+void concurrent_text_index<TI>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    read()->save(os);
+}
+
+template <typename TI>
+void concurrent_text_index<TI>::load(std::istream &is) {  // NOLINT(runtime/references)
+    // the stream is parsed once, and the other replica is brought up to date
+    // by copying the loaded one before the next update, as after a rollback
+    TI loaded;
+    loaded.load(is);
+
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    auto k = active_.load();
+    auto &replica = replicas_[1 - k];
+    wait_for_readers(1 - k);
+    if (is_held(1 - k)) {
+        replica = std::make_shared<TI>(std::move(loaded));
+    } else {
+        *replica = std::move(loaded);
+    }
+
+    active_.store(1 - k);
+    is_stale_ = true;
+}
+
+template <typename TI>
+typename concurrent_text_index<TI>::snapshot concurrent_text_index<TI>::read() const {
+    auto s = stripe();
+    while (true) {
+        auto k = active_.load();
+        auto &count = readers_[k][s].value;
+        ++count;
+
+        // the writer may have switched replicas before seeing this reader;
+        // otherwise it does not touch the replica until the count drops
+        if (active_.load() == k) {
+            snapshot result(replicas_[k]);
+            --count;
+            return result;
+        }
+
+        --count;
+    }
+}
+
+template <typename TI>
+inline typename concurrent_text_index<TI>::size_type concurrent_text_index<TI>::stripe() {
+    static thread_local size_type s =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) % NUM_STRIPES;
+    return s;
+}
+
+template <typename TI>
+void concurrent_text_index<TI>::wait_for_readers(size_type k) const {
+    // only calls of read() are waited for, which hold no snapshot yet
+    for (auto const &c : readers_[k]) {
+        while (c.value.load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template <typename TI>
+inline bool concurrent_text_index<TI>::is_held(size_type k) const {
+    // whether snapshots still hold replica k; once they are all released,
+    // their reads of it happen before the writer changes it
+    auto is_held = replicas_[k].use_count() > 1;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return is_held;
+}
+
+template <typename TI>
+TI &concurrent_text_index<TI>::standby(size_type k) {
+    // the replica that is not published, brought up to date with replica k
+    // if it misses an update; one that snapshots still hold is replaced
+    auto &replica = replicas_[1 - k];
+    if (!is_stale_) { return *replica; }
+
+    wait_for_readers(1 - k);
+    if (is_held(1 - k)) {
+        replica = std::make_shared<TI>(*replicas_[k]);
+    } else {
+        *replica = *replicas_[k];
+    }
+
+    is_stale_ = false;
+    return *replica;
+}
+
+/************************************************
+ * Implementation: class concurrent_text_index<TI>::snapshot
+ ************************************************/
+
+template <typename TI>
+inline concurrent_text_index<TI>::snapshot::snapshot(std::shared_ptr<TI const> index)
+    : index_(std::move(index)) {
+    // do nothing
+}
+
+template <typename TI>
+inline TI const &concurrent_text_index<TI>::snapshot::operator*() const {
+    return *index_;
+}
+
+template <typename TI>
+inline TI const *concurrent_text_index<TI>::snapshot::operator->() const {
+    return index_.get();
+}
+
+}  // namespace dict
+
+#endif  // DICT_CONCURRENT_TEXT_INDEX_HPP_
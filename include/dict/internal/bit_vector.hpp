@@ -10,36 +10,68 @@
 #define DICT_INTERNAL_BIT_VECTOR_HPP_
 
 #include <cassert>
+#include <cstdint>
 
+#include <algorithm>
 #include <bitset>
+#include <istream>
 #include <iterator>
+#include <memory>
+#include <ostream>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
+#include "broadword.hpp"
 #include "rbtree.hpp"
+#include "serialization.hpp"
 
 namespace dict {
 
 namespace internal {
 
 /************************************************
- * Declaration: class bit_vector<N>
+ * Declaration: class bit_vector<N, A>
  ************************************************/
 
-template <std::size_t N>
+// The blocks are kept in tree nodes allocated with Allocator.
+template <std::size_t N, typename Allocator = std::allocator<bool>>
 class bit_vector {
  public:  // Public Type(s)
     using size_type = std::size_t;
     using value_type = bool;
+    using allocator_type = Allocator;
 
  public:  // Public Method(s)
+    explicit bit_vector(allocator_type const &alloc = allocator_type());
+    template <typename InputIterator>
+    bit_vector(InputIterator first, InputIterator last,
+               allocator_type const &alloc = allocator_type());
+    bit_vector(bit_vector const &) = default;
+    bit_vector(bit_vector &&) = default;
     ~bit_vector();
 
+    bit_vector &operator=(bit_vector const &) = default;
+    bit_vector &operator=(bit_vector &&) = default;
+
+    allocator_type get_allocator() const;
+    void swap(bit_vector &other);  // NOLINT(runtime/references)
+
     bit_vector &set(size_type i, value_type b = true);
     bit_vector &reset(size_type i);
     size_type insert(size_type i, value_type b);
     value_type erase(size_type i);
 
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+    void assign_words(std::vector<std::uint64_t> const &words, size_type n);
+    void replace(size_type first, size_type last,
+                 std::vector<std::uint64_t> const &words, size_type n);
+    std::vector<std::uint64_t> words() const;
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
     std::pair<value_type, size_type> access_and_rank(size_type i) const;
     std::pair<value_type, size_type> access_and_rank(size_type i, value_type b) const;
     size_type rank(size_type i, value_type b) const;
@@ -56,17 +88,21 @@ class bit_vector {
         MAX_BLOCK_SIZE - 1 < 0.9 * MAX_BLOCK_SIZE
             ? MAX_BLOCK_SIZE - 1
             : 0.9 * MAX_BLOCK_SIZE;
+    static constexpr size_type WORD_SIZE = 64;
+    static constexpr size_type NUM_BLOCK_WORDS = (MAX_BLOCK_SIZE + WORD_SIZE - 1) / WORD_SIZE;
 
  private:  // Private Type(s)
     struct block;
     struct counts_updater;
-    using bstree = rbtree<block, counts_updater>;
+    using bstree = rbtree<block, counts_updater, Allocator>;
     using bitset = std::bitset<MAX_BLOCK_SIZE>;
+    using word_type = std::uint64_t;
 
  private:  // Private Static Method(s)
     static void equalize_blocks(block &p, block &q);    // NOLINT(runtime/references)
     static void merge_blocks(block &p, block &q);       // NOLINT(runtime/references)
     static void update_counts(typename bstree::iterator it);
+    static void update_node_counts(typename bstree::iterator it);
 
  private:  // Private Method(s)
     // NOLINTNEXTLINE(runtime/references)
@@ -78,14 +114,14 @@ class bit_vector {
 
  private:  // Private Property(ies)
     bstree tree_;
-};  // class bit_vector<N>
+};  // class bit_vector<N, A>
 
 /************************************************
- * Declaration: struct bit_vector<N>::block
+ * Declaration: struct bit_vector<N, A>::block
  ************************************************/
 
-template <std::size_t N>
-struct bit_vector<N>::block {
+template <std::size_t N, typename A>
+struct bit_vector<N, A>::block {
     block()
         : num_bits(0), num_sub_bits(0), num_sub_set_bits(0) {
         // do nothing
@@ -100,30 +136,54 @@ struct bit_vector<N>::block {
     size_type num_sub_bits;
     size_type num_sub_set_bits;
     bitset bits;
-};  // class bit_vector<N>::block
+};  // class bit_vector<N, A>::block
 
 /************************************************
- * Declaration: struct bit_vector<N>::counts_updater
+ * Declaration: struct bit_vector<N, A>::counts_updater
  ************************************************/
 
-template <std::size_t N>
-struct bit_vector<N>::counts_updater {
+template <std::size_t N, typename A>
+struct bit_vector<N, A>::counts_updater {
     void operator()(typename bstree::iterator it) const {
         update_counts(it);
     }
-};  // class bit_vector<N>::counts_updater
+};  // class bit_vector<N, A>::counts_updater
 
 /************************************************
- * Implementation: class bit_vector<N>
+ * Implementation: class bit_vector<N, A>
  ************************************************/
 
-template <std::size_t N>
-inline bit_vector<N>::~bit_vector() {
+template <std::size_t N, typename A>
+inline bit_vector<N, A>::bit_vector(allocator_type const &alloc)
+    : tree_(alloc) {
     // do nothing
 }
 
-template <std::size_t N>
-inline bit_vector<N> &bit_vector<N>::set(size_type i, value_type b) {
+template <std::size_t N, typename A>
+template <typename InputIterator>
+inline bit_vector<N, A>::bit_vector(InputIterator first, InputIterator last,
+                                    allocator_type const &alloc)
+    : tree_(alloc) {
+    assign(first, last);
+}
+
+template <std::size_t N, typename A>
+inline bit_vector<N, A>::~bit_vector() {
+    // do nothing
+}
+
+template <std::size_t N, typename A>
+inline typename bit_vector<N, A>::allocator_type bit_vector<N, A>::get_allocator() const {
+    return tree_.get_allocator();
+}
+
+template <std::size_t N, typename A>
+inline void bit_vector<N, A>::swap(bit_vector &other) {  // NOLINT(runtime/references)
+    tree_.swap(other.tree_);
+}
+
+template <std::size_t N, typename A>
+inline bit_vector<N, A> &bit_vector<N, A>::set(size_type i, value_type b) {
     size_type pos = 0, rank = 0;
     auto it = find_block(i, pos, rank);
     i -= pos;
@@ -136,13 +196,13 @@ inline bit_vector<N> &bit_vector<N>::set(size_type i, value_type b) {
     return *this;
 }
 
-template <std::size_t N>
-inline bit_vector<N> &bit_vector<N>::reset(size_type i) {
+template <std::size_t N, typename A>
+inline bit_vector<N, A> &bit_vector<N, A>::reset(size_type i) {
     return set(i, false);
 }
 
-template <std::size_t N>
-typename bit_vector<N>::size_type bit_vector<N>::insert(size_type i, value_type b) {
+template <std::size_t N, typename A>
+typename bit_vector<N, A>::size_type bit_vector<N, A>::insert(size_type i, value_type b) {
     if (!tree_.root()) {
         assert(i == 0);
         tree_.insert_before(tree_.end(), block(b));
@@ -232,8 +292,8 @@ typename bit_vector<N>::size_type bit_vector<N>::insert(size_type i, value_type
     return (b ? rank : k - rank) + 1;
 }
 
-template <std::size_t N>
-typename bit_vector<N>::value_type bit_vector<N>::erase(size_type i) {
+template <std::size_t N, typename A>
+typename bit_vector<N, A>::value_type bit_vector<N, A>::erase(size_type i) {
     size_type pos = 0, rank = 0;
     auto it = find_block(i, pos, rank);
     i -= pos;
@@ -288,9 +348,193 @@ typename bit_vector<N>::value_type bit_vector<N>::erase(size_type i) {
     return b;
 }
 
-template <std::size_t N>
-inline std::pair<typename bit_vector<N>::value_type, typename bit_vector<N>::size_type>
-bit_vector<N>::access_and_rank(size_type i) const {
+template <std::size_t N, typename A>
+template <typename InputIterator>
+void bit_vector<N, A>::assign(InputIterator first, InputIterator last) {
+    std::vector<word_type> words;
+    size_type n = 0;
+    for (; first != last; ++first, ++n) {
+        if (n % WORD_SIZE == 0) { words.push_back(0); }
+        words.back() |= word_type(*first ? 1 : 0) << (n % WORD_SIZE);
+    }
+
+    assign_words(words, n);
+}
+
+template <std::size_t N, typename A>
+void bit_vector<N, A>::assign_words(std::vector<std::uint64_t> const &words, size_type n) {
+    assert(n <= words.size() * WORD_SIZE);
+
+    // blocks hold at most MAX_MERGE_SIZE bits, as after merging them
+    std::vector<block> blocks((n + MAX_MERGE_SIZE - 1) / MAX_MERGE_SIZE);
+    size_type pos = 0;
+    for (auto &bb : blocks) {
+        bb.num_bits = n - pos;
+        if (bb.num_bits > MAX_MERGE_SIZE) { bb.num_bits = MAX_MERGE_SIZE; }
+
+        for (size_type k = 0; k < bb.num_bits; k += WORD_SIZE) {
+            auto len = bb.num_bits - k < WORD_SIZE ? bb.num_bits - k : WORD_SIZE;
+            bb.bits |= bitset(broadword::get_bits(words.data(), pos + k, len)) << k;
+        }
+
+        pos += bb.num_bits;
+    }
+
+    tree_.assign(blocks.begin(), blocks.end(), update_node_counts);
+}
+
+template <std::size_t N, typename A>
+void bit_vector<N, A>::replace(size_type first, size_type last,
+                               std::vector<std::uint64_t> const &words, size_type n) {
+    assert(first <= last && last <= size());
+    assert(n <= words.size() * WORD_SIZE);
+
+    if (!tree_.root()) {
+        assign_words(words, n);
+        return;
+    }
+
+    // only the blocks holding [first, last] (or the last block, when
+    // appending) are re-packed, together with a neighbour if too few bits
+    // would be left for a block
+    auto num_bits = size();
+    size_type first_pos = 0, last_pos = 0, rank = 0;
+    auto first_it = find_block(first < num_bits ? first : num_bits - 1, first_pos, rank);
+    auto last_it = find_block(last < num_bits ? last : num_bits - 1, last_pos, rank);
+    auto end_pos = last_pos + last_it->num_bits;
+
+    auto m = first - first_pos + n + (end_pos - last);
+    if (m > 0 && m < MIN_BLOCK_SIZE) {
+        if (std::next(last_it)) {
+            ++last_it;
+            end_pos += last_it->num_bits;
+            m += last_it->num_bits;
+        } else if (std::prev(first_it)) {
+            --first_it;
+            first_pos -= first_it->num_bits;
+            m += first_it->num_bits;
+        }
+    }
+
+    std::vector<word_type> packed((m + WORD_SIZE - 1) / WORD_SIZE);
+    size_type p = 0;
+    auto put_bits = [&](bitset const &bits, size_type from, size_type to) {
+        bitset const word_mask(~0ULL);
+        for (auto k = from; k < to; k += WORD_SIZE) {
+            auto len = to - k < WORD_SIZE ? to - k : WORD_SIZE;
+            broadword::set_bits(packed.data(), p, len, ((bits >> k) & word_mask).to_ullong());
+            p += len;
+        }
+    };
+
+    auto put_words = [&]() {
+        for (size_type k = 0; k < n; k += WORD_SIZE) {
+            auto len = n - k < WORD_SIZE ? n - k : WORD_SIZE;
+            broadword::set_bits(packed.data(), p, len,
+                                broadword::get_bits(words.data(), k, len));
+            p += len;
+        }
+    };
+
+    auto stop = std::next(last_it);
+    auto is_put = false;
+    auto pos = first_pos;
+    for (auto it = first_it; it != stop; ++it) {
+        auto block_first = pos, block_last = pos + it->num_bits;
+        if (block_first < first) {
+            put_bits(it->bits, 0, std::min(first, block_last) - block_first);
+        }
+
+        if (!is_put && first <= block_last) {
+            put_words();
+            is_put = true;
+        }
+
+        if (block_last > last) {
+            put_bits(it->bits, std::max(last, block_first) - block_first, it->num_bits);
+        }
+
+        pos = block_last;
+    }
+
+    for (auto it = first_it; it != stop; ) {
+        it = tree_.erase(it);
+    }
+
+    // split the bits evenly into blocks of at most MAX_MERGE_SIZE bits
+    auto num_blocks = (m + MAX_MERGE_SIZE - 1) / MAX_MERGE_SIZE;
+    p = 0;
+    for (size_type k = 1; k <= num_blocks; ++k) {
+        block bb;
+        bb.num_bits = m * k / num_blocks - p;
+        for (size_type t = 0; t < bb.num_bits; t += WORD_SIZE) {
+            auto len = bb.num_bits - t < WORD_SIZE ? bb.num_bits - t : WORD_SIZE;
+            bb.bits |= bitset(broadword::get_bits(packed.data(), p + t, len)) << t;
+        }
+
+        p += bb.num_bits;
+        update_counts(tree_.insert_before(stop, bb));
+    }
+}
+
+template <std::size_t N, typename A>
+std::vector<std::uint64_t> bit_vector<N, A>::words() const {
+    // the bits packed as assign_words() takes them
+    std::vector<std::uint64_t> words((size() + WORD_SIZE - 1) / WORD_SIZE);
+    bitset const word_mask(~0ULL);
+    size_type pos = 0;
+    for (auto const &bb : tree_) {
+        for (size_type k = 0; k < bb.num_bits; k += WORD_SIZE) {
+            auto len = bb.num_bits - k < WORD_SIZE ? bb.num_bits - k : WORD_SIZE;
+            auto word = ((bb.bits >> k) & word_mask).to_ullong();
+            broadword::set_bits(words.data(), pos + k, len, word);
+        }
+
+        pos += bb.num_bits;
+    }
+
+    return words;
+}
+
+template <std::size_t N, typename A>
+void bit_vector<N, A>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    // blocks are written in order, each as its length followed by its bits
+    write_value<std::uint64_t>(os, tree_.size());
+
+    bitset const word_mask(~0ULL);
+    for (auto const &bb : tree_) {
+        write_value<std::uint64_t>(os, bb.num_bits);
+        for (size_type k = 0; k < NUM_BLOCK_WORDS; ++k) {
+            auto word = ((bb.bits >> (k * WORD_SIZE)) & word_mask).to_ullong();
+            write_value<std::uint64_t>(os, word);
+        }
+    }
+}
+
+template <std::size_t N, typename A>
+void bit_vector<N, A>::load(std::istream &is) {  // NOLINT(runtime/references)
+    auto num_blocks = read_value<std::uint64_t>(is);
+    check_remaining(is, num_blocks, sizeof(std::uint64_t) * (1 + NUM_BLOCK_WORDS));
+
+    std::vector<block> blocks(num_blocks);
+    for (auto &bb : blocks) {
+        bb.num_bits = read_value<std::uint64_t>(is);
+        if (bb.num_bits == 0 || bb.num_bits > MAX_BLOCK_SIZE) {
+            throw std::runtime_error("invalid bit_vector block");
+        }
+
+        for (size_type k = 0; k < NUM_BLOCK_WORDS; ++k) {
+            auto word = read_value<std::uint64_t>(is);
+            bb.bits |= bitset(word) << (k * WORD_SIZE);
+        }
+    }
+
+    tree_.assign(blocks.begin(), blocks.end(), update_node_counts);
+}
+
+template <std::size_t N, typename A>
+inline std::pair<typename bit_vector<N, A>::value_type, typename bit_vector<N, A>::size_type>
+bit_vector<N, A>::access_and_rank(size_type i) const {
     size_type pos = 0, rank = 0;
     auto it = find_bit(i, pos, rank);
     auto b = it->bits[i];
@@ -298,22 +542,23 @@ bit_vector<N>::access_and_rank(size_type i) const {
     return std::make_pair(b, r);
 }
 
-template <std::size_t N>
-inline std::pair<typename bit_vector<N>::value_type, typename bit_vector<N>::size_type>
-    bit_vector<N>::access_and_rank(size_type i, value_type b) const {
+template <std::size_t N, typename A>
+inline std::pair<typename bit_vector<N, A>::value_type, typename bit_vector<N, A>::size_type>
+    bit_vector<N, A>::access_and_rank(size_type i, value_type b) const {
     size_type pos = 0, rank = 0;
     auto it = find_bit(i, pos, rank);
     auto r = b ? rank : i + pos + 1 - rank;
     return std::make_pair(it->bits[i], r);
 }
 
-template <std::size_t N>
-inline typename bit_vector<N>::size_type bit_vector<N>::rank(size_type i, value_type b) const {
+template <std::size_t N, typename A>
+inline typename bit_vector<N, A>::size_type
+bit_vector<N, A>::rank(size_type i, value_type b) const {
     return access_and_rank(i, b).second;
 }
 
-template <std::size_t N>
-typename bit_vector<N>::size_type bit_vector<N>::select(size_type i, value_type b) const {
+template <std::size_t N, typename A>
+typename bit_vector<N, A>::size_type bit_vector<N, A>::select(size_type i, value_type b) const {
     size_type pos = 0;
 
     auto it = tree_.root();
@@ -348,43 +593,54 @@ typename bit_vector<N>::size_type bit_vector<N>::select(size_type i, value_type
         }
     }
 
-    for (decltype(i) j = 0, k = 0; k <= i; ++pos, ++j) {
-        if (it->bits[j] == b) { ++k; }
-    }
+    // skip whole words, then select within the word
+    bitset const word_mask(~0ULL);
+    for (size_type k = 0; ; ++k) {
+        word_type word = ((it->bits >> (k * WORD_SIZE)) & word_mask).to_ullong();
+        if (!b) {
+            auto num_bits = it->num_bits - k * WORD_SIZE;
+            word = num_bits < WORD_SIZE ? ~word & ((word_type(1) << num_bits) - 1) : ~word;
+        }
+
+        auto num_set_bits = broadword::popcount(word);
+        if (i < num_set_bits) {
+            return pos + k * WORD_SIZE + broadword::select(word, i);
+        }
 
-    return pos - 1;
+        i -= num_set_bits;
+    }
 }
 
-template <std::size_t N>
-inline typename bit_vector<N>::size_type bit_vector<N>::count() const {
+template <std::size_t N, typename A>
+inline typename bit_vector<N, A>::size_type bit_vector<N, A>::count() const {
     auto root = tree_.root();
     return root ? root->num_sub_set_bits : 0;
 }
 
-template <std::size_t N>
-inline typename bit_vector<N>::size_type bit_vector<N>::size() const {
+template <std::size_t N, typename A>
+inline typename bit_vector<N, A>::size_type bit_vector<N, A>::size() const {
     auto root = tree_.root();
     return root ? root->num_sub_bits : 0;
 }
 
-template <std::size_t N>
-inline typename bit_vector<N>::value_type bit_vector<N>::operator[](size_type i) const {
+template <std::size_t N, typename A>
+inline typename bit_vector<N, A>::value_type bit_vector<N, A>::operator[](size_type i) const {
     size_type pos = 0, rank = 0;
     auto it = find_block(i, pos, rank);
     return it->bits[i - pos];
 }
 
-template <std::size_t N>
-inline typename bit_vector<N>::bstree::iterator  // NOLINTNEXTLINE(runtime/references)
-bit_vector<N>::find_block(size_type i, size_type &pos, size_type &rank) {
+template <std::size_t N, typename A>
+inline typename bit_vector<N, A>::bstree::iterator  // NOLINTNEXTLINE(runtime/references)
+bit_vector<N, A>::find_block(size_type i, size_type &pos, size_type &rank) {
     auto const &that = *this;
     auto it = that.find_block(i, pos, rank);
     return it.unconst();
 }
 
-template <std::size_t N>
-typename bit_vector<N>::bstree::const_iterator  // NOLINTNEXTLINE(runtime/references)
-bit_vector<N>::find_block(size_type i, size_type &pos, size_type &rank) const {
+template <std::size_t N, typename A>
+typename bit_vector<N, A>::bstree::const_iterator  // NOLINTNEXTLINE(runtime/references)
+bit_vector<N, A>::find_block(size_type i, size_type &pos, size_type &rank) const {
     auto it = tree_.root();
     while (it) {
         size_type num_left_bits, num_left_set_bits;
@@ -418,17 +674,17 @@ bit_vector<N>::find_block(size_type i, size_type &pos, size_type &rank) const {
     return it;
 }
 
-template <std::size_t N>
-inline typename bit_vector<N>::bstree::const_iterator  // NOLINTNEXTLINE(runtime/references)
-bit_vector<N>::find_bit(size_type &i, size_type &pos, size_type &rank) const {
+template <std::size_t N, typename A>
+inline typename bit_vector<N, A>::bstree::const_iterator  // NOLINTNEXTLINE(runtime/references)
+bit_vector<N, A>::find_bit(size_type &i, size_type &pos, size_type &rank) const {
     auto it = find_block(i, pos, rank);
     i -= pos;
     rank += (it->bits << (MAX_BLOCK_SIZE - i - 1)).count();
     return it;
 }
 
-template <std::size_t N>  // NOLINTNEXTLINE(runtime/references)
-void bit_vector<N>::equalize_blocks(block &p, block &q) {
+template <std::size_t N, typename A>  // NOLINTNEXTLINE(runtime/references)
+void bit_vector<N, A>::equalize_blocks(block &p, block &q) {
     auto num_bits = (p.num_bits + q.num_bits) / 2;
     if (p.num_bits > q.num_bits) {
         auto offset = p.num_bits - num_bits;
@@ -449,8 +705,8 @@ void bit_vector<N>::equalize_blocks(block &p, block &q) {
     }
 }
 
-template <std::size_t N>  // NOLINTNEXTLINE(runtime/references)
-inline void bit_vector<N>::merge_blocks(block &p, block &q) {
+template <std::size_t N, typename A>  // NOLINTNEXTLINE(runtime/references)
+inline void bit_vector<N, A>::merge_blocks(block &p, block &q) {
     p.bits |= q.bits << p.num_bits;
     q.bits.reset();
 
@@ -458,26 +714,30 @@ inline void bit_vector<N>::merge_blocks(block &p, block &q) {
     q.num_bits = 0;
 }
 
-template <std::size_t N>
-inline void bit_vector<N>::update_counts(typename bstree::iterator it) {
+template <std::size_t N, typename A>
+inline void bit_vector<N, A>::update_counts(typename bstree::iterator it) {
     do {
-        it->num_sub_bits = it->num_bits;
-        it->num_sub_set_bits = it->bits.count();
+        update_node_counts(it);
+        it.go_parent();
+    } while (it);
+}
 
-        auto left = it.left();
-        if (left) {
-            it->num_sub_bits += left->num_sub_bits;
-            it->num_sub_set_bits += left->num_sub_set_bits;
-        }
+template <std::size_t N, typename A>
+inline void bit_vector<N, A>::update_node_counts(typename bstree::iterator it) {
+    it->num_sub_bits = it->num_bits;
+    it->num_sub_set_bits = it->bits.count();
 
-        auto right = it.right();
-        if (right) {
-            it->num_sub_bits += right->num_sub_bits;
-            it->num_sub_set_bits += right->num_sub_set_bits;
-        }
+    auto left = it.left();
+    if (left) {
+        it->num_sub_bits += left->num_sub_bits;
+        it->num_sub_set_bits += left->num_sub_set_bits;
+    }
 
-        it.go_parent();
-    } while (it);
+    auto right = it.right();
+    if (right) {
+        it->num_sub_bits += right->num_sub_bits;
+        it->num_sub_set_bits += right->num_sub_set_bits;
+    }
 }
 
 }  // namespace internal
@@ -0,0 +1,141 @@
+/************************************************
+ *  broadword.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_BROADWORD_HPP_
+#define DICT_INTERNAL_BROADWORD_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <bitset>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <immintrin.h>
+#define DICT_INTERNAL_BROADWORD_X86_64
+#endif
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class broadword
+ ************************************************/
+
+// Operations on single 64-bit words. select() uses PDEP/TZCNT when the CPU
+// supports BMI2 (detected at run time unless it is enabled at compile time)
+// and a branch-free broadword algorithm otherwise.
+class broadword {
+ public:  // Public Type(s)
+    using size_type = std::size_t;
+    using word_type = std::uint64_t;
+
+ public:  // Public Static Method(s)
+    static size_type popcount(word_type w);
+    static size_type select(word_type w, size_type i);
+    static size_type select_broadword(word_type w, size_type i);
+#ifdef DICT_INTERNAL_BROADWORD_X86_64
+    static size_type select_bmi2(word_type w, size_type i);
+#endif
+    static bool has_bmi2();
+    static word_type get_bits(word_type const *words, size_type pos, size_type len);
+    static void set_bits(word_type *words, size_type pos, size_type len, word_type x);
+
+ private:  // Private Static Property(ies)
+    static constexpr word_type L8 = 0x0101010101010101ULL;
+    static constexpr word_type H8 = 0x8080808080808080ULL;
+
+ private:  // Private Static Method(s)
+    static word_type leq_bytes(word_type x, word_type y);
+    static word_type nonzero_bytes(word_type x);
+};  // class broadword
+
+/************************************************
+ * Implementation: class broadword
+ ************************************************/
+
+inline broadword::size_type broadword::popcount(word_type w) {
+    return std::bitset<64>(w).count();
+}
+
+inline broadword::size_type broadword::select(word_type w, size_type i) {
+    // position of the i-th (0-based) set bit of w, which must exist
+#if defined(DICT_INTERNAL_BROADWORD_X86_64) && defined(__BMI2__)
+    return select_bmi2(w, i);
+#elif defined(DICT_INTERNAL_BROADWORD_X86_64)
+    static auto const impl = has_bmi2() ? &select_bmi2 : &select_broadword;
+    return impl(w, i);
+#else
+    return select_broadword(w, i);
+#endif
+}
+
+inline broadword::size_type broadword::select_broadword(word_type w, size_type i) {
+    // cumulative popcounts of the bytes (Vigna, 2008)
+    auto s = w - ((w >> 1) & 0x5555555555555555ULL);
+    s = (s & 0x3333333333333333ULL) + ((s >> 2) & 0x3333333333333333ULL);
+    s = ((s + (s >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * L8;
+
+    // find the byte containing the bit, then the bit within the byte
+    auto place = ((leq_bytes(s, i * L8) * L8) >> 53) & ~word_type(7);
+    auto byte_rank = i - (((s << 8) >> place) & 0xFF);
+    auto spread_bits = (((w >> place) & 0xFF) * L8) & 0x8040201008040201ULL;
+    auto bit_sums = nonzero_bytes(spread_bits) * L8;
+    return place + ((leq_bytes(bit_sums, byte_rank * L8) * L8) >> 56);
+}
+
+#ifdef DICT_INTERNAL_BROADWORD_X86_64
+__attribute__((target("bmi2")))
+inline broadword::size_type broadword::select_bmi2(word_type w, size_type i) {
+    return __builtin_ctzll(_pdep_u64(word_type(1) << i, w));
+}
+#endif
+
+inline bool broadword::has_bmi2() {
+#ifdef DICT_INTERNAL_BROADWORD_X86_64
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+}
+
+inline broadword::word_type broadword::get_bits(word_type const *words,
+                                                size_type pos, size_type len) {
+    // read len (<= 64) bits starting at pos of an array of words
+    auto k = pos / 64, r = pos % 64;
+    auto w = words[k] >> r;
+    if (r > 0 && r + len > 64) { w |= words[k + 1] << (64 - r); }
+    return len < 64 ? w & ((word_type(1) << len) - 1) : w;
+}
+
+inline void broadword::set_bits(word_type *words, size_type pos, size_type len, word_type x) {
+    // write the low len (<= 64) bits of x starting at pos of an array of words
+    auto k = pos / 64, r = pos % 64;
+    auto mask = len < 64 ? (word_type(1) << len) - 1 : ~word_type(0);
+    x &= mask;
+    words[k] = (words[k] & ~(mask << r)) | (x << r);
+    if (r > 0 && r + len > 64) {
+        words[k + 1] = (words[k + 1] & ~(mask >> (64 - r))) | (x >> (64 - r));
+    }
+}
+
+inline broadword::word_type broadword::leq_bytes(word_type x, word_type y) {
+    // 1 in each byte where the byte of x is not greater than that of y
+    return (((((y | H8) - (x & ~H8)) | (x ^ y)) ^ (x & ~y)) & H8) >> 7;
+}
+
+inline broadword::word_type broadword::nonzero_bytes(word_type x) {
+    // 1 in each non-zero byte of x
+    return ((((x | H8) - L8) | x) & H8) >> 7;
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_BROADWORD_HPP_
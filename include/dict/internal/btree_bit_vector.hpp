@@ -0,0 +1,850 @@
+/************************************************
+ *  btree_bit_vector.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_BTREE_BIT_VECTOR_HPP_
+#define DICT_INTERNAL_BTREE_BIT_VECTOR_HPP_
+
+#include <cassert>
+#include <cstdint>
+
+#include <array>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "broadword.hpp"
+#include "serialization.hpp"
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class btree_bit_vector<L, F>
+ ************************************************/
+
+// A dynamic bit vector with the same interface as bit_vector<N>, stored in
+// a B+-tree whose leaves hold up to LeafBits bits and whose internal nodes
+// keep prefix sums of bits and set bits over up to Fanout children. Its
+// nodes are allocated with new, so it only takes the stateless
+// std::allocator that bit_vector<N> uses by default.
+template <std::size_t LeafBits = 1024, std::size_t Fanout = 16>
+class btree_bit_vector {
+ public:  // Public Type(s)
+    using size_type = std::size_t;
+    using value_type = bool;
+    using allocator_type = std::allocator<bool>;
+
+ public:  // Public Method(s)
+    explicit btree_bit_vector(allocator_type const &alloc = allocator_type());
+
+    allocator_type get_allocator() const;
+    void swap(btree_bit_vector &other);  // NOLINT(runtime/references)
+
+    btree_bit_vector &set(size_type i, value_type b = true);
+    btree_bit_vector &reset(size_type i);
+    size_type insert(size_type i, value_type b);
+    value_type erase(size_type i);
+
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+    void assign_words(std::vector<std::uint64_t> const &words, size_type n);
+    std::vector<std::uint64_t> words() const;
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
+    std::pair<value_type, size_type> access_and_rank(size_type i) const;
+    std::pair<value_type, size_type> access_and_rank(size_type i, value_type b) const;
+    size_type rank(size_type i, value_type b) const;
+    size_type select(size_type i, value_type b) const;
+    size_type count() const;
+    size_type size() const;
+
+    value_type operator[](size_type i) const;
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type WORD_SIZE = 64;
+    static constexpr size_type NUM_LEAF_WORDS = LeafBits / WORD_SIZE;
+    static constexpr size_type MIN_LEAF_BITS = LeafBits / 4;
+    static constexpr size_type MAX_MERGE_BITS = LeafBits - LeafBits / 8;
+    static constexpr size_type MIN_CHILDREN = Fanout / 4 < 2 ? 2 : Fanout / 4;
+
+    static_assert(LeafBits % WORD_SIZE == 0 && LeafBits >= 4 * WORD_SIZE,
+                  "LeafBits must be a multiple of 64 and at least 256");
+    static_assert(Fanout >= 4, "Fanout must be at least 4");
+
+ private:  // Private Type(s)
+    using word_type = std::uint64_t;
+
+    struct node;
+    struct leaf;
+    struct inner;
+    struct node_deleter;
+    using node_ptr = std::unique_ptr<node, node_deleter>;
+
+ private:  // Private Static Method(s)
+    static node_ptr insert_at(node *p, size_type i, value_type b,
+                              size_type &rank);  // NOLINT(runtime/references)
+    static value_type erase_at(node *p, size_type i);
+    static bool set_at(node *p, size_type i, value_type b);
+    static void rebalance(inner *p, size_type k);
+
+    static size_type find_child(inner const *p, size_type i);
+    static std::pair<size_type, size_type> counts(node const *p);
+    static void insert_child(inner *p, size_type k, node_ptr &&child);
+    static void erase_child(inner *p, size_type k);
+    static void update_prefix_sums(inner *p, size_type k);
+    static void add_to_prefix_sums(inner *p, size_type k,
+                                   size_type num_bits, size_type num_set_bits);
+    static void sub_from_prefix_sums(inner *p, size_type k,
+                                     size_type num_bits, size_type num_set_bits);
+
+    static node_ptr split_leaf(leaf *p);
+    static node_ptr split_inner(inner *p);
+    static void merge_or_equalize_leaves(leaf *p, leaf *q);
+    static void merge_or_equalize_inners(inner *p, inner *q);
+
+    static word_type get_bits(leaf const *p, size_type pos, size_type len);
+    static void append_bits(leaf *p, leaf const *q, size_type from, size_type len);
+    static void truncate_bits(leaf *p, size_type len);
+    static void insert_bit(leaf *p, size_type i, value_type b);
+    static value_type erase_bit(leaf *p, size_type i);
+    static size_type count_bits(leaf const *p, size_type len);
+    // NOLINTNEXTLINE(runtime/references)
+    static void copy_words(node const *p, word_type *words, size_type &pos);
+
+ private:  // Private Method(s)
+    // NOLINTNEXTLINE(runtime/references)
+    leaf const *find_leaf(size_type &i, size_type &rank) const;
+
+ private:  // Private Property(ies)
+    node_ptr root_;
+    size_type size_;
+    size_type num_set_bits_;
+};  // class btree_bit_vector<L, F>
+
+/************************************************
+ * Declaration: struct btree_bit_vector<L, F>::node
+ ************************************************/
+
+template <std::size_t L, std::size_t F>
+struct btree_bit_vector<L, F>::node {
+    explicit node(bool is_leaf) : is_leaf(is_leaf) {
+        // do nothing
+    }
+
+    bool is_leaf;
+};  // struct btree_bit_vector<L, F>::node
+
+/************************************************
+ * Declaration: struct btree_bit_vector<L, F>::leaf
+ ************************************************/
+
+template <std::size_t L, std::size_t F>
+struct btree_bit_vector<L, F>::leaf : node {
+    leaf() : node(true), num_bits(0), words() {
+        // do nothing
+    }
+
+    size_type num_bits;
+    std::array<word_type, NUM_LEAF_WORDS> words;
+};  // struct btree_bit_vector<L, F>::leaf
+
+/************************************************
+ * Declaration: struct btree_bit_vector<L, F>::inner
+ ************************************************/
+
+template <std::size_t L, std::size_t F>
+struct btree_bit_vector<L, F>::inner : node {
+    inner() : node(false), num_children(0) {
+        // do nothing
+    }
+
+    // one extra slot lets a node overflow before it is split
+    size_type num_children;
+    std::array<size_type, F + 1> num_bits;
+    std::array<size_type, F + 1> num_set_bits;
+    std::array<node_ptr, F + 1> children;
+};  // struct btree_bit_vector<L, F>::inner
+
+/************************************************
+ * Declaration: struct btree_bit_vector<L, F>::node_deleter
+ ************************************************/
+
+template <std::size_t L, std::size_t F>
+struct btree_bit_vector<L, F>::node_deleter {
+    void operator()(node *p) const {
+        if (p->is_leaf) {
+            delete static_cast<leaf *>(p);
+        } else {
+            delete static_cast<inner *>(p);
+        }
+    }
+};  // struct btree_bit_vector<L, F>::node_deleter
+
+/************************************************
+ * Implementation: class btree_bit_vector<L, F>
+ ************************************************/
+
+template <std::size_t L, std::size_t F>
+inline btree_bit_vector<L, F>::btree_bit_vector(allocator_type const &)
+    : root_(new leaf()), size_(0), num_set_bits_(0) {
+    // do nothing
+}
+
+template <std::size_t L, std::size_t F>
+inline typename btree_bit_vector<L, F>::allocator_type
+btree_bit_vector<L, F>::get_allocator() const {
+    return allocator_type();
+}
+
+template <std::size_t L, std::size_t F>
+inline void btree_bit_vector<L, F>::swap(btree_bit_vector &other) {  // NOLINT(runtime/references)
+    root_.swap(other.root_);
+    std::swap(size_, other.size_);
+    std::swap(num_set_bits_, other.num_set_bits_);
+}
+
+template <std::size_t L, std::size_t F>
+inline btree_bit_vector<L, F> &btree_bit_vector<L, F>::set(size_type i, value_type b) {
+    if (set_at(root_.get(), i, b)) {
+        if (b) {
+            ++num_set_bits_;
+        } else {
+            --num_set_bits_;
+        }
+    }
+
+    return *this;
+}
+
+template <std::size_t L, std::size_t F>
+inline btree_bit_vector<L, F> &btree_bit_vector<L, F>::reset(size_type i) {
+    return set(i, false);
+}
+
+template <std::size_t L, std::size_t F>
+typename btree_bit_vector<L, F>::size_type
+btree_bit_vector<L, F>::insert(size_type i, value_type b) {
+    assert(i <= size_);
+
+    size_type rank = 0;
+    auto sibling = insert_at(root_.get(), i, b, rank);
+    if (sibling) {
+        node_ptr new_root(new inner());
+        auto p = static_cast<inner *>(new_root.get());
+        p->children[0] = std::move(root_);
+        p->num_children = 1;
+        update_prefix_sums(p, 0);
+        insert_child(p, 1, std::move(sibling));
+        root_ = std::move(new_root);
+    }
+
+    ++size_;
+    num_set_bits_ += b;
+    return b ? rank + 1 : i - rank + 1;
+}
+
+template <std::size_t L, std::size_t F>
+typename btree_bit_vector<L, F>::value_type btree_bit_vector<L, F>::erase(size_type i) {
+    assert(i < size_);
+
+    auto b = erase_at(root_.get(), i);
+    while (!root_->is_leaf && static_cast<inner *>(root_.get())->num_children == 1) {
+        auto child = std::move(static_cast<inner *>(root_.get())->children[0]);
+        root_ = std::move(child);
+    }
+
+    --size_;
+    num_set_bits_ -= b;
+    return b;
+}
+
+template <std::size_t L, std::size_t F>
+template <typename InputIterator>
+void btree_bit_vector<L, F>::assign(InputIterator first, InputIterator last) {
+    std::vector<word_type> words;
+    size_type n = 0;
+    for (; first != last; ++first, ++n) {
+        if (n % WORD_SIZE == 0) { words.push_back(0); }
+        words.back() |= word_type(*first ? 1 : 0) << (n % WORD_SIZE);
+    }
+
+    assign_words(words, n);
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::assign_words(std::vector<std::uint64_t> const &words, size_type n) {
+    assert(n <= words.size() * WORD_SIZE);
+
+    // spread the bits evenly over leaves that still have some room
+    std::vector<node_ptr> level;
+    auto num_leaves = (n + MAX_MERGE_BITS - 1) / MAX_MERGE_BITS;
+    for (size_type k = 0, pos = 0; k < num_leaves; ++k) {
+        auto end = (k + 1) * n / num_leaves;
+        auto p = new leaf();
+        level.emplace_back(p);
+        p->num_bits = end - pos;
+        for (size_type i = 0; i < p->num_bits; i += WORD_SIZE) {
+            auto len = p->num_bits - i < WORD_SIZE ? p->num_bits - i : WORD_SIZE;
+            p->words[i / WORD_SIZE] = broadword::get_bits(words.data(), pos + i, len);
+        }
+
+        pos = end;
+    }
+
+    while (level.size() > 1) {
+        std::vector<node_ptr> parents;
+        auto num_parents = (level.size() + F - 1) / F;
+        for (size_type k = 0, pos = 0; k < num_parents; ++k) {
+            auto end = (k + 1) * level.size() / num_parents;
+            auto p = new inner();
+            parents.emplace_back(p);
+            for (; pos < end; ++pos) {
+                p->children[p->num_children++] = std::move(level[pos]);
+                update_prefix_sums(p, p->num_children - 1);
+            }
+        }
+
+        level.swap(parents);
+    }
+
+    root_ = level.empty() ? node_ptr(new leaf()) : std::move(level[0]);
+    size_ = n;
+    num_set_bits_ = counts(root_.get()).second;
+}
+
+template <std::size_t L, std::size_t F>
+std::vector<std::uint64_t> btree_bit_vector<L, F>::words() const {
+    // the bits packed as assign_words() takes them
+    std::vector<std::uint64_t> words((size_ + WORD_SIZE - 1) / WORD_SIZE);
+    size_type pos = 0;
+    if (root_) { copy_words(root_.get(), words.data(), pos); }
+    return words;
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    write_value<std::uint64_t>(os, size_);
+    for (size_type i = 0; i < size_; i += WORD_SIZE) {
+        word_type word = 0;
+        for (size_type j = 0; j < WORD_SIZE && i + j < size_; ++j) {
+            if ((*this)[i + j]) { word |= word_type(1) << j; }
+        }
+
+        write_value<word_type>(os, word);
+    }
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::load(std::istream &is) {  // NOLINT(runtime/references)
+    auto n = read_value<std::uint64_t>(is);
+    check_remaining(is, n / WORD_SIZE + (n % WORD_SIZE != 0), sizeof(word_type));
+
+    std::vector<bool> bits(n);
+    for (size_type i = 0; i < n; i += WORD_SIZE) {
+        auto word = read_value<word_type>(is);
+        for (size_type j = 0; j < WORD_SIZE && i + j < n; ++j) {
+            bits[i + j] = (word >> j) & 1;
+        }
+    }
+
+    assign(bits.begin(), bits.end());
+}
+
+template <std::size_t L, std::size_t F>
+inline std::pair<
+    typename btree_bit_vector<L, F>::value_type,
+    typename btree_bit_vector<L, F>::size_type
+>
+btree_bit_vector<L, F>::access_and_rank(size_type i) const {
+    auto k = i;
+    size_type rank = 0;
+    auto p = find_leaf(i, rank);
+    rank += count_bits(p, i + 1);
+
+    auto b = static_cast<value_type>((p->words[i / WORD_SIZE] >> (i % WORD_SIZE)) & 1);
+    return std::make_pair(b, b ? rank : k + 1 - rank);
+}
+
+template <std::size_t L, std::size_t F>
+inline std::pair<
+    typename btree_bit_vector<L, F>::value_type,
+    typename btree_bit_vector<L, F>::size_type
+>
+btree_bit_vector<L, F>::access_and_rank(size_type i, value_type b) const {
+    auto k = i;
+    size_type rank = 0;
+    auto p = find_leaf(i, rank);
+    rank += count_bits(p, i + 1);
+
+    auto c = static_cast<value_type>((p->words[i / WORD_SIZE] >> (i % WORD_SIZE)) & 1);
+    return std::make_pair(c, b ? rank : k + 1 - rank);
+}
+
+template <std::size_t L, std::size_t F>
+inline typename btree_bit_vector<L, F>::size_type
+btree_bit_vector<L, F>::rank(size_type i, value_type b) const {
+    return access_and_rank(i, b).second;
+}
+
+template <std::size_t L, std::size_t F>
+typename btree_bit_vector<L, F>::size_type
+btree_bit_vector<L, F>::select(size_type i, value_type b) const {
+    size_type pos = 0;
+    auto p = root_.get();
+    while (!p->is_leaf) {
+        auto q = static_cast<inner const *>(p);
+
+        // scan the prefix sums for the first child past the i-th bit
+        size_type k = 0;
+        while (k + 1 < q->num_children &&
+                (b ? q->num_set_bits[k] : q->num_bits[k] - q->num_set_bits[k]) <= i) {
+            ++k;
+        }
+
+        if (k > 0) {
+            pos += q->num_bits[k - 1];
+            i -= b ? q->num_set_bits[k - 1] : q->num_bits[k - 1] - q->num_set_bits[k - 1];
+        }
+
+        p = q->children[k].get();
+    }
+
+    auto q = static_cast<leaf const *>(p);
+    for (size_type k = 0; ; ++k) {
+        auto word = b ? q->words[k] : ~q->words[k];
+        auto num_bits = q->num_bits - k * WORD_SIZE;
+        if (!b && num_bits < WORD_SIZE) { word &= (word_type(1) << num_bits) - 1; }
+
+        auto c = broadword::popcount(word);
+        if (i < c) { return pos + k * WORD_SIZE + broadword::select(word, i); }
+
+        i -= c;
+    }
+}
+
+template <std::size_t L, std::size_t F>
+inline typename btree_bit_vector<L, F>::size_type btree_bit_vector<L, F>::count() const {
+    return num_set_bits_;
+}
+
+template <std::size_t L, std::size_t F>
+inline typename btree_bit_vector<L, F>::size_type btree_bit_vector<L, F>::size() const {
+    return size_;
+}
+
+template <std::size_t L, std::size_t F>
+inline typename btree_bit_vector<L, F>::value_type
+btree_bit_vector<L, F>::operator[](size_type i) const {
+    size_type rank = 0;
+    auto p = find_leaf(i, rank);
+    return (p->words[i / WORD_SIZE] >> (i % WORD_SIZE)) & 1;
+}
+
+template <std::size_t L, std::size_t F>
+typename btree_bit_vector<L, F>::node_ptr btree_bit_vector<L, F>::insert_at(
+        node *p, size_type i, value_type b, size_type &rank) {  // NOLINT(runtime/references)
+    if (p->is_leaf) {
+        auto q = static_cast<leaf *>(p);
+        rank += count_bits(q, i);
+
+        node_ptr sibling;
+        if (q->num_bits == L) {
+            sibling = split_leaf(q);
+            if (i > q->num_bits) {
+                i -= q->num_bits;
+                q = static_cast<leaf *>(sibling.get());
+            }
+        }
+
+        insert_bit(q, i, b);
+        return sibling;
+    }
+
+    auto q = static_cast<inner *>(p);
+    auto k = find_child(q, i);
+    if (k > 0) {
+        i -= q->num_bits[k - 1];
+        rank += q->num_set_bits[k - 1];
+    }
+
+    auto child_sibling = insert_at(q->children[k].get(), i, b, rank);
+    add_to_prefix_sums(q, k, 1, b);
+    if (!child_sibling) { return nullptr; }
+
+    insert_child(q, k + 1, std::move(child_sibling));
+    return q->num_children > F ? split_inner(q) : nullptr;
+}
+
+template <std::size_t L, std::size_t F>
+typename btree_bit_vector<L, F>::value_type
+btree_bit_vector<L, F>::erase_at(node *p, size_type i) {
+    if (p->is_leaf) {
+        return erase_bit(static_cast<leaf *>(p), i);
+    }
+
+    auto q = static_cast<inner *>(p);
+    auto k = find_child(q, i);
+    if (k > 0) { i -= q->num_bits[k - 1]; }
+
+    auto child = q->children[k].get();
+    auto b = erase_at(child, i);
+    sub_from_prefix_sums(q, k, 1, b);
+
+    auto is_underfull = child->is_leaf
+        ? static_cast<leaf *>(child)->num_bits < MIN_LEAF_BITS
+        : static_cast<inner *>(child)->num_children < MIN_CHILDREN;
+    if (is_underfull && q->num_children > 1) { rebalance(q, k); }
+
+    return b;
+}
+
+template <std::size_t L, std::size_t F>
+bool btree_bit_vector<L, F>::set_at(node *p, size_type i, value_type b) {
+    if (p->is_leaf) {
+        auto q = static_cast<leaf *>(p);
+        auto &word = q->words[i / WORD_SIZE];
+        auto mask = word_type(1) << (i % WORD_SIZE);
+        if (static_cast<value_type>(word & mask) == b) { return false; }
+
+        word ^= mask;
+        return true;
+    }
+
+    auto q = static_cast<inner *>(p);
+    auto k = find_child(q, i);
+    if (k > 0) { i -= q->num_bits[k - 1]; }
+    if (!set_at(q->children[k].get(), i, b)) { return false; }
+
+    if (b) {
+        add_to_prefix_sums(q, k, 0, 1);
+    } else {
+        sub_from_prefix_sums(q, k, 0, 1);
+    }
+
+    return true;
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::rebalance(inner *p, size_type k) {
+    // fix the k-th child together with one of its neighbours
+    auto l = k > 0 ? k - 1 : k;
+    auto left = p->children[l].get();
+    auto right = p->children[l + 1].get();
+    if (left->is_leaf) {
+        merge_or_equalize_leaves(static_cast<leaf *>(left), static_cast<leaf *>(right));
+        if (static_cast<leaf *>(right)->num_bits == 0) {
+            erase_child(p, l + 1);
+        } else {
+            update_prefix_sums(p, l);
+        }
+    } else {
+        merge_or_equalize_inners(static_cast<inner *>(left), static_cast<inner *>(right));
+        if (static_cast<inner *>(right)->num_children == 0) {
+            erase_child(p, l + 1);
+        } else {
+            update_prefix_sums(p, l);
+        }
+    }
+}
+
+template <std::size_t L, std::size_t F>
+inline typename btree_bit_vector<L, F>::size_type
+btree_bit_vector<L, F>::find_child(inner const *p, size_type i) {
+    // positions past the end belong to the last child
+    size_type k = 0;
+    while (k + 1 < p->num_children && p->num_bits[k] <= i) { ++k; }
+    return k;
+}
+
+template <std::size_t L, std::size_t F>
+inline std::pair<
+    typename btree_bit_vector<L, F>::size_type,
+    typename btree_bit_vector<L, F>::size_type
+>
+btree_bit_vector<L, F>::counts(node const *p) {
+    if (p->is_leaf) {
+        auto q = static_cast<leaf const *>(p);
+        return std::make_pair(q->num_bits, count_bits(q, q->num_bits));
+    }
+
+    auto q = static_cast<inner const *>(p);
+    return q->num_children > 0
+        ? std::make_pair(q->num_bits[q->num_children - 1], q->num_set_bits[q->num_children - 1])
+        : std::make_pair(size_type(0), size_type(0));
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::insert_child(inner *p, size_type k, node_ptr &&child) {
+    for (auto j = p->num_children; j > k; --j) {
+        p->children[j] = std::move(p->children[j - 1]);
+        p->num_bits[j] = p->num_bits[j - 1];
+        p->num_set_bits[j] = p->num_set_bits[j - 1];
+    }
+
+    p->children[k] = std::move(child);
+    ++p->num_children;
+
+    // the k-th child is cut from the (k - 1)-th one, so later sums stay
+    update_prefix_sums(p, k - 1);
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::erase_child(inner *p, size_type k) {
+    for (auto j = k; j + 1 < p->num_children; ++j) {
+        p->children[j] = std::move(p->children[j + 1]);
+        p->num_bits[j] = p->num_bits[j + 1];
+        p->num_set_bits[j] = p->num_set_bits[j + 1];
+    }
+
+    p->children[--p->num_children].reset();
+    if (k > 0) { update_prefix_sums(p, k - 1); }
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::update_prefix_sums(inner *p, size_type k) {
+    // recompute the sums of the k-th child and the next one (if any) from
+    // the sums preceding them
+    for (auto j = k; j < k + 2 && j < p->num_children; ++j) {
+        auto c = counts(p->children[j].get());
+        p->num_bits[j] = (j > 0 ? p->num_bits[j - 1] : 0) + c.first;
+        p->num_set_bits[j] = (j > 0 ? p->num_set_bits[j - 1] : 0) + c.second;
+    }
+}
+
+template <std::size_t L, std::size_t F>
+inline void btree_bit_vector<L, F>::add_to_prefix_sums(
+        inner *p, size_type k, size_type num_bits, size_type num_set_bits) {
+    for (auto j = k; j < p->num_children; ++j) {
+        p->num_bits[j] += num_bits;
+        p->num_set_bits[j] += num_set_bits;
+    }
+}
+
+template <std::size_t L, std::size_t F>
+inline void btree_bit_vector<L, F>::sub_from_prefix_sums(
+        inner *p, size_type k, size_type num_bits, size_type num_set_bits) {
+    for (auto j = k; j < p->num_children; ++j) {
+        p->num_bits[j] -= num_bits;
+        p->num_set_bits[j] -= num_set_bits;
+    }
+}
+
+template <std::size_t L, std::size_t F>
+typename btree_bit_vector<L, F>::node_ptr btree_bit_vector<L, F>::split_leaf(leaf *p) {
+    // split at a word boundary so that both halves are copied word by word
+    auto mid = p->num_bits / 2 / WORD_SIZE * WORD_SIZE;
+    auto q = new leaf();
+    append_bits(q, p, mid, p->num_bits - mid);
+    truncate_bits(p, mid);
+    return node_ptr(q);
+}
+
+template <std::size_t L, std::size_t F>
+typename btree_bit_vector<L, F>::node_ptr btree_bit_vector<L, F>::split_inner(inner *p) {
+    auto mid = p->num_children / 2;
+    auto q = new inner();
+    for (auto j = mid; j < p->num_children; ++j) {
+        q->children[q->num_children] = std::move(p->children[j]);
+        q->num_bits[q->num_children] = p->num_bits[j] - p->num_bits[mid - 1];
+        q->num_set_bits[q->num_children] = p->num_set_bits[j] - p->num_set_bits[mid - 1];
+        ++q->num_children;
+    }
+
+    p->num_children = mid;
+    return node_ptr(q);
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::merge_or_equalize_leaves(leaf *p, leaf *q) {
+    auto total = p->num_bits + q->num_bits;
+    if (total <= MAX_MERGE_BITS) {
+        append_bits(p, q, 0, q->num_bits);
+        truncate_bits(q, 0);
+        return;
+    }
+
+    auto mid = total / 2;
+    leaf tmp;
+    if (p->num_bits > mid) {
+        append_bits(&tmp, p, mid, p->num_bits - mid);
+        append_bits(&tmp, q, 0, q->num_bits);
+        truncate_bits(p, mid);
+    } else {
+        auto offset = mid - p->num_bits;
+        append_bits(p, q, 0, offset);
+        append_bits(&tmp, q, offset, q->num_bits - offset);
+    }
+
+    *q = tmp;
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::merge_or_equalize_inners(inner *p, inner *q) {
+    auto total = p->num_children + q->num_children;
+    auto mid = total <= F ? total : total / 2;
+    if (p->num_children < mid) {
+        // move the first children of q to the end of p
+        auto offset = mid - p->num_children;
+        for (size_type j = 0; j < offset; ++j) {
+            p->children[p->num_children++] = std::move(q->children[j]);
+            update_prefix_sums(p, p->num_children - 1);
+        }
+
+        for (size_type j = offset; j < q->num_children; ++j) {
+            q->children[j - offset] = std::move(q->children[j]);
+        }
+
+        q->num_children -= offset;
+    } else {
+        // move the last children of p to the front of q
+        auto offset = p->num_children - mid;
+        for (auto j = q->num_children; j > 0; --j) {
+            q->children[j - 1 + offset] = std::move(q->children[j - 1]);
+        }
+
+        for (size_type j = 0; j < offset; ++j) {
+            q->children[j] = std::move(p->children[mid + j]);
+        }
+
+        q->num_children += offset;
+        p->num_children = mid;
+    }
+
+    for (size_type j = 0; j < q->num_children; j += 2) {
+        update_prefix_sums(q, j);
+    }
+}
+
+template <std::size_t L, std::size_t F>
+// NOLINTNEXTLINE(runtime/references)
+void btree_bit_vector<L, F>::copy_words(node const *p, word_type *words, size_type &pos) {
+    if (!p->is_leaf) {
+        auto q = static_cast<inner const *>(p);
+        for (size_type k = 0; k < q->num_children; ++k) {
+            copy_words(q->children[k].get(), words, pos);
+        }
+
+        return;
+    }
+
+    auto q = static_cast<leaf const *>(p);
+    for (size_type i = 0; i < q->num_bits; i += WORD_SIZE) {
+        auto len = q->num_bits - i < WORD_SIZE ? q->num_bits - i : WORD_SIZE;
+        broadword::set_bits(words, pos + i, len, q->words[i / WORD_SIZE]);
+    }
+
+    pos += q->num_bits;
+}
+
+template <std::size_t L, std::size_t F>
+inline typename btree_bit_vector<L, F>::word_type
+btree_bit_vector<L, F>::get_bits(leaf const *p, size_type pos, size_type len) {
+    return broadword::get_bits(p->words.data(), pos, len);
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::append_bits(leaf *p, leaf const *q, size_type from, size_type len) {
+    for (size_type i = 0; i < len; i += WORD_SIZE) {
+        auto n = len - i < WORD_SIZE ? len - i : WORD_SIZE;
+        auto word = get_bits(q, from + i, n);
+
+        auto k = p->num_bits / WORD_SIZE, r = p->num_bits % WORD_SIZE;
+        p->words[k] |= word << r;
+        if (r > 0 && r + n > WORD_SIZE) { p->words[k + 1] |= word >> (WORD_SIZE - r); }
+        p->num_bits += n;
+    }
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::truncate_bits(leaf *p, size_type len) {
+    // bits past the end are kept cleared
+    auto k = len / WORD_SIZE, r = len % WORD_SIZE;
+    if (r > 0) { p->words[k++] &= (word_type(1) << r) - 1; }
+    for (; k < NUM_LEAF_WORDS; ++k) {
+        p->words[k] = 0;
+    }
+
+    p->num_bits = len;
+}
+
+template <std::size_t L, std::size_t F>
+void btree_bit_vector<L, F>::insert_bit(leaf *p, size_type i, value_type b) {
+    auto k = i / WORD_SIZE, r = i % WORD_SIZE;
+    for (auto j = p->num_bits / WORD_SIZE; j > k; --j) {
+        p->words[j] = (p->words[j] << 1) | (p->words[j - 1] >> (WORD_SIZE - 1));
+    }
+
+    auto low_mask = (word_type(1) << r) - 1;
+    auto word = p->words[k];
+    p->words[k] = (word & low_mask) | ((word & ~low_mask) << 1) | (word_type(b) << r);
+    ++p->num_bits;
+}
+
+template <std::size_t L, std::size_t F>
+typename btree_bit_vector<L, F>::value_type
+btree_bit_vector<L, F>::erase_bit(leaf *p, size_type i) {
+    auto k = i / WORD_SIZE, r = i % WORD_SIZE;
+    auto last = (p->num_bits - 1) / WORD_SIZE;
+
+    auto low_mask = (word_type(1) << r) - 1;
+    auto word = p->words[k];
+    auto b = static_cast<value_type>((word >> r) & 1);
+    p->words[k] = (word & low_mask) | ((word >> 1) & ~low_mask);
+    for (auto j = k; j < last; ++j) {
+        p->words[j] |= p->words[j + 1] << (WORD_SIZE - 1);
+        p->words[j + 1] >>= 1;
+    }
+
+    --p->num_bits;
+    return b;
+}
+
+template <std::size_t L, std::size_t F>
+inline typename btree_bit_vector<L, F>::size_type
+btree_bit_vector<L, F>::count_bits(leaf const *p, size_type len) {
+    // number of set bits in [0, len)
+    size_type n = 0;
+    auto k = len / WORD_SIZE;
+    for (size_type j = 0; j < k; ++j) {
+        n += broadword::popcount(p->words[j]);
+    }
+
+    auto r = len % WORD_SIZE;
+    if (r > 0) { n += broadword::popcount(p->words[k] & ((word_type(1) << r) - 1)); }
+    return n;
+}
+
+template <std::size_t L, std::size_t F>
+typename btree_bit_vector<L, F>::leaf const *  // NOLINTNEXTLINE(runtime/references)
+btree_bit_vector<L, F>::find_leaf(size_type &i, size_type &rank) const {
+    auto p = root_.get();
+    while (!p->is_leaf) {
+        auto q = static_cast<inner const *>(p);
+        auto k = find_child(q, i);
+        if (k > 0) {
+            i -= q->num_bits[k - 1];
+            rank += q->num_set_bits[k - 1];
+        }
+
+        p = q->children[k].get();
+    }
+
+    return static_cast<leaf const *>(p);
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_BTREE_BIT_VECTOR_HPP_
@@ -9,6 +9,11 @@
 #ifndef DICT_INTERNAL_CHAINED_UPDATER_HPP_
 #define DICT_INTERNAL_CHAINED_UPDATER_HPP_
 
+#include <cstdint>
+
+#include <istream>
+#include <ostream>
+
 namespace dict {
 
 namespace internal {
@@ -40,6 +45,13 @@ class chained_updater<UpdaterArgs, FirstUpdater, RestUpdaters...>
     template <typename Event>
     void update(Event const &info);
 
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+    void swap(chained_updater &other);  // NOLINT(runtime/references)
+
+ protected:  // Protected Static Method(s)
+    static std::uint64_t tag();
+
  private:  // Private Type(s)
     using first_updater = typename UpdaterArgs::template apply<FirstUpdater>;
     using rest_updaters = chained_updater<UpdaterArgs, RestUpdaters...>;
@@ -58,6 +70,13 @@ class chained_updater<UpdaterArgs> {
  protected:  // Protected Method(s)
     template <typename Event>
     void update(Event const &info);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+    void swap(chained_updater &other);  // NOLINT(runtime/references)
+
+ protected:  // Protected Static Method(s)
+    static std::uint64_t tag();
 };  // class chained_updater<T>
 
 /************************************************
@@ -86,13 +105,53 @@ inline void chained_updater<UpdaterArgs, U, Us...>::update(Event const &info) {
     rest_updaters::update(info);
 }
 
+template <
+    typename UpdaterArgs,
+    template <typename...> class U,
+    template <typename...> class... Us
+>  // NOLINTNEXTLINE(runtime/references)
+inline void chained_updater<UpdaterArgs, U, Us...>::save(std::ostream &os) const {
+    first_updater::save(os);
+    rest_updaters::save(os);
+}
+
+template <
+    typename UpdaterArgs,
+    template <typename...> class U,
+    template <typename...> class... Us
+>  // NOLINTNEXTLINE(runtime/references)
+inline void chained_updater<UpdaterArgs, U, Us...>::load(std::istream &is) {
+    first_updater::load(is);
+    rest_updaters::load(is);
+}
+
+template <
+    typename UpdaterArgs,
+    template <typename...> class U,
+    template <typename...> class... Us
+>  // NOLINTNEXTLINE(runtime/references)
+inline void chained_updater<UpdaterArgs, U, Us...>::swap(chained_updater &other) {
+    first_updater::swap(other);
+    rest_updaters::swap(other);
+}
+
+template <
+    typename UpdaterArgs,
+    template <typename...> class U,
+    template <typename...> class... Us
+>
+inline std::uint64_t chained_updater<UpdaterArgs, U, Us...>::tag() {
+    // the tags are folded in order as FNV-1a folds bytes
+    return (rest_updaters::tag() ^ first_updater::tag()) * 0x100000001B3;
+}
+
 /************************************************
  * Implementation: class chained_updater<T>
  ************************************************/
 
 template <typename UpdaterArgs>
 template <typename... Args>
-inline chained_updater<UpdaterArgs>::chained_updater(Args const &... args) {
+inline chained_updater<UpdaterArgs>::chained_updater(Args const &...) {
     // do nothing
 }
 
@@ -102,6 +161,26 @@ inline void chained_updater<UpdaterArgs>::update(Event const &) {
     // do nothing
 }
 
+template <typename UpdaterArgs>  // NOLINTNEXTLINE(runtime/references)
+inline void chained_updater<UpdaterArgs>::save(std::ostream &) const {
+    // do nothing
+}
+
+template <typename UpdaterArgs>  // NOLINTNEXTLINE(runtime/references)
+inline void chained_updater<UpdaterArgs>::load(std::istream &) {
+    // do nothing
+}
+
+template <typename UpdaterArgs>  // NOLINTNEXTLINE(runtime/references)
+inline void chained_updater<UpdaterArgs>::swap(chained_updater &) {
+    // do nothing
+}
+
+template <typename UpdaterArgs>
+inline std::uint64_t chained_updater<UpdaterArgs>::tag() {
+    return 0xCBF29CE484222325;
+}
+
 }  // namespace internal
 
 }  // namespace dict
@@ -0,0 +1,301 @@
+/************************************************
+ *  csa_base.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_CSA_BASE_HPP_
+#define DICT_INTERNAL_CSA_BASE_HPP_
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bit_vector.hpp"
+#include "permutation.hpp"
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class csa_base<P, T>
+ ************************************************/
+
+// The sampled suffix array shared by with_csa and with_text_order_csa: the
+// sampled rows (sa_samples_) and text positions (isa_samples_), the
+// permutation between their ranks (pi_) and the ends of the sequences.
+// Policy decides which positions are sampled and resolves the value of a
+// sampled row by sampled_value(i, off); it may also count the positions
+// reported by locate() by count_locate(j), which at() and rank() skip as the
+// library calls them internally.
+template <typename Policy, typename Trait>
+class csa_base {
+ public:  // Public Type(s)
+    using size_type = typename Trait::size_type;
+    using value_type = typename Trait::size_type;
+    using term_type = typename Trait::term_type;
+    using allocator_type = typename Trait::allocator_type;
+
+ public:  // Public Method(s)
+    value_type at(size_type i) const;
+    size_type rank(value_type j) const;
+    term_type term(value_type j) const;
+
+    template <typename Sequence, typename OutputIterator>
+    OutputIterator locate(Sequence const &s, OutputIterator it) const;
+    template <typename OutputIterator>
+    OutputIterator extract(size_type k, size_type from, size_type len, OutputIterator it) const;
+
+    size_type sample_distance() const;
+
+    value_type operator[](size_type i) const;
+
+ protected:  // Protected Type(s)
+    using helper = typename Trait::helper;
+
+ protected:  // Protected Static Property(ies)
+    static constexpr size_type DEFAULT_SAMPLE_DISTANCE = 100;
+    static constexpr size_type BIT_BLOCK_SIZE = 64;
+
+ protected:  // Protected Method(s)
+    explicit csa_base(allocator_type const &alloc);
+
+    void swap(csa_base &other);  // NOLINT(runtime/references)
+
+    value_type walk_to_sample(size_type i, size_type off) const;
+    void locate_rows(size_type first, size_type last, value_type *out) const;
+    void count_locate(value_type j) const;
+
+ private:  // Private Method(s)
+    Policy const *policy() const;
+
+ protected:  // Protected Property(ies)
+    bit_vector<BIT_BLOCK_SIZE, allocator_type> isa_samples_;
+    bit_vector<BIT_BLOCK_SIZE, allocator_type> sa_samples_;
+    basic_permutation<allocator_type> pi_;
+    bit_vector<BIT_BLOCK_SIZE, allocator_type> seq_ends_;
+    size_type sample_distance_;
+};  // class csa_base<P, T>
+
+/************************************************
+ * Implementation: class csa_base<P, T>
+ ************************************************/
+
+template <typename P, typename T>
+inline csa_base<P, T>::csa_base(allocator_type const &alloc)
+    : isa_samples_(alloc), sa_samples_(alloc), pi_(alloc), seq_ends_(alloc),
+      sample_distance_(DEFAULT_SAMPLE_DISTANCE) {
+    // do nothing
+}
+
+template <typename P, typename T>
+inline typename csa_base<P, T>::value_type csa_base<P, T>::at(size_type i) const {
+    return walk_to_sample(i, 0);
+}
+
+template <typename P, typename T>
+typename csa_base<P, T>::size_type csa_base<P, T>::rank(value_type j) const {
+    auto br_pair = isa_samples_.access_and_rank(j, true);
+    auto b = br_pair.first;
+    auto r = br_pair.second;
+    if (b) {
+        // retrieve a value at a sampled position
+        auto i = pi_.rank(r - 1);
+        return sa_samples_.select(i, true);
+    } else {
+        // retrieve a value at a unsampled position
+        auto off = isa_samples_.select(r, true) - j;
+        auto i = pi_.rank(r);
+        auto v = sa_samples_.select(i, true);
+        for (decltype(off) t = 0; t < off; ++t) {
+            v = helper::to_host(policy())->lf(v);
+        }
+
+        return v;
+    }
+}
+
+template <typename P, typename T>
+inline typename csa_base<P, T>::term_type csa_base<P, T>::term(value_type j) const {
+    auto const &wm = helper::get_wm(policy());
+    return wm.search(rank(j) + 1);
+}
+
+template <typename P, typename T>
+template <typename Sequence, typename OutputIterator>
+OutputIterator csa_base<P, T>::locate(Sequence const &s, OutputIterator it) const {
+    auto range = helper::to_host(policy())->equal_range(s);
+    std::vector<value_type> values(range.second - range.first);
+    locate_rows(range.first, range.second, values.data());
+
+    // a sequence is identified by the row of its terminator, which is
+    // resolved only once per sequence
+    std::unordered_map<size_type, size_type> seq_ids;
+    for (auto v : values) {
+        policy()->count_locate(v);
+        auto r = v > 0 ? seq_ends_.rank(v - 1, true) : 0;
+        auto start = r > 0 ? seq_ends_.select(r - 1, true) + 1 : 0;
+
+        auto seq_it = seq_ids.find(r);
+        if (seq_it == seq_ids.end()) {
+            auto end = seq_ends_.select(r, true);
+            seq_it = seq_ids.emplace(r, rank(end)).first;
+        }
+
+        *it++ = std::make_pair(seq_it->second, v - start);
+    }
+
+    return it;
+}
+
+template <typename P, typename T>
+template <typename OutputIterator>
+OutputIterator csa_base<P, T>::extract(
+        size_type k, size_type from, size_type len, OutputIterator it) const {
+    auto end = at(k);
+    auto r = seq_ends_.rank(end, true) - 1;
+    auto start = r > 0 ? seq_ends_.select(r - 1, true) + 1 : 0;
+    if (from >= end - start) { return it; }
+    if (len > end - start - from) { len = end - start - from; }
+    if (len == 0) { return it; }
+
+    auto first = start + from;
+    auto last = first + len;
+
+    // both policies sample the last position of the text, so there is a
+    // sample at or after `last`; a sample before `first` may not exist
+    auto right_r = isa_samples_.rank(last - 1, true);
+    auto right_pos = isa_samples_.select(right_r, true);
+    auto left_r = isa_samples_.rank(first, true);
+    auto left_pos = left_r > 0 ? isa_samples_.select(left_r - 1, true) : 0;
+
+    auto const *host = helper::to_host(policy());
+    if (left_r > 0 && first - left_pos <= right_pos - last) {
+        // decode forward from the preceding sample
+        auto i = sa_samples_.select(pi_.rank(left_r - 1), true);
+        for (auto p = left_pos; p < first; ++p) {
+            i = host->psi(i);
+        }
+
+        for (size_type t = 0; t < len; ++t) {
+            *it++ = host->f(i);
+            i = host->psi(i);
+        }
+
+        return it;
+    }
+
+    // decode backward from the following sample
+    auto i = sa_samples_.select(pi_.rank(right_r), true);
+    for (auto p = right_pos; p > last; --p) {
+        i = host->lf(i);
+    }
+
+    std::vector<term_type> terms(len);
+    for (auto t = len; t > 0; --t) {
+        terms[t - 1] = host->bwt(i);
+        i = host->lf(i);
+    }
+
+    return std::copy(terms.begin(), terms.end(), it);
+}
+
+template <typename P, typename T>
+inline typename csa_base<P, T>::size_type csa_base<P, T>::sample_distance() const {
+    return sample_distance_;
+}
+
+template <typename P, typename T>
+inline typename csa_base<P, T>::value_type csa_base<P, T>::operator[](size_type i) const {
+    return at(i);
+}
+
+template <typename P, typename T>
+void csa_base<P, T>::swap(csa_base &other) {  // NOLINT(runtime/references)
+    isa_samples_.swap(other.isa_samples_);
+    sa_samples_.swap(other.sa_samples_);
+    pi_.swap(other.pi_);
+    seq_ends_.swap(other.seq_ends_);
+    std::swap(sample_distance_, other.sample_distance_);
+}
+
+template <typename P, typename T>
+typename csa_base<P, T>::value_type
+csa_base<P, T>::walk_to_sample(size_type i, size_type off) const {
+    while (!sa_samples_[i]) {
+        i = helper::to_host(policy())->lf(i);
+        ++off;
+    }
+
+    return policy()->sampled_value(i, off);
+}
+
+template <typename P, typename T>
+void csa_base<P, T>::locate_rows(size_type first, size_type last, value_type *out) const {
+    struct rows {
+        size_type first, last, off;
+        value_type *out;
+    };
+
+    auto const &wm = helper::get_wm(policy());
+    std::vector<rows> stack;
+    if (first < last) { stack.push_back({first, last, 0, out}); }
+
+    while (!stack.empty()) {
+        auto x = stack.back();
+        stack.pop_back();
+
+        // resolve sampled rows and split the range into unsampled runs
+        auto r = x.first > 0 ? sa_samples_.rank(x.first - 1, true) : 0;
+        auto r_end = sa_samples_.rank(x.last - 1, true);
+        auto run_first = x.first;
+        while (true) {
+            auto run_last = r < r_end ? sa_samples_.select(r, true) : x.last;
+            auto run_out = x.out + (run_first - x.first);
+
+            // all rows of a run preceded by the same term stay adjacent
+            // after LF, so they can share the remaining walk
+            auto lf_pair = std::make_pair(run_first, run_first);
+            if (run_first + 1 < run_last) {
+                auto c = wm[run_first];
+                if (c != 0) { lf_pair = wm.lf_range(run_first, run_last, c); }
+            }
+
+            if (lf_pair.second - lf_pair.first == run_last - run_first) {
+                if (run_first < run_last) {
+                    stack.push_back({lf_pair.first, lf_pair.second, x.off + 1, run_out});
+                }
+            } else {
+                for (auto i = run_first; i < run_last; ++i) {
+                    *run_out++ = walk_to_sample(i, x.off);
+                }
+            }
+
+            if (r == r_end) { break; }
+
+            x.out[run_last - x.first] = policy()->sampled_value(run_last, x.off);
+            run_first = run_last + 1;
+            ++r;
+        }
+    }
+}
+
+template <typename P, typename T>
+inline void csa_base<P, T>::count_locate(value_type) const {
+    // do nothing
+}
+
+template <typename P, typename T>
+inline P const *csa_base<P, T>::policy() const {
+    return static_cast<P const *>(this);
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_CSA_BASE_HPP_
@@ -0,0 +1,211 @@
+/************************************************
+ *  flat_bit_vector.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_FLAT_BIT_VECTOR_HPP_
+#define DICT_INTERNAL_FLAT_BIT_VECTOR_HPP_
+
+#include <cstdint>
+
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "broadword.hpp"
+#include "serialization.hpp"
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class flat_bit_vector
+ ************************************************/
+
+// A read-only view of a bit vector stored as 64-bit words followed by a
+// directory of cumulative ranks, which is mapped without being copied.
+class flat_bit_vector {
+ public:  // Public Type(s)
+    using size_type = std::size_t;
+    using value_type = bool;
+    using word_type = std::uint64_t;
+
+ public:  // Public Static Method(s)
+    // NOLINTNEXTLINE(runtime/references)
+    static void write(std::ostream &os, std::vector<bool> const &bits);
+
+ public:  // Public Method(s)
+    flat_bit_vector();
+
+    word_type const *map(word_type const *first, word_type const *last);
+
+    std::pair<value_type, size_type> access_and_rank(size_type i) const;
+    size_type rank(size_type i, value_type b) const;
+    size_type select(size_type i, value_type b) const;
+    size_type count() const;
+    size_type size() const;
+
+    value_type operator[](size_type i) const;
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type WORD_SIZE = 64;
+    static constexpr size_type BLOCK_WORDS = 8;
+    static constexpr size_type BLOCK_SIZE = WORD_SIZE * BLOCK_WORDS;
+
+ private:  // Private Method(s)
+    size_type num_blocks() const;
+    size_type num_bits_before_block(size_type k, value_type b) const;
+    word_type word_of(size_type k, value_type b) const;
+
+ private:  // Private Property(ies)
+    size_type size_;
+    size_type num_words_;
+    word_type const *words_;
+    word_type const *ranks_;
+};  // class flat_bit_vector
+
+/************************************************
+ * Implementation: class flat_bit_vector
+ ************************************************/
+
+// NOLINTNEXTLINE(runtime/references)
+inline void flat_bit_vector::write(std::ostream &os, std::vector<bool> const &bits) {
+    auto num_words = (bits.size() + WORD_SIZE - 1) / WORD_SIZE;
+    write_value<std::uint64_t>(os, bits.size());
+    write_value<std::uint64_t>(os, num_words);
+
+    std::vector<word_type> ranks;
+    word_type rank = 0;
+    for (size_type k = 0; k < num_words; ++k) {
+        if (k % BLOCK_WORDS == 0) { ranks.push_back(rank); }
+
+        word_type w = 0;
+        for (size_type j = 0; j < WORD_SIZE && k * WORD_SIZE + j < bits.size(); ++j) {
+            if (bits[k * WORD_SIZE + j]) { w |= word_type(1) << j; }
+        }
+
+        rank += broadword::popcount(w);
+        write_value<word_type>(os, w);
+    }
+
+    ranks.push_back(rank);
+    for (auto r : ranks) {
+        write_value<word_type>(os, r);
+    }
+}
+
+inline flat_bit_vector::flat_bit_vector()
+    : size_(0), num_words_(0), words_(nullptr), ranks_(nullptr) {
+    // do nothing
+}
+
+inline flat_bit_vector::word_type const *
+flat_bit_vector::map(word_type const *first, word_type const *last) {
+    if (last - first < 2) {
+        throw std::runtime_error("truncated flat_bit_vector");
+    }
+
+    size_ = first[0];
+    num_words_ = first[1];
+    first += 2;
+
+    auto num_ranks = num_blocks() + 1;
+    if (num_words_ != (size_ + WORD_SIZE - 1) / WORD_SIZE ||
+            static_cast<size_type>(last - first) < num_words_ + num_ranks) {
+        throw std::runtime_error("truncated flat_bit_vector");
+    }
+
+    words_ = first;
+    ranks_ = first + num_words_;
+    return ranks_ + num_ranks;
+}
+
+inline std::pair<flat_bit_vector::value_type, flat_bit_vector::size_type>
+flat_bit_vector::access_and_rank(size_type i) const {
+    auto b = (*this)[i];
+    return std::make_pair(b, rank(i, b));
+}
+
+inline flat_bit_vector::size_type flat_bit_vector::rank(size_type i, value_type b) const {
+    // count bits in [0, i]
+    auto k = i / WORD_SIZE;
+    size_type r = ranks_[k / BLOCK_WORDS];
+    for (auto t = k - k % BLOCK_WORDS; t < k; ++t) {
+        r += broadword::popcount(words_[t]);
+    }
+
+    auto shift = WORD_SIZE - 1 - i % WORD_SIZE;
+    r += broadword::popcount(words_[k] << shift);
+    return b ? r : i + 1 - r;
+}
+
+inline flat_bit_vector::size_type flat_bit_vector::select(size_type i, value_type b) const {
+    // find the last block that starts before the (i + 1)-th bit
+    size_type lo = 0, hi = num_blocks();
+    while (hi - lo > 1) {
+        auto mid = (lo + hi) / 2;
+        if (num_bits_before_block(mid, b) <= i) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    i -= num_bits_before_block(lo, b);
+    for (auto k = lo * BLOCK_WORDS; k < num_words_; ++k) {
+        auto w = word_of(k, b);
+        auto c = broadword::popcount(w);
+        if (i < c) {
+            return k * WORD_SIZE + broadword::select(w, i);
+        }
+
+        i -= c;
+    }
+
+    throw std::out_of_range("flat_bit_vector::select");
+}
+
+inline flat_bit_vector::size_type flat_bit_vector::count() const {
+    return ranks_ ? ranks_[num_blocks()] : 0;
+}
+
+inline flat_bit_vector::size_type flat_bit_vector::size() const {
+    return size_;
+}
+
+inline flat_bit_vector::value_type flat_bit_vector::operator[](size_type i) const {
+    return (words_[i / WORD_SIZE] >> (i % WORD_SIZE)) & 1;
+}
+
+inline flat_bit_vector::size_type flat_bit_vector::num_blocks() const {
+    return (num_words_ + BLOCK_WORDS - 1) / BLOCK_WORDS;
+}
+
+inline flat_bit_vector::size_type
+flat_bit_vector::num_bits_before_block(size_type k, value_type b) const {
+    auto r = ranks_[k];
+    if (b) { return r; }
+
+    auto num_bits = k * BLOCK_SIZE;
+    return (num_bits < size_ ? num_bits : size_) - r;
+}
+
+inline flat_bit_vector::word_type flat_bit_vector::word_of(size_type k, value_type b) const {
+    if (b) { return words_[k]; }
+
+    // padding bits of the last word are not zeros of the vector
+    auto w = ~words_[k];
+    auto num_bits = size_ - k * WORD_SIZE;
+    return num_bits < WORD_SIZE ? w & ((word_type(1) << num_bits) - 1) : w;
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_FLAT_BIT_VECTOR_HPP_
@@ -0,0 +1,262 @@
+/************************************************
+ *  flat_partial_sum.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_FLAT_PARTIAL_SUM_HPP_
+#define DICT_INTERNAL_FLAT_PARTIAL_SUM_HPP_
+
+#include <cstdint>
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "partial_sum.hpp"
+#include "serialization.hpp"
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class flat_partial_sum<K, T, A>
+ ************************************************/
+
+// A partial_sum<K, T> over small unsigned keys, kept as a Fenwick tree in
+// an array that covers every key up to the largest one seen. It is saved in
+// the same format as partial_sum<K, T>.
+template <typename Key, typename T, typename Allocator = std::allocator<T>>
+class flat_partial_sum {
+ public:  // Public Type(s)
+    using key_type = Key;
+    using value_type = T;
+    using allocator_type = Allocator;
+
+ public:  // Public Method(s)
+    explicit flat_partial_sum(allocator_type const &alloc = allocator_type());
+
+    allocator_type get_allocator() const;
+    void swap(flat_partial_sum &other);  // NOLINT(runtime/references)
+
+    void increase(key_type k, value_type x);
+    void decrease(key_type k, value_type x);
+
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
+    value_type sum() const;
+    value_type sum(key_type k) const;
+    key_type search(value_type x) const;
+    std::pair<key_type, value_type> search_and_sum(value_type x) const;
+
+ private:  // Private Type(s)
+    using size_type = std::size_t;
+    using value_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+    static_assert(std::is_integral<Key>::value && std::is_unsigned<Key>::value,
+                  "keys of flat_partial_sum must be of an unsigned integer type");
+
+ private:  // Private Method(s)
+    void reserve(key_type k);
+    std::vector<value_type> values() const;
+
+ private:  // Private Property(ies)
+    // node i (1-based) holds the sum of keys in [i - (i & -i), i), and the
+    // number of nodes is zero or a power of two
+    std::vector<value_type, value_allocator> tree_;
+};  // class flat_partial_sum<K, T, A>
+
+/************************************************
+ * Declaration: alias c_table<K, T, KeyBits, A>
+ ************************************************/
+
+// Cumulative counts of keys of KeyBits bits, flat when the keys are
+// unsigned and there are at most 2^16 of them.
+template <typename Key, typename T, std::size_t KeyBits, typename Allocator = std::allocator<T>>
+using c_table = typename std::conditional<
+    KeyBits <= 16 && std::is_unsigned<Key>::value,
+    flat_partial_sum<Key, T, Allocator>,
+    partial_sum<Key, T, Allocator>
+>::type;
+
+/************************************************
+ * Implementation: class flat_partial_sum<K, T, A>
+ ************************************************/
+
+template <typename K, typename T, typename A>
+inline flat_partial_sum<K, T, A>::flat_partial_sum(allocator_type const &alloc)
+    : tree_(alloc) {
+    // do nothing
+}
+
+template <typename K, typename T, typename A>
+inline typename flat_partial_sum<K, T, A>::allocator_type
+flat_partial_sum<K, T, A>::get_allocator() const {
+    return allocator_type(tree_.get_allocator());
+}
+
+template <typename K, typename T, typename A>
+// NOLINTNEXTLINE(runtime/references)
+inline void flat_partial_sum<K, T, A>::swap(flat_partial_sum &other) {
+    tree_.swap(other.tree_);
+}
+
+template <typename K, typename T, typename A>
+inline void flat_partial_sum<K, T, A>::increase(key_type k, value_type x) {
+    reserve(k);
+    for (size_type i = size_type(k) + 1; i <= tree_.size(); i += i & (~i + 1)) {
+        tree_[i - 1] += x;
+    }
+}
+
+template <typename K, typename T, typename A>
+inline void flat_partial_sum<K, T, A>::decrease(key_type k, value_type x) {
+    reserve(k);
+    for (size_type i = size_type(k) + 1; i <= tree_.size(); i += i & (~i + 1)) {
+        tree_[i - 1] -= x;
+    }
+}
+
+template <typename K, typename T, typename A>
+template <typename InputIterator>
+void flat_partial_sum<K, T, A>::assign(InputIterator first, InputIterator last) {
+    // the input is a sequence of (key, value) pairs sorted by key
+    tree_.clear();
+    std::vector<std::pair<key_type, value_type>> pairs(first, last);
+    if (pairs.empty()) { return; }
+
+    reserve(pairs.back().first);
+    for (auto const &p : pairs) {
+        tree_[p.first] += p.second;
+    }
+
+    for (size_type i = 1; i <= tree_.size(); ++i) {
+        auto j = i + (i & (~i + 1));
+        if (j <= tree_.size()) { tree_[j - 1] += tree_[i - 1]; }
+    }
+}
+
+template <typename K, typename T, typename A>
+void flat_partial_sum<K, T, A>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    auto xs = values();
+
+    size_type num_keys = 0;
+    for (auto x : xs) {
+        if (x != 0) { ++num_keys; }
+    }
+
+    write_value<std::uint64_t>(os, num_keys);
+    for (size_type k = 0; k < xs.size(); ++k) {
+        if (xs[k] == 0) { continue; }
+
+        write_value<key_type>(os, static_cast<key_type>(k));
+        write_value<value_type>(os, xs[k]);
+    }
+}
+
+template <typename K, typename T, typename A>
+void flat_partial_sum<K, T, A>::load(std::istream &is) {  // NOLINT(runtime/references)
+    auto num_keys = read_value<std::uint64_t>(is);
+    check_remaining(is, num_keys, sizeof(key_type) + sizeof(value_type));
+
+    std::vector<std::pair<key_type, value_type>> pairs;
+    pairs.reserve(num_keys);
+    for (decltype(num_keys) i = 0; i < num_keys; ++i) {
+        auto k = read_value<key_type>(is);
+        auto x = read_value<value_type>(is);
+        pairs.emplace_back(k, x);
+    }
+
+    assign(pairs.begin(), pairs.end());
+}
+
+template <typename K, typename T, typename A>
+inline typename flat_partial_sum<K, T, A>::value_type flat_partial_sum<K, T, A>::sum() const {
+    return tree_.empty() ? 0 : tree_.back();
+}
+
+template <typename K, typename T, typename A>
+inline typename flat_partial_sum<K, T, A>::value_type
+flat_partial_sum<K, T, A>::sum(key_type k) const {
+    if (size_type(k) >= tree_.size()) { return sum(); }
+
+    value_type sum = 0;
+    for (size_type i = size_type(k) + 1; i > 0; i &= i - 1) {
+        sum += tree_[i - 1];
+    }
+
+    return sum;
+}
+
+template <typename K, typename T, typename A>
+inline typename flat_partial_sum<K, T, A>::key_type
+flat_partial_sum<K, T, A>::search(value_type x) const {
+    return search_and_sum(x).first;
+}
+
+template <typename K, typename T, typename A>
+inline std::pair<
+    typename flat_partial_sum<K, T, A>::key_type,
+    typename flat_partial_sum<K, T, A>::value_type
+>
+flat_partial_sum<K, T, A>::search_and_sum(value_type x) const {
+    // find the first key whose sum reaches x (at least 1) by descending
+    // from the root, which is the last node
+    if (x == 0) { x = 1; }
+    if (x > sum()) {
+        throw std::invalid_argument("not found");
+    }
+
+    size_type i = 0;
+    value_type sum = 0;
+    for (auto step = tree_.size(); step > 0; step >>= 1) {
+        if (i + step <= tree_.size() && sum + tree_[i + step - 1] < x) {
+            i += step;
+            sum += tree_[i - 1];
+        }
+    }
+
+    return std::make_pair(static_cast<key_type>(i), sum);
+}
+
+template <typename K, typename T, typename A>
+void flat_partial_sum<K, T, A>::reserve(key_type k) {
+    // doubling a tree only adds nodes for empty keys, except for the new
+    // root which covers all of the keys
+    auto total = sum();
+    if (tree_.empty()) { tree_.push_back(0); }
+
+    while (tree_.size() <= size_type(k)) {
+        tree_.resize(tree_.size() * 2, 0);
+        tree_.back() = total;
+    }
+}
+
+template <typename K, typename T, typename A>
+std::vector<typename flat_partial_sum<K, T, A>::value_type>
+flat_partial_sum<K, T, A>::values() const {
+    std::vector<value_type> xs(tree_.begin(), tree_.end());
+    for (auto i = xs.size(); i > 0; --i) {
+        auto j = i + (i & (~i + 1));
+        if (j <= xs.size()) { xs[j - 1] -= xs[i - 1]; }
+    }
+
+    return xs;
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_FLAT_PARTIAL_SUM_HPP_
@@ -0,0 +1,258 @@
+/************************************************
+ *  flat_wavelet_matrix.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_FLAT_WAVELET_MATRIX_HPP_
+#define DICT_INTERNAL_FLAT_WAVELET_MATRIX_HPP_
+
+#include <climits>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "flat_bit_vector.hpp"
+#include "serialization.hpp"
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class flat_wavelet_matrix<T, H>
+ ************************************************/
+
+// A read-only counterpart of wavelet_matrix<T, H> whose levels and
+// cumulative counts are mapped from a flat layout of 64-bit words.
+template <typename T, std::size_t Height = sizeof(T) * CHAR_BIT>
+class flat_wavelet_matrix {
+ public:  // Public Type(s)
+    using value_type = T;
+    using size_type = std::size_t;
+    using word_type = std::uint64_t;
+
+ public:  // Public Static Method(s)
+    template <typename InputIterator>
+    static void write(std::ostream &os,  // NOLINT(runtime/references)
+                      InputIterator first, InputIterator last);
+
+ public:  // Public Method(s)
+    flat_wavelet_matrix();
+
+    word_type const *map(word_type const *first, word_type const *last);
+
+    size_type size() const;
+
+    size_type sum(value_type c) const;
+    value_type search(size_type i) const;
+    size_type select(size_type j, value_type c) const;
+
+    std::pair<value_type, size_type> access_and_lf(size_type i) const;
+    size_type psi(size_type i) const;
+
+    value_type at(size_type i) const;
+
+    value_type operator[](size_type i) const;
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type HEIGHT = Height;
+
+ private:  // Private Method(s)
+    size_type select_at(size_type j, value_type c) const;
+
+ private:  // Private Property(ies)
+    std::array<std::pair<size_type, flat_bit_vector>, Height> levels_;
+    size_type num_values_;
+    word_type const *sums_;
+};  // class flat_wavelet_matrix<T, H>
+
+/************************************************
+ * Implementation: class flat_wavelet_matrix<T, H>
+ ************************************************/
+
+template <typename T, std::size_t H>
+template <typename InputIterator>
+void flat_wavelet_matrix<T, H>::write(std::ostream &os,  // NOLINT(runtime/references)
+                                      InputIterator first, InputIterator last) {
+    std::vector<value_type> values(first, last);
+    auto n = values.size();
+
+    write_value<std::uint64_t>(os, HEIGHT);
+
+    // each level is a stable partition of the previous one by a single bit
+    std::vector<value_type> next_values(n);
+    std::vector<bool> bits(n);
+    for (size_type l = 0; l < HEIGHT; ++l) {
+        size_type num_zeros = 0;
+        for (size_type i = 0; i < n; ++i) {
+            bits[i] = (values[i] >> l) & 1;
+            num_zeros += !bits[i];
+        }
+
+        write_value<std::uint64_t>(os, num_zeros);
+        flat_bit_vector::write(os, bits);
+
+        auto zero_it = next_values.begin();
+        auto one_it = zero_it + num_zeros;
+        for (size_type i = 0; i < n; ++i) {
+            *(bits[i] ? one_it : zero_it)++ = values[i];
+        }
+
+        values.swap(next_values);
+    }
+
+    // after the last level the values are sorted, so the first row of
+    // every distinct value is its cumulative count
+    std::vector<std::pair<word_type, word_type>> sums;
+    for (size_type i = 0; i < n; ++i) {
+        if (i == 0 || values[i] != values[i - 1]) { sums.emplace_back(values[i], i); }
+    }
+
+    write_value<std::uint64_t>(os, sums.size());
+    for (auto const &p : sums) {
+        write_value<word_type>(os, p.first);
+        write_value<word_type>(os, p.second);
+    }
+}
+
+template <typename T, std::size_t H>
+inline flat_wavelet_matrix<T, H>::flat_wavelet_matrix()
+    : levels_(), num_values_(0), sums_(nullptr) {
+    // do nothing
+}
+
+template <typename T, std::size_t H>
+typename flat_wavelet_matrix<T, H>::word_type const *
+flat_wavelet_matrix<T, H>::map(word_type const *first, word_type const *last) {
+    if (first == last || *first++ != HEIGHT) {
+        throw std::runtime_error("mismatched height of flat_wavelet_matrix");
+    }
+
+    for (size_type l = 0; l < HEIGHT; ++l) {
+        if (first == last) {
+            throw std::runtime_error("truncated flat_wavelet_matrix");
+        }
+
+        levels_[l].first = *first++;
+        first = levels_[l].second.map(first, last);
+    }
+
+    if (first == last) {
+        throw std::runtime_error("truncated flat_wavelet_matrix");
+    }
+
+    num_values_ = *first++;
+    if (static_cast<size_type>(last - first) < 2 * num_values_) {
+        throw std::runtime_error("truncated flat_wavelet_matrix");
+    }
+
+    sums_ = first;
+    return first + 2 * num_values_;
+}
+
+template <typename T, std::size_t H>
+inline typename flat_wavelet_matrix<T, H>::size_type flat_wavelet_matrix<T, H>::size() const {
+    return levels_[0].second.size();
+}
+
+template <typename T, std::size_t H>
+typename flat_wavelet_matrix<T, H>::size_type
+flat_wavelet_matrix<T, H>::sum(value_type c) const {
+    // number of values less than c
+    size_type lo = 0, hi = num_values_;
+    while (lo < hi) {
+        auto mid = (lo + hi) / 2;
+        if (sums_[2 * mid] < c) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo < num_values_ ? sums_[2 * lo + 1] : size();
+}
+
+template <typename T, std::size_t H>
+typename flat_wavelet_matrix<T, H>::value_type
+flat_wavelet_matrix<T, H>::search(size_type i) const {
+    // the value of the i-th (1-based) smallest element
+    size_type lo = 0, hi = num_values_;
+    while (hi - lo > 1) {
+        auto mid = (lo + hi) / 2;
+        if (sums_[2 * mid + 1] < i) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return static_cast<value_type>(sums_[2 * lo]);
+}
+
+template <typename T, std::size_t H>
+inline typename flat_wavelet_matrix<T, H>::size_type
+flat_wavelet_matrix<T, H>::select(size_type j, value_type c) const {
+    return select_at(j + sum(c), c);
+}
+
+template <typename T, std::size_t H>
+std::pair<
+    typename flat_wavelet_matrix<T, H>::value_type,
+    typename flat_wavelet_matrix<T, H>::size_type
+>
+flat_wavelet_matrix<T, H>::access_and_lf(size_type i) const {
+    value_type c = 0;
+    for (size_type l = 0; l < HEIGHT; ++l) {
+        auto const &bits = levels_[l].second;
+        auto br_pair = bits.access_and_rank(i);
+        c |= br_pair.first << l;
+        i = (br_pair.first ? levels_[l].first : 0) + br_pair.second - 1;
+    }
+
+    return std::make_pair(c, i);
+}
+
+template <typename T, std::size_t H>
+inline typename flat_wavelet_matrix<T, H>::size_type
+flat_wavelet_matrix<T, H>::psi(size_type i) const {
+    return select_at(i, search(i + 1));
+}
+
+template <typename T, std::size_t H>
+inline typename flat_wavelet_matrix<T, H>::value_type
+flat_wavelet_matrix<T, H>::at(size_type i) const {
+    return access_and_lf(i).first;
+}
+
+template <typename T, std::size_t H>
+inline typename flat_wavelet_matrix<T, H>::value_type
+flat_wavelet_matrix<T, H>::operator[](size_type i) const {
+    return at(i);
+}
+
+template <typename T, std::size_t H>
+typename flat_wavelet_matrix<T, H>::size_type
+flat_wavelet_matrix<T, H>::select_at(size_type j, value_type c) const {
+    for (auto l = HEIGHT; l > 0; --l) {
+        auto const &bits = levels_[l - 1].second;
+        auto b = (c >> (l - 1)) & 1;
+        j -= b ? levels_[l - 1].first : 0;
+        j = bits.select(j, b);
+    }
+
+    return j;
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_FLAT_WAVELET_MATRIX_HPP_
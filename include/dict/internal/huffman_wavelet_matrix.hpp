@@ -0,0 +1,821 @@
+/************************************************
+ *  huffman_wavelet_matrix.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_HUFFMAN_WAVELET_MATRIX_HPP_
+#define DICT_INTERNAL_HUFFMAN_WAVELET_MATRIX_HPP_
+
+#include <climits>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "flat_partial_sum.hpp"
+#include "partial_sum.hpp"
+#include "serialization.hpp"
+#include "symbol_vector.hpp"
+#include "thread_pool.hpp"
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class huffman_wavelet_matrix<T, H, W, N, A>
+ ************************************************/
+
+// A wavelet matrix shaped by a length-limited canonical Huffman code over
+// digits of Width bits, so that frequent values pass through fewer levels.
+// Each level stores, for the values still present, the next digit of their
+// codes and whether the code ends there. Values without a code of their own
+// are written as an escape code followed by their raw digits. The code is
+// rebuilt from the current counts when the total code length drifts away
+// from the optimum. It has the interface of wavelet_matrix<T, H>.
+//
+// Given a thread pool, assign() and insert_batch() build the symbols of
+// each level over chunks of the codes in parallel.
+template <typename T, std::size_t Height = sizeof(T) * CHAR_BIT,
+          std::size_t Width = 2, std::size_t N = 64, typename Allocator = std::allocator<T>>
+class huffman_wavelet_matrix {
+ public:  // Public Type(s)
+    using value_type = T;
+    using size_type = std::size_t;
+    using allocator_type = Allocator;
+
+ public:  // Public Method(s)
+    explicit huffman_wavelet_matrix(allocator_type const &alloc = allocator_type());
+
+    allocator_type get_allocator() const;
+    void swap(huffman_wavelet_matrix &other);  // NOLINT(runtime/references)
+
+    void insert(size_type i, value_type c);
+    value_type erase(size_type i);
+    void insert_batch(std::vector<std::pair<size_type, value_type>> const &values);
+    void insert_batch(std::vector<std::pair<size_type, value_type>> const &values,
+                      thread_pool &pool);  // NOLINT(runtime/references)
+
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+    template <typename InputIterator>  // NOLINTNEXTLINE(runtime/references)
+    void assign(InputIterator first, InputIterator last, thread_pool &pool);
+    void rebalance();
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
+    size_type size() const;
+    size_type num_levels() const;
+    size_type code_length(value_type c) const;
+
+    size_type sum(value_type c) const;
+    value_type search(size_type i) const;
+    std::pair<value_type, size_type> access_and_rank(size_type i) const;
+    size_type rank(size_type i, value_type c) const;
+    size_type select(size_type j, value_type c) const;
+
+    std::pair<value_type, size_type> access_and_lf(size_type i) const;
+    size_type lf(size_type i) const;
+    std::pair<size_type, size_type> lf_range(size_type i, size_type j, value_type c) const;
+    std::pair<size_type, value_type> psi_and_access(size_type i) const;
+    size_type psi(size_type i) const;
+    size_type psi(size_type i, value_type hint) const;
+
+    value_type at(size_type i) const;
+
+    value_type operator[](size_type i) const;
+
+ private:  // Private Type(s)
+    struct codeword;
+    using symbols = symbol_vector<Width + 1, N, Allocator>;
+    using symbol_type = typename symbols::value_type;
+    using digits_type = std::uint64_t;
+    using key_type = std::uint64_t;
+    using value_counts = std::vector<std::pair<value_type, size_type>>;
+
+    template <typename U>
+    using rebind_alloc = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type HEIGHT = Height;
+    static constexpr size_type WIDTH = Width;
+    static constexpr size_type DEGREE = size_type(1) << Width;
+    static constexpr symbol_type TERMINAL = DEGREE;
+    static constexpr size_type MAX_CODE_LENGTH = 24 / Width;
+    static constexpr size_type RAW_CODE_LENGTH = (Height + Width - 1) / Width;
+    static constexpr size_type MAX_NUM_LEVELS = MAX_CODE_LENGTH + RAW_CODE_LENGTH;
+    static constexpr size_type PREFIX_BITS = Width * (MAX_NUM_LEVELS - 1);
+    static constexpr size_type MIN_REBALANCE_PERIOD = 1024;
+    static constexpr size_type CHUNK_SIZE = 1 << 16;
+
+    static_assert(Width * MAX_NUM_LEVELS <= 64 && PREFIX_BITS < 64 &&
+                  ((MAX_NUM_LEVELS * DEGREE + 1) >> (64 - PREFIX_BITS)) == 0,
+                  "codes of huffman_wavelet_matrix must fit in 64-bit keys");
+
+ private:  // Private Static Method(s)
+    static std::vector<size_type> code_lengths(std::vector<size_type> weights);
+    static size_type digit_of(codeword const &x, size_type l);
+    static key_type key_of(codeword const &x);
+
+ private:  // Private Method(s)
+    void build_codes(value_counts counts);
+    template <typename Values>  // NOLINTNEXTLINE(runtime/references)
+    void build_levels(Values const &values, value_counts const &counts, thread_pool &pool);
+    void count_updates(size_type num_updates);
+    bool drifted() const;
+    value_counts counts() const;
+    codeword encode(value_type c) const;
+    value_type decode(codeword const &x) const;
+    size_type offset_of(codeword const &x) const;
+    size_type num_less(size_type l, size_type d) const;
+
+ private:  // Private Property(ies)
+    // a vector, so that each level is constructed in place with the allocator
+    std::vector<symbols, rebind_alloc<symbols>> levels_;
+    size_type num_levels_;
+    std::unordered_map<value_type, codeword, std::hash<value_type>, std::equal_to<value_type>,
+                       rebind_alloc<std::pair<value_type const, codeword>>> codes_;
+    std::unordered_map<key_type, value_type, std::hash<key_type>, std::equal_to<key_type>,
+                       rebind_alloc<std::pair<key_type const, value_type>>> values_;
+    codeword escape_;
+    c_table<value_type, size_type, Height, Allocator> sums_;
+    partial_sum<key_type, size_type, Allocator> offsets_;
+    size_type total_length_;
+    size_type num_updates_;
+};  // class huffman_wavelet_matrix<T, H, W, N, A>
+
+/************************************************
+ * Declaration: struct huffman_wavelet_matrix<T, H, W, N, A>::codeword
+ ************************************************/
+
+// The digit read at level l is stored in bits [l * W, (l + 1) * W).
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+struct huffman_wavelet_matrix<T, H, W, N, A>::codeword {
+    size_type length;
+    digits_type digits;
+};  // struct huffman_wavelet_matrix<T, H, W, N, A>::codeword
+
+/************************************************
+ * Implementation: class huffman_wavelet_matrix<T, H, W, N, A>
+ ************************************************/
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+huffman_wavelet_matrix<T, H, W, N, A>::huffman_wavelet_matrix(allocator_type const &alloc)
+    : levels_(alloc), num_levels_(RAW_CODE_LENGTH), codes_(alloc), values_(alloc),
+      escape_{0, 0}, sums_(alloc), offsets_(alloc), total_length_(0), num_updates_(0) {
+    levels_.reserve(MAX_NUM_LEVELS);
+    for (size_type l = 0; l < MAX_NUM_LEVELS; ++l) {
+        levels_.emplace_back(alloc);
+    }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::allocator_type
+huffman_wavelet_matrix<T, H, W, N, A>::get_allocator() const {
+    return levels_[0].get_allocator();
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+// NOLINTNEXTLINE(runtime/references)
+inline void huffman_wavelet_matrix<T, H, W, N, A>::swap(huffman_wavelet_matrix &other) {
+    levels_.swap(other.levels_);
+    std::swap(num_levels_, other.num_levels_);
+    codes_.swap(other.codes_);
+    values_.swap(other.values_);
+    std::swap(escape_, other.escape_);
+    sums_.swap(other.sums_);
+    offsets_.swap(other.offsets_);
+    std::swap(total_length_, other.total_length_);
+    std::swap(num_updates_, other.num_updates_);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void huffman_wavelet_matrix<T, H, W, N, A>::insert(size_type i, value_type c) {
+    auto x = encode(c);
+    sums_.increase(c, 1);
+    offsets_.increase(key_of(x), 1);
+    total_length_ += x.length;
+
+    for (size_type l = 0; l < x.length; ++l) {
+        auto d = digit_of(x, l);
+        if (l + 1 == x.length) {
+            levels_[l].insert(i, d | TERMINAL);
+        } else {
+            i = num_less(l, d) + levels_[l].insert(i, d) - 1;
+        }
+    }
+
+    count_updates(1);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+typename huffman_wavelet_matrix<T, H, W, N, A>::value_type
+huffman_wavelet_matrix<T, H, W, N, A>::erase(size_type i) {
+    codeword x{0, 0};
+    for (size_type l = 0; ; ++l) {
+        auto &seq = levels_[l];
+        auto s = seq.erase(i);
+        x.digits |= static_cast<digits_type>(s & (DEGREE - 1)) << (l * WIDTH);
+        if (s & TERMINAL) {
+            x.length = l + 1;
+            break;
+        }
+
+        i = num_less(l, s) + ((i > 0) ? seq.rank(i - 1, s) : 0);
+    }
+
+    auto c = decode(x);
+    sums_.decrease(c, 1);
+    offsets_.decrease(key_of(x), 1);
+    total_length_ -= x.length;
+
+    count_updates(1);
+    return c;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline void huffman_wavelet_matrix<T, H, W, N, A>::insert_batch(
+        std::vector<std::pair<size_type, value_type>> const &values) {
+    thread_pool pool(0);
+    insert_batch(values, pool);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void huffman_wavelet_matrix<T, H, W, N, A>::insert_batch(
+        std::vector<std::pair<size_type, value_type>> const &values,
+        thread_pool &pool) {  // NOLINT(runtime/references)
+    // the values are given with their rows in the result, in ascending order
+    std::vector<std::pair<size_type, codeword>> rows, next_rows;
+    for (auto const &p : values) {
+        auto x = encode(p.second);
+        sums_.increase(p.second, 1);
+        offsets_.increase(key_of(x), 1);
+        total_length_ += x.length;
+        rows.emplace_back(p.first, x);
+    }
+
+    std::vector<std::pair<size_type, symbol_type>> level_rows;
+    for (size_type l = 0; !rows.empty(); ++l) {
+        level_rows.clear();
+        for (auto const &p : rows) {
+            auto const &x = p.second;
+            level_rows.emplace_back(p.first, digit_of(x, l) | (x.length == l + 1 ? TERMINAL : 0));
+        }
+
+        auto ranks = levels_[l].insert_batch(level_rows, pool);
+
+        // codes that go on stay in order within each digit
+        next_rows.clear();
+        for (size_type d = 0; d < DEGREE; ++d) {
+            for (size_type t = 0; t < rows.size(); ++t) {
+                auto const &x = rows[t].second;
+                if (x.length > l + 1 && digit_of(x, l) == d) {
+                    next_rows.emplace_back(num_less(l, d) + ranks[t] - 1, x);
+                }
+            }
+        }
+
+        rows.swap(next_rows);
+    }
+
+    count_updates(values.size());
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+template <typename InputIterator>
+inline void huffman_wavelet_matrix<T, H, W, N, A>::assign(InputIterator first,
+                                                       InputIterator last) {
+    thread_pool pool(0);
+    assign(first, last, pool);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+template <typename InputIterator>  // NOLINTNEXTLINE(runtime/references)
+void huffman_wavelet_matrix<T, H, W, N, A>::assign(InputIterator first, InputIterator last,
+                                                thread_pool &pool) {
+    std::vector<value_type> values(first, last);
+
+    // count the distinct values by sorting, as the alphabet may be wide
+    std::vector<value_type> sorted_values(values);
+    std::sort(sorted_values.begin(), sorted_values.end());
+
+    value_counts counts;
+    for (auto c : sorted_values) {
+        if (counts.empty() || counts.back().first != c) {
+            counts.emplace_back(c, 0);
+        }
+
+        ++counts.back().second;
+    }
+
+    sums_.assign(counts.begin(), counts.end());
+    build_codes(counts);
+    build_levels(values, counts, pool);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void huffman_wavelet_matrix<T, H, W, N, A>::rebalance() {
+    // the values are recovered in order and re-encoded with fresh codes
+    std::vector<value_type> values(size());
+    for (size_type i = 0; i < values.size(); ++i) {
+        values[i] = at(i);
+    }
+
+    auto value_counts = counts();
+    build_codes(value_counts);
+
+    thread_pool pool(0);
+    build_levels(values, value_counts, pool);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void huffman_wavelet_matrix<T, H, W, N, A>::save(std::ostream &os) const {  // NOLINT
+    write_value<std::uint64_t>(os, HEIGHT);
+    write_value<std::uint64_t>(os, WIDTH);
+
+    // the code table, followed by the levels in use
+    write_value<std::uint64_t>(os, codes_.size());
+    for (auto const &p : codes_) {
+        write_value<std::uint64_t>(os, p.first);
+        write_value<std::uint64_t>(os, p.second.length);
+        write_value<std::uint64_t>(os, p.second.digits);
+    }
+
+    write_value<std::uint64_t>(os, escape_.length);
+    write_value<std::uint64_t>(os, escape_.digits);
+    for (size_type l = 0; l < num_levels_; ++l) {
+        levels_[l].save(os);
+    }
+
+    sums_.save(os);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void huffman_wavelet_matrix<T, H, W, N, A>::load(std::istream &is) {  // NOLINT(runtime/references)
+    if (read_value<std::uint64_t>(is) != HEIGHT || read_value<std::uint64_t>(is) != WIDTH) {
+        throw std::runtime_error("mismatched shape of huffman_wavelet_matrix");
+    }
+
+    codes_.clear();
+    values_.clear();
+    num_levels_ = 0;
+
+    auto num_codes = read_value<std::uint64_t>(is);
+    check_remaining(is, num_codes, 3 * sizeof(std::uint64_t));
+    for (decltype(num_codes) k = 0; k <= num_codes; ++k) {
+        auto c = static_cast<value_type>(k < num_codes ? read_value<std::uint64_t>(is) : 0);
+        codeword x;
+        x.length = read_value<std::uint64_t>(is);
+        x.digits = read_value<std::uint64_t>(is);
+        if (x.length > MAX_CODE_LENGTH) {
+            throw std::runtime_error("invalid code of huffman_wavelet_matrix");
+        }
+
+        if (k < num_codes) {
+            codes_[c] = x;
+            values_[key_of(x)] = c;
+            num_levels_ = std::max(num_levels_, x.length);
+        } else {
+            escape_ = x;
+            num_levels_ = std::max(num_levels_, x.length + RAW_CODE_LENGTH);
+        }
+    }
+
+    std::vector<symbol_type> empty;
+    for (size_type l = 0; l < MAX_NUM_LEVELS; ++l) {
+        if (l < num_levels_) {
+            levels_[l].load(is);
+        } else {
+            levels_[l].assign(empty.begin(), empty.end());
+        }
+    }
+
+    sums_.load(is);
+
+    // the offsets and the total length follow from the counts and codes
+    std::vector<std::pair<key_type, size_type>> offsets;
+    total_length_ = num_updates_ = 0;
+    for (auto const &p : counts()) {
+        auto x = encode(p.first);
+        offsets.emplace_back(key_of(x), p.second);
+        total_length_ += x.length * p.second;
+    }
+
+    std::sort(offsets.begin(), offsets.end());
+    offsets_.assign(offsets.begin(), offsets.end());
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::size() const {
+    return levels_[0].size();
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::num_levels() const {
+    return num_levels_;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::code_length(value_type c) const {
+    return encode(c).length;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::sum(value_type c) const {
+    return (c > 0) ? sums_.sum(c - 1) : 0;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::value_type
+huffman_wavelet_matrix<T, H, W, N, A>::search(size_type i) const {
+    return sums_.search(i);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+std::pair<
+    typename huffman_wavelet_matrix<T, H, W, N, A>::value_type,
+    typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+>
+huffman_wavelet_matrix<T, H, W, N, A>::access_and_rank(size_type i) const {
+    codeword x{0, 0};
+    for (size_type l = 0; ; ++l) {
+        auto sr_pair = levels_[l].access_and_rank(i);
+        auto s = sr_pair.first;
+        x.digits |= static_cast<digits_type>(s & (DEGREE - 1)) << (l * WIDTH);
+        if (s & TERMINAL) {
+            // occurrences of other codes that end here precede this block
+            x.length = l + 1;
+            return std::make_pair(decode(x), sr_pair.second - offset_of(x));
+        }
+
+        i = num_less(l, s) + sr_pair.second - 1;
+    }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::rank(size_type i, value_type c) const {
+    auto x = encode(c);
+    for (size_type l = 0; l + 1 < x.length; ++l) {
+        auto d = digit_of(x, l);
+        auto r = levels_[l].rank(i, d);
+        if (r == 0) { return 0; }
+
+        i = num_less(l, d) + r - 1;
+    }
+
+    auto r = levels_[x.length - 1].rank(i, digit_of(x, x.length - 1) | TERMINAL);
+    return r - offset_of(x);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::select(size_type j, value_type c) const {
+    auto x = encode(c);
+    auto l = x.length - 1;
+    j = levels_[l].select(j + offset_of(x), digit_of(x, l) | TERMINAL);
+    while (l > 0) {
+        --l;
+        auto d = digit_of(x, l);
+        j = levels_[l].select(j - num_less(l, d), d);
+    }
+
+    return j;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline std::pair<
+    typename huffman_wavelet_matrix<T, H, W, N, A>::value_type,
+    typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+>
+huffman_wavelet_matrix<T, H, W, N, A>::access_and_lf(size_type i) const {
+    auto pair = access_and_rank(i);
+    return std::make_pair(pair.first, sum(pair.first) + pair.second - 1);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::lf(size_type i) const {
+    return access_and_lf(i).second;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+std::pair<
+    typename huffman_wavelet_matrix<T, H, W, N, A>::size_type,
+    typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+>
+huffman_wavelet_matrix<T, H, W, N, A>::lf_range(size_type i, size_type j, value_type c) const {
+    auto ps = sum(c);
+    i = ps + ((i > 0) ? rank(i - 1, c) : 0);
+    j = ps + ((j > 0) ? rank(j - 1, c) : 0);
+    return (i < j) ? std::make_pair(i, j) : std::make_pair(i, i);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline std::pair<
+    typename huffman_wavelet_matrix<T, H, W, N, A>::size_type,
+    typename huffman_wavelet_matrix<T, H, W, N, A>::value_type
+>
+huffman_wavelet_matrix<T, H, W, N, A>::psi_and_access(size_type i) const {
+    auto c = sums_.search(i + 1);
+    return std::make_pair(select(i - sum(c), c), c);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::psi(size_type i) const {
+    return psi_and_access(i).first;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::psi(size_type i, value_type hint) const {
+    return select(i - sum(hint), hint);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::value_type
+huffman_wavelet_matrix<T, H, W, N, A>::at(size_type i) const {
+    return access_and_rank(i).first;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::value_type
+huffman_wavelet_matrix<T, H, W, N, A>::operator[](size_type i) const {
+    return at(i);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+std::vector<typename huffman_wavelet_matrix<T, H, W, N, A>::size_type>
+huffman_wavelet_matrix<T, H, W, N, A>::code_lengths(std::vector<size_type> weights) {
+    // DEGREE-ary Huffman code; the weights are flattened until no code is
+    // longer than MAX_CODE_LENGTH, which ends once they are all equal
+    auto num_leaves = weights.size();
+    if (num_leaves <= 1) { return std::vector<size_type>(num_leaves, 0); }
+
+    // pad with empty leaves so that every internal node is full
+    auto num_nodes = num_leaves;
+    while ((num_nodes - 1) % (DEGREE - 1) != 0) { ++num_nodes; }
+
+    while (true) {
+        using node = std::pair<size_type, size_type>;
+        std::priority_queue<node, std::vector<node>, std::greater<node>> heap;
+        for (size_type k = 0; k < num_nodes; ++k) {
+            heap.emplace(k < num_leaves ? weights[k] : 0, k);
+        }
+
+        std::vector<size_type> parents(num_nodes);
+        while (heap.size() > 1) {
+            size_type weight = 0;
+            auto parent = parents.size();
+            parents.push_back(parent);
+            for (size_type k = 0; k < DEGREE; ++k) {
+                weight += heap.top().first;
+                parents[heap.top().second] = parent;
+                heap.pop();
+            }
+
+            heap.emplace(weight, parent);
+        }
+
+        // nodes are created after their children, so depths are filled in
+        // from the root down
+        std::vector<size_type> depths(parents.size(), 0);
+        for (auto k = parents.size() - 1; k > 0; --k) {
+            depths[k - 1] = depths[parents[k - 1]] + 1;
+        }
+
+        depths.resize(num_leaves);
+        if (*std::max_element(depths.begin(), depths.end()) <= MAX_CODE_LENGTH) {
+            return depths;
+        }
+
+        for (auto &w : weights) {
+            w = (w + 1) / 2;
+        }
+    }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::digit_of(codeword const &x, size_type l) {
+    return (x.digits >> (l * WIDTH)) & (DEGREE - 1);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::key_type
+huffman_wavelet_matrix<T, H, W, N, A>::key_of(codeword const &x) {
+    // codes ending at the same level with the same digit are ordered as
+    // their blocks on that level, i.e. by their preceding digits
+    auto l = x.length - 1;
+    auto group = l * DEGREE + digit_of(x, l) + 1;
+    auto prefix = x.digits & ((digits_type(1) << (l * WIDTH)) - 1);
+    return (static_cast<key_type>(group) << PREFIX_BITS) | prefix;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void huffman_wavelet_matrix<T, H, W, N, A>::build_codes(value_counts counts) {
+    // keep the most frequent values if there are more than the codes
+    auto max_num_codes = (size_type(1) << (WIDTH * MAX_CODE_LENGTH)) - 1;
+    if (counts.size() > max_num_codes) {
+        std::nth_element(counts.begin(), counts.begin() + max_num_codes, counts.end(),
+                         [](std::pair<value_type, size_type> const &p,
+                            std::pair<value_type, size_type> const &q) {
+            return p.second > q.second;
+        });
+
+        counts.resize(max_num_codes);
+        std::sort(counts.begin(), counts.end());
+    }
+
+    // the escape code takes the last leaf with the least weight
+    std::vector<size_type> weights;
+    for (auto const &p : counts) {
+        weights.push_back(p.second);
+    }
+
+    weights.push_back(1);
+    auto lengths = code_lengths(weights);
+
+    std::vector<size_type> order(lengths.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&lengths](size_type p, size_type q) {
+        return lengths[p] < lengths[q];
+    });
+
+    // canonical codes, whose first digit is read at level 0
+    codes_.clear();
+    values_.clear();
+    num_levels_ = 0;
+
+    digits_type code = 0;
+    for (size_type k = 0; k < order.size(); ++k) {
+        auto len = lengths[order[k]];
+        if (k > 0) {
+            code = (code + 1) << (WIDTH * (len - lengths[order[k - 1]]));
+        }
+
+        codeword x{len, 0};
+        for (size_type l = 0; l < len; ++l) {
+            auto d = (code >> (WIDTH * (len - 1 - l))) & (DEGREE - 1);
+            x.digits |= d << (WIDTH * l);
+        }
+
+        if (order[k] < counts.size()) {
+            auto c = counts[order[k]].first;
+            codes_[c] = x;
+            values_[key_of(x)] = c;
+            num_levels_ = std::max(num_levels_, len);
+        } else {
+            escape_ = x;
+            num_levels_ = std::max(num_levels_, len + RAW_CODE_LENGTH);
+        }
+    }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+template <typename Values>  // NOLINTNEXTLINE(runtime/references)
+void huffman_wavelet_matrix<T, H, W, N, A>::build_levels(Values const &values,
+                                                      value_counts const &counts,
+                                                      thread_pool &pool) {
+    std::vector<std::pair<key_type, size_type>> offsets;
+    total_length_ = num_updates_ = 0;
+    for (auto const &p : counts) {
+        auto x = encode(p.first);
+        offsets.emplace_back(key_of(x), p.second);
+        total_length_ += x.length * p.second;
+    }
+
+    std::sort(offsets.begin(), offsets.end());
+    offsets_.assign(offsets.begin(), offsets.end());
+
+    std::vector<codeword> codes(values.size());
+    pool.run((codes.size() + CHUNK_SIZE - 1) / CHUNK_SIZE, [&](size_type k) {
+        auto first = k * CHUNK_SIZE, last = std::min(codes.size(), first + CHUNK_SIZE);
+        for (auto i = first; i < last; ++i) {
+            codes[i] = encode(values[i]);
+        }
+    });
+
+    // each level is a stable partition of the codes that go on by digit;
+    // those that end at a level have terminal symbols, which are dropped
+    std::vector<codeword> next_codes;
+    for (size_type l = 0; l < MAX_NUM_LEVELS; ++l) {
+        levels_[l].assign_and_partition(codes, [l](codeword const &x) {
+            return digit_of(x, l) | (x.length == l + 1 ? TERMINAL : 0);
+        }, DEGREE, next_codes, pool);
+
+        codes.swap(next_codes);
+    }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void huffman_wavelet_matrix<T, H, W, N, A>::count_updates(size_type num_updates) {
+    // check the code from time to time, so that the cost of rebuilding it
+    // is amortized over the updates in between
+    auto period = size() / 4;
+    num_updates_ += num_updates;
+    if (num_updates_ < period || num_updates_ < MIN_REBALANCE_PERIOD) { return; }
+
+    num_updates_ = 0;
+    if (drifted()) { rebalance(); }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+bool huffman_wavelet_matrix<T, H, W, N, A>::drifted() const {
+    // the current code is kept while it costs at most 1/8 more than the
+    // code that would be built from the current counts
+    auto value_counts = counts();
+    std::vector<size_type> weights;
+    for (auto const &p : value_counts) {
+        weights.push_back(p.second);
+    }
+
+    weights.push_back(1);
+    auto lengths = code_lengths(weights);
+
+    size_type optimal_length = 0;
+    for (size_type k = 0; k < value_counts.size(); ++k) {
+        optimal_length += lengths[k] * value_counts[k].second;
+    }
+
+    return 8 * total_length_ > 9 * optimal_length;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+typename huffman_wavelet_matrix<T, H, W, N, A>::value_counts
+huffman_wavelet_matrix<T, H, W, N, A>::counts() const {
+    value_counts value_counts;
+    for (size_type k = 0, n = size(); k < n; ) {
+        auto c = sums_.search(k + 1);
+        auto next_k = sums_.sum(c);
+        value_counts.emplace_back(c, next_k - k);
+        k = next_k;
+    }
+
+    return value_counts;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::codeword
+huffman_wavelet_matrix<T, H, W, N, A>::encode(value_type c) const {
+    auto it = codes_.find(c);
+    if (it != codes_.end()) { return it->second; }
+
+    auto raw_digits = static_cast<digits_type>(c) << (WIDTH * escape_.length);
+    return codeword{escape_.length + RAW_CODE_LENGTH, escape_.digits | raw_digits};
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::value_type
+huffman_wavelet_matrix<T, H, W, N, A>::decode(codeword const &x) const {
+    auto it = values_.find(key_of(x));
+    if (it != values_.end()) { return it->second; }
+
+    return static_cast<value_type>(x.digits >> (WIDTH * escape_.length));
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::offset_of(codeword const &x) const {
+    // number of occurrences of the codes that end before x on its level
+    auto key = key_of(x);
+    auto group_key = (key >> PREFIX_BITS) << PREFIX_BITS;
+    return offsets_.sum(key - 1) - offsets_.sum(group_key - 1);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename huffman_wavelet_matrix<T, H, W, N, A>::size_type
+huffman_wavelet_matrix<T, H, W, N, A>::num_less(size_type l, size_type d) const {
+    // codes that go on from this level with a smaller digit
+    size_type num = 0;
+    for (size_type t = 0; t < d; ++t) {
+        num += levels_[l].count(t);
+    }
+
+    return num;
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_HUFFMAN_WAVELET_MATRIX_HPP_
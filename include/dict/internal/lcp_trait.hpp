@@ -9,6 +9,8 @@
 #ifndef DICT_INTERNAL_LCP_TRAIT_HPP_
 #define DICT_INTERNAL_LCP_TRAIT_HPP_
 
+#include <vector>
+
 namespace dict {
 
 namespace internal {
@@ -22,6 +24,7 @@ struct lcp_trait {
     using size_type = typename Trait::size_type;
     using term_type = typename Trait::term_type;
     using seq_type = typename Trait::seq_type;
+    using allocator_type = typename Trait::allocator_type;
 
     struct event {
         template <typename Sequence>
@@ -34,6 +37,15 @@ struct lcp_trait {
             size_type lcp_next;
         };
 
+        // the inserted rows in ascending order, the LCP values at them and
+        // at the rows after them
+        struct after_inserting_batch_lcp {
+            seq_type const &text;
+            std::vector<size_type> const &rows;
+            std::vector<size_type> const &lcps;
+            std::vector<size_type> const &next_lcps;
+        };
+
         struct after_erasing_lcp {
             seq_type const &s;
 
@@ -41,6 +53,11 @@ struct lcp_trait {
             size_type lcp;
             size_type lcp_next;
         };
+
+        struct after_building_lcp {
+            seq_type const &text;
+            std::vector<size_type> const &lcpa;
+        };
     };
 };  // class lcp_trait<T>
 
@@ -0,0 +1,48 @@
+/************************************************
+ *  mapped_file.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_MAPPED_FILE_HPP_
+#define DICT_INTERNAL_MAPPED_FILE_HPP_
+
+#include <cstddef>
+
+#include <string>
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class mapped_file
+ ************************************************/
+
+// A file mapped read-only into memory for the lifetime of the object.
+class mapped_file {
+ public:  // Public Type(s)
+    using size_type = std::size_t;
+
+ public:  // Public Method(s)
+    explicit mapped_file(std::string const &path);
+    mapped_file(mapped_file const &) = delete;
+    ~mapped_file();
+
+    mapped_file &operator=(mapped_file const &) = delete;
+
+    void const *data() const;
+    size_type size() const;
+
+ private:  // Private Property(ies)
+    void *data_;
+    size_type size_;
+};  // class mapped_file
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_MAPPED_FILE_HPP_
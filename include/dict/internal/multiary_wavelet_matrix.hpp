@@ -0,0 +1,565 @@
+/************************************************
+ *  multiary_wavelet_matrix.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_MULTIARY_WAVELET_MATRIX_HPP_
+#define DICT_INTERNAL_MULTIARY_WAVELET_MATRIX_HPP_
+
+#include <climits>
+#include <algorithm>
+#include <array>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "flat_partial_sum.hpp"
+#include "serialization.hpp"
+#include "symbol_vector.hpp"
+#include "thread_pool.hpp"
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class multiary_wavelet_matrix<T, H, W, N, A>
+ ************************************************/
+
+// A wavelet matrix that consumes Width bits of the values per level. The
+// Width bitmaps of a level share the blocks of one symbol_vector, so that a
+// single tree descent serves Width binary levels. Only the levels needed by
+// the largest value inserted so far are kept, up to Height bits; the others
+// would hold zeros only. It has the interface of wavelet_matrix<T, H>.
+//
+// Given a thread pool, assign() and insert_batch() build the symbols of
+// each level over chunks of the values in parallel.
+template <typename T, std::size_t Height = sizeof(T) * CHAR_BIT,
+          std::size_t Width = 2, std::size_t N = 64, typename Allocator = std::allocator<T>>
+class multiary_wavelet_matrix {
+ public:  // Public Type(s)
+    using value_type = T;
+    using size_type = std::size_t;
+    using allocator_type = Allocator;
+
+ public:  // Public Method(s)
+    explicit multiary_wavelet_matrix(allocator_type const &alloc = allocator_type());
+
+    allocator_type get_allocator() const;
+    void swap(multiary_wavelet_matrix &other);  // NOLINT(runtime/references)
+
+    void insert(size_type i, value_type c);
+    value_type erase(size_type i);
+    void insert_batch(std::vector<std::pair<size_type, value_type>> const &values);
+    void insert_batch(std::vector<std::pair<size_type, value_type>> const &values,
+                      thread_pool &pool);  // NOLINT(runtime/references)
+
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+    template <typename InputIterator>  // NOLINTNEXTLINE(runtime/references)
+    void assign(InputIterator first, InputIterator last, thread_pool &pool);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
+    size_type size() const;
+    size_type num_levels() const;
+
+    size_type sum(value_type c) const;
+    value_type search(size_type i) const;
+    std::pair<value_type, size_type> access_and_rank(size_type i) const;
+    size_type rank(size_type i, value_type c) const;
+    size_type select(size_type j, value_type c) const;
+
+    std::pair<value_type, size_type> access_and_lf(size_type i) const;
+    size_type lf(size_type i) const;
+    std::pair<size_type, size_type> lf_range(size_type i, size_type j, value_type c) const;
+    std::pair<size_type, value_type> psi_and_access(size_type i) const;
+    size_type psi(size_type i) const;
+    size_type psi(size_type i, value_type hint) const;
+
+    value_type at(size_type i) const;
+
+    value_type operator[](size_type i) const;
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type HEIGHT = Height;
+    static constexpr size_type WIDTH = Width;
+    static constexpr size_type MAX_NUM_LEVELS = (Height + Width - 1) / Width;
+
+ private:  // Private Type(s)
+    using symbols = symbol_vector<Width, N, Allocator>;
+    using symbol_type = typename symbols::value_type;
+    using counts = std::array<size_type, symbols::SIGMA>;
+    using tree_level = std::pair<counts, symbols>;
+
+ private:  // Private Static Method(s)
+    static symbol_type symbol_of(value_type c, size_type l);
+    static size_type num_levels_of(value_type c);
+
+ private:  // Private Method(s)
+    template <std::size_t... Ls>
+    multiary_wavelet_matrix(allocator_type const &alloc, std::index_sequence<Ls...>);
+
+    void grow(size_type num_levels);
+    void increase_num_less(size_type l, symbol_type s);
+    void decrease_num_less(size_type l, symbol_type s);
+    size_type num_less(size_type l, symbol_type s) const;
+    symbols &level_symbols(size_type l);
+    symbols const &level_symbols(size_type l) const;
+    size_type select_at(size_type j, value_type c) const;
+
+ private:  // Private Property(ies)
+    std::array<tree_level, MAX_NUM_LEVELS> levels_;
+    size_type num_levels_ = 1;
+    c_table<value_type, size_type, Height, Allocator> sums_;
+};  // class multiary_wavelet_matrix<T, H, W, N, A>
+
+/************************************************
+ * Implementation: class multiary_wavelet_matrix<T, H, W, N, A>
+ ************************************************/
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline multiary_wavelet_matrix<T, H, W, N, A>::multiary_wavelet_matrix(allocator_type const &alloc)
+    : multiary_wavelet_matrix(alloc, std::make_index_sequence<MAX_NUM_LEVELS>()) {
+    // do nothing
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+template <std::size_t... Ls>
+inline multiary_wavelet_matrix<T, H, W, N, A>::multiary_wavelet_matrix(
+        allocator_type const &alloc, std::index_sequence<Ls...>)
+    // the levels are constructed in place, as in wavelet_matrix
+    : levels_{{{std::piecewise_construct, std::forward_as_tuple(),
+                std::forward_as_tuple((static_cast<void>(Ls), alloc))}...}},
+      sums_(alloc) {
+    // do nothing
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::allocator_type
+multiary_wavelet_matrix<T, H, W, N, A>::get_allocator() const {
+    return level_symbols(0).get_allocator();
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+// NOLINTNEXTLINE(runtime/references)
+inline void multiary_wavelet_matrix<T, H, W, N, A>::swap(multiary_wavelet_matrix &other) {
+    for (size_type l = 0; l < levels_.size(); ++l) {
+        std::swap(levels_[l].first, other.levels_[l].first);
+        levels_[l].second.swap(other.levels_[l].second);
+    }
+
+    std::swap(num_levels_, other.num_levels_);
+    sums_.swap(other.sums_);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void multiary_wavelet_matrix<T, H, W, N, A>::insert(size_type i, value_type c) {
+    grow(num_levels_of(c));
+    sums_.increase(c, 1);
+    for (size_type l = 0; l < num_levels_; ++l) {
+        auto s = symbol_of(c, l);
+        i = num_less(l, s) + level_symbols(l).insert(i, s) - 1;
+        increase_num_less(l, s);
+    }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+typename multiary_wavelet_matrix<T, H, W, N, A>::value_type
+multiary_wavelet_matrix<T, H, W, N, A>::erase(size_type i) {
+    value_type c = 0;
+    for (size_type l = 0; l < num_levels_; ++l) {
+        auto &seq = level_symbols(l);
+        auto s = seq.erase(i);
+        i = (i > 0) ? seq.rank(i - 1, s) : 0;
+        c |= static_cast<value_type>(s << (l * WIDTH));
+        decrease_num_less(l, s);
+        i += num_less(l, s);
+    }
+
+    sums_.decrease(c, 1);
+    return c;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline void multiary_wavelet_matrix<T, H, W, N, A>::insert_batch(
+        std::vector<std::pair<size_type, value_type>> const &values) {
+    thread_pool pool(0);
+    insert_batch(values, pool);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void multiary_wavelet_matrix<T, H, W, N, A>::insert_batch(
+        std::vector<std::pair<size_type, value_type>> const &values,
+        thread_pool &pool) {  // NOLINT(runtime/references)
+    // the values are given with their rows in the result, in ascending order
+    auto num_levels = num_levels_;
+    for (auto const &p : values) {
+        num_levels = std::max(num_levels, num_levels_of(p.second));
+        sums_.increase(p.second, 1);
+    }
+
+    grow(num_levels);
+
+    auto k = values.size();
+    std::vector<std::pair<size_type, value_type>> rows(values), next_rows(k);
+    std::vector<std::pair<size_type, symbol_type>> level_rows(k);
+    for (size_type l = 0; l < num_levels_; ++l) {
+        counts num_inserted{};
+        for (size_type t = 0; t < k; ++t) {
+            auto s = symbol_of(rows[t].second, l);
+            level_rows[t] = std::make_pair(rows[t].first, s);
+            ++num_inserted[s];
+        }
+
+        auto &starts = levels_[l].first;
+        for (size_type s = 1, num = 0; s < symbols::SIGMA; ++s) {
+            num += num_inserted[s - 1];
+            starts[s] += num;
+        }
+
+        auto ranks = level_symbols(l).insert_batch(level_rows, pool);
+
+        // rows on the next level stay ascending within each symbol, and the
+        // symbols are in order there
+        counts next{};
+        for (size_type s = 1; s < symbols::SIGMA; ++s) {
+            next[s] = next[s - 1] + num_inserted[s - 1];
+        }
+
+        for (size_type t = 0; t < k; ++t) {
+            auto s = level_rows[t].second;
+            next_rows[next[s]++] = std::make_pair(num_less(l, s) + ranks[t] - 1, rows[t].second);
+        }
+
+        rows.swap(next_rows);
+    }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+template <typename InputIterator>
+inline void multiary_wavelet_matrix<T, H, W, N, A>::assign(InputIterator first,
+                                                        InputIterator last) {
+    thread_pool pool(0);
+    assign(first, last, pool);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+template <typename InputIterator>  // NOLINTNEXTLINE(runtime/references)
+void multiary_wavelet_matrix<T, H, W, N, A>::assign(InputIterator first, InputIterator last,
+                                                 thread_pool &pool) {
+    std::vector<value_type> values(first, last);
+
+    // the largest value decides the number of levels
+    value_type max_value = 0;
+    for (auto c : values) {
+        if (max_value < c) { max_value = c; }
+    }
+
+    num_levels_ = num_levels_of(max_value);
+    for (auto l = num_levels_; l < MAX_NUM_LEVELS; ++l) {
+        levels_[l].first.fill(0);
+        level_symbols(l).assign(values.end(), values.end());
+    }
+
+    // each level is a stable partition of the previous one by its symbols
+    std::vector<value_type> next_values;
+    for (size_type l = 0; l < num_levels_; ++l) {
+        auto num_symbols = level_symbols(l).assign_and_partition(
+            values, [l](value_type c) { return symbol_of(c, l); }, symbols::SIGMA,
+            next_values, pool);
+
+        auto &starts = levels_[l].first;
+        starts[0] = 0;
+        for (size_type s = 1; s < symbols::SIGMA; ++s) {
+            starts[s] = starts[s - 1] + num_symbols[s - 1];
+        }
+
+        values.swap(next_values);
+    }
+
+    // partitioning by the symbols from the lowest level up sorts the values,
+    // so the distinct ones are counted in one pass, however wide the alphabet
+    std::vector<std::pair<value_type, size_type>> sums;
+    for (auto c : values) {
+        if (sums.empty() || sums.back().first != c) {
+            sums.emplace_back(c, 0);
+        }
+
+        ++sums.back().second;
+    }
+
+    sums_.assign(sums.begin(), sums.end());
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void multiary_wavelet_matrix<T, H, W, N, A>::save(std::ostream &os) const {  // NOLINT
+    write_value<std::uint64_t>(os, HEIGHT);
+    write_value<std::uint64_t>(os, WIDTH);
+    write_value<std::uint64_t>(os, num_levels_);
+    for (size_type l = 0; l < num_levels_; ++l) {
+        for (auto x : levels_[l].first) {
+            write_value<std::uint64_t>(os, x);
+        }
+
+        level_symbols(l).save(os);
+    }
+
+    sums_.save(os);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void multiary_wavelet_matrix<T, H, W, N, A>::load(std::istream &is) {  // NOLINT
+    if (read_value<std::uint64_t>(is) != HEIGHT || read_value<std::uint64_t>(is) != WIDTH) {
+        throw std::runtime_error("mismatched shape of multiary_wavelet_matrix");
+    }
+
+    num_levels_ = read_value<std::uint64_t>(is);
+    if (num_levels_ == 0 || num_levels_ > MAX_NUM_LEVELS) {
+        throw std::runtime_error("invalid number of levels of multiary_wavelet_matrix");
+    }
+
+    for (size_type l = 0; l < MAX_NUM_LEVELS; ++l) {
+        auto &starts = levels_[l].first;
+        if (l < num_levels_) {
+            for (auto &x : starts) {
+                x = read_value<std::uint64_t>(is);
+            }
+
+            level_symbols(l).load(is);
+        } else {
+            starts.fill(0);
+            level_symbols(l).assign(starts.end(), starts.end());
+        }
+    }
+
+    sums_.load(is);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::size() const {
+    return level_symbols(0).size();
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::num_levels() const {
+    return num_levels_;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::sum(value_type c) const {
+    return (c > 0) ? sums_.sum(c - 1) : 0;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::value_type
+multiary_wavelet_matrix<T, H, W, N, A>::search(size_type i) const {
+    return sums_.search(i);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline std::pair<
+    typename multiary_wavelet_matrix<T, H, W, N, A>::value_type,
+    typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+>
+multiary_wavelet_matrix<T, H, W, N, A>::access_and_rank(size_type i) const {
+    auto pair = access_and_lf(i);
+    auto ps = sum(pair.first);
+    return std::make_pair(pair.first, pair.second + 1 - ps);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::rank(size_type i, value_type c) const {
+    if (num_levels_of(c) > num_levels_) { return 0; }
+
+    auto ps = sum(c);
+    for (size_type l = 0; l < num_levels_; ++l) {
+        auto s = symbol_of(c, l);
+        i = level_symbols(l).rank(i, s);
+        if (i > 0) {
+            --i;
+        } else {
+            return 0;
+        }
+
+        i += num_less(l, s);
+    }
+
+    return i + 1 - ps;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::select(size_type j, value_type c) const {
+    return select_at(j + sum(c), c);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+std::pair<
+    typename multiary_wavelet_matrix<T, H, W, N, A>::value_type,
+    typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+>
+multiary_wavelet_matrix<T, H, W, N, A>::access_and_lf(size_type i) const {
+    value_type c = 0;
+    for (size_type l = 0; l < num_levels_; ++l) {
+        auto sr_pair = level_symbols(l).access_and_rank(i);
+        c |= static_cast<value_type>(sr_pair.first << (l * WIDTH));
+        i = num_less(l, sr_pair.first) + sr_pair.second - 1;
+    }
+
+    return std::make_pair(c, i);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::lf(size_type i) const {
+    return access_and_lf(i).second;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+std::pair<
+    typename multiary_wavelet_matrix<T, H, W, N, A>::size_type,
+    typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+>
+multiary_wavelet_matrix<T, H, W, N, A>::lf_range(size_type i, size_type j, value_type c) const {
+    if (num_levels_of(c) > num_levels_) { return std::make_pair(i, i); }
+
+    // map both ends of [i, j) in the same top-down pass
+    for (size_type l = 0; l < num_levels_ && i < j; ++l) {
+        auto const &seq = level_symbols(l);
+        auto s = symbol_of(c, l);
+        i = num_less(l, s) + ((i > 0) ? seq.rank(i - 1, s) : 0);
+        j = num_less(l, s) + ((j > 0) ? seq.rank(j - 1, s) : 0);
+    }
+
+    return (i < j) ? std::make_pair(i, j) : std::make_pair(i, i);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline std::pair<
+    typename multiary_wavelet_matrix<T, H, W, N, A>::size_type,
+    typename multiary_wavelet_matrix<T, H, W, N, A>::value_type
+>
+multiary_wavelet_matrix<T, H, W, N, A>::psi_and_access(size_type i) const {
+    auto c = sums_.search(i + 1);
+    return std::make_pair(select_at(i, c), c);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::psi(size_type i) const {
+    return psi_and_access(i).first;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::psi(size_type i, value_type hint) const {
+    return select_at(i, hint);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::value_type
+multiary_wavelet_matrix<T, H, W, N, A>::at(size_type i) const {
+    return access_and_lf(i).first;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::value_type
+multiary_wavelet_matrix<T, H, W, N, A>::operator[](size_type i) const {
+    return at(i);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::symbol_type
+multiary_wavelet_matrix<T, H, W, N, A>::symbol_of(value_type c, size_type l) {
+    // bits of the last level beyond HEIGHT are always zero
+    auto num_bits = (l + 1 < MAX_NUM_LEVELS) ? WIDTH : HEIGHT - l * WIDTH;
+    return (static_cast<symbol_type>(c) >> (l * WIDTH)) & ((symbol_type(1) << num_bits) - 1);
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::num_levels_of(value_type c) {
+    // levels up to the highest non-zero symbol of c, but at least one
+    auto num_levels = MAX_NUM_LEVELS;
+    while (num_levels > 1 && symbol_of(c, num_levels - 1) == 0) {
+        --num_levels;
+    }
+
+    return num_levels;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+void multiary_wavelet_matrix<T, H, W, N, A>::grow(size_type num_levels) {
+    // existing values only have zeros on the new levels, and the rows of
+    // a new level follow the order left by the current top level
+    auto n = size();
+    std::vector<symbol_type> zeros(num_levels > num_levels_ ? n : 0, 0);
+    for (; num_levels_ < num_levels; ++num_levels_) {
+        auto &starts = levels_[num_levels_].first;
+        starts.fill(n);
+        starts[0] = 0;
+        level_symbols(num_levels_).assign(zeros.begin(), zeros.end());
+    }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline void multiary_wavelet_matrix<T, H, W, N, A>::increase_num_less(size_type l, symbol_type s) {
+    for (auto t = s + 1; t < symbols::SIGMA; ++t) {
+        ++levels_[l].first[t];
+    }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline void multiary_wavelet_matrix<T, H, W, N, A>::decrease_num_less(size_type l, symbol_type s) {
+    for (auto t = s + 1; t < symbols::SIGMA; ++t) {
+        --levels_[l].first[t];
+    }
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::num_less(size_type l, symbol_type s) const {
+    return levels_[l].first[s];
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::symbols &
+multiary_wavelet_matrix<T, H, W, N, A>::level_symbols(size_type l) {
+    return levels_[l].second;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+inline typename multiary_wavelet_matrix<T, H, W, N, A>::symbols const &
+multiary_wavelet_matrix<T, H, W, N, A>::level_symbols(size_type l) const {
+    return levels_[l].second;
+}
+
+template <typename T, std::size_t H, std::size_t W, std::size_t N, typename A>
+typename multiary_wavelet_matrix<T, H, W, N, A>::size_type
+multiary_wavelet_matrix<T, H, W, N, A>::select_at(size_type j, value_type c) const {
+    for (auto l = num_levels_; l > 0; --l) {
+        auto s = symbol_of(c, l - 1);
+        j = level_symbols(l - 1).select(j - num_less(l - 1, s), s);
+    }
+
+    return j;
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_MULTIARY_WAVELET_MATRIX_HPP_
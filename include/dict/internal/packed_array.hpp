@@ -0,0 +1,383 @@
+/************************************************
+ *  packed_array.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_PACKED_ARRAY_HPP_
+#define DICT_INTERNAL_PACKED_ARRAY_HPP_
+
+#include <cassert>
+#include <cstdint>
+
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "rbtree.hpp"
+#include "serialization.hpp"
+#include "value_coding.hpp"
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class packed_array<N, C, A>
+ ************************************************/
+
+// A dynamic array of integers kept in blocks of up to 2N adjacent values,
+// so that an access walks a tree with one node per block rather than one
+// node per value (as tree_list does). Coding stores the values of a block
+// (see value_coding.hpp): fixed_width_coding packs them at the width of the
+// largest one, and byte_escape_coding suits mostly small values.
+template <std::size_t N, template <std::size_t> class Coding = fixed_width_coding,
+          typename Allocator = std::allocator<std::uint64_t>>
+class packed_array {
+ public:  // Public Type(s)
+    using size_type = std::size_t;
+    using value_type = std::uint64_t;
+    using allocator_type = Allocator;
+
+ public:  // Public Method(s)
+    explicit packed_array(allocator_type const &alloc = allocator_type());
+    packed_array(packed_array const &) = default;
+    packed_array(packed_array &&) = default;
+    ~packed_array();
+
+    packed_array &operator=(packed_array const &) = default;
+    packed_array &operator=(packed_array &&) = default;
+
+    allocator_type get_allocator() const;
+    void swap(packed_array &other);  // NOLINT(runtime/references)
+
+    packed_array &set(size_type i, value_type x);
+    void insert(size_type i, value_type x);
+    value_type erase(size_type i);
+
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
+    size_type size() const;
+    value_type at(size_type i) const;
+
+    value_type operator[](size_type i) const;
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type MAX_BLOCK_SIZE = 2 * N;
+    static constexpr size_type MIN_BLOCK_SIZE = MAX_BLOCK_SIZE / 4;
+    static constexpr size_type MAX_MERGE_SIZE = MAX_BLOCK_SIZE - MAX_BLOCK_SIZE / 8;
+
+ private:  // Private Type(s)
+    struct block;
+    struct sizes_updater;
+    using bstree = rbtree<block, sizes_updater, Allocator>;
+    using coding = Coding<MAX_BLOCK_SIZE>;
+
+ private:  // Private Static Method(s)
+    static void equalize_blocks(block &p, block &q);    // NOLINT(runtime/references)
+    static void merge_blocks(block &p, block &q);       // NOLINT(runtime/references)
+    static void update_sizes(typename bstree::iterator it);
+    static void update_node_size(typename bstree::iterator it);
+
+ private:  // Private Method(s)
+    // NOLINTNEXTLINE(runtime/references)
+    typename bstree::iterator find_block(size_type i, size_type &pos);
+    // NOLINTNEXTLINE(runtime/references)
+    typename bstree::const_iterator find_block(size_type i, size_type &pos) const;
+
+ private:  // Private Property(ies)
+    bstree tree_;
+};  // class packed_array<N, C, A>
+
+/************************************************
+ * Declaration: struct packed_array<N, C, A>::block
+ ************************************************/
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+struct packed_array<N, C, A>::block {
+    block()
+        : num_values(0), num_sub_values(0) {
+        // do nothing
+    }
+
+    size_type num_values;
+    size_type num_sub_values;
+    coding values;
+};  // struct packed_array<N, C, A>::block
+
+/************************************************
+ * Declaration: struct packed_array<N, C, A>::sizes_updater
+ ************************************************/
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+struct packed_array<N, C, A>::sizes_updater {
+    void operator()(typename bstree::iterator it) const {
+        update_sizes(it);
+    }
+};  // struct packed_array<N, C, A>::sizes_updater
+
+/************************************************
+ * Implementation: class packed_array<N, C, A>
+ ************************************************/
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline packed_array<N, C, A>::packed_array(allocator_type const &alloc)
+    : tree_(alloc) {
+    // do nothing
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline packed_array<N, C, A>::~packed_array() {
+    // do nothing
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline typename packed_array<N, C, A>::allocator_type
+packed_array<N, C, A>::get_allocator() const {
+    return tree_.get_allocator();
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline void packed_array<N, C, A>::swap(packed_array &other) {  // NOLINT(runtime/references)
+    tree_.swap(other.tree_);
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline packed_array<N, C, A> &packed_array<N, C, A>::set(size_type i, value_type x) {
+    size_type pos = 0;
+    auto it = find_block(i, pos);
+    it->values.set(i - pos, x, it->num_values);
+    return *this;
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+void packed_array<N, C, A>::insert(size_type i, value_type x) {
+    if (!tree_.root()) {
+        assert(i == 0);
+        block bb;
+        bb.values.insert(0, x, 0);
+        bb.num_values = 1;
+        update_sizes(tree_.insert_before(tree_.end(), std::move(bb)));
+        return;
+    }
+
+    auto it = tree_.end();
+    if (i == size()) {
+        --it;
+        i = it->num_values;
+    } else {
+        assert(i < size());
+        size_type pos = 0;
+        it = find_block(i, pos);
+        i -= pos;
+    }
+
+    if (it->num_values >= MAX_BLOCK_SIZE) {
+        // move the first half of a full block into a new one before it
+        block bb;
+        equalize_blocks(bb, *it);
+        auto new_it = tree_.insert_before(it, std::move(bb));
+        if (i >= new_it->num_values) {
+            update_sizes(new_it);
+            i -= new_it->num_values;
+        } else {
+            update_sizes(it);
+            it = new_it;
+        }
+    }
+
+    it->values.insert(i, x, it->num_values);
+    it->num_values++;
+    update_sizes(it);
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+typename packed_array<N, C, A>::value_type packed_array<N, C, A>::erase(size_type i) {
+    size_type pos = 0;
+    auto it = find_block(i, pos);
+    auto x = it->values.erase(i - pos, it->num_values);
+    it->num_values--;
+    update_sizes(it);
+
+    // delete or merge small blocks
+    if (it->num_values == 0) {
+        tree_.erase(it);
+    } else if (it->num_values < MIN_BLOCK_SIZE) {
+        auto prev_it = std::prev(it);
+        auto next_it = std::next(it);
+        if (prev_it && (!next_it || prev_it->num_values < next_it->num_values)) {
+            if (prev_it->num_values + it->num_values <= MAX_MERGE_SIZE) {
+                merge_blocks(*prev_it, *it);
+                update_sizes(prev_it);
+                tree_.erase(it);
+            }
+        } else if (next_it) {
+            if (next_it->num_values + it->num_values <= MAX_MERGE_SIZE) {
+                merge_blocks(*it, *next_it);
+                update_sizes(it);
+                tree_.erase(next_it);
+            }
+        }
+    }
+
+    return x;
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+template <typename InputIterator>
+void packed_array<N, C, A>::assign(InputIterator first, InputIterator last) {
+    // blocks are filled as merging would, up to MAX_MERGE_SIZE values
+    std::vector<value_type> values(first, last);
+    std::vector<block> blocks((values.size() + MAX_MERGE_SIZE - 1) / MAX_MERGE_SIZE);
+    for (size_type k = 0; k < blocks.size(); ++k) {
+        auto offset = k * MAX_MERGE_SIZE;
+        auto n = values.size() - offset;
+        auto &bb = blocks[k];
+        bb.num_values = n < MAX_MERGE_SIZE ? n : MAX_MERGE_SIZE;
+        bb.values.encode(values.data() + offset, bb.num_values);
+    }
+
+    tree_.assign(blocks.begin(), blocks.end(), update_node_size);
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+void packed_array<N, C, A>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    write_value<std::uint64_t>(os, size());
+    for (auto const &bb : tree_) {
+        for (size_type k = 0; k < bb.num_values; ++k) {
+            write_value<std::uint64_t>(os, bb.values.get(k));
+        }
+    }
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+void packed_array<N, C, A>::load(std::istream &is) {  // NOLINT(runtime/references)
+    auto n = read_value<std::uint64_t>(is);
+    check_remaining(is, n, sizeof(std::uint64_t));
+
+    std::vector<value_type> values;
+    values.reserve(n);
+    for (decltype(n) i = 0; i < n; ++i) {
+        values.push_back(read_value<std::uint64_t>(is));
+    }
+
+    assign(values.begin(), values.end());
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline typename packed_array<N, C, A>::size_type packed_array<N, C, A>::size() const {
+    auto root = tree_.root();
+    return root ? root->num_sub_values : 0;
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline typename packed_array<N, C, A>::value_type packed_array<N, C, A>::at(size_type i) const {
+    size_type pos = 0;
+    auto it = find_block(i, pos);
+    return it->values.get(i - pos);
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline typename packed_array<N, C, A>::value_type
+packed_array<N, C, A>::operator[](size_type i) const {
+    return at(i);
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline typename packed_array<N, C, A>::bstree::iterator  // NOLINTNEXTLINE(runtime/references)
+packed_array<N, C, A>::find_block(size_type i, size_type &pos) {
+    auto const &that = *this;
+    auto it = that.find_block(i, pos);
+    return it.unconst();
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+typename packed_array<N, C, A>::bstree::const_iterator  // NOLINTNEXTLINE(runtime/references)
+packed_array<N, C, A>::find_block(size_type i, size_type &pos) const {
+    auto it = tree_.root();
+    while (it) {
+        auto left = it.left();
+        auto num_left_values = left ? left->num_sub_values : 0;
+        if (i < num_left_values) {
+            it.go_left();
+        } else {
+            pos += num_left_values;
+            i -= num_left_values;
+            if (i < it->num_values) {
+                break;
+            } else {
+                pos += it->num_values;
+                i -= it->num_values;
+                it.go_right();
+            }
+        }
+    }
+
+    if (!it) {
+        throw std::out_of_range("index out of range");
+    }
+
+    return it;
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+// NOLINTNEXTLINE(runtime/references)
+void packed_array<N, C, A>::equalize_blocks(block &p, block &q) {
+    // decode both blocks and encode each half again
+    std::vector<value_type> values(p.num_values + q.num_values);
+    p.values.decode(values.data(), p.num_values);
+    q.values.decode(values.data() + p.num_values, q.num_values);
+
+    p.num_values = values.size() / 2;
+    q.num_values = values.size() - p.num_values;
+    p.values.encode(values.data(), p.num_values);
+    q.values.encode(values.data() + p.num_values, q.num_values);
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+// NOLINTNEXTLINE(runtime/references)
+inline void packed_array<N, C, A>::merge_blocks(block &p, block &q) {
+    std::vector<value_type> values(p.num_values + q.num_values);
+    p.values.decode(values.data(), p.num_values);
+    q.values.decode(values.data() + p.num_values, q.num_values);
+
+    p.num_values = values.size();
+    q.num_values = 0;
+    p.values.encode(values.data(), p.num_values);
+    q.values.encode(values.data(), 0);
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline void packed_array<N, C, A>::update_sizes(typename bstree::iterator it) {
+    do {
+        update_node_size(it);
+        it.go_parent();
+    } while (it);
+}
+
+template <std::size_t N, template <std::size_t> class C, typename A>
+inline void packed_array<N, C, A>::update_node_size(typename bstree::iterator it) {
+    it->num_sub_values = it->num_values;
+
+    auto left = it.left();
+    if (left) { it->num_sub_values += left->num_sub_values; }
+
+    auto right = it.right();
+    if (right) { it->num_sub_values += right->num_sub_values; }
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_PACKED_ARRAY_HPP_
@@ -10,31 +10,52 @@
 #define DICT_INTERNAL_PARTIAL_SUM_HPP_
 
 #include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 #include "rbtree.hpp"
+#include "serialization.hpp"
 
 namespace dict {
 
 namespace internal {
 
 /************************************************
- * Declaration: class partial_sum<K, T>
+ * Declaration: class partial_sum<K, T, A>
  ************************************************/
 
-template <typename Key, typename T>
+template <typename Key, typename T, typename Allocator = std::allocator<T>>
 class partial_sum {
  public:  // Public Type(s)
     using key_type = Key;
     using value_type = T;
+    using allocator_type = Allocator;
 
  public:  // Public Method(s)
+    explicit partial_sum(allocator_type const &alloc = allocator_type());
+    partial_sum(partial_sum const &) = default;
+    partial_sum(partial_sum &&) = default;
     ~partial_sum();
 
+    partial_sum &operator=(partial_sum const &) = default;
+    partial_sum &operator=(partial_sum &&) = default;
+
+    allocator_type get_allocator() const;
+    void swap(partial_sum &other);  // NOLINT(runtime/references)
+
     void increase(key_type k, value_type x);
     void decrease(key_type k, value_type x);
 
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
     value_type sum() const;
     value_type sum(key_type k) const;
     key_type search(value_type x) const;
@@ -43,32 +64,33 @@ class partial_sum {
  private:  // Private Type(s)
     struct key_and_sum;
     struct sums_updater;
-    using bstree = rbtree<key_and_sum, sums_updater>;
+    using bstree = rbtree<key_and_sum, sums_updater, Allocator>;
 
  private:  // Private Static Method(s)
     template <typename Op>
     void update(key_type k, value_type x, Op op);
+    static void add_left_sums(typename bstree::iterator it);
 
  private:  // Private Property(ies)
     bstree tree_;
-};  // class partial_sum<K, T>
+};  // class partial_sum<K, T, A>
 
 /************************************************
- * Declaration: struct partial_sum<K, T>::key_and_sum
+ * Declaration: struct partial_sum<K, T, A>::key_and_sum
  ************************************************/
 
-template <typename K, typename T>
-struct partial_sum<K, T>::key_and_sum {
+template <typename K, typename T, typename A>
+struct partial_sum<K, T, A>::key_and_sum {
     key_type key;
     value_type sum;
-};  // struct partial_sum<K, T>::key_and_sum
+};  // struct partial_sum<K, T, A>::key_and_sum
 
 /************************************************
- * Declaration: struct partial_sum<K, T>::sums_updater
+ * Declaration: struct partial_sum<K, T, A>::sums_updater
  ************************************************/
 
-template <typename K, typename T>
-struct partial_sum<K, T>::sums_updater {
+template <typename K, typename T, typename A>
+struct partial_sum<K, T, A>::sums_updater {
     void operator()(typename bstree::iterator it) const {
         if (it.has_parent()) {
             if (it == it.parent().left()) {
@@ -78,29 +100,92 @@ struct partial_sum<K, T>::sums_updater {
             }
         }
     }
-};  // struct partial_sum<K, T>::sums_updater
+};  // struct partial_sum<K, T, A>::sums_updater
 
 /************************************************
- * Implementation: class partial_sum<K, T>
+ * Implementation: class partial_sum<K, T, A>
  ************************************************/
 
-template <typename K, typename T>
-inline partial_sum<K, T>::~partial_sum() {
+template <typename K, typename T, typename A>
+inline partial_sum<K, T, A>::partial_sum(allocator_type const &alloc)
+    : tree_(alloc) {
+    // do nothing
+}
+
+template <typename K, typename T, typename A>
+inline partial_sum<K, T, A>::~partial_sum() {
     // do nothing
 }
 
-template <typename K, typename T>
-inline void partial_sum<K, T>::increase(key_type k, value_type x) {
+template <typename K, typename T, typename A>
+inline typename partial_sum<K, T, A>::allocator_type
+partial_sum<K, T, A>::get_allocator() const {
+    return tree_.get_allocator();
+}
+
+template <typename K, typename T, typename A>
+inline void partial_sum<K, T, A>::swap(partial_sum &other) {  // NOLINT(runtime/references)
+    tree_.swap(other.tree_);
+}
+
+template <typename K, typename T, typename A>
+inline void partial_sum<K, T, A>::increase(key_type k, value_type x) {
     update(k, x, std::plus<T>());
 }
 
-template <typename K, typename T>
-inline void partial_sum<K, T>::decrease(key_type k, value_type x) {
+template <typename K, typename T, typename A>
+inline void partial_sum<K, T, A>::decrease(key_type k, value_type x) {
     update(k, x, std::minus<T>());
 }
 
-template <typename K, typename T>
-typename partial_sum<K, T>::value_type partial_sum<K, T>::sum() const {
+template <typename K, typename T, typename A>
+template <typename InputIterator>
+void partial_sum<K, T, A>::assign(InputIterator first, InputIterator last) {
+    // the input is a sequence of (key, value) pairs sorted by key
+    std::vector<key_and_sum> nodes;
+    for (; first != last; ++first) {
+        nodes.push_back({first->first, first->second});
+    }
+
+    tree_.assign(nodes.begin(), nodes.end(), add_left_sums);
+}
+
+template <typename K, typename T, typename A>
+void partial_sum<K, T, A>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    // nodes are written in order as (key, value) pairs, where the value of
+    // a node is its sum without its left subtree
+    write_value<std::uint64_t>(os, tree_.size());
+    for (auto it = tree_.begin(); it != tree_.end(); ++it) {
+        auto x = it->sum;
+        auto left = it.left();
+        while (left) {
+            x -= left->sum;
+            left.go_right();
+        }
+
+        write_value<key_type>(os, it->key);
+        write_value<value_type>(os, x);
+    }
+}
+
+template <typename K, typename T, typename A>
+void partial_sum<K, T, A>::load(std::istream &is) {  // NOLINT(runtime/references)
+    auto num_nodes = read_value<std::uint64_t>(is);
+    check_remaining(is, num_nodes, sizeof(key_type) + sizeof(value_type));
+
+    std::vector<std::pair<key_type, value_type>> pairs;
+    pairs.reserve(num_nodes);
+    for (decltype(num_nodes) i = 0; i < num_nodes; ++i) {
+        auto k = read_value<key_type>(is);
+        auto x = read_value<value_type>(is);
+        pairs.emplace_back(k, x);
+    }
+
+    assign(pairs.begin(), pairs.end());
+}
+
+template <typename K, typename T, typename A>
+typename partial_sum<K, T, A>::value_type partial_sum<K, T, A>::sum() const {
     auto it = tree_.root();
     auto sum = 0;
     while (it) {
@@ -111,8 +196,8 @@ typename partial_sum<K, T>::value_type partial_sum<K, T>::sum() const {
     return sum;
 }
 
-template <typename K, typename T>
-typename partial_sum<K, T>::value_type partial_sum<K, T>::sum(key_type k) const {
+template <typename K, typename T, typename A>
+typename partial_sum<K, T, A>::value_type partial_sum<K, T, A>::sum(key_type k) const {
     value_type sum = 0;
     auto it = tree_.root();
     while (it) {
@@ -131,15 +216,15 @@ typename partial_sum<K, T>::value_type partial_sum<K, T>::sum(key_type k) const
     return sum;
 }
 
-template <typename K, typename T>
-typename partial_sum<K, T>::key_type partial_sum<K, T>::search(value_type x) const {
+template <typename K, typename T, typename A>
+typename partial_sum<K, T, A>::key_type partial_sum<K, T, A>::search(value_type x) const {
     auto pair = search_and_sum(x);
     return pair.first;
 }
 
-template <typename K, typename T>
-std::pair<typename partial_sum<K, T>::key_type, typename partial_sum<K, T>::value_type>
-partial_sum<K, T>::search_and_sum(value_type x) const {
+template <typename K, typename T, typename A>
+std::pair<typename partial_sum<K, T, A>::key_type, typename partial_sum<K, T, A>::value_type>
+partial_sum<K, T, A>::search_and_sum(value_type x) const {
     auto it = tree_.root();
 
     decltype(x) sum = 0;
@@ -164,9 +249,9 @@ partial_sum<K, T>::search_and_sum(value_type x) const {
     return std::make_pair(key, sum);
 }
 
-template <typename K, typename T>
+template <typename K, typename T, typename A>
 template <typename Op>
-void partial_sum<K, T>::update(key_type k, value_type x, Op op) {
+void partial_sum<K, T, A>::update(key_type k, value_type x, Op op) {
     auto it = tree_.root();
     if (!it) {
         tree_.insert_before(it, {k, op(0, x)});
@@ -196,6 +281,16 @@ void partial_sum<K, T>::update(key_type k, value_type x, Op op) {
     }
 }
 
+template <typename K, typename T, typename A>
+void partial_sum<K, T, A>::add_left_sums(typename bstree::iterator it) {
+    // the sum of a subtree is the sum of the nodes on its right spine
+    auto left = it.left();
+    while (left) {
+        it->sum += left->sum;
+        left.go_right();
+    }
+}
+
 }  // namespace internal
 
 }  // namespace dict
@@ -9,28 +9,55 @@
 #ifndef DICT_INTERNAL_PERMUTATION_HPP_
 #define DICT_INTERNAL_PERMUTATION_HPP_
 
+#include <cstdint>
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "rbtree.hpp"
+#include "serialization.hpp"
 
 namespace dict {
 
 namespace internal {
 
 /************************************************
- * Declaration: class permutation
+ * Declaration: class basic_permutation<A>
  ************************************************/
 
-class permutation {
+template <typename Allocator>
+class basic_permutation {
  public:  // Public Type(s)
     using size_type = std::size_t;
     using value_type = std::size_t;
+    using allocator_type = Allocator;
 
  public:  // Public Method(s)
-    permutation();
+    explicit basic_permutation(allocator_type const &alloc = allocator_type());
+    basic_permutation(basic_permutation const &other);
+    basic_permutation(basic_permutation &&) = default;
+
+    basic_permutation &operator=(basic_permutation const &other);
+    basic_permutation &operator=(basic_permutation &&) = default;
+
+    allocator_type get_allocator() const;
+    void swap(basic_permutation &other);  // NOLINT(runtime/references)
 
     void insert(size_type i, size_type j);
     void erase(size_type i);
     void move(size_type from, size_type to);
 
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
     size_type size() const;
     size_type at(size_type i) const;
     size_type rank(size_type j) const;
@@ -38,69 +65,304 @@ class permutation {
     size_type operator[](size_type i) const;
 
  private:  // Private Type(s)
-    struct link_and_rank;
-    struct ranks_updater;
-    using bstree = rbtree<link_and_rank, ranks_updater>;
+    struct link_and_size;
+    struct sizes_updater;
+    using bstree = rbtree<link_and_size, sizes_updater, Allocator>;
 
  private:  // Private Static Method(s)
     static typename bstree::const_iterator
         find_node(typename bstree::const_iterator it, size_type i);
-    static size_type access(typename bstree::const_iterator it, size_type i);
-    static void update_ranks(typename bstree::iterator it);
+    static size_type access(typename bstree::const_iterator it, bstree const &linked_tree,
+                            size_type i);
+    static void update_sizes(typename bstree::iterator it);
+    static void update_node_size(typename bstree::iterator it);
+
+ private:  // Private Method(s)
+    void assign_values(std::vector<size_type> const &values);
+    void relink(basic_permutation const &other);
 
  private:  // Private Property(ies)
     bstree tree_, inv_tree_;
     size_type size_;
-};  // class permutation
+};  // class basic_permutation<A>
+
+/************************************************
+ * Declaration: alias permutation
+ ************************************************/
+
+using permutation = basic_permutation<std::allocator<std::size_t>>;
 
 /************************************************
- * Declaration: struct permutation::link_and_rank
+ * Declaration: struct basic_permutation<A>::link_and_size
  ************************************************/
 
-struct permutation::link_and_rank {
-    link_and_rank() : rank(1) {
+template <typename A>
+struct basic_permutation<A>::link_and_size {
+    link_and_size() : left_size(0), size(1) {
         // do nothing
     }
 
-    bstree::iterator link;
-    size_type rank;
-};  // struct permutation::link_and_rank
+    // a node rather than an iterator, which would name the tree it was
+    // taken from and so break when the trees are moved or swapped
+    typename bstree::iterator::node_ptr link;
+    size_type left_size;
+    size_type size;
+};  // struct basic_permutation<A>::link_and_size
 
 /************************************************
- * Declaration: struct permutation::ranks_updater
+ * Declaration: struct basic_permutation<A>::sizes_updater
  ************************************************/
 
-struct permutation::ranks_updater {
+template <typename A>
+struct basic_permutation<A>::sizes_updater {
     void operator()(typename bstree::iterator it) const {
-        update_ranks(it);
+        update_sizes(it);
     }
-};  // struct permutation::ranks_updater
+};  // struct basic_permutation<A>::sizes_updater
 
 /************************************************
- * Implementation: class permutation
+ * Implementation: class basic_permutation<A>
  ************************************************/
 
-inline permutation::permutation()
-    : size_(0) {
+template <typename A>
+inline basic_permutation<A>::basic_permutation(allocator_type const &alloc)
+    : tree_(alloc), inv_tree_(alloc), size_(0) {
     // do nothing
 }
 
-inline permutation::size_type permutation::size() const {
+template <typename A>
+basic_permutation<A>::basic_permutation(basic_permutation const &other)
+    : tree_(other.tree_), inv_tree_(other.inv_tree_), size_(other.size_) {
+    relink(other);
+}
+
+template <typename A>
+basic_permutation<A> &basic_permutation<A>::operator=(basic_permutation const &other) {
+    tree_ = other.tree_;
+    inv_tree_ = other.inv_tree_;
+    size_ = other.size_;
+    relink(other);
+    return *this;
+}
+
+template <typename A>
+inline typename basic_permutation<A>::allocator_type
+basic_permutation<A>::get_allocator() const {
+    return tree_.get_allocator();
+}
+
+template <typename A>
+inline void basic_permutation<A>::swap(basic_permutation &other) {  // NOLINT(runtime/references)
+    tree_.swap(other.tree_);
+    inv_tree_.swap(other.inv_tree_);
+    std::swap(size_, other.size_);
+}
+
+template <typename A>
+template <typename InputIterator>
+inline void basic_permutation<A>::assign(InputIterator first, InputIterator last) {
+    assign_values(std::vector<size_type>(first, last));
+}
+
+template <typename A>
+inline typename basic_permutation<A>::size_type basic_permutation<A>::size() const {
     return size_;
 }
 
-inline permutation::size_type permutation::at(size_type i) const {
-    return access(tree_.root(), i);
+template <typename A>
+inline typename basic_permutation<A>::size_type basic_permutation<A>::at(size_type i) const {
+    return access(tree_.root(), inv_tree_, i);
 }
 
-inline permutation::size_type permutation::rank(size_type j) const {
-    return access(inv_tree_.root(), j);
+template <typename A>
+inline typename basic_permutation<A>::size_type basic_permutation<A>::rank(size_type j) const {
+    return access(inv_tree_.root(), tree_, j);
 }
 
-inline permutation::size_type permutation::operator[](size_type i) const {
+template <typename A>
+inline typename basic_permutation<A>::size_type
+basic_permutation<A>::operator[](size_type i) const {
     return at(i);
 }
 
+template <typename A>
+void basic_permutation<A>::insert(size_type i, size_type j) {
+    auto it = find_node(tree_.croot(), i).unconst();
+    it = tree_.insert_before(it, link_and_size());
+    update_sizes(it);
+
+    auto inv_it = find_node(inv_tree_.croot(), j).unconst();
+    inv_it = inv_tree_.insert_before(inv_it, link_and_size());
+    update_sizes(inv_it);
+
+    it->link = inv_it.get_node_ptr();
+    inv_it->link = it.get_node_ptr();
+    size_++;
+}
+
+template <typename A>
+void basic_permutation<A>::erase(size_type i) {
+    auto it = find_node(tree_.croot(), i).unconst();
+    auto inv_it = typename bstree::iterator(&inv_tree_, it->link);
+
+    tree_.erase(it);
+    inv_tree_.erase(inv_it);
+    size_--;
+}
+
+template <typename A>
+void basic_permutation<A>::move(size_type from, size_type to) {
+    auto from_it = find_node(tree_.croot(), from).unconst();
+    auto v = *from_it;
+    v.left_size = 0;
+    v.size = 1;
+
+    tree_.erase(from_it);
+
+    auto to_it = find_node(tree_.croot(), to).unconst();
+    auto new_it = tree_.insert_before(to_it, v);
+    update_sizes(new_it);
+
+    typename bstree::iterator(&inv_tree_, new_it->link)->link = new_it.get_node_ptr();
+}
+
+template <typename A>
+void basic_permutation<A>::assign_values(std::vector<size_type> const &values) {
+    auto n = values.size();
+    std::vector<link_and_size> nodes(n);
+    tree_.assign(nodes.begin(), nodes.end(), update_node_size);
+    inv_tree_.assign(nodes.begin(), nodes.end(), update_node_size);
+
+    std::vector<typename bstree::iterator> inv_its;
+    inv_its.reserve(n);
+    for (auto inv_it = inv_tree_.begin(); inv_it != inv_tree_.end(); ++inv_it) {
+        inv_its.push_back(inv_it);
+    }
+
+    auto it = tree_.begin();
+    for (size_type i = 0; i < n; ++i, ++it) {
+        auto inv_it = inv_its[values[i]];
+        it->link = inv_it.get_node_ptr();
+        inv_it->link = it.get_node_ptr();
+    }
+
+    size_ = n;
+}
+
+template <typename A>
+void basic_permutation<A>::relink(basic_permutation const &other) {
+    // the copied links still point into the trees of other, whose nodes are
+    // in the same order as the copied ones
+    std::unordered_map<typename bstree::const_iterator::node_ptr,
+                       typename bstree::iterator> inv_its;
+    auto inv_it = inv_tree_.begin();
+    for (auto other_it = other.inv_tree_.begin(); other_it != other.inv_tree_.end(); ++other_it) {
+        inv_its.emplace(other_it.get_node_ptr(), inv_it++);
+    }
+
+    for (auto it = tree_.begin(); it != tree_.end(); ++it) {
+        auto inv_it = inv_its.at(it->link);
+        it->link = inv_it.get_node_ptr();
+        inv_it->link = it.get_node_ptr();
+    }
+}
+
+template <typename A>
+void basic_permutation<A>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    // number the nodes of the inverse tree in order, so that each value can
+    // be written without a search from the root
+    std::unordered_map<typename bstree::const_iterator::node_ptr, size_type> inv_ranks;
+    size_type j = 0;
+    for (auto inv_it = inv_tree_.begin(); inv_it != inv_tree_.end(); ++inv_it) {
+        inv_ranks.emplace(inv_it.get_node_ptr(), j++);
+    }
+
+    write_value<std::uint64_t>(os, size_);
+    for (auto it = tree_.begin(); it != tree_.end(); ++it) {
+        write_value<std::uint64_t>(os, inv_ranks.at(it->link));
+    }
+}
+
+template <typename A>
+void basic_permutation<A>::load(std::istream &is) {  // NOLINT(runtime/references)
+    auto n = read_value<std::uint64_t>(is);
+    check_remaining(is, n, sizeof(std::uint64_t));
+
+    std::vector<size_type> values;
+    values.reserve(n);
+    std::vector<bool> used(n, false);
+    for (decltype(n) i = 0; i < n; ++i) {
+        auto j = read_value<std::uint64_t>(is);
+        if (j >= n || used[j]) {
+            throw std::runtime_error("invalid permutation");
+        }
+
+        used[j] = true;
+        values.push_back(j);
+    }
+
+    assign_values(values);
+}
+
+template <typename A>
+typename basic_permutation<A>::bstree::const_iterator
+basic_permutation<A>::find_node(typename bstree::const_iterator it, size_type i) {
+    while (it) {
+        if (i < it->left_size) {
+            it.go_left();
+        } else if (i == it->left_size) {
+            break;
+        } else {
+            i -= it->left_size + 1;
+            it.go_right();
+        }
+    }
+
+    return it;
+}
+
+template <typename A>
+typename basic_permutation<A>::size_type
+basic_permutation<A>::access(typename bstree::const_iterator it, bstree const &linked_tree,
+                             size_type i) {
+    it = find_node(it, i);
+    auto linked_it = typename bstree::const_iterator(&linked_tree, it->link);
+    auto rank = linked_it->left_size;
+    auto parent = linked_it.parent();
+    while (parent) {
+        if (linked_it == parent.right()) {
+            rank += parent->left_size + 1;
+        }
+
+        linked_it.go_parent();
+        parent.go_parent();
+    }
+
+    return rank;
+}
+
+template <typename A>
+void basic_permutation<A>::update_sizes(typename bstree::iterator it) {
+    // each node only sums its children, so a path is updated in O(log n)
+    while (it) {
+        update_node_size(it);
+        it.go_parent();
+    }
+}
+
+template <typename A>
+void basic_permutation<A>::update_node_size(typename bstree::iterator it) {
+    // the size of the left subtree is kept as well to spare searches a
+    // visit to the left child
+    it->left_size = it.has_left() ? it.left()->size : 0;
+    it->size = it->left_size + 1;
+    if (it.has_right()) {
+        it->size += it.right()->size;
+    }
+}
+
+extern template class basic_permutation<std::allocator<std::size_t>>;
+
 }  // namespace internal
 
 }  // namespace dict
@@ -9,9 +9,11 @@
 #ifndef DICT_INTERNAL_RBTREE_HPP_
 #define DICT_INTERNAL_RBTREE_HPP_
 
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
 
+#include <iterator>
 #include <memory>
 #include <type_traits>
 #include <utility>
@@ -21,10 +23,15 @@ namespace dict {
 namespace internal {
 
 /************************************************
- * Declaration: class rbtree<T, U>
+ * Declaration: class rbtree<T, U, A>
  ************************************************/
 
-template <typename T, typename Updater>
+// Nodes are allocated from a pool owned by each tree, so independent trees
+// share no state and the pool is released with the tree. For the same
+// reason, copying a tree is a deep copy of all its nodes in linear time;
+// trees never share nodes, so a copy is not a persistent version. Moving
+// a tree takes over its pool and nodes in constant time.
+template <typename T, typename Updater, typename Allocator = std::allocator<T>>
 class rbtree {
  private:  // Private Type(s) - Part 1
     template <bool IsConst> class tree_iterator;
@@ -32,12 +39,23 @@ class rbtree {
  public:  // Public Type(s)
     using size_type = std::size_t;
     using value_type = T;
+    using allocator_type = Allocator;
 
     using iterator = tree_iterator<false>;
     using const_iterator = tree_iterator<true>;
 
  public:  // Public Method(s)
-    rbtree();
+    explicit rbtree(allocator_type const &alloc = allocator_type());
+    rbtree(rbtree const &other);
+    rbtree(rbtree &&other) noexcept;
+
+    rbtree &operator=(rbtree const &other);
+    rbtree &operator=(rbtree &&other) noexcept(
+        std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value);
+
+    void swap(rbtree &other);  // NOLINT(runtime/references)
+
+    allocator_type get_allocator() const;
 
     iterator root();
     const_iterator root() const;
@@ -53,6 +71,9 @@ class rbtree {
     iterator insert_before(iterator it, value_type &&data, Updater const &update = Updater());
     iterator erase(iterator it, Updater const &update = Updater());
 
+    template <typename RandomAccessIterator, typename Visitor>
+    void assign(RandomAccessIterator first, RandomAccessIterator last, Visitor visit);
+
     size_type size() const;
 
  private:  // Private Type(s) - Part 2
@@ -70,6 +91,13 @@ class rbtree {
     void rebalance_after_insertion(weak_node_ptr ptr, weak_node_ptr parent, Updater const &update);
     void rebalance_after_erasure(weak_node_ptr ptr, weak_node_ptr parent, Updater const &update);
 
+    void copy_nodes(rbtree const &other);
+    weak_node_ptr copy_subtree(weak_const_node_ptr ptr);
+
+    template <typename RandomAccessIterator, typename Visitor>
+    weak_node_ptr build_subtree(RandomAccessIterator first, size_type n,
+                                size_type depth, size_type red_depth, Visitor &visit);
+
     void rotate_left(weak_node_ptr weak_ptr, Updater const &update);
     void rotate_right(weak_node_ptr weak_ptr, Updater const &update);
 
@@ -80,20 +108,21 @@ class rbtree {
     static bool is_black_node(weak_const_node_ptr ptr);
 
  private:  // Private Static Property(ies)
-    constexpr static size_type INITIAL_POOL_SIZE = 1024;
-    static node_pool pool_;
+    constexpr static size_type INITIAL_POOL_SIZE = 32;
 
  private:  // Private Property(ies)
+    // declared before root_ so that the nodes are destroyed first
+    node_pool pool_;
     node_ptr root_;
     weak_node_ptr first_, last_;
-};  // class rbtree<T, U>
+};  // class rbtree<T, U, A>
 
 /************************************************
- * Declaration: class rbtree<T, U>::node
+ * Declaration: class rbtree<T, U, A>::node
  ************************************************/
 
-template <typename T, typename U>
-class rbtree<T, U>::node {
+template <typename T, typename U, typename A>
+class rbtree<T, U, A>::node {
  public:  // Public Method(s)
     explicit node(value_type &&data);
     explicit node(value_type const &data);
@@ -127,16 +156,16 @@ class rbtree<T, U>::node {
     node_ptr left_, right_;
     color color_;
     value_type data_;
-};  // class rbtree<T, U>::node
+};  // class rbtree<T, U, A>::node
 
 /************************************************
- * Declaration: class rbtree<T, U>::node_pool
+ * Declaration: class rbtree<T, U, A>::node_pool
  ************************************************/
 
-template <typename T, typename U>
-class rbtree<T, U>::node_pool {
+template <typename T, typename U, typename A>
+class rbtree<T, U, A>::node_pool {
  public:  // Public Method(s)
-    explicit node_pool(size_type size);
+    explicit node_pool(allocator_type const &alloc);
     node_pool(node_pool const &) = delete;
     ~node_pool();
 
@@ -144,7 +173,12 @@ class rbtree<T, U>::node_pool {
 
     template <typename ...Args>
     weak_node_ptr new_node(Args &&...args);
-    void delete_node(weak_node_ptr p);
+    void free_node(weak_node_ptr p);
+    void clear();
+    void swap(node_pool &other);  // NOLINT(runtime/references)
+
+    allocator_type get_allocator() const;
+    void set_allocator(allocator_type const &alloc);
 
  private:  // Private Type(s)
     union block {
@@ -155,36 +189,40 @@ class rbtree<T, U>::node_pool {
         block *next;
     };
 
+    using block_allocator = typename std::allocator_traits<A>::template rebind_alloc<block>;
+
  private:  // Private Property(ies)
+    block_allocator alloc_;
     size_type next_size_;
     block *chunks_head_;
     block *free_list_head_;
-};  // class rbtree<T, U>::node_pool
+};  // class rbtree<T, U, A>::node_pool
 
 /************************************************
- * Declaration: struct rbtree<T, U>::node_deleter
+ * Declaration: struct rbtree<T, U, A>::node_deleter
  ************************************************/
 
-template <typename T, typename U>
-struct rbtree<T, U>::node_deleter {
+template <typename T, typename U, typename A>
+struct rbtree<T, U, A>::node_deleter {
     void operator()(weak_node_ptr p) const {
-        pool_.delete_node(p);
+        // the storage is returned to the pool by the owning tree
+        p->~node();
     }
-};  // struct rbtree<T, U>::node_deleter
+};  // struct rbtree<T, U, A>::node_deleter
 
 /************************************************
- * Declaration: class rbtree<T, U>::tree_iterator<B>
+ * Declaration: class rbtree<T, U, A>::tree_iterator<B>
  ************************************************/
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool IsConst>
-class rbtree<T, U>::tree_iterator {
+class rbtree<T, U, A>::tree_iterator {
  public:  // Public Type(s)
     using iterator_category = std::bidirectional_iterator_tag;
     using value_type = typename std::conditional<
         IsConst,
-        rbtree<T, U>::value_type const,
-        rbtree<T, U>::value_type
+        rbtree<T, U, A>::value_type const,
+        rbtree<T, U, A>::value_type
     >::type;
     using pointer = value_type *;
     using reference = value_type &;
@@ -200,7 +238,7 @@ class rbtree<T, U>::tree_iterator {
     tree_iterator();
     explicit tree_iterator(rbtree const *tree);
     tree_iterator(rbtree const *tree, node_ptr ptr);
-    tree_iterator(rbtree const *tree, typename rbtree<T, U>::node_ptr const &ptr);
+    tree_iterator(rbtree const *tree, typename rbtree<T, U, A>::node_ptr const &ptr);
 
     bool has_parent();
     bool has_left();
@@ -233,81 +271,145 @@ class rbtree<T, U>::tree_iterator {
  private:  // Private Property(ies)
     rbtree const *tree_;
     node_ptr ptr_;
-};  // class rbtree<T, U>::tree_iterator<B>
+};  // class rbtree<T, U, A>::tree_iterator<B>
 
 /************************************************
- * Implementation: class rbtree<T, U>
+ * Implementation: class rbtree<T, U, A>
  ************************************************/
 
-template <typename T, typename U>
-typename rbtree<T, U>::node_pool rbtree<T, U>::pool_(INITIAL_POOL_SIZE);
-
-template <typename T, typename U>
-inline rbtree<T, U>::rbtree() : first_(nullptr), last_(nullptr) {
+template <typename T, typename U, typename A>
+inline rbtree<T, U, A>::rbtree(allocator_type const &alloc)
+    : pool_(alloc), first_(nullptr), last_(nullptr) {
     // do nothing
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::iterator rbtree<T, U>::root() {
+template <typename T, typename U, typename A>
+inline rbtree<T, U, A>::rbtree(rbtree const &other)
+    : pool_(std::allocator_traits<allocator_type>::select_on_container_copy_construction(
+          other.get_allocator())),
+      first_(nullptr), last_(nullptr) {
+    copy_nodes(other);
+}
+
+template <typename T, typename U, typename A>
+rbtree<T, U, A> &rbtree<T, U, A>::operator=(rbtree const &other) {
+    if (this != &other) {
+        root_.reset();
+        pool_.clear();
+        first_ = last_ = nullptr;
+        if (std::allocator_traits<allocator_type>::propagate_on_container_copy_assignment::value) {
+            pool_.set_allocator(other.get_allocator());
+        }
+
+        copy_nodes(other);
+    }
+
+    return *this;
+}
+
+template <typename T, typename U, typename A>
+inline rbtree<T, U, A>::rbtree(rbtree &&other) noexcept
+    : pool_(other.get_allocator()), first_(nullptr), last_(nullptr) {
+    swap(other);
+}
+
+template <typename T, typename U, typename A>
+rbtree<T, U, A> &rbtree<T, U, A>::operator=(rbtree &&other) noexcept(
+        std::allocator_traits<A>::propagate_on_container_move_assignment::value) {
+    if (this != &other) {
+        root_.reset();
+        pool_.clear();
+        first_ = last_ = nullptr;
+        if (std::allocator_traits<allocator_type>::propagate_on_container_move_assignment::value) {
+            pool_.set_allocator(other.get_allocator());
+        }
+
+        // nodes can only be taken over from a pool of an equal allocator
+        if (get_allocator() == other.get_allocator()) {
+            swap(other);
+        } else {
+            copy_nodes(other);
+        }
+    }
+
+    return *this;
+}
+
+template <typename T, typename U, typename A>
+inline void rbtree<T, U, A>::swap(rbtree &other) {  // NOLINT(runtime/references)
+    // nodes stay where they are, so only the pools and the pointers move
+    pool_.swap(other.pool_);
+    root_.swap(other.root_);
+    std::swap(first_, other.first_);
+    std::swap(last_, other.last_);
+}
+
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::allocator_type rbtree<T, U, A>::get_allocator() const {
+    return pool_.get_allocator();
+}
+
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::iterator rbtree<T, U, A>::root() {
     return iterator(this, root_);
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::const_iterator rbtree<T, U>::root() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::const_iterator rbtree<T, U, A>::root() const {
     return croot();
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::const_iterator rbtree<T, U>::croot() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::const_iterator rbtree<T, U, A>::croot() const {
     return const_iterator(this, root_);
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::iterator rbtree<T, U>::begin() {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::iterator rbtree<T, U, A>::begin() {
     return iterator(this, first_);
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::const_iterator rbtree<T, U>::begin() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::const_iterator rbtree<T, U, A>::begin() const {
     return cbegin();
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::const_iterator rbtree<T, U>::cbegin() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::const_iterator rbtree<T, U, A>::cbegin() const {
     return const_iterator(this, first_);
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::iterator rbtree<T, U>::end() {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::iterator rbtree<T, U, A>::end() {
     return iterator(this);
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::const_iterator rbtree<T, U>::end() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::const_iterator rbtree<T, U, A>::end() const {
     return cend();
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::const_iterator rbtree<T, U>::cend() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::const_iterator rbtree<T, U, A>::cend() const {
     return const_iterator(this);
 }
 
-template <typename T, typename U>
-typename rbtree<T, U>::iterator rbtree<T, U>::insert_before(
+template <typename T, typename U, typename A>
+typename rbtree<T, U, A>::iterator rbtree<T, U, A>::insert_before(
         iterator it, value_type const &data, U const &update) {
     auto new_node_ptr = pool_.new_node(data);
     return insert_before(it, new_node_ptr, update);
 }
 
-template <typename T, typename U>
-typename rbtree<T, U>::iterator rbtree<T, U>::insert_before(
+template <typename T, typename U, typename A>
+typename rbtree<T, U, A>::iterator rbtree<T, U, A>::insert_before(
         iterator it, value_type &&data, U const &update) {
     auto new_node_ptr = pool_.new_node(std::move(data));
     return insert_before(it, new_node_ptr, update);
 }
 
-template <typename T, typename U>
-typename rbtree<T, U>::iterator rbtree<T, U>::insert_before(
+template <typename T, typename U, typename A>
+typename rbtree<T, U, A>::iterator rbtree<T, U, A>::insert_before(
         iterator it, weak_node_ptr new_node_ptr, U const &update) {
     auto ptr = it.get_node_ptr();
     if (ptr) {
@@ -344,12 +446,13 @@ typename rbtree<T, U>::iterator rbtree<T, U>::insert_before(
     return iterator(this, new_node_ptr);
 }
 
-template <typename T, typename U>
-typename rbtree<T, U>::iterator rbtree<T, U>::erase(iterator it, U const &update) {
+template <typename T, typename U, typename A>
+typename rbtree<T, U, A>::iterator rbtree<T, U, A>::erase(iterator it, U const &update) {
     auto ptr = it.get_node_ptr();
     if (first_ == ptr && last_ == ptr) {
         // current node is at the root of the tree
-        root_.release();
+        root_.reset();
+        pool_.clear();
         first_ = last_ = nullptr;
         return end();
     }
@@ -429,7 +532,8 @@ typename rbtree<T, U>::iterator rbtree<T, U>::erase(iterator it, U const &update
         update(it);
     } else if (it && it.parent() != next_parent_it) {
         update(next_parent_it);
-    } else {
+    } else if (parent_it) {
+        // no update is needed if the erased node was the root
         update(parent_it);
     }
 
@@ -437,11 +541,39 @@ typename rbtree<T, U>::iterator rbtree<T, U>::erase(iterator it, U const &update
         rebalance_after_erasure(child, parent, update);
     }
 
+    // the unlinked node has been destroyed by its previous owner
+    pool_.free_node(ptr);
     return iterator(this, next_ptr);
 }
 
-template <typename T, typename U>
-void rbtree<T, U>::rebalance_after_insertion(
+template <typename T, typename U, typename A>
+template <typename RandomAccessIterator, typename Visitor>
+void rbtree<T, U, A>::assign(RandomAccessIterator first, RandomAccessIterator last,
+                             Visitor visit) {
+    root_.reset();
+    pool_.clear();
+    first_ = last_ = nullptr;
+
+    auto n = static_cast<size_type>(std::distance(first, last));
+    if (n == 0) { return; }
+
+    // the tree is perfectly balanced, so only nodes at the deepest level
+    // (if it is not full) need to be red
+    size_type red_depth = 0;
+    while ((static_cast<size_type>(2) << red_depth) - 1 < n) {
+        ++red_depth;
+    }
+
+    root_.reset(build_subtree(first, n, 0, red_depth, visit));
+    root_->set_color(color::black);
+
+    first_ = last_ = root_.get();
+    while (first_->get_left()) { first_ = first_->get_left(); }
+    while (last_->get_right()) { last_ = last_->get_right(); }
+}
+
+template <typename T, typename U, typename A>
+void rbtree<T, U, A>::rebalance_after_insertion(
         weak_node_ptr ptr, weak_node_ptr parent, U const &update) {
     while (is_red_node(parent)) {
         auto grandparent = parent->get_parent();
@@ -485,8 +617,8 @@ void rbtree<T, U>::rebalance_after_insertion(
     root_->set_color(color::black);
 }
 
-template <typename T, typename U>
-void rbtree<T, U>::rebalance_after_erasure(
+template <typename T, typename U, typename A>
+void rbtree<T, U, A>::rebalance_after_erasure(
         weak_node_ptr ptr, weak_node_ptr parent, U const &update) {
     while (parent && is_black_node(ptr)) {
         auto sibling = (ptr == parent->get_left())
@@ -557,8 +689,68 @@ void rbtree<T, U>::rebalance_after_erasure(
     }
 }
 
-template <typename T, typename U>
-void rbtree<T, U>::rotate_left(weak_node_ptr ptr, U const &update) {
+template <typename T, typename U, typename A>
+void rbtree<T, U, A>::copy_nodes(rbtree const &other) {
+    if (!other.root_) { return; }
+
+    // nodes are copied along with their colors and data (including any
+    // subtree sizes kept in it), so the copy needs neither rebalancing nor
+    // updates
+    root_.reset(copy_subtree(other.root_.get()));
+
+    first_ = last_ = root_.get();
+    while (first_->get_left()) { first_ = first_->get_left(); }
+    while (last_->get_right()) { last_ = last_->get_right(); }
+}
+
+template <typename T, typename U, typename A>
+typename rbtree<T, U, A>::weak_node_ptr rbtree<T, U, A>::copy_subtree(weak_const_node_ptr ptr) {
+    auto new_ptr = pool_.new_node(ptr->data());
+    new_ptr->set_color(ptr->get_color());
+
+    if (ptr->get_left()) {
+        auto left = copy_subtree(ptr->get_left());
+        left->set_parent(new_ptr);
+        new_ptr->set_left(left);
+    }
+
+    if (ptr->get_right()) {
+        auto right = copy_subtree(ptr->get_right());
+        right->set_parent(new_ptr);
+        new_ptr->set_right(right);
+    }
+
+    return new_ptr;
+}
+
+template <typename T, typename U, typename A>
+template <typename RandomAccessIterator, typename Visitor>
+typename rbtree<T, U, A>::weak_node_ptr rbtree<T, U, A>::build_subtree(
+        RandomAccessIterator first, size_type n,
+        size_type depth, size_type red_depth, Visitor &visit) {
+    auto mid = n / 2;
+    auto ptr = pool_.new_node(first[mid]);
+    ptr->set_color(depth == red_depth ? color::red : color::black);
+
+    if (mid > 0) {
+        auto left = build_subtree(first, mid, depth + 1, red_depth, visit);
+        left->set_parent(ptr);
+        ptr->set_left(left);
+    }
+
+    if (n - mid > 1) {
+        auto right = build_subtree(first + mid + 1, n - mid - 1, depth + 1, red_depth, visit);
+        right->set_parent(ptr);
+        ptr->set_right(right);
+    }
+
+    // subtrees are complete before their parent is visited
+    visit(iterator(this, ptr));
+    return ptr;
+}
+
+template <typename T, typename U, typename A>
+void rbtree<T, U, A>::rotate_left(weak_node_ptr ptr, U const &update) {
     auto parent = ptr->get_parent();
     auto right = ptr->move_right();
     right->set_parent(parent);
@@ -583,8 +775,8 @@ void rbtree<T, U>::rotate_left(weak_node_ptr ptr, U const &update) {
     update(iterator(this, ptr));
 }
 
-template <typename T, typename U>
-void rbtree<T, U>::rotate_right(weak_node_ptr ptr, U const &update) {
+template <typename T, typename U, typename A>
+void rbtree<T, U, A>::rotate_right(weak_node_ptr ptr, U const &update) {
     auto parent = ptr->get_parent();
     auto left = ptr->move_left();
     left->set_parent(parent);
@@ -609,8 +801,8 @@ void rbtree<T, U>::rotate_right(weak_node_ptr ptr, U const &update) {
     update(iterator(this, ptr));
 }
 
-template <typename T, typename U>
-typename rbtree<T, U>::weak_node_ptr rbtree<T, U>::next_node(weak_const_node_ptr ptr) const {
+template <typename T, typename U, typename A>
+typename rbtree<T, U, A>::weak_node_ptr rbtree<T, U, A>::next_node(weak_const_node_ptr ptr) const {
     if (!ptr) {
         ptr = first_;
     } else if (ptr == last_) {
@@ -631,8 +823,8 @@ typename rbtree<T, U>::weak_node_ptr rbtree<T, U>::next_node(weak_const_node_ptr
     return const_cast<weak_node_ptr>(ptr);
 }
 
-template <typename T, typename U>
-typename rbtree<T, U>::weak_node_ptr rbtree<T, U>::prev_node(weak_const_node_ptr ptr) const {
+template <typename T, typename U, typename A>
+typename rbtree<T, U, A>::weak_node_ptr rbtree<T, U, A>::prev_node(weak_const_node_ptr ptr) const {
     if (!ptr) {
         ptr = last_;
     } else if (ptr == first_) {
@@ -653,154 +845,150 @@ typename rbtree<T, U>::weak_node_ptr rbtree<T, U>::prev_node(weak_const_node_ptr
     return const_cast<weak_node_ptr>(ptr);
 }
 
-template <typename T, typename U>
-inline bool rbtree<T, U>::is_red_node(weak_const_node_ptr ptr) {
+template <typename T, typename U, typename A>
+inline bool rbtree<T, U, A>::is_red_node(weak_const_node_ptr ptr) {
     return ptr && ptr->get_color() == color::red;
 }
 
-template <typename T, typename U>
-inline bool rbtree<T, U>::is_black_node(weak_const_node_ptr ptr) {
+template <typename T, typename U, typename A>
+inline bool rbtree<T, U, A>::is_black_node(weak_const_node_ptr ptr) {
     return !is_red_node(ptr);
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::size_type rbtree<T, U>::size() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::size_type rbtree<T, U, A>::size() const {
     return root_ ? root_->size() : 0;
 }
 
 /************************************************
- * Implementation: struct rbtree<T, U>::node
+ * Implementation: struct rbtree<T, U, A>::node
  ************************************************/
 
-template <typename T, typename U>
-inline rbtree<T, U>::node::node(T &&data)
+template <typename T, typename U, typename A>
+inline rbtree<T, U, A>::node::node(T &&data)
     : parent_(nullptr), data_(std::move(data)) {
     // do nothing
 }
 
-template <typename T, typename U>
-inline rbtree<T, U>::node::node(T const &data)
+template <typename T, typename U, typename A>
+inline rbtree<T, U, A>::node::node(T const &data)
     : parent_(nullptr), data_(data) {
     // do nothing
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::weak_const_node_ptr rbtree<T, U>::node::get_parent() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::weak_const_node_ptr rbtree<T, U, A>::node::get_parent() const {
     return parent_;
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::weak_node_ptr rbtree<T, U>::node::get_parent() {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::weak_node_ptr rbtree<T, U, A>::node::get_parent() {
     return parent_;
 }
 
-template <typename T, typename U>
-inline void rbtree<T, U>::node::set_parent(weak_node_ptr parent) {
+template <typename T, typename U, typename A>
+inline void rbtree<T, U, A>::node::set_parent(weak_node_ptr parent) {
     parent_ = parent;
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::weak_const_node_ptr rbtree<T, U>::node::get_left() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::weak_const_node_ptr rbtree<T, U, A>::node::get_left() const {
     return left_.get();
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::weak_node_ptr rbtree<T, U>::node::get_left() {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::weak_node_ptr rbtree<T, U, A>::node::get_left() {
     return left_.get();
 }
 
-template <typename T, typename U>
-inline void rbtree<T, U>::node::set_left(weak_node_ptr left) {
+template <typename T, typename U, typename A>
+inline void rbtree<T, U, A>::node::set_left(weak_node_ptr left) {
     left_.reset(left);
 }
 
-template <typename T, typename U>
-inline void rbtree<T, U>::node::set_left(node_ptr &&left) {
+template <typename T, typename U, typename A>
+inline void rbtree<T, U, A>::node::set_left(node_ptr &&left) {
     left_ = std::move(left);
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::node_ptr &&rbtree<T, U>::node::move_left() {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::node_ptr &&rbtree<T, U, A>::node::move_left() {
     return std::move(left_);
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::weak_const_node_ptr rbtree<T, U>::node::get_right() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::weak_const_node_ptr rbtree<T, U, A>::node::get_right() const {
     return right_.get();
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::weak_node_ptr rbtree<T, U>::node::get_right() {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::weak_node_ptr rbtree<T, U, A>::node::get_right() {
     return right_.get();
 }
 
-template <typename T, typename U>
-inline void rbtree<T, U>::node::set_right(weak_node_ptr right) {
+template <typename T, typename U, typename A>
+inline void rbtree<T, U, A>::node::set_right(weak_node_ptr right) {
     right_.reset(right);
 }
 
-template <typename T, typename U>
-inline void rbtree<T, U>::node::set_right(node_ptr &&right) {
+template <typename T, typename U, typename A>
+inline void rbtree<T, U, A>::node::set_right(node_ptr &&right) {
     right_ = std::move(right);
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::node_ptr &&rbtree<T, U>::node::move_right() {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::node_ptr &&rbtree<T, U, A>::node::move_right() {
     return std::move(right_);
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::color rbtree<T, U>::node::get_color() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::color rbtree<T, U, A>::node::get_color() const {
     return color_;
 }
 
-template <typename T, typename U>
-inline void rbtree<T, U>::node::set_color(color c) {
+template <typename T, typename U, typename A>
+inline void rbtree<T, U, A>::node::set_color(color c) {
     color_ = c;
 }
 
-template <typename T, typename U>
-inline T const &rbtree<T, U>::node::data() const {
+template <typename T, typename U, typename A>
+inline T const &rbtree<T, U, A>::node::data() const {
     return data_;
 }
 
-template <typename T, typename U>
-inline T &rbtree<T, U>::node::data() {
+template <typename T, typename U, typename A>
+inline T &rbtree<T, U, A>::node::data() {
     return data_;
 }
 
-template <typename T, typename U>
-inline typename rbtree<T, U>::size_type rbtree<T, U>::node::size() const {
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::size_type rbtree<T, U, A>::node::size() const {
     return 1
         + (left_ ? left_->size() : 0)
         + (right_ ? right_->size() : 0);
 }
 
 /************************************************
- * Implementation: class rbtree<T, U>::node_pool
+ * Implementation: class rbtree<T, U, A>::node_pool
  ************************************************/
 
-template <typename T, typename U>
-inline rbtree<T, U>::node_pool::node_pool(size_type size)
-    : next_size_(size), chunks_head_(nullptr), free_list_head_(nullptr) {
+template <typename T, typename U, typename A>
+inline rbtree<T, U, A>::node_pool::node_pool(allocator_type const &alloc)
+    : alloc_(alloc), next_size_(INITIAL_POOL_SIZE),
+      chunks_head_(nullptr), free_list_head_(nullptr) {
     // do nothing
 }
 
-template <typename T, typename U>
-inline rbtree<T, U>::node_pool::~node_pool() {
-    auto chunk = chunks_head_;
-    while (chunk != nullptr) {
-        auto next_chunk = chunk[0].next;
-        delete [] chunk;
-        chunk = next_chunk;
-    }
+template <typename T, typename U, typename A>
+inline rbtree<T, U, A>::node_pool::~node_pool() {
+    clear();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <typename ...Args>
-typename rbtree<T, U>::weak_node_ptr rbtree<T, U>::node_pool::new_node(Args &&...args) {
+typename rbtree<T, U, A>::weak_node_ptr rbtree<T, U, A>::node_pool::new_node(Args &&...args) {
     if (free_list_head_ == nullptr) {
-        auto chunk = new block[next_size_ + 1];
+        auto chunk = std::allocator_traits<block_allocator>::allocate(alloc_, next_size_ + 1);
         chunk[0].next = chunks_head_;
         chunks_head_ = chunk;
         free_list_head_ = chunk + 1;
@@ -817,184 +1005,229 @@ typename rbtree<T, U>::weak_node_ptr rbtree<T, U>::node_pool::new_node(Args &&..
     return new(p) node(std::forward<Args>(args)...);
 }
 
-template <typename T, typename U>
-inline void rbtree<T, U>::node_pool::delete_node(weak_node_ptr p) {
-    p->~node();
+template <typename T, typename U, typename A>
+inline void rbtree<T, U, A>::node_pool::free_node(weak_node_ptr p) {
     reinterpret_cast<block *>(p)->next = free_list_head_;
     free_list_head_ = reinterpret_cast<block *>(p);
 }
 
+template <typename T, typename U, typename A>
+void rbtree<T, U, A>::node_pool::clear() {
+    // chunk sizes double, so they can be recovered from the newest one
+    auto chunk = chunks_head_;
+    while (chunk != nullptr) {
+        next_size_ >>= 1;
+        auto next_chunk = chunk[0].next;
+        std::allocator_traits<block_allocator>::deallocate(alloc_, chunk, next_size_ + 1);
+        chunk = next_chunk;
+    }
+
+    next_size_ = INITIAL_POOL_SIZE;
+    chunks_head_ = free_list_head_ = nullptr;
+}
+
+template <typename T, typename U, typename A>
+// NOLINTNEXTLINE(runtime/references)
+inline void rbtree<T, U, A>::node_pool::swap(node_pool &other) {
+    // pools with unequal allocators may swap only if the allocators do
+    if (std::allocator_traits<allocator_type>::propagate_on_container_swap::value) {
+        std::swap(alloc_, other.alloc_);
+    } else {
+        assert(alloc_ == other.alloc_);
+    }
+
+    std::swap(next_size_, other.next_size_);
+    std::swap(chunks_head_, other.chunks_head_);
+    std::swap(free_list_head_, other.free_list_head_);
+}
+
+template <typename T, typename U, typename A>
+inline typename rbtree<T, U, A>::allocator_type
+rbtree<T, U, A>::node_pool::get_allocator() const {
+    return allocator_type(alloc_);
+}
+
+template <typename T, typename U, typename A>
+inline void rbtree<T, U, A>::node_pool::set_allocator(allocator_type const &alloc) {
+    // only an empty pool may change its allocator
+    assert(chunks_head_ == nullptr);
+    alloc_ = block_allocator(alloc);
+}
+
 /************************************************
- * Implementation: class rbtree<T, U>::tree_iterator<B>
+ * Implementation: class rbtree<T, U, A>::tree_iterator<B>
  ************************************************/
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline rbtree<T, U>::tree_iterator<B>::tree_iterator()
+inline rbtree<T, U, A>::tree_iterator<B>::tree_iterator()
     : tree_(nullptr), ptr_(nullptr) {
     // do nothing
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline rbtree<T, U>::tree_iterator<B>::tree_iterator(rbtree const *tree)
+inline rbtree<T, U, A>::tree_iterator<B>::tree_iterator(rbtree const *tree)
     : tree_(tree), ptr_(nullptr) {
     // do nothing
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline rbtree<T, U>::tree_iterator<B>::tree_iterator(rbtree const *tree, node_ptr ptr)
+inline rbtree<T, U, A>::tree_iterator<B>::tree_iterator(rbtree const *tree, node_ptr ptr)
     : tree_(tree), ptr_(ptr) {
     // do nothing
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline rbtree<T, U>::tree_iterator<B>::tree_iterator(
-        rbtree const *tree, typename rbtree<T, U>::node_ptr const &ptr)
+inline rbtree<T, U, A>::tree_iterator<B>::tree_iterator(
+        rbtree const *tree, typename rbtree<T, U, A>::node_ptr const &ptr)
     : tree_(tree), ptr_(ptr.get()) {
     // do nothing
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline bool rbtree<T, U>::tree_iterator<B>::has_parent() {
+inline bool rbtree<T, U, A>::tree_iterator<B>::has_parent() {
     return ptr_->get_parent();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline bool rbtree<T, U>::tree_iterator<B>::has_left() {
+inline bool rbtree<T, U, A>::tree_iterator<B>::has_left() {
     return ptr_->get_left();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline bool rbtree<T, U>::tree_iterator<B>::has_right() {
+inline bool rbtree<T, U, A>::tree_iterator<B>::has_right() {
     return ptr_->get_right();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline void rbtree<T, U>::tree_iterator<B>::go_parent() {
+inline void rbtree<T, U, A>::tree_iterator<B>::go_parent() {
     ptr_ = ptr_->get_parent();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline void rbtree<T, U>::tree_iterator<B>::go_left() {
+inline void rbtree<T, U, A>::tree_iterator<B>::go_left() {
     ptr_ = ptr_->get_left();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline void rbtree<T, U>::tree_iterator<B>::go_right() {
+inline void rbtree<T, U, A>::tree_iterator<B>::go_right() {
     ptr_ = ptr_->get_right();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<B> rbtree<T, U>::tree_iterator<B>::parent() {
+inline typename rbtree<T, U, A>::template tree_iterator<B>
+rbtree<T, U, A>::tree_iterator<B>::parent() {
     return tree_iterator(tree_, ptr_->get_parent());
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<B> rbtree<T, U>::tree_iterator<B>::left() {
+inline typename rbtree<T, U, A>::template tree_iterator<B>
+rbtree<T, U, A>::tree_iterator<B>::left() {
     return tree_iterator(tree_, ptr_->get_left());
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<B> rbtree<T, U>::tree_iterator<B>::right() {
+inline typename rbtree<T, U, A>::template tree_iterator<B>
+rbtree<T, U, A>::tree_iterator<B>::right() {
     return tree_iterator(tree_, ptr_->get_right());
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<false>
-rbtree<T, U>::tree_iterator<B>::unconst() const {
+inline typename rbtree<T, U, A>::template tree_iterator<false>
+rbtree<T, U, A>::tree_iterator<B>::unconst() const {
     using node_ptr = typename tree_iterator<false>::node_ptr;
     return tree_iterator<false>(tree_, const_cast<node_ptr>(ptr_));
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<B> &
-rbtree<T, U>::tree_iterator<B>::operator++() {
+inline typename rbtree<T, U, A>::template tree_iterator<B> &
+rbtree<T, U, A>::tree_iterator<B>::operator++() {
     ptr_ = tree_->next_node(ptr_);
     return *this;
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<B>
-rbtree<T, U>::tree_iterator<B>::operator++(int) {
+inline typename rbtree<T, U, A>::template tree_iterator<B>
+rbtree<T, U, A>::tree_iterator<B>::operator++(int) {
     tree_iterator it(tree_, ptr_);
     operator++();
     return it;
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<B> &
-rbtree<T, U>::tree_iterator<B>::operator--() {
+inline typename rbtree<T, U, A>::template tree_iterator<B> &
+rbtree<T, U, A>::tree_iterator<B>::operator--() {
     ptr_ = tree_->prev_node(ptr_);
     return *this;
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<B>
-rbtree<T, U>::tree_iterator<B>::operator--(int) {
+inline typename rbtree<T, U, A>::template tree_iterator<B>
+rbtree<T, U, A>::tree_iterator<B>::operator--(int) {
     tree_iterator it(tree_, ptr_);
     operator--();
     return it;
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<B>::reference
-rbtree<T, U>::tree_iterator<B>::operator*() {
+inline typename rbtree<T, U, A>::template tree_iterator<B>::reference
+rbtree<T, U, A>::tree_iterator<B>::operator*() {
     return *operator->();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<B>::pointer
-rbtree<T, U>::tree_iterator<B>::operator->() {
+inline typename rbtree<T, U, A>::template tree_iterator<B>::pointer
+rbtree<T, U, A>::tree_iterator<B>::operator->() {
     return &ptr_->data();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline bool rbtree<T, U>::tree_iterator<B>::operator==(tree_iterator it) const {
+inline bool rbtree<T, U, A>::tree_iterator<B>::operator==(tree_iterator it) const {
     return ptr_ == it.ptr_;
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline bool rbtree<T, U>::tree_iterator<B>::operator!=(tree_iterator it) const {
+inline bool rbtree<T, U, A>::tree_iterator<B>::operator!=(tree_iterator it) const {
     return !(*this == it);
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline bool rbtree<T, U>::tree_iterator<B>::operator!() const {
+inline bool rbtree<T, U, A>::tree_iterator<B>::operator!() const {
     return !this->operator bool();
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline rbtree<T, U>::tree_iterator<B>::operator bool() const {
+inline rbtree<T, U, A>::tree_iterator<B>::operator bool() const {
     return static_cast<bool>(ptr_);
 }
 
-template <typename T, typename U>
+template <typename T, typename U, typename A>
 template <bool B>
-inline typename rbtree<T, U>::template tree_iterator<B>::node_ptr
-rbtree<T, U>::tree_iterator<B>::get_node_ptr() {
+inline typename rbtree<T, U, A>::template tree_iterator<B>::node_ptr
+rbtree<T, U, A>::tree_iterator<B>::get_node_ptr() {
     return ptr_;
 }
 
@@ -0,0 +1,96 @@
+/************************************************
+ *  serialization.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_SERIALIZATION_HPP_
+#define DICT_INTERNAL_SERIALIZATION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ios>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: functions write_value<T>/read_value<T>
+ ************************************************/
+
+template <typename T>
+void write_value(std::ostream &os, T x);  // NOLINT(runtime/references)
+
+template <typename T>
+T read_value(std::istream &is);  // NOLINT(runtime/references)
+
+/************************************************
+ * Declaration: function check_remaining
+ ************************************************/
+
+// Throws if the rest of a seekable stream is too short to hold count elements
+// of elem_size bytes, so that a corrupt count read from the stream is caught
+// before anything is allocated for it.
+// NOLINTNEXTLINE(runtime/references)
+void check_remaining(std::istream &is, std::uint64_t count, std::size_t elem_size);
+
+/************************************************
+ * Implementation: functions write_value<T>/read_value<T>
+ ************************************************/
+
+template <typename T>
+inline void write_value(std::ostream &os, T x) {  // NOLINT(runtime/references)
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+    os.write(reinterpret_cast<char const *>(&x), sizeof(T));
+    if (!os) {
+        throw std::runtime_error("failed to write to stream");
+    }
+}
+
+template <typename T>
+inline T read_value(std::istream &is) {  // NOLINT(runtime/references)
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+    T x;
+    is.read(reinterpret_cast<char *>(&x), sizeof(T));
+    if (!is) {
+        throw std::runtime_error("unexpected end of stream");
+    }
+
+    return x;
+}
+
+/************************************************
+ * Implementation: function check_remaining
+ ************************************************/
+
+// NOLINTNEXTLINE(runtime/references)
+inline void check_remaining(std::istream &is, std::uint64_t count, std::size_t elem_size) {
+    auto pos = is.tellg();
+    if (pos == std::istream::pos_type(-1)) { return; }
+
+    is.seekg(0, std::ios_base::end);
+    auto end = is.tellg();
+    is.seekg(pos);
+    if (!is || end < pos) {
+        throw std::runtime_error("failed to seek in stream");
+    }
+
+    auto remaining = static_cast<std::uint64_t>(end - pos);
+    if (elem_size > 0 && count > remaining / elem_size) {
+        throw std::runtime_error("unexpected end of stream");
+    }
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_SERIALIZATION_HPP_
@@ -0,0 +1,222 @@
+/************************************************
+ *  suffix_sorter.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_SUFFIX_SORTER_HPP_
+#define DICT_INTERNAL_SUFFIX_SORTER_HPP_
+
+#include <cstddef>
+
+#include <algorithm>
+#include <vector>
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class suffix_sorter
+ ************************************************/
+
+// Builds suffix arrays by induced sorting (SA-IS). The input must be a
+// string of integers in [0, sigma) that ends with a unique 0.
+class suffix_sorter {
+ public:  // Public Type(s)
+    using size_type = std::size_t;
+
+ public:  // Public Static Method(s)
+    template <typename String>
+    static std::vector<size_type> sort(String const &s, size_type sigma);
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type EMPTY = static_cast<size_type>(-1);
+
+ private:  // Private Static Method(s)
+    template <typename String>
+    // NOLINTNEXTLINE(runtime/references)
+    static void sort(String const &s, std::vector<size_type> &sa, size_type sigma);
+    template <typename String>
+    static void induce(String const &s, std::vector<size_type> &sa,  // NOLINT(runtime/references)
+                       std::vector<bool> const &types, std::vector<size_type> const &sizes);
+    template <typename String>
+    static bool equal_substrings(String const &s, std::vector<bool> const &types,
+                                 size_type i, size_type j);
+
+    static bool is_lms(std::vector<bool> const &types, size_type i);
+    // NOLINTNEXTLINE(runtime/references)
+    static void bucket_heads(std::vector<size_type> const &sizes, std::vector<size_type> &heads);
+    // NOLINTNEXTLINE(runtime/references)
+    static void bucket_tails(std::vector<size_type> const &sizes, std::vector<size_type> &tails);
+};  // class suffix_sorter
+
+/************************************************
+ * Implementation: class suffix_sorter
+ ************************************************/
+
+template <typename String>
+inline std::vector<suffix_sorter::size_type>
+suffix_sorter::sort(String const &s, size_type sigma) {
+    std::vector<size_type> sa;
+    sort(s, sa, sigma);
+    return sa;
+}
+
+template <typename String>
+// NOLINTNEXTLINE(runtime/references)
+void suffix_sorter::sort(String const &s, std::vector<size_type> &sa, size_type sigma) {
+    size_type n = s.size();
+    size_type const empty = EMPTY;
+    sa.assign(n, empty);
+    if (n <= 1) {
+        if (n == 1) { sa[0] = 0; }
+        return;
+    }
+
+    // classify suffixes into S-type (true) and L-type (false)
+    std::vector<bool> types(n);
+    types[n - 1] = true;
+    for (auto i = n - 1; i > 0; --i) {
+        types[i - 1] = s[i - 1] < s[i] || (s[i - 1] == s[i] && types[i]);
+    }
+
+    std::vector<size_type> sizes(sigma, 0);
+    for (size_type i = 0; i < n; ++i) {
+        ++sizes[s[i]];
+    }
+
+    // sort LMS-substrings
+    std::vector<size_type> tails;
+    bucket_tails(sizes, tails);
+    for (size_type i = 1; i < n; ++i) {
+        if (is_lms(types, i)) { sa[--tails[s[i]]] = i; }
+    }
+
+    induce(s, sa, types, sizes);
+
+    // name LMS-substrings by their order
+    size_type num_lms = 0;
+    for (size_type i = 0; i < n; ++i) {
+        if (is_lms(types, sa[i])) { sa[num_lms++] = sa[i]; }
+    }
+
+    std::fill(sa.begin() + num_lms, sa.end(), empty);
+
+    size_type num_names = 0;
+    auto prev = EMPTY;
+    for (size_type k = 0; k < num_lms; ++k) {
+        auto i = sa[k];
+        if (prev == EMPTY || !equal_substrings(s, types, prev, i)) { ++num_names; }
+
+        // LMS positions are at least two apart, so the slots never collide
+        sa[num_lms + i / 2] = num_names - 1;
+        prev = i;
+    }
+
+    std::vector<size_type> reduced;
+    reduced.reserve(num_lms);
+    for (auto i = num_lms; i < n; ++i) {
+        if (sa[i] != EMPTY) { reduced.push_back(sa[i]); }
+    }
+
+    // sort LMS-suffixes, recursively if some names are duplicated
+    std::vector<size_type> reduced_sa;
+    if (num_names < num_lms) {
+        sort(reduced, reduced_sa, num_names);
+    } else {
+        reduced_sa.resize(num_lms);
+        for (size_type k = 0; k < num_lms; ++k) {
+            reduced_sa[reduced[k]] = k;
+        }
+    }
+
+    for (size_type i = 1, k = 0; i < n; ++i) {
+        if (is_lms(types, i)) { reduced[k++] = i; }
+    }
+
+    // induce the order of all suffixes from the sorted LMS-suffixes
+    std::fill(sa.begin(), sa.end(), empty);
+    bucket_tails(sizes, tails);
+    for (auto k = num_lms; k > 0; --k) {
+        auto i = reduced[reduced_sa[k - 1]];
+        sa[--tails[s[i]]] = i;
+    }
+
+    induce(s, sa, types, sizes);
+}
+
+template <typename String>  // NOLINTNEXTLINE(runtime/references)
+void suffix_sorter::induce(String const &s, std::vector<size_type> &sa,
+                           std::vector<bool> const &types, std::vector<size_type> const &sizes) {
+    size_type n = s.size();
+    std::vector<size_type> buckets;
+
+    // induce L-type suffixes from left to right
+    bucket_heads(sizes, buckets);
+    for (size_type k = 0; k < n; ++k) {
+        auto i = sa[k];
+        if (i != EMPTY && i > 0 && !types[i - 1]) {
+            sa[buckets[s[i - 1]]++] = i - 1;
+        }
+    }
+
+    // induce S-type suffixes from right to left
+    bucket_tails(sizes, buckets);
+    for (auto k = n; k > 0; --k) {
+        auto i = sa[k - 1];
+        if (i != EMPTY && i > 0 && types[i - 1]) {
+            sa[--buckets[s[i - 1]]] = i - 1;
+        }
+    }
+}
+
+template <typename String>
+bool suffix_sorter::equal_substrings(String const &s, std::vector<bool> const &types,
+                                     size_type i, size_type j) {
+    size_type n = s.size();
+    for (size_type d = 0; i + d < n && j + d < n; ++d) {
+        if (s[i + d] != s[j + d] || types[i + d] != types[j + d]) { return false; }
+        if (d > 0) {
+            auto i_end = is_lms(types, i + d);
+            auto j_end = is_lms(types, j + d);
+            if (i_end || j_end) { return i_end && j_end; }
+        }
+    }
+
+    return false;
+}
+
+inline bool suffix_sorter::is_lms(std::vector<bool> const &types, size_type i) {
+    return i != EMPTY && i > 0 && types[i] && !types[i - 1];
+}
+
+// NOLINTNEXTLINE(runtime/references)
+inline void suffix_sorter::bucket_heads(std::vector<size_type> const &sizes,
+                                        std::vector<size_type> &heads) {
+    heads.resize(sizes.size());
+    size_type sum = 0;
+    for (size_type c = 0; c < sizes.size(); ++c) {
+        heads[c] = sum;
+        sum += sizes[c];
+    }
+}
+
+// NOLINTNEXTLINE(runtime/references)
+inline void suffix_sorter::bucket_tails(std::vector<size_type> const &sizes,
+                                        std::vector<size_type> &tails) {
+    tails.resize(sizes.size());
+    size_type sum = 0;
+    for (size_type c = 0; c < sizes.size(); ++c) {
+        sum += sizes[c];
+        tails[c] = sum;
+    }
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_SUFFIX_SORTER_HPP_
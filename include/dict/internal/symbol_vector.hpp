@@ -0,0 +1,822 @@
+/************************************************
+ *  symbol_vector.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_SYMBOL_VECTOR_HPP_
+#define DICT_INTERNAL_SYMBOL_VECTOR_HPP_
+
+#include <cassert>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "broadword.hpp"
+#include "rbtree.hpp"
+#include "serialization.hpp"
+#include "thread_pool.hpp"
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class symbol_vector<W, N, A>
+ ************************************************/
+
+// A dynamic sequence of W-bit symbols. Each block keeps one bitset per bit
+// of the symbols (a plane), so that a single descent answers access, rank
+// and select for all W bits at once. With W = 1 it behaves as bit_vector<N>.
+//
+// Given a thread pool, the methods that rebuild the blocks pack the planes
+// over chunks of the symbols in parallel, as wavelet_matrix::assign does.
+template <std::size_t W, std::size_t N, typename Allocator = std::allocator<std::size_t>>
+class symbol_vector {
+ public:  // Public Type(s)
+    using size_type = std::size_t;
+    using value_type = std::size_t;
+    using allocator_type = Allocator;
+
+ public:  // Public Static Property(ies)
+    static constexpr size_type SIGMA = size_type(1) << W;
+
+ public:  // Public Type(s)
+    using counts = std::array<size_type, SIGMA>;
+    using planes = std::array<std::vector<std::uint64_t>, W>;
+
+ public:  // Public Method(s)
+    explicit symbol_vector(allocator_type const &alloc = allocator_type());
+
+    allocator_type get_allocator() const;
+    void swap(symbol_vector &other);  // NOLINT(runtime/references)
+
+    size_type insert(size_type i, value_type s);
+    value_type erase(size_type i);
+    std::vector<size_type> insert_batch(
+        std::vector<std::pair<size_type, value_type>> const &symbols);
+    std::vector<size_type> insert_batch(
+        std::vector<std::pair<size_type, value_type>> const &symbols,
+        thread_pool &pool);  // NOLINT(runtime/references)
+
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+    template <typename InputIterator>  // NOLINTNEXTLINE(runtime/references)
+    void assign(InputIterator first, InputIterator last, thread_pool &pool);
+    void assign_words(planes const &words, size_type n);
+    // NOLINTNEXTLINE(runtime/references)
+    void assign_words(planes const &words, size_type n, thread_pool &pool);
+    template <typename Value, typename SymbolOf>
+    counts assign_and_partition(std::vector<Value> const &values, SymbolOf symbol_of,
+                                size_type num_kept,
+                                std::vector<Value> &next_values,  // NOLINT(runtime/references)
+                                thread_pool &pool);               // NOLINT(runtime/references)
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
+    std::pair<value_type, size_type> access_and_rank(size_type i) const;
+    size_type rank(size_type i, value_type s) const;
+    size_type select(size_type i, value_type s) const;
+    size_type count(value_type s) const;
+    size_type size() const;
+
+    value_type operator[](size_type i) const;
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type MAX_BLOCK_SIZE = 2 * N;
+    static constexpr size_type MIN_BLOCK_SIZE = 0.25 * MAX_BLOCK_SIZE;
+    static constexpr size_type MAX_MERGE_SIZE =
+        MAX_BLOCK_SIZE - 1 < 0.9 * MAX_BLOCK_SIZE
+            ? MAX_BLOCK_SIZE - 1
+            : 0.9 * MAX_BLOCK_SIZE;
+    static constexpr size_type WORD_SIZE = 64;
+    static constexpr size_type NUM_BLOCK_WORDS = (MAX_BLOCK_SIZE + WORD_SIZE - 1) / WORD_SIZE;
+    static constexpr size_type CHUNK_SIZE = 1 << 16;
+
+ private:  // Private Type(s)
+    struct block;
+    struct counts_updater;
+    using bstree = rbtree<block, counts_updater, Allocator>;
+    using bitset = std::bitset<MAX_BLOCK_SIZE>;
+    using word_type = std::uint64_t;
+
+ private:  // Private Static Method(s)
+    static bitset match(block const &p, value_type s);
+    static size_type count_prefix(block const &p, value_type s, size_type k);
+    static value_type symbol_at(block const &p, size_type i);
+    static void equalize_blocks(block &p, block &q);    // NOLINT(runtime/references)
+    static void merge_blocks(block &p, block &q);       // NOLINT(runtime/references)
+    static void update_counts(typename bstree::iterator it);
+    static void update_node_counts(typename bstree::iterator it);
+
+ private:  // Private Method(s)
+    // NOLINTNEXTLINE(runtime/references)
+    typename bstree::iterator find_block(size_type i, size_type &pos, value_type s,
+                                         size_type &rank);
+    // NOLINTNEXTLINE(runtime/references)
+    typename bstree::const_iterator find_block(size_type i, size_type &pos, value_type s,
+                                               size_type &rank) const;
+
+ private:  // Private Property(ies)
+    bstree tree_;
+};  // class symbol_vector<W, N, A>
+
+/************************************************
+ * Declaration: struct symbol_vector<W, N, A>::block
+ ************************************************/
+
+template <std::size_t W, std::size_t N, typename A>
+struct symbol_vector<W, N, A>::block {
+    block()
+        : num_symbols(0), num_sub_symbols(0), num_sub_counts(), planes() {
+        // do nothing
+    }
+
+    size_type num_symbols;
+    size_type num_sub_symbols;
+    counts num_sub_counts;
+    std::array<bitset, W> planes;
+};  // class symbol_vector<W, N, A>::block
+
+/************************************************
+ * Declaration: struct symbol_vector<W, N, A>::counts_updater
+ ************************************************/
+
+template <std::size_t W, std::size_t N, typename A>
+struct symbol_vector<W, N, A>::counts_updater {
+    void operator()(typename bstree::iterator it) const {
+        update_counts(it);
+    }
+};  // class symbol_vector<W, N, A>::counts_updater
+
+/************************************************
+ * Implementation: class symbol_vector<W, N, A>
+ ************************************************/
+
+template <std::size_t W, std::size_t N, typename A>
+inline symbol_vector<W, N, A>::symbol_vector(allocator_type const &alloc)
+    : tree_(alloc) {
+    // do nothing
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline typename symbol_vector<W, N, A>::allocator_type
+symbol_vector<W, N, A>::get_allocator() const {
+    return tree_.get_allocator();
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline void symbol_vector<W, N, A>::swap(symbol_vector &other) {  // NOLINT(runtime/references)
+    tree_.swap(other.tree_);
+}
+
+template <std::size_t W, std::size_t N, typename A>
+typename symbol_vector<W, N, A>::size_type
+symbol_vector<W, N, A>::insert(size_type i, value_type s) {
+    assert(s < SIGMA);
+    if (!tree_.root()) {
+        assert(i == 0);
+        block bb;
+        bb.num_symbols = 1;
+        for (size_type w = 0; w < W; ++w) {
+            bb.planes[w][0] = (s >> w) & 1;
+        }
+
+        update_counts(tree_.insert_before(tree_.end(), bb));
+        return 1;
+    }
+
+    size_type rank = 0;
+
+    auto it = tree_.end();
+    if (i == size()) {
+        --it;
+        i = it->num_symbols;
+        rank = count(s) - count_prefix(*it, s, i);
+    } else {
+        assert(i < size());
+        size_type pos = 0;
+        it = find_block(i, pos, s, rank);
+        i -= pos;
+    }
+
+    if (it->num_symbols >= MAX_BLOCK_SIZE) {
+        auto prev_it = std::prev(it);
+        auto next_it = std::next(it);
+        if (prev_it &&
+                prev_it->num_symbols + it->num_symbols <= (MAX_MERGE_SIZE << 1) &&
+                (!next_it || prev_it->num_symbols < next_it->num_symbols)) {
+            i += prev_it->num_symbols;
+            rank -= count_prefix(*prev_it, s, prev_it->num_symbols);
+            equalize_blocks(*prev_it, *it);
+
+            if (i >= prev_it->num_symbols) {
+                update_counts(prev_it);
+                i -= prev_it->num_symbols;
+                rank += count_prefix(*prev_it, s, prev_it->num_symbols);
+            } else {
+                update_counts(it);
+                it = prev_it;
+            }
+        } else if (next_it &&
+                next_it->num_symbols + it->num_symbols <= (MAX_MERGE_SIZE << 1)) {
+            equalize_blocks(*it, *next_it);
+
+            if (i >= it->num_symbols) {
+                update_counts(it);
+                i -= it->num_symbols;
+                rank += count_prefix(*it, s, it->num_symbols);
+                it = next_it;
+            } else {
+                update_counts(next_it);
+            }
+        } else {
+            block bb;
+            equalize_blocks(bb, *it);
+            auto new_it = tree_.insert_before(it, bb);
+
+            if (i >= new_it->num_symbols) {
+                update_counts(new_it);
+                i -= new_it->num_symbols;
+                rank += count_prefix(*new_it, s, new_it->num_symbols);
+            } else {
+                update_counts(it);
+                it = new_it;
+            }
+        }
+    }
+
+    // insert symbol in every plane
+    rank += count_prefix(*it, s, i);
+    for (size_type w = 0; w < W; ++w) {
+        auto &bits = it->planes[w];
+        if (i == 0) {
+            bits <<= 1;
+        } else if (i < it->num_symbols) {
+            auto mask = (bits >> i) << i;
+            bits ^= mask;
+            bits |= mask << 1;
+        }
+
+        bits[i] = (s >> w) & 1;
+    }
+
+    // update counters
+    it->num_symbols++;
+    update_counts(it);
+
+    return rank + 1;
+}
+
+template <std::size_t W, std::size_t N, typename A>
+typename symbol_vector<W, N, A>::value_type symbol_vector<W, N, A>::erase(size_type i) {
+    size_type pos = 0, rank = 0;
+    auto it = find_block(i, pos, 0, rank);
+    i -= pos;
+
+    // erase symbol in every plane
+    auto s = symbol_at(*it, i);
+    for (size_type w = 0; w < W; ++w) {
+        auto &bits = it->planes[w];
+        if (i == 0) {
+            bits >>= 1;
+        } else if (i < it->num_symbols - 1) {
+            bits[i] = 0;
+
+            auto mask = (bits >> i) << i;
+            bits ^= mask;
+            bits |= mask >> 1;
+        } else {
+            bits.reset(i);
+        }
+    }
+
+    // update counters
+    it->num_symbols--;
+    update_counts(it);
+
+    // delete or merge small blocks
+    if (it->num_symbols == 0) {
+        tree_.erase(it);
+    } else if (it->num_symbols < MIN_BLOCK_SIZE) {
+        auto prev_it = std::prev(it);
+        auto next_it = std::next(it);
+        if (prev_it && (!next_it || prev_it->num_symbols < next_it->num_symbols)) {
+            if (prev_it->num_symbols + it->num_symbols <= MAX_MERGE_SIZE) {
+                merge_blocks(*prev_it, *it);
+                update_counts(prev_it);
+                tree_.erase(it);
+            } else if (prev_it->num_symbols + it->num_symbols <= (MAX_MERGE_SIZE << 1)) {
+                equalize_blocks(*prev_it, *it);
+                update_counts(prev_it);
+                update_counts(it);
+            }
+        } else if (next_it) {
+            if (next_it->num_symbols + it->num_symbols <= MAX_MERGE_SIZE) {
+                merge_blocks(*it, *next_it);
+                update_counts(it);
+                tree_.erase(next_it);
+            } else if (next_it->num_symbols + it->num_symbols <= (MAX_MERGE_SIZE << 1)) {
+                equalize_blocks(*it, *next_it);
+                update_counts(it);
+                update_counts(next_it);
+            }
+        }
+    }
+
+    return s;
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline std::vector<typename symbol_vector<W, N, A>::size_type>
+symbol_vector<W, N, A>::insert_batch(
+        std::vector<std::pair<size_type, value_type>> const &symbols) {
+    thread_pool pool(0);
+    return insert_batch(symbols, pool);
+}
+
+template <std::size_t W, std::size_t N, typename A>
+std::vector<typename symbol_vector<W, N, A>::size_type>
+symbol_vector<W, N, A>::insert_batch(
+        std::vector<std::pair<size_type, value_type>> const &symbols,
+        thread_pool &pool) {  // NOLINT(runtime/references)
+    // the positions are those in the resulting sequence, in ascending order,
+    // and the ranks are returned as insert() returns them
+    auto k = symbols.size();
+    auto n = size();
+    std::vector<size_type> ranks(k);
+    if (k * N < n) {
+        // a few symbols are inserted one by one
+        for (size_type t = 0; t < k; ++t) {
+            ranks[t] = insert(symbols[t].first, symbols[t].second);
+        }
+
+        return ranks;
+    }
+
+    // otherwise they are merged with all blocks in a single pass
+    std::vector<value_type> seq;
+    seq.reserve(n + k);
+    counts num_symbols{};
+    size_type t = 0;
+    auto put_inserted = [&]() {
+        while (t < k && symbols[t].first == seq.size()) {
+            auto s = symbols[t].second;
+            assert(s < SIGMA);
+            seq.push_back(s);
+            ranks[t++] = ++num_symbols[s];
+        }
+    };
+
+    for (auto const &bb : tree_) {
+        for (size_type i = 0; i < bb.num_symbols; ++i) {
+            put_inserted();
+
+            auto s = symbol_at(bb, i);
+            seq.push_back(s);
+            ++num_symbols[s];
+        }
+    }
+
+    put_inserted();
+    assert(t == k);
+
+    assign(seq.begin(), seq.end(), pool);
+    return ranks;
+}
+
+template <std::size_t W, std::size_t N, typename A>
+template <typename InputIterator>
+inline void symbol_vector<W, N, A>::assign(InputIterator first, InputIterator last) {
+    thread_pool pool(0);
+    assign(first, last, pool);
+}
+
+template <std::size_t W, std::size_t N, typename A>
+template <typename InputIterator>  // NOLINTNEXTLINE(runtime/references)
+void symbol_vector<W, N, A>::assign(InputIterator first, InputIterator last, thread_pool &pool) {
+    std::vector<value_type> seq(first, last), rest;
+    assign_and_partition(seq, [](value_type s) { return s; }, 0, rest, pool);
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline void symbol_vector<W, N, A>::assign_words(planes const &words, size_type n) {
+    thread_pool pool(0);
+    assign_words(words, n, pool);
+}
+
+template <std::size_t W, std::size_t N, typename A>
+// NOLINTNEXTLINE(runtime/references)
+void symbol_vector<W, N, A>::assign_words(planes const &words, size_type n, thread_pool &pool) {
+    for (auto const &plane : words) {
+        assert(n <= plane.size() * WORD_SIZE);
+    }
+
+    // blocks hold at most MAX_MERGE_SIZE symbols, as after merging them, and
+    // are filled by chunks of about CHUNK_SIZE symbols each
+    auto num_blocks = (n + MAX_MERGE_SIZE - 1) / MAX_MERGE_SIZE;
+    auto blocks_per_chunk = (CHUNK_SIZE + MAX_MERGE_SIZE - 1) / MAX_MERGE_SIZE;
+    std::vector<block> blocks(num_blocks);
+    pool.run((num_blocks + blocks_per_chunk - 1) / blocks_per_chunk, [&](size_type k) {
+        auto first = k * blocks_per_chunk;
+        auto last = std::min(num_blocks, first + blocks_per_chunk);
+        for (auto b = first; b < last; ++b) {
+            auto &bb = blocks[b];
+            auto pos = b * MAX_MERGE_SIZE;
+            bb.num_symbols = n - pos < MAX_MERGE_SIZE ? n - pos : MAX_MERGE_SIZE;
+            for (size_type w = 0; w < W; ++w) {
+                for (size_type t = 0; t < bb.num_symbols; t += WORD_SIZE) {
+                    auto len = bb.num_symbols - t < WORD_SIZE ? bb.num_symbols - t : WORD_SIZE;
+                    auto word = broadword::get_bits(words[w].data(), pos + t, len);
+                    bb.planes[w] |= bitset(word) << t;
+                }
+            }
+        }
+    });
+
+    tree_.assign(blocks.begin(), blocks.end(), update_node_counts);
+}
+
+template <std::size_t W, std::size_t N, typename A>
+template <typename Value, typename SymbolOf>
+typename symbol_vector<W, N, A>::counts symbol_vector<W, N, A>::assign_and_partition(
+        std::vector<Value> const &values, SymbolOf symbol_of, size_type num_kept,
+        std::vector<Value> &next_values,  // NOLINT(runtime/references)
+        thread_pool &pool) {              // NOLINT(runtime/references)
+    // assigns the symbols of the values, and moves the values of symbols
+    // less than num_kept to next_values, ordered by symbol and then by
+    // position; returns the number of values of each symbol
+    auto n = values.size();
+    auto num_chunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    planes words;
+    for (auto &plane : words) {
+        plane.resize((n + WORD_SIZE - 1) / WORD_SIZE);
+    }
+
+    // chunks start at word boundaries, so they never share a word
+    std::vector<counts> chunk_counts(num_chunks);
+    pool.run(num_chunks, [&](size_type k) {
+        auto first = k * CHUNK_SIZE, last = std::min(n, first + CHUNK_SIZE);
+        auto &num_symbols = chunk_counts[k];
+        num_symbols.fill(0);
+        for (auto i = first; i < last; i += WORD_SIZE) {
+            std::array<word_type, W> plane_words{};
+            for (auto j = i; j < last && j < i + WORD_SIZE; ++j) {
+                value_type s = symbol_of(values[j]);
+                assert(s < SIGMA);
+                ++num_symbols[s];
+                for (size_type w = 0; w < W; ++w) {
+                    plane_words[w] |= static_cast<word_type>((s >> w) & 1) << (j - i);
+                }
+            }
+
+            for (size_type w = 0; w < W; ++w) {
+                words[w][i / WORD_SIZE] = plane_words[w];
+            }
+        }
+    });
+
+    // a chunk moves a value after those of the same symbol in the chunks
+    // before it
+    counts num_symbols{};
+    for (auto &chunk_count : chunk_counts) {
+        for (size_type s = 0; s < SIGMA; ++s) {
+            auto num = chunk_count[s];
+            chunk_count[s] = num_symbols[s];
+            num_symbols[s] += num;
+        }
+    }
+
+    counts starts{};
+    size_type num_next_values = 0;
+    for (size_type s = 0; s < num_kept; ++s) {
+        starts[s] = num_next_values;
+        num_next_values += num_symbols[s];
+    }
+
+    next_values.resize(num_next_values);
+    if (num_kept > 0) {
+        pool.run(num_chunks, [&](size_type k) {
+            auto first = k * CHUNK_SIZE, last = std::min(n, first + CHUNK_SIZE);
+            auto next = chunk_counts[k];
+            for (size_type s = 0; s < num_kept; ++s) {
+                next[s] += starts[s];
+            }
+
+            for (auto i = first; i < last; ++i) {
+                value_type s = symbol_of(values[i]);
+                if (s < num_kept) { next_values[next[s]++] = values[i]; }
+            }
+        });
+    }
+
+    assign_words(words, n, pool);
+    return num_symbols;
+}
+
+template <std::size_t W, std::size_t N, typename A>
+void symbol_vector<W, N, A>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    // blocks are written in order, each as its length followed by its planes
+    write_value<std::uint64_t>(os, tree_.size());
+
+    bitset const word_mask(~0ULL);
+    for (auto const &bb : tree_) {
+        write_value<std::uint64_t>(os, bb.num_symbols);
+        for (auto const &bits : bb.planes) {
+            for (size_type k = 0; k < NUM_BLOCK_WORDS; ++k) {
+                auto word = ((bits >> (k * WORD_SIZE)) & word_mask).to_ullong();
+                write_value<std::uint64_t>(os, word);
+            }
+        }
+    }
+}
+
+template <std::size_t W, std::size_t N, typename A>
+void symbol_vector<W, N, A>::load(std::istream &is) {  // NOLINT(runtime/references)
+    auto num_blocks = read_value<std::uint64_t>(is);
+    check_remaining(is, num_blocks, sizeof(std::uint64_t) * (1 + W * NUM_BLOCK_WORDS));
+
+    std::vector<block> blocks(num_blocks);
+    for (auto &bb : blocks) {
+        bb.num_symbols = read_value<std::uint64_t>(is);
+        if (bb.num_symbols == 0 || bb.num_symbols > MAX_BLOCK_SIZE) {
+            throw std::runtime_error("invalid symbol_vector block");
+        }
+
+        for (auto &bits : bb.planes) {
+            for (size_type k = 0; k < NUM_BLOCK_WORDS; ++k) {
+                auto word = read_value<std::uint64_t>(is);
+                bits |= bitset(word) << (k * WORD_SIZE);
+            }
+        }
+    }
+
+    tree_.assign(blocks.begin(), blocks.end(), update_node_counts);
+}
+
+template <std::size_t W, std::size_t N, typename A>
+std::pair<typename symbol_vector<W, N, A>::value_type, typename symbol_vector<W, N, A>::size_type>
+symbol_vector<W, N, A>::access_and_rank(size_type i) const {
+    // the symbol is only known at the block, so count every symbol on the way
+    counts ranks{};
+    auto it = tree_.root();
+    while (it) {
+        auto left = it.left();
+        auto num_left_symbols = left ? left->num_sub_symbols : 0;
+        if (i < num_left_symbols) {
+            it.go_left();
+        } else if (i < num_left_symbols + it->num_symbols) {
+            if (left) {
+                for (size_type t = 0; t < SIGMA; ++t) {
+                    ranks[t] += left->num_sub_counts[t];
+                }
+            }
+
+            i -= num_left_symbols;
+            break;
+        } else {
+            // everything in this subtree but the right one precedes i
+            auto right = it.right();
+            for (size_type t = 0; t < SIGMA; ++t) {
+                ranks[t] += it->num_sub_counts[t] - (right ? right->num_sub_counts[t] : 0);
+            }
+
+            i -= it->num_sub_symbols - (right ? right->num_sub_symbols : 0);
+            it.go_right();
+        }
+    }
+
+    auto s = symbol_at(*it, i);
+    return std::make_pair(s, ranks[s] + count_prefix(*it, s, i + 1));
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline typename symbol_vector<W, N, A>::size_type
+symbol_vector<W, N, A>::rank(size_type i, value_type s) const {
+    // count occurrences of s in [0, i]
+    size_type pos = 0, rank = 0;
+    auto it = find_block(i, pos, s, rank);
+    return rank + count_prefix(*it, s, i - pos + 1);
+}
+
+template <std::size_t W, std::size_t N, typename A>
+typename symbol_vector<W, N, A>::size_type
+symbol_vector<W, N, A>::select(size_type i, value_type s) const {
+    size_type pos = 0;
+
+    auto it = tree_.root();
+    while (it) {
+        size_type num_left_symbols, num_left_matches;
+        auto left = it.left();
+        if (left) {
+            num_left_symbols = left->num_sub_symbols;
+            num_left_matches = left->num_sub_counts[s];
+        } else {
+            num_left_symbols = num_left_matches = 0;
+        }
+
+        if (i < num_left_matches) {
+            it.go_left();
+        } else {
+            pos += num_left_symbols;
+            i -= num_left_matches;
+
+            auto num_matches = count_prefix(*it, s, it->num_symbols);
+            if (i < num_matches) {
+                break;
+            } else {
+                pos += it->num_symbols;
+                i -= num_matches;
+                it.go_right();
+            }
+        }
+    }
+
+    // skip whole words, then select within the word
+    auto bits = match(*it, s);
+    bitset const word_mask(~0ULL);
+    for (size_type k = 0; ; ++k) {
+        word_type word = ((bits >> (k * WORD_SIZE)) & word_mask).to_ullong();
+        auto num_symbols = it->num_symbols - k * WORD_SIZE;
+        if (num_symbols < WORD_SIZE) {
+            word &= (word_type(1) << num_symbols) - 1;
+        }
+
+        auto num_matches = broadword::popcount(word);
+        if (i < num_matches) {
+            return pos + k * WORD_SIZE + broadword::select(word, i);
+        }
+
+        i -= num_matches;
+    }
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline typename symbol_vector<W, N, A>::size_type
+symbol_vector<W, N, A>::count(value_type s) const {
+    auto root = tree_.root();
+    return root ? root->num_sub_counts[s] : 0;
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline typename symbol_vector<W, N, A>::size_type symbol_vector<W, N, A>::size() const {
+    auto root = tree_.root();
+    return root ? root->num_sub_symbols : 0;
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline typename symbol_vector<W, N, A>::value_type
+symbol_vector<W, N, A>::operator[](size_type i) const {
+    size_type pos = 0, rank = 0;
+    auto it = find_block(i, pos, 0, rank);
+    return symbol_at(*it, i - pos);
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline typename symbol_vector<W, N, A>::bitset
+symbol_vector<W, N, A>::match(block const &p, value_type s) {
+    // positions holding s; those past the end of the block are arbitrary
+    auto bits = (s & 1) ? p.planes[0] : ~p.planes[0];
+    for (size_type w = 1; w < W; ++w) {
+        bits &= ((s >> w) & 1) ? p.planes[w] : ~p.planes[w];
+    }
+
+    return bits;
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline typename symbol_vector<W, N, A>::size_type
+symbol_vector<W, N, A>::count_prefix(block const &p, value_type s, size_type k) {
+    // count occurrences of s in the first k symbols of the block
+    return k > 0 ? (match(p, s) << (MAX_BLOCK_SIZE - k)).count() : 0;
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline typename symbol_vector<W, N, A>::value_type
+symbol_vector<W, N, A>::symbol_at(block const &p, size_type i) {
+    value_type s = 0;
+    for (size_type w = 0; w < W; ++w) {
+        s |= value_type(p.planes[w][i]) << w;
+    }
+
+    return s;
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline typename symbol_vector<W, N, A>::bstree::iterator  // NOLINTNEXTLINE(runtime/references)
+symbol_vector<W, N, A>::find_block(size_type i, size_type &pos, value_type s, size_type &rank) {
+    auto const &that = *this;
+    auto it = that.find_block(i, pos, s, rank);
+    return it.unconst();
+}
+
+template <std::size_t W, std::size_t N, typename A>
+typename symbol_vector<W, N, A>::bstree::const_iterator  // NOLINTNEXTLINE(runtime/references)
+symbol_vector<W, N, A>::find_block(size_type i, size_type &pos, value_type s,
+                                   size_type &rank) const {
+    auto it = tree_.root();
+    while (it) {
+        auto left = it.left();
+        auto num_left_symbols = left ? left->num_sub_symbols : 0;
+        if (i < num_left_symbols) {
+            it.go_left();
+        } else if (i < num_left_symbols + it->num_symbols) {
+            pos += num_left_symbols;
+            rank += left ? left->num_sub_counts[s] : 0;
+            break;
+        } else {
+            // everything in this subtree but the right one precedes i
+            auto right = it.right();
+            auto num_symbols = it->num_sub_symbols - (right ? right->num_sub_symbols : 0);
+            pos += num_symbols;
+            rank += it->num_sub_counts[s] - (right ? right->num_sub_counts[s] : 0);
+
+            i -= num_symbols;
+            it.go_right();
+        }
+    }
+
+    return it;
+}
+
+template <std::size_t W, std::size_t N, typename A>  // NOLINTNEXTLINE(runtime/references)
+void symbol_vector<W, N, A>::equalize_blocks(block &p, block &q) {
+    auto num_symbols = (p.num_symbols + q.num_symbols) / 2;
+    if (p.num_symbols > q.num_symbols) {
+        auto offset = p.num_symbols - num_symbols;
+        for (size_type w = 0; w < W; ++w) {
+            auto &p_bits = p.planes[w], &q_bits = q.planes[w];
+            q_bits <<= offset;
+            q_bits |= p_bits >> num_symbols;
+            p_bits ^= (p_bits >> num_symbols) << num_symbols;
+        }
+
+        p.num_symbols -= offset;
+        q.num_symbols += offset;
+    } else {
+        auto offset = q.num_symbols - num_symbols;
+        for (size_type w = 0; w < W; ++w) {
+            auto &p_bits = p.planes[w], &q_bits = q.planes[w];
+            auto mask = (q_bits >> offset) << offset;
+            p_bits |= (q_bits ^ mask) << p.num_symbols;
+            q_bits >>= offset;
+        }
+
+        p.num_symbols += offset;
+        q.num_symbols -= offset;
+    }
+}
+
+template <std::size_t W, std::size_t N, typename A>  // NOLINTNEXTLINE(runtime/references)
+inline void symbol_vector<W, N, A>::merge_blocks(block &p, block &q) {
+    for (size_type w = 0; w < W; ++w) {
+        p.planes[w] |= q.planes[w] << p.num_symbols;
+        q.planes[w].reset();
+    }
+
+    p.num_symbols += q.num_symbols;
+    q.num_symbols = 0;
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline void symbol_vector<W, N, A>::update_counts(typename bstree::iterator it) {
+    do {
+        update_node_counts(it);
+        it.go_parent();
+    } while (it);
+}
+
+template <std::size_t W, std::size_t N, typename A>
+inline void symbol_vector<W, N, A>::update_node_counts(typename bstree::iterator it) {
+    auto left = it.left();
+    auto right = it.right();
+
+    it->num_sub_symbols = it->num_symbols;
+    if (left) { it->num_sub_symbols += left->num_sub_symbols; }
+    if (right) { it->num_sub_symbols += right->num_sub_symbols; }
+
+    for (size_type t = 0; t < SIGMA; ++t) {
+        auto &num_sub_matches = it->num_sub_counts[t];
+        num_sub_matches = count_prefix(*it, t, it->num_symbols);
+        if (left) { num_sub_matches += left->num_sub_counts[t]; }
+        if (right) { num_sub_matches += right->num_sub_counts[t]; }
+    }
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_SYMBOL_VECTOR_HPP_
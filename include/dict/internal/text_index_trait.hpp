@@ -9,33 +9,52 @@
 #ifndef DICT_INTERNAL_TEXT_INDEX_TRAIT_HPP_
 #define DICT_INTERNAL_TEXT_INDEX_TRAIT_HPP_
 
+#include <cstdint>
+
+#include <type_traits>
 #include <vector>
 
-#include "wavelet_matrix.hpp"
+#include "huffman_wavelet_matrix.hpp"
+#include "multiary_wavelet_matrix.hpp"
 
 namespace dict {
 
 namespace internal {
 
 /************************************************
- * Declaration: struct text_index_trait
+ * Declaration: struct text_index_trait<T, WM>
  ************************************************/
 
+// Types shared by a text index and its updating policies. Term is the
+// unsigned integer type of the terms, whose width bounds the height of the
+// wavelet matrix. WaveletMatrix stores the BWT of the text; a
+// huffman_wavelet_matrix<Term> suits texts with skewed term frequencies.
+// The matrix also has to provide insert_batch(), which merges the terms of
+// a batch into its levels, and overloads of assign() and insert_batch()
+// taking a thread_pool. Its allocator_type is used for every dynamic
+// structure of the index and of its updating policies.
+template <typename Term = std::uint16_t,
+          typename WaveletMatrix = multiary_wavelet_matrix<Term>>
 struct text_index_trait {
+    static_assert(std::is_integral<Term>::value && std::is_unsigned<Term>::value,
+                  "terms must be of an unsigned integer type");
+
     using size_type = std::size_t;
-    using term_type = std::uint16_t;
+    using term_type = Term;
     using seq_type = std::vector<term_type>;
-    using wm_type = wavelet_matrix<term_type>;
+    using wm_type = WaveletMatrix;
+    using allocator_type = typename wm_type::allocator_type;
 
     struct helper;
     struct event;
-};  // class text_index_trait
+};  // class text_index_trait<T, WM>
 
 /************************************************
- * Declaration: struct text_index_trait::helper
+ * Declaration: struct text_index_trait<T, WM>::helper
  ************************************************/
 
-struct text_index_trait::helper {
+template <typename Term, typename WaveletMatrix>
+struct text_index_trait<Term, WaveletMatrix>::helper {
     template <typename TextIndex>
     static typename TextIndex::host_type *to_host(TextIndex *ti) {  // NOLINT(runtime/references)
         return static_cast<typename TextIndex::host_type *>(ti);
@@ -50,13 +69,14 @@ struct text_index_trait::helper {
     static wm_type const &get_wm(TextIndex const *ti) {
         return to_host(ti)->wm_;
     }
-};  // class text_index_trait::helper
+};  // class text_index_trait<T, WM>::helper
 
 /************************************************
- * Declaration: struct text_index_trait::event
+ * Declaration: struct text_index_trait<T, WM>::event
  ************************************************/
 
-struct text_index_trait::event {
+template <typename Term, typename WaveletMatrix>
+struct text_index_trait<Term, WaveletMatrix>::event {
     template <typename Sequence>
     struct after_inserting_first_term {
         Sequence const &s;
@@ -94,7 +114,20 @@ struct text_index_trait::event {
         size_type from_pos;
         size_type to_pos;
     };
-};  // class text_index_trait::event
+
+    // the inserted terms, as placed in front of the text, the rows of the
+    // suffixes starting at them and their positions in the order of rows
+    struct after_inserting_batch {
+        seq_type const &text;
+        std::vector<size_type> const &rows;
+        std::vector<size_type> const &sa;
+    };
+
+    struct after_building {
+        seq_type const &text;
+        std::vector<size_type> const &sa;
+    };
+};  // class text_index_trait<T, WM>::event
 
 }  // namespace internal
 
@@ -0,0 +1,114 @@
+/************************************************
+ *  thread_pool.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_THREAD_POOL_HPP_
+#define DICT_INTERNAL_THREAD_POOL_HPP_
+
+#include <cstddef>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Declaration: class thread_pool
+ ************************************************/
+
+// A fixed set of worker threads that run the tasks handed to run(). The
+// calling thread runs queued tasks as well while it waits, so tasks may call
+// run() themselves. A pool without workers runs the tasks on the calling
+// thread.
+class thread_pool {
+ public:  // Public Type(s)
+    using size_type = std::size_t;
+
+ public:  // Public Method(s)
+    explicit thread_pool(size_type num_threads);
+    thread_pool(thread_pool const &) = delete;
+    ~thread_pool();
+
+    thread_pool &operator=(thread_pool const &) = delete;
+
+    template <typename Function>
+    void run(size_type n, Function f);
+
+    size_type size() const;
+
+ private:  // Private Method(s)
+    void work();
+    bool run_queued();
+
+ private:  // Private Property(ies)
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopped_;
+};  // class thread_pool
+
+/************************************************
+ * Implementation: class thread_pool
+ ************************************************/
+
+template <typename Function>
+void thread_pool::run(size_type n, Function f) {
+    // calls f(0), ..., f(n - 1) and waits for all of them, rethrowing the
+    // first exception (by task order) if any
+    if (threads_.empty() || n == 1) {
+        for (size_type k = 0; k < n; ++k) {
+            f(k);
+        }
+
+        return;
+    }
+
+    std::vector<std::future<void>> results;
+    results.reserve(n);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_type k = 0; k < n; ++k) {
+            auto task = std::make_shared<std::packaged_task<void()>>([&f, k] { f(k); });
+            results.push_back(task->get_future());
+            tasks_.emplace_back([task] { (*task)(); });
+        }
+    }
+
+    cv_.notify_all();
+
+    // once the queue is empty, every task is either done or being run
+    while (run_queued()) {
+        // do nothing
+    }
+
+    for (auto &result : results) {
+        result.wait();
+    }
+
+    for (auto &result : results) {
+        result.get();
+    }
+}
+
+inline thread_pool::size_type thread_pool::size() const {
+    return threads_.size();
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_THREAD_POOL_HPP_
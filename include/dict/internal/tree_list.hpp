@@ -9,17 +9,24 @@
 #ifndef DICT_INTERNAL_TREE_LIST_HPP_
 #define DICT_INTERNAL_TREE_LIST_HPP_
 
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <vector>
+
 #include "rbtree.hpp"
+#include "serialization.hpp"
 
 namespace dict {
 
 namespace internal {
 
 /************************************************
- * Declaration: class tree_list
+ * Declaration: class basic_tree_list<A>
  ************************************************/
 
-class tree_list {
+template <typename Allocator>
+class basic_tree_list {
  private:  // Private Type(s) - Part 1
     template <bool IsConst> class tree_iterator;
 
@@ -28,16 +35,35 @@ class tree_list {
     using size_type = std::size_t;
     using reference = value_type &;
     using const_reference = value_type const &;
+    using allocator_type = Allocator;
 
     using iterator = tree_iterator<false>;
     using const_iterator = tree_iterator<true>;
 
  public:  // Public Method(s)
-    ~tree_list();
+    explicit basic_tree_list(allocator_type const &alloc = allocator_type());
+    template <typename InputIterator>
+    basic_tree_list(InputIterator first, InputIterator last,
+                    allocator_type const &alloc = allocator_type());
+    basic_tree_list(basic_tree_list const &) = default;
+    basic_tree_list(basic_tree_list &&) = default;
+    ~basic_tree_list();
+
+    basic_tree_list &operator=(basic_tree_list const &) = default;
+    basic_tree_list &operator=(basic_tree_list &&) = default;
+
+    allocator_type get_allocator() const;
+    void swap(basic_tree_list &other);  // NOLINT(runtime/references)
 
     iterator insert(iterator it, value_type val);
     iterator erase(iterator it);
 
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
     size_type size() const;
     reference at(size_type i);
     const_reference at(size_type i) const;
@@ -58,27 +84,35 @@ class tree_list {
  private:  // Private Type(s) - Part 2
     struct data;
     struct sizes_updater;
-    using tree = rbtree<data, sizes_updater>;
+    using tree = rbtree<data, sizes_updater, Allocator>;
 
  private:  // Private Static Method(s)
     static void update_sizes(typename tree::iterator it);
+    static void update_node_size(typename tree::iterator it);
 
  private:  // Private Property(ies)
     tree tree_;
-};  // class tree_list
+};  // class basic_tree_list<A>
 
 /************************************************
- * Declaration: class tree_list::tree_iterator<B>
+ * Declaration: alias tree_list
  ************************************************/
 
+using tree_list = basic_tree_list<std::allocator<std::size_t>>;
+
+/************************************************
+ * Declaration: class basic_tree_list<A>::tree_iterator<B>
+ ************************************************/
+
+template <typename A>
 template <bool IsConst>
-class tree_list::tree_iterator {
+class basic_tree_list<A>::tree_iterator {
  public:  // Public Type(s)
     using iterator_category = std::bidirectional_iterator_tag;
     using value_type = typename std::conditional<
         IsConst,
-        tree_list::value_type const,
-        tree_list::value_type
+        typename basic_tree_list<A>::value_type const,
+        typename basic_tree_list<A>::value_type
     >::type;
     using pointer = value_type *;
     using reference = value_type &;
@@ -86,8 +120,8 @@ class tree_list::tree_iterator {
 
     using rbtree_iterator = typename std::conditional<
         IsConst,
-        tree::const_iterator,
-        tree::iterator
+        typename tree::const_iterator,
+        typename tree::iterator
     >::type;
 
  public:  // Public Method(s)
@@ -112,95 +146,169 @@ class tree_list::tree_iterator {
 
  private:  // Private Property(ies)
     rbtree_iterator it_;
-};  // class tree_list::tree_iterator<B>
+};  // class basic_tree_list<A>::tree_iterator<B>
 
 /************************************************
- * Declaration: struct tree_list::data
+ * Declaration: struct basic_tree_list<A>::data
  ************************************************/
 
-struct tree_list::data {
+template <typename A>
+struct basic_tree_list<A>::data {
     explicit data(value_type x) : val(x), size(1) {
         // do nothing
     }
 
     value_type val;
     size_type size;
-};  // struct tree_list::data
+};  // struct basic_tree_list<A>::data
 
 /************************************************
- * Declaration: struct tree_list::sizes_updater
+ * Declaration: struct basic_tree_list<A>::sizes_updater
  ************************************************/
 
-struct tree_list::sizes_updater {
+template <typename A>
+struct basic_tree_list<A>::sizes_updater {
     void operator()(typename tree::iterator it) const {
         update_sizes(it);
     }
-};  // struct tree_list::sizes_updater
+};  // struct basic_tree_list<A>::sizes_updater
 
 /************************************************
- * Implementation: class tree_list
+ * Implementation: class basic_tree_list<A>
  ************************************************/
 
-inline tree_list::~tree_list() {
+template <typename A>
+inline basic_tree_list<A>::basic_tree_list(allocator_type const &alloc)
+    : tree_(alloc) {
+    // do nothing
+}
+
+template <typename A>
+template <typename InputIterator>
+inline basic_tree_list<A>::basic_tree_list(InputIterator first, InputIterator last,
+                                           allocator_type const &alloc)
+    : tree_(alloc) {
+    assign(first, last);
+}
+
+template <typename A>
+inline basic_tree_list<A>::~basic_tree_list() {
     // do nothing
 }
 
-inline tree_list::iterator tree_list::insert(iterator it, value_type val) {
+template <typename A>
+inline typename basic_tree_list<A>::allocator_type basic_tree_list<A>::get_allocator() const {
+    return tree_.get_allocator();
+}
+
+template <typename A>
+inline void basic_tree_list<A>::swap(basic_tree_list &other) {  // NOLINT(runtime/references)
+    tree_.swap(other.tree_);
+}
+
+template <typename A>
+inline typename basic_tree_list<A>::iterator
+basic_tree_list<A>::insert(iterator it, value_type val) {
     auto tree_it = tree_.insert_before(
-        it.get_tree_iterator(), tree::value_type(val));
+        it.get_tree_iterator(), typename tree::value_type(val));
     update_sizes(tree_it);
     return decltype(insert(it, val))(tree_it);
 }
 
-inline tree_list::iterator tree_list::erase(iterator it) {
+template <typename A>
+inline typename basic_tree_list<A>::iterator basic_tree_list<A>::erase(iterator it) {
     auto erased_it = it.get_tree_iterator();
     auto tree_it = tree_.erase(erased_it);
     return decltype(erase(it))(tree_it);
 }
 
-inline tree_list::size_type tree_list::size() const {
+template <typename A>
+template <typename InputIterator>
+void basic_tree_list<A>::assign(InputIterator first, InputIterator last) {
+    std::vector<data> nodes;
+    for (; first != last; ++first) {
+        nodes.emplace_back(*first);
+    }
+
+    tree_.assign(nodes.begin(), nodes.end(), update_node_size);
+}
+
+template <typename A>
+inline void basic_tree_list<A>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    write_value<std::uint64_t>(os, size());
+    for (auto x : *this) {
+        write_value<std::uint64_t>(os, x);
+    }
+}
+
+template <typename A>
+inline void basic_tree_list<A>::load(std::istream &is) {  // NOLINT(runtime/references)
+    auto n = read_value<std::uint64_t>(is);
+    check_remaining(is, n, sizeof(std::uint64_t));
+
+    std::vector<value_type> values;
+    values.reserve(n);
+    for (decltype(n) i = 0; i < n; ++i) {
+        values.push_back(read_value<std::uint64_t>(is));
+    }
+
+    assign(values.begin(), values.end());
+}
+
+template <typename A>
+inline typename basic_tree_list<A>::size_type basic_tree_list<A>::size() const {
     auto root = tree_.root();
     return root ? root->size : 0;
 }
 
-inline tree_list::iterator tree_list::begin() {
+template <typename A>
+inline typename basic_tree_list<A>::iterator basic_tree_list<A>::begin() {
     return decltype(begin())(tree_.begin());
 }
 
-inline tree_list::const_iterator tree_list::begin() const {
+template <typename A>
+inline typename basic_tree_list<A>::const_iterator basic_tree_list<A>::begin() const {
     return cbegin();
 }
 
-inline tree_list::const_iterator tree_list::cbegin() const {
+template <typename A>
+inline typename basic_tree_list<A>::const_iterator basic_tree_list<A>::cbegin() const {
     return decltype(cbegin())(tree_.cbegin());
 }
 
-inline tree_list::iterator tree_list::end() {
+template <typename A>
+inline typename basic_tree_list<A>::iterator basic_tree_list<A>::end() {
     return decltype(end())(tree_.end());
 }
 
-inline tree_list::const_iterator tree_list::end() const {
+template <typename A>
+inline typename basic_tree_list<A>::const_iterator basic_tree_list<A>::end() const {
     return cend();
 }
 
-inline tree_list::const_iterator tree_list::cend() const {
+template <typename A>
+inline typename basic_tree_list<A>::const_iterator basic_tree_list<A>::cend() const {
     return decltype(cend())(tree_.cend());
 }
 
-inline tree_list::reference tree_list::at(size_type i) {
+template <typename A>
+inline typename basic_tree_list<A>::reference basic_tree_list<A>::at(size_type i) {
     return *(find(i));
 }
 
-inline tree_list::const_reference tree_list::at(size_type i) const {
+template <typename A>
+inline typename basic_tree_list<A>::const_reference basic_tree_list<A>::at(size_type i) const {
     return *(find(i));
 }
 
-inline tree_list::iterator tree_list::find(size_type i) {
+template <typename A>
+inline typename basic_tree_list<A>::iterator basic_tree_list<A>::find(size_type i) {
     const auto &that = *this;
     return that.find(i).unconst();
 }
 
-inline tree_list::const_iterator tree_list::find(size_type i) const {
+template <typename A>
+inline typename basic_tree_list<A>::const_iterator basic_tree_list<A>::find(size_type i) const {
     auto it = tree_.root();
     while (it) {
         auto left_size = it.has_left() ? it.left()->size : 0;
@@ -217,116 +325,143 @@ inline tree_list::const_iterator tree_list::find(size_type i) const {
     return decltype(find(i))(it);
 }
 
-inline tree_list::reference tree_list::operator[](size_type i) {
+template <typename A>
+inline typename basic_tree_list<A>::reference basic_tree_list<A>::operator[](size_type i) {
     return at(i);
 }
 
-inline tree_list::const_reference tree_list::operator[](size_type i) const {
+template <typename A>
+inline typename basic_tree_list<A>::const_reference
+basic_tree_list<A>::operator[](size_type i) const {
     return at(i);
 }
 
-inline void tree_list::update_sizes(typename tree::iterator it) {
+template <typename A>
+inline void basic_tree_list<A>::update_sizes(typename tree::iterator it) {
     do {
-        it->size = 1;
-        if (it.has_left()) {
-            it->size += it.left()->size;
-        }
-
-        if (it.has_right()) {
-            it->size += it.right()->size;
-        }
-
+        update_node_size(it);
         it.go_parent();
     } while (it);
 }
 
+template <typename A>
+inline void basic_tree_list<A>::update_node_size(typename tree::iterator it) {
+    it->size = 1;
+    if (it.has_left()) {
+        it->size += it.left()->size;
+    }
+
+    if (it.has_right()) {
+        it->size += it.right()->size;
+    }
+}
+
 /************************************************
- * Implementation: class tree_list::tree_iterator<B>
+ * Implementation: class basic_tree_list<A>::tree_iterator<B>
  ************************************************/
 
+template <typename A>
 template <bool B>
-inline tree_list::tree_iterator<B>::tree_iterator() {
+inline basic_tree_list<A>::tree_iterator<B>::tree_iterator() {
     // do nothing
 }
 
+template <typename A>
 template <bool B>
-inline tree_list::tree_iterator<B>::tree_iterator(rbtree_iterator it)
+inline basic_tree_list<A>::tree_iterator<B>::tree_iterator(rbtree_iterator it)
     : it_(it) {
     // do nothing
 }
 
+template <typename A>
 template <bool B>
-inline tree_list::tree_iterator<B>::~tree_iterator() {
+inline basic_tree_list<A>::tree_iterator<B>::~tree_iterator() {
     // do nothing
 }
 
+template <typename A>
 template <bool B>
-inline typename tree_list::tree_iterator<B>::rbtree_iterator &
-    tree_list::tree_iterator<B>::get_tree_iterator() {
+inline typename basic_tree_list<A>::template tree_iterator<B>::rbtree_iterator &
+    basic_tree_list<A>::tree_iterator<B>::get_tree_iterator() {
     return it_;
 }
 
+template <typename A>
 template <bool B>
-inline typename tree_list::template tree_iterator<false>
-tree_list::tree_iterator<B>::unconst() const {
+inline typename basic_tree_list<A>::template tree_iterator<false>
+basic_tree_list<A>::tree_iterator<B>::unconst() const {
     return tree_iterator<false>(it_.unconst());
 }
 
+template <typename A>
 template <bool B>
-inline typename tree_list::template tree_iterator<B> &tree_list::tree_iterator<B>::operator++() {
+inline typename basic_tree_list<A>::template tree_iterator<B> &
+basic_tree_list<A>::tree_iterator<B>::operator++() {
     ++it_;
     return *this;
 }
 
+template <typename A>
 template <bool B>
-inline typename tree_list::template tree_iterator<B> tree_list::tree_iterator<B>::operator++(int) {
+inline typename basic_tree_list<A>::template tree_iterator<B>
+basic_tree_list<A>::tree_iterator<B>::operator++(int) {
     tree_iterator it(it_);
     operator++();
     return it;
 }
 
+template <typename A>
 template <bool B>
-inline typename tree_list::template tree_iterator<B> &tree_list::tree_iterator<B>::operator--() {
+inline typename basic_tree_list<A>::template tree_iterator<B> &
+basic_tree_list<A>::tree_iterator<B>::operator--() {
     --it_;
     return *this;
 }
 
+template <typename A>
 template <bool B>
-inline typename tree_list::template tree_iterator<B> tree_list::tree_iterator<B>::operator--(int) {
+inline typename basic_tree_list<A>::template tree_iterator<B>
+basic_tree_list<A>::tree_iterator<B>::operator--(int) {
     tree_iterator it(it_);
     operator--();
     return it;
 }
 
+template <typename A>
 template <bool B>
-inline typename tree_list::template tree_iterator<B>::reference
-tree_list::tree_iterator<B>::operator*() {
+inline typename basic_tree_list<A>::template tree_iterator<B>::reference
+basic_tree_list<A>::tree_iterator<B>::operator*() {
     return *operator->();
 }
 
+template <typename A>
 template <bool B>
-inline typename tree_list::template tree_iterator<B>::pointer
-tree_list::tree_iterator<B>::operator->() {
+inline typename basic_tree_list<A>::template tree_iterator<B>::pointer
+basic_tree_list<A>::tree_iterator<B>::operator->() {
     return &(it_->val);
 }
 
+template <typename A>
 template <bool B>
-inline bool tree_list::tree_iterator<B>::operator==(tree_iterator it) const {
+inline bool basic_tree_list<A>::tree_iterator<B>::operator==(tree_iterator it) const {
     return it_ == it.it_;
 }
 
+template <typename A>
 template <bool B>
-inline bool tree_list::tree_iterator<B>::operator!=(tree_iterator it) const {
+inline bool basic_tree_list<A>::tree_iterator<B>::operator!=(tree_iterator it) const {
     return !(*this == it);
 }
 
+template <typename A>
 template <bool B>
-inline bool tree_list::tree_iterator<B>::operator!() const {
+inline bool basic_tree_list<A>::tree_iterator<B>::operator!() const {
     return !this->operator bool();
 }
 
+template <typename A>
 template <bool B>
-inline tree_list::tree_iterator<B>::operator bool() const {
+inline basic_tree_list<A>::tree_iterator<B>::operator bool() const {
     return static_cast<bool>(it_);
 }
 
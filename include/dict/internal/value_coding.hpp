@@ -0,0 +1,291 @@
+/************************************************
+ *  value_coding.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_INTERNAL_VALUE_CODING_HPP_
+#define DICT_INTERNAL_VALUE_CODING_HPP_
+
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "broadword.hpp"
+
+namespace dict {
+
+namespace internal {
+
+// The codings keep the values of a block of packed_array, which holds up to
+// Capacity values. Their methods take the number n of values in the block
+// before the call; insert() and erase() shift the values after k.
+
+/************************************************
+ * Declaration: class fixed_width_coding<C>
+ ************************************************/
+
+// Packs the values at the width of the largest one, which grows as wider
+// values are stored.
+template <std::size_t Capacity>
+class fixed_width_coding {
+ public:  // Public Type(s)
+    using size_type = std::size_t;
+    using value_type = std::uint64_t;
+
+ public:  // Public Method(s)
+    fixed_width_coding();
+
+    value_type get(size_type k) const;
+    void set(size_type k, value_type x, size_type n);
+    void insert(size_type k, value_type x, size_type n);
+    value_type erase(size_type k, size_type n);
+
+    void decode(value_type *values, size_type n) const;
+    void encode(value_type const *values, size_type n);
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type WORD_SIZE = 64;
+
+ private:  // Private Type(s)
+    using word_type = std::uint64_t;
+
+ private:  // Private Static Method(s)
+    static size_type width_of(value_type x);
+
+ private:  // Private Method(s)
+    void resize(size_type n, size_type width);
+
+ private:  // Private Property(ies)
+    size_type width_;
+    std::vector<word_type> words_;
+};  // class fixed_width_coding<C>
+
+/************************************************
+ * Declaration: class byte_escape_coding<C>
+ ************************************************/
+
+// Suits mostly small values, such as LCP values. Each value takes a byte; a
+// value that does not fit is kept aside, and its byte is ESCAPE.
+template <std::size_t Capacity>
+class byte_escape_coding {
+ public:  // Public Type(s)
+    using size_type = std::size_t;
+    using value_type = std::uint64_t;
+
+ public:  // Public Method(s)
+    value_type get(size_type k) const;
+    void set(size_type k, value_type x, size_type n);
+    void insert(size_type k, value_type x, size_type n);
+    value_type erase(size_type k, size_type n);
+
+    void decode(value_type *values, size_type n) const;
+    void encode(value_type const *values, size_type n);
+
+ private:  // Private Static Property(ies)
+    static constexpr std::uint8_t ESCAPE = 0xFF;
+
+ private:  // Private Method(s)
+    size_type count_escapes(size_type k) const;
+
+ private:  // Private Property(ies)
+    std::array<std::uint8_t, Capacity> bytes_;
+
+    // the escaped values, in order
+    std::vector<value_type> wide_values_;
+};  // class byte_escape_coding<C>
+
+/************************************************
+ * Implementation: class fixed_width_coding<C>
+ ************************************************/
+
+template <std::size_t C>
+inline fixed_width_coding<C>::fixed_width_coding()
+    : width_(0) {
+    // do nothing
+}
+
+template <std::size_t C>
+inline typename fixed_width_coding<C>::value_type
+fixed_width_coding<C>::get(size_type k) const {
+    return width_ > 0 ? broadword::get_bits(words_.data(), k * width_, width_) : 0;
+}
+
+template <std::size_t C>
+void fixed_width_coding<C>::set(size_type k, value_type x, size_type n) {
+    auto width = width_of(x);
+    if (width > width_) {
+        // repack the whole block at the wider width
+        std::array<value_type, C> values;
+        decode(values.data(), n);
+        resize(n, width);
+        for (size_type t = 0; t < n; ++t) {
+            broadword::set_bits(words_.data(), t * width, width, values[t]);
+        }
+    }
+
+    if (width_ > 0) {
+        broadword::set_bits(words_.data(), k * width_, width_, x);
+    }
+}
+
+template <std::size_t C>
+void fixed_width_coding<C>::insert(size_type k, value_type x, size_type n) {
+    resize(n + 1, width_);
+    if (width_ > 0) {
+        auto *words = words_.data();
+        for (auto t = n; t > k; --t) {
+            auto y = broadword::get_bits(words, (t - 1) * width_, width_);
+            broadword::set_bits(words, t * width_, width_, y);
+        }
+    }
+
+    set(k, x, n + 1);
+}
+
+template <std::size_t C>
+typename fixed_width_coding<C>::value_type
+fixed_width_coding<C>::erase(size_type k, size_type n) {
+    auto x = get(k);
+    if (width_ > 0) {
+        auto *words = words_.data();
+        for (auto t = k + 1; t < n; ++t) {
+            auto y = broadword::get_bits(words, t * width_, width_);
+            broadword::set_bits(words, (t - 1) * width_, width_, y);
+        }
+    }
+
+    resize(n - 1, width_);
+    return x;
+}
+
+template <std::size_t C>
+void fixed_width_coding<C>::decode(value_type *values, size_type n) const {
+    for (size_type k = 0; k < n; ++k) {
+        values[k] = get(k);
+    }
+}
+
+template <std::size_t C>
+void fixed_width_coding<C>::encode(value_type const *values, size_type n) {
+    size_type width = 0;
+    for (size_type k = 0; k < n; ++k) {
+        auto w = width_of(values[k]);
+        if (w > width) { width = w; }
+    }
+
+    resize(n, width);
+    for (size_type k = 0; width > 0 && k < n; ++k) {
+        broadword::set_bits(words_.data(), k * width, width, values[k]);
+    }
+}
+
+template <std::size_t C>
+inline typename fixed_width_coding<C>::size_type fixed_width_coding<C>::width_of(value_type x) {
+    size_type width = 0;
+    for (; x > 0; x >>= 1) {
+        ++width;
+    }
+
+    return width;
+}
+
+template <std::size_t C>
+inline void fixed_width_coding<C>::resize(size_type n, size_type width) {
+    width_ = width;
+    words_.resize((n * width + WORD_SIZE - 1) / WORD_SIZE);
+}
+
+/************************************************
+ * Implementation: class byte_escape_coding<C>
+ ************************************************/
+
+template <std::size_t C>
+inline typename byte_escape_coding<C>::value_type
+byte_escape_coding<C>::get(size_type k) const {
+    auto b = bytes_[k];
+    return b != ESCAPE ? b : wide_values_[count_escapes(k)];
+}
+
+template <std::size_t C>
+void byte_escape_coding<C>::set(size_type k, value_type x, size_type) {
+    auto was_wide = bytes_[k] == ESCAPE;
+    auto is_wide = x >= ESCAPE;
+    if (!was_wide && !is_wide) {
+        bytes_[k] = static_cast<std::uint8_t>(x);
+        return;
+    }
+
+    auto wide_it = wide_values_.begin() + count_escapes(k);
+    if (was_wide && is_wide) {
+        *wide_it = x;
+    } else if (was_wide) {
+        wide_values_.erase(wide_it);
+        bytes_[k] = static_cast<std::uint8_t>(x);
+    } else {
+        wide_values_.insert(wide_it, x);
+        bytes_[k] = ESCAPE;
+    }
+}
+
+template <std::size_t C>
+void byte_escape_coding<C>::insert(size_type k, value_type x, size_type n) {
+    std::copy_backward(bytes_.begin() + k, bytes_.begin() + n, bytes_.begin() + n + 1);
+    bytes_[k] = 0;
+    set(k, x, n + 1);
+}
+
+template <std::size_t C>
+typename byte_escape_coding<C>::value_type
+byte_escape_coding<C>::erase(size_type k, size_type n) {
+    auto x = get(k);
+    set(k, 0, n);
+    std::copy(bytes_.begin() + k + 1, bytes_.begin() + n, bytes_.begin() + k);
+    return x;
+}
+
+template <std::size_t C>
+void byte_escape_coding<C>::decode(value_type *values, size_type n) const {
+    auto wide_it = wide_values_.begin();
+    for (size_type k = 0; k < n; ++k) {
+        auto b = bytes_[k];
+        values[k] = b != ESCAPE ? b : *wide_it++;
+    }
+}
+
+template <std::size_t C>
+void byte_escape_coding<C>::encode(value_type const *values, size_type n) {
+    wide_values_.clear();
+    for (size_type k = 0; k < n; ++k) {
+        auto x = values[k];
+        if (x < ESCAPE) {
+            bytes_[k] = static_cast<std::uint8_t>(x);
+        } else {
+            bytes_[k] = ESCAPE;
+            wide_values_.push_back(x);
+        }
+    }
+}
+
+template <std::size_t C>
+inline typename byte_escape_coding<C>::size_type
+byte_escape_coding<C>::count_escapes(size_type k) const {
+    if (wide_values_.empty()) { return 0; }
+
+    size_type num_escapes = 0;
+    for (size_type t = 0; t < k; ++t) {
+        num_escapes += bytes_[t] == ESCAPE;
+    }
+
+    return num_escapes;
+}
+
+}  // namespace internal
+
+}  // namespace dict
+
+#endif  // DICT_INTERNAL_VALUE_CODING_HPP_
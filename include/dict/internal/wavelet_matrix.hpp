@@ -10,29 +10,65 @@
 #define DICT_INTERNAL_WAVELET_MATRIX_HPP_
 
 #include <climits>
+#include <cstdint>
+
+#include <algorithm>
 #include <array>
+#include <istream>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include "bit_vector.hpp"
-#include "partial_sum.hpp"
+#include "broadword.hpp"
+#include "flat_partial_sum.hpp"
+#include "serialization.hpp"
+#include "thread_pool.hpp"
 
 namespace dict {
 
 namespace internal {
 
 /************************************************
- * Declaration: class wavelet_matrix<T, H>
+ * Declaration: class wavelet_matrix<T, H, B>
  ************************************************/
 
-template <typename T, std::size_t Height = sizeof(T) * CHAR_BIT>
+// The levels are stored in BitVector, which may be any dynamic bit vector
+// with the interface of bit_vector<N> (e.g. btree_bit_vector<L, F>).
+//
+// Given a thread pool, assign() builds each level over chunks of the values
+// in parallel: a chunk packs its bits into words and counts its zeros, and
+// the prefix sums of those counts tell where it moves its values to.
+template <typename T, std::size_t Height = sizeof(T) * CHAR_BIT,
+          typename BitVector = bit_vector<64>>
 class wavelet_matrix {
  public:  // Public Type(s)
     using value_type = T;
     using size_type = std::size_t;
+    using allocator_type = typename BitVector::allocator_type;
 
  public:  // Public Method(s)
+    explicit wavelet_matrix(allocator_type const &alloc = allocator_type());
+
+    allocator_type get_allocator() const;
+    void swap(wavelet_matrix &other);  // NOLINT(runtime/references)
+
     void insert(size_type i, value_type c);
     value_type erase(size_type i);
+    void insert_batch(std::vector<std::pair<size_type, value_type>> const &values);
+    void insert_batch(std::vector<std::pair<size_type, value_type>> const &values,
+                      thread_pool &pool);  // NOLINT(runtime/references)
+
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+    template <typename InputIterator>  // NOLINTNEXTLINE(runtime/references)
+    void assign(InputIterator first, InputIterator last, thread_pool &pool);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
 
     size_type size() const;
 
@@ -44,6 +80,7 @@ class wavelet_matrix {
 
     std::pair<value_type, size_type> access_and_lf(size_type i) const;
     size_type lf(size_type i) const;
+    std::pair<size_type, size_type> lf_range(size_type i, size_type j, value_type c) const;
     std::pair<size_type, value_type> psi_and_access(size_type i) const;
     size_type psi(size_type i) const;
     size_type psi(size_type i, value_type hint) const;
@@ -54,13 +91,17 @@ class wavelet_matrix {
 
  private:  // Private Static Property(ies)
     static constexpr size_type HEIGHT = Height;
-    static constexpr size_type BITMAP_BLOCK_SIZE = 64;
+    static constexpr size_type WORD_SIZE = 64;
+    static constexpr size_type CHUNK_SIZE = 1 << 16;
 
  private:  // Private Type(s)
-    using bitmap = bit_vector<BITMAP_BLOCK_SIZE>;
+    using bitmap = BitVector;
     using tree_level = std::pair<size_type, bitmap>;
 
  private:  // Private Method(s)
+    template <std::size_t... Ls>
+    wavelet_matrix(allocator_type const &alloc, std::index_sequence<Ls...>);
+
     void increase_num_zeros(size_type l);
     void decrease_num_zeros(size_type l);
     size_type num_zeros(size_type l) const;
@@ -70,15 +111,49 @@ class wavelet_matrix {
 
  private:  // Private Property(ies)
     std::array<tree_level, Height> levels_;
-    partial_sum<value_type, size_type> sums_;
-};  // class wavelet_matrix<T, H>
+    c_table<value_type, size_type, Height, allocator_type> sums_;
+};  // class wavelet_matrix<T, H, B>
 
 /************************************************
- * Implementation: class wavelet_matrix<T, H>
+ * Implementation: class wavelet_matrix<T, H, B>
  ************************************************/
 
-template <typename T, std::size_t H>
-void wavelet_matrix<T, H>::insert(size_type i, value_type c) {
+template <typename T, std::size_t H, typename B>
+inline wavelet_matrix<T, H, B>::wavelet_matrix(allocator_type const &alloc)
+    : wavelet_matrix(alloc, std::make_index_sequence<H>()) {
+    // do nothing
+}
+
+template <typename T, std::size_t H, typename B>
+template <std::size_t... Ls>
+inline wavelet_matrix<T, H, B>::wavelet_matrix(allocator_type const &alloc,
+                                               std::index_sequence<Ls...>)
+    // the levels are constructed in place, since a copy of a bit vector
+    // gets its allocator from select_on_container_copy_construction()
+    : levels_{{{std::piecewise_construct, std::forward_as_tuple(0),
+                std::forward_as_tuple((static_cast<void>(Ls), alloc))}...}},
+      sums_(alloc) {
+    // do nothing
+}
+
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::allocator_type
+wavelet_matrix<T, H, B>::get_allocator() const {
+    return level_bits(0).get_allocator();
+}
+
+template <typename T, std::size_t H, typename B>
+inline void wavelet_matrix<T, H, B>::swap(wavelet_matrix &other) {  // NOLINT(runtime/references)
+    for (size_type l = 0; l < levels_.size(); ++l) {
+        std::swap(levels_[l].first, other.levels_[l].first);
+        levels_[l].second.swap(other.levels_[l].second);
+    }
+
+    sums_.swap(other.sums_);
+}
+
+template <typename T, std::size_t H, typename B>
+void wavelet_matrix<T, H, B>::insert(size_type i, value_type c) {
     sums_.increase(c, 1);
     for (size_type l = 0; l < HEIGHT; ++l, c >>= 1) {
         auto &bits = level_bits(l);
@@ -92,8 +167,8 @@ void wavelet_matrix<T, H>::insert(size_type i, value_type c) {
     }
 }
 
-template <typename T, std::size_t H>
-typename wavelet_matrix<T, H>::value_type wavelet_matrix<T, H>::erase(size_type i) {
+template <typename T, std::size_t H, typename B>
+typename wavelet_matrix<T, H, B>::value_type wavelet_matrix<T, H, B>::erase(size_type i) {
     value_type c = 0;
     for (size_type l = 0; l < HEIGHT; ++l) {
         auto &bits = level_bits(l);
@@ -111,36 +186,216 @@ typename wavelet_matrix<T, H>::value_type wavelet_matrix<T, H>::erase(size_type
     return c;
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::size_type wavelet_matrix<T, H>::size() const {
+template <typename T, std::size_t H, typename B>
+inline void wavelet_matrix<T, H, B>::insert_batch(
+        std::vector<std::pair<size_type, value_type>> const &values) {
+    thread_pool pool(0);
+    insert_batch(values, pool);
+}
+
+template <typename T, std::size_t H, typename B>
+void wavelet_matrix<T, H, B>::insert_batch(
+        std::vector<std::pair<size_type, value_type>> const &values,
+        thread_pool &pool) {  // NOLINT(runtime/references)
+    // the values are given with their rows in the result, in ascending order
+    for (auto const &p : values) {
+        sums_.increase(p.second, 1);
+    }
+
+    // a batch of at least one value per word of the result is merged into
+    // the packed words of each level, and a smaller one is inserted bit by bit
+    auto k = values.size();
+    auto n = size() + k;
+    auto is_merged = k * WORD_SIZE >= n;
+    auto num_chunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<std::pair<size_type, value_type>> rows(values), next_rows(k);
+    std::vector<size_type> ranks(k);
+    for (size_type l = 0; l < HEIGHT; ++l) {
+        auto &bits = level_bits(l);
+        size_type num_new_zeros = 0;
+        for (size_type t = 0; t < k; ++t) {
+            if (!((rows[t].second >> l) & 1)) { ++num_new_zeros; }
+        }
+
+        if (is_merged) {
+            auto old_words = bits.words();
+            std::vector<std::uint64_t> words((n + WORD_SIZE - 1) / WORD_SIZE);
+            pool.run(num_chunks, [&, l](size_type c) {
+                // the old bits of a chunk are shifted by the new ones before it
+                auto first = c * CHUNK_SIZE, last = std::min(n, first + CHUNK_SIZE);
+                auto t = static_cast<size_type>(std::lower_bound(
+                    rows.begin(), rows.end(), first,
+                    [](std::pair<size_type, value_type> const &p, size_type i) {
+                        return p.first < i;
+                    }) - rows.begin());
+
+                for (auto i = first; i < last;) {
+                    auto end = t < k && rows[t].first < last ? rows[t].first : last;
+                    while (i < end) {
+                        auto len = end - i < WORD_SIZE ? end - i : WORD_SIZE;
+                        auto word = broadword::get_bits(old_words.data(), i - t, len);
+                        broadword::set_bits(words.data(), i, len, word);
+                        i += len;
+                    }
+
+                    if (i < last) {
+                        broadword::set_bits(words.data(), i++, 1, (rows[t++].second >> l) & 1);
+                    }
+                }
+            });
+
+            bits.assign_words(words, n);
+            pool.run((k + CHUNK_SIZE - 1) / CHUNK_SIZE, [&, l](size_type c) {
+                auto first = c * CHUNK_SIZE, last = std::min(k, first + CHUNK_SIZE);
+                for (auto t = first; t < last; ++t) {
+                    ranks[t] = bits.rank(rows[t].first, (rows[t].second >> l) & 1);
+                }
+            });
+        } else {
+            for (size_type t = 0; t < k; ++t) {
+                ranks[t] = bits.insert(rows[t].first, (rows[t].second >> l) & 1);
+            }
+        }
+
+        levels_[l].first += num_new_zeros;
+
+        // zeros go first on the next level and ones after them, both in order
+        size_type zero_t = 0, one_t = num_new_zeros;
+        for (size_type t = 0; t < k; ++t) {
+            auto b = (rows[t].second >> l) & 1;
+            auto i = ranks[t] - 1 + (b ? num_zeros(l) : 0);
+            next_rows[b ? one_t++ : zero_t++] = std::make_pair(i, rows[t].second);
+        }
+
+        rows.swap(next_rows);
+    }
+}
+
+template <typename T, std::size_t H, typename B>
+template <typename InputIterator>
+inline void wavelet_matrix<T, H, B>::assign(InputIterator first, InputIterator last) {
+    thread_pool pool(0);
+    assign(first, last, pool);
+}
+
+template <typename T, std::size_t H, typename B>
+template <typename InputIterator>  // NOLINTNEXTLINE(runtime/references)
+void wavelet_matrix<T, H, B>::assign(InputIterator first, InputIterator last, thread_pool &pool) {
+    std::vector<value_type> values(first, last);
+    auto n = values.size();
+
+    std::vector<size_type> counts;
+    for (auto c : values) {
+        if (c >= counts.size()) { counts.resize(c + 1, 0); }
+        ++counts[c];
+    }
+
+    std::vector<std::pair<value_type, size_type>> sums;
+    for (size_type c = 0; c < counts.size(); ++c) {
+        if (counts[c] > 0) { sums.emplace_back(c, counts[c]); }
+    }
+
+    sums_.assign(sums.begin(), sums.end());
+
+    // each level is a stable partition of the previous one by a single bit;
+    // chunks start at word boundaries, so they never share a word
+    auto num_chunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<value_type> next_values(n);
+    std::vector<std::uint64_t> words((n + WORD_SIZE - 1) / WORD_SIZE);
+    std::vector<size_type> chunk_zeros(num_chunks + 1);
+    for (size_type l = 0; l < HEIGHT; ++l) {
+        pool.run(num_chunks, [&, l](size_type k) {
+            auto first = k * CHUNK_SIZE, last = std::min(n, first + CHUNK_SIZE);
+            size_type num_ones = 0;
+            for (auto i = first; i < last; i += WORD_SIZE) {
+                std::uint64_t word = 0;
+                for (auto j = i; j < last && j < i + WORD_SIZE; ++j) {
+                    word |= static_cast<std::uint64_t>((values[j] >> l) & 1) << (j - i);
+                }
+
+                words[i / WORD_SIZE] = word;
+                num_ones += broadword::popcount(word);
+            }
+
+            chunk_zeros[k + 1] = last - first - num_ones;
+        });
+
+        chunk_zeros[0] = 0;
+        std::partial_sum(chunk_zeros.begin(), chunk_zeros.end(), chunk_zeros.begin());
+        auto num_zeros = chunk_zeros[num_chunks];
+
+        pool.run(num_chunks, [&, l, num_zeros](size_type k) {
+            auto first = k * CHUNK_SIZE, last = std::min(n, first + CHUNK_SIZE);
+            auto zero_it = next_values.begin() + chunk_zeros[k];
+            auto one_it = next_values.begin() + num_zeros + (first - chunk_zeros[k]);
+            for (auto i = first; i < last; ++i) {
+                *(((values[i] >> l) & 1) ? one_it : zero_it)++ = values[i];
+            }
+        });
+
+        level_bits(l).assign_words(words, n);
+        levels_[l].first = num_zeros;
+        values.swap(next_values);
+    }
+}
+
+template <typename T, std::size_t H, typename B>
+void wavelet_matrix<T, H, B>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    write_value<std::uint64_t>(os, HEIGHT);
+    for (size_type l = 0; l < HEIGHT; ++l) {
+        write_value<std::uint64_t>(os, num_zeros(l));
+        level_bits(l).save(os);
+    }
+
+    sums_.save(os);
+}
+
+template <typename T, std::size_t H, typename B>
+void wavelet_matrix<T, H, B>::load(std::istream &is) {  // NOLINT(runtime/references)
+    if (read_value<std::uint64_t>(is) != HEIGHT) {
+        throw std::runtime_error("mismatched height of wavelet_matrix");
+    }
+
+    for (size_type l = 0; l < HEIGHT; ++l) {
+        levels_[l].first = read_value<std::uint64_t>(is);
+        level_bits(l).load(is);
+    }
+
+    sums_.load(is);
+}
+
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::size_type wavelet_matrix<T, H, B>::size() const {
     auto const &bits = level_bits(0);
     return bits.size();
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::size_type wavelet_matrix<T, H>::sum(value_type c) const {
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::size_type
+wavelet_matrix<T, H, B>::sum(value_type c) const {
     return (c > 0) ? sums_.sum(c - 1) : 0;
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::value_type wavelet_matrix<T, H>::search(size_type i) const {
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::value_type
+wavelet_matrix<T, H, B>::search(size_type i) const {
     return sums_.search(i);
 }
 
-template <typename T, std::size_t H>
+template <typename T, std::size_t H, typename B>
 inline std::pair<
-    typename wavelet_matrix<T, H>::value_type,
-    typename wavelet_matrix<T, H>::size_type
+    typename wavelet_matrix<T, H, B>::value_type,
+    typename wavelet_matrix<T, H, B>::size_type
 >
-wavelet_matrix<T, H>::access_and_rank(size_type i) const {
+wavelet_matrix<T, H, B>::access_and_rank(size_type i) const {
     auto pair = access_and_lf(i);
     auto ps = sum(pair.first);
     return std::make_pair(pair.first, pair.second + 1 - ps);
 }
 
-template <typename T, std::size_t H>
-typename wavelet_matrix<T, H>::size_type
-wavelet_matrix<T, H>::rank(size_type i, value_type c) const {
+template <typename T, std::size_t H, typename B>
+typename wavelet_matrix<T, H, B>::size_type
+wavelet_matrix<T, H, B>::rank(size_type i, value_type c) const {
     auto ps = sum(c);
     for (size_type l = 0; l < HEIGHT; ++l, c >>= 1) {
         auto &bits = level_bits(l);
@@ -158,18 +413,18 @@ wavelet_matrix<T, H>::rank(size_type i, value_type c) const {
     return i + 1 - ps;
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::size_type
-wavelet_matrix<T, H>::select(size_type j, value_type c) const {
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::size_type
+wavelet_matrix<T, H, B>::select(size_type j, value_type c) const {
     return select_at(j + sum(c), c);
 }
 
-template <typename T, std::size_t H>
+template <typename T, std::size_t H, typename B>
 std::pair<
-    typename wavelet_matrix<T, H>::value_type,
-    typename wavelet_matrix<T, H>::size_type
+    typename wavelet_matrix<T, H, B>::value_type,
+    typename wavelet_matrix<T, H, B>::size_type
 >
-wavelet_matrix<T, H>::access_and_lf(size_type i) const {
+wavelet_matrix<T, H, B>::access_and_lf(size_type i) const {
     value_type c = 0;
     for (size_type l = 0; l < HEIGHT; ++l) {
         auto &bits = level_bits(l);
@@ -181,72 +436,96 @@ wavelet_matrix<T, H>::access_and_lf(size_type i) const {
     return std::make_pair(c, i);
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::size_type wavelet_matrix<T, H>::lf(size_type i) const {
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::size_type wavelet_matrix<T, H, B>::lf(size_type i) const {
     return access_and_lf(i).second;
 }
 
-template <typename T, std::size_t H>
+template <typename T, std::size_t H, typename B>
+std::pair<
+    typename wavelet_matrix<T, H, B>::size_type,
+    typename wavelet_matrix<T, H, B>::size_type
+>
+wavelet_matrix<T, H, B>::lf_range(size_type i, size_type j, value_type c) const {
+    // map both ends of [i, j) in the same top-down pass
+    for (size_type l = 0; l < HEIGHT && i < j; ++l, c >>= 1) {
+        auto &bits = level_bits(l);
+        auto b = c & 1;
+        i = (i > 0) ? bits.rank(i - 1, b) : 0;
+        j = (j > 0) ? bits.rank(j - 1, b) : 0;
+        if (b) {
+            i += num_zeros(l);
+            j += num_zeros(l);
+        }
+    }
+
+    return (i < j) ? std::make_pair(i, j) : std::make_pair(i, i);
+}
+
+template <typename T, std::size_t H, typename B>
 inline std::pair<
-    typename wavelet_matrix<T, H>::size_type,
-    typename wavelet_matrix<T, H>::value_type
+    typename wavelet_matrix<T, H, B>::size_type,
+    typename wavelet_matrix<T, H, B>::value_type
 >
-wavelet_matrix<T, H>::psi_and_access(size_type i) const {
+wavelet_matrix<T, H, B>::psi_and_access(size_type i) const {
     auto c = sums_.search(i + 1);
     return std::make_pair(select_at(i, c), c);
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::size_type wavelet_matrix<T, H>::psi(size_type i) const {
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::size_type
+wavelet_matrix<T, H, B>::psi(size_type i) const {
     return psi_and_access(i).first;
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::size_type wavelet_matrix<T, H>::psi(size_type i,
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::size_type wavelet_matrix<T, H, B>::psi(size_type i,
                                                                           value_type hint) const {
     return select_at(i, hint);
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::value_type wavelet_matrix<T, H>::at(size_type i) const {
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::value_type
+wavelet_matrix<T, H, B>::at(size_type i) const {
     return access_and_lf(i).first;
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::value_type
-wavelet_matrix<T, H>::operator[](size_type i) const {
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::value_type
+wavelet_matrix<T, H, B>::operator[](size_type i) const {
     return at(i);
 }
 
-template <typename T, std::size_t H>
-inline void wavelet_matrix<T, H>::increase_num_zeros(size_type l) {
+template <typename T, std::size_t H, typename B>
+inline void wavelet_matrix<T, H, B>::increase_num_zeros(size_type l) {
     levels_[l].first++;
 }
 
-template <typename T, std::size_t H>
-inline void wavelet_matrix<T, H>::decrease_num_zeros(size_type l) {
+template <typename T, std::size_t H, typename B>
+inline void wavelet_matrix<T, H, B>::decrease_num_zeros(size_type l) {
     levels_[l].first--;
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::size_type wavelet_matrix<T, H>::num_zeros(size_type l) const {
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::size_type
+wavelet_matrix<T, H, B>::num_zeros(size_type l) const {
     return levels_[l].first;
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::bitmap &wavelet_matrix<T, H>::level_bits(size_type l) {
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::bitmap &wavelet_matrix<T, H, B>::level_bits(size_type l) {
     return levels_[l].second;
 }
 
-template <typename T, std::size_t H>
-inline typename wavelet_matrix<T, H>::bitmap const &
-wavelet_matrix<T, H>::level_bits(size_type l) const {
+template <typename T, std::size_t H, typename B>
+inline typename wavelet_matrix<T, H, B>::bitmap const &
+wavelet_matrix<T, H, B>::level_bits(size_type l) const {
     return levels_[l].second;
 }
 
-template <typename T, std::size_t H>
-typename wavelet_matrix<T, H>::size_type
-wavelet_matrix<T, H>::select_at(size_type j, value_type c) const {
+template <typename T, std::size_t H, typename B>
+typename wavelet_matrix<T, H, B>::size_type
+wavelet_matrix<T, H, B>::select_at(size_type j, value_type c) const {
     for (auto l = HEIGHT; l > 0; --l) {
         auto &bits = level_bits(l - 1);
         auto b = (c >> (l - 1)) & 1;
@@ -9,11 +9,18 @@
 #ifndef DICT_INTERNAL_WITH_LCP_IMPL_HPP_
 #define DICT_INTERNAL_WITH_LCP_IMPL_HPP_
 
+#include <cstdint>
+
+#include <algorithm>
+#include <istream>
 #include <iterator>
+#include <ostream>
+#include <utility>
+#include <vector>
 
 #include "chained_updater.hpp"
 #include "lcp_trait.hpp"
-#include "tree_list.hpp"
+#include "packed_array.hpp"
 #include "type_list.hpp"
 
 namespace dict {
@@ -39,12 +46,13 @@ class with_lcp_impl : public chained_updater<
  public:  // Public Type(s)
     using host_type = TextIndex;
     using size_type = typename Trait::size_type;
+    using allocator_type = typename Trait::allocator_type;
 
  private:  // Private Types(s)
     using helper = typename Trait::helper;
     using event = typename Trait::event;
 
-    using lcp_trait = lcp_trait<Trait>;
+    using lcp_trait = internal::lcp_trait<Trait>;
     using updating_policies = chained_updater<
             type_list<
                 with_lcp_impl<TextIndex, Trait>,
@@ -54,6 +62,8 @@ class with_lcp_impl : public chained_updater<
         >;
 
  public:  // Public Method(s)
+    explicit with_lcp_impl(allocator_type const &alloc = allocator_type());
+
     size_type lcp(size_type i) const;
 
  protected:  // Protected Method(s)
@@ -69,8 +79,21 @@ class with_lcp_impl : public chained_updater<
     void update(typename event::after_moving_term const &);
     void update(typename event::after_erasuring_sequence const &);
 
+    void update(typename event::after_inserting_batch const &info);
+    void update(typename event::after_building const &info);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+    void swap(with_lcp_impl &other);  // NOLINT(runtime/references)
+
+ protected:  // Protected Static Method(s)
+    static std::uint64_t tag();
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type LCP_BLOCK_SIZE = 64;
+
  private:  // Private Property(ies)
-    tree_list lcpa_;
+    packed_array<LCP_BLOCK_SIZE, byte_escape_coding, allocator_type> lcpa_;
     size_type psi_lcp_;
 };  // class with_lcp_impl<TI, T, UPs...>
 
@@ -78,6 +101,12 @@ class with_lcp_impl : public chained_updater<
  * Implementation: class with_lcp_impl<TI, T, UPs...>
  ************************************************/
 
+template <typename TI, typename T, template <typename, typename> class... UPs>
+inline with_lcp_impl<TI, T, UPs...>::with_lcp_impl(allocator_type const &alloc)
+    : updating_policies(alloc), lcpa_(alloc), psi_lcp_(0) {
+    // do nothing
+}
+
 template <typename TI, typename T, template <typename, typename> class... UPs>
 inline typename with_lcp_impl<TI, T, UPs...>::size_type
 with_lcp_impl<TI, T, UPs...>::lcp(size_type i) const {
@@ -89,7 +118,7 @@ template <typename Sequence>
 inline void with_lcp_impl<TI, T, UPs...>::update(
         typename event::template after_inserting_first_term<Sequence> const &info) {
     assert(psi_lcp_ == 0);
-    lcpa_.insert(lcpa_.begin(), 0);
+    lcpa_.insert(0, 0);
     updating_policies::update(typename lcp_trait::event::template after_inserting_lcp<Sequence>{
         info.s, 0,
         0, 0, 0
@@ -118,8 +147,8 @@ void with_lcp_impl<TI, T, UPs...>::update(
     };
 
     // calculate LCP[pos]
-    auto lcpa_it = lcpa_.find(pos);
-    auto old_lcp = lcpa_it ? *lcpa_it : 0;
+    auto has_next = pos < lcpa_.size();
+    auto old_lcp = has_next ? lcpa_[pos] : 0;
     assert(pos > 0);
     if (psi_pos > 0 && psi(pos - 1) == psi_pos - 1) {
         if (num_inserted > 0 && *s_rend == term_at_f(pos - 1)) {
@@ -142,9 +171,9 @@ void with_lcp_impl<TI, T, UPs...>::update(
         }
     }
 
-    if (lcpa_it && old_lcp == psi_lcp_) {
+    auto next_lcp = old_lcp;
+    if (has_next && old_lcp == psi_lcp_) {
         // re-calculate LCP[pos + 1]
-        auto &next_lcp = *lcpa_it;
         auto s_it = s_rend;
         auto x = pos + 1;
         for (next_lcp = 0; next_lcp < old_lcp; ++next_lcp) {
@@ -157,13 +186,15 @@ void with_lcp_impl<TI, T, UPs...>::update(
             ++next_lcp;
             --s_it;
         }
+
+        lcpa_.set(pos, next_lcp);
     }
 
-    lcpa_.insert(lcpa_it, psi_lcp_);
+    lcpa_.insert(pos, psi_lcp_);
     updating_policies::update(
         typename lcp_trait::event::template after_inserting_lcp<Sequence>{
             info.s, info.num_inserted,
-            pos, psi_lcp_, lcpa_it ? *lcpa_it : 0
+            pos, psi_lcp_, next_lcp
         });
 }
 
@@ -183,15 +214,14 @@ inline void with_lcp_impl<TI, T, UPs...>::update(
 template <typename TI, typename T, template <typename, typename> class... UPs>
 inline void with_lcp_impl<TI, T, UPs...>::update(
         typename event::after_erasuring_term const &info) {
-    auto it = lcpa_.find(info.pos);
-    auto lcp = *it;
-    auto next_it = lcpa_.erase(it);
-    auto next_lcp = next_it ? *next_it : 0;
-    if (next_lcp > lcp) { *next_it = lcp; }
+    auto pos = info.pos;
+    auto lcp = lcpa_.erase(pos);
+    auto next_lcp = pos < lcpa_.size() ? lcpa_[pos] : 0;
+    if (next_lcp > lcp) { lcpa_.set(pos, lcp); }
 
     updating_policies::update(
         typename lcp_trait::event::after_erasing_lcp{
-            info.s, info.pos, lcp, next_lcp
+            info.s, pos, lcp, next_lcp
         });
 }
 
@@ -207,6 +237,113 @@ inline void with_lcp_impl<TI, T, UPs...>::update(
     // do nothing
 }
 
+template <typename TI, typename T, template <typename, typename> class... UPs>
+void with_lcp_impl<TI, T, UPs...>::update(typename event::after_inserting_batch const &info) {
+    auto const &text = info.text;
+    auto const &rows = info.rows;
+    auto const *host = helper::to_host(this);
+    auto n = host->num_terms();
+
+    // LCP of the new suffix at j with the one at row x; its terms are known,
+    // and those of the other suffix are read along psi
+    auto lcp_with = [&text, host](size_type j, size_type x) {
+        size_type h = 0;
+        while (text[j + h] != 0 && text[j + h] == host->f(x)) {
+            x = host->psi(x);
+            ++h;
+        }
+
+        return h;
+    };
+
+    std::vector<size_type> new_rows, lcps, next_lcps;
+    for (auto j : info.sa) {
+        lcpa_.insert(rows[j], 0);
+        new_rows.push_back(rows[j]);
+    }
+
+    // the new rows and the old ones after them have new preceding rows;
+    // row 0 is the last terminator, which is never new
+    for (auto j : info.sa) {
+        auto i = rows[j];
+        auto lcp = lcp_with(j, i - 1);
+        lcpa_.set(i, lcp);
+        lcps.push_back(lcp);
+
+        auto next_lcp = i + 1 < n ? lcpa_[i + 1] : 0;
+        if (i + 1 < n && !std::binary_search(new_rows.begin(), new_rows.end(), i + 1)) {
+            next_lcp = lcp_with(j, i + 1);
+            lcpa_.set(i + 1, next_lcp);
+        }
+
+        next_lcps.push_back(next_lcp);
+    }
+
+    updating_policies::update(typename lcp_trait::event::after_inserting_batch_lcp{
+        text, new_rows, lcps, next_lcps
+    });
+}
+
+template <typename TI, typename T, template <typename, typename> class... UPs>
+void with_lcp_impl<TI, T, UPs...>::update(typename event::after_building const &info) {
+    auto const &text = info.text;
+    auto const &sa = info.sa;
+    auto n = sa.size();
+
+    std::vector<size_type> isa(n);
+    for (size_type i = 0; i < n; ++i) {
+        isa[sa[i]] = i;
+    }
+
+    // Kasai's algorithm, except that terminators never match each other
+    std::vector<size_type> lcpa(n, 0);
+    size_type h = 0;
+    for (size_type j = 0; j < n; ++j) {
+        auto i = isa[j];
+        if (i == 0) {
+            h = 0;
+            continue;
+        }
+
+        auto k = sa[i - 1];
+        while (text[j + h] != 0 && text[j + h] == text[k + h]) {
+            ++h;
+        }
+
+        lcpa[i] = h;
+        if (h > 0) { --h; }
+    }
+
+    lcpa_.assign(lcpa.begin(), lcpa.end());
+    updating_policies::update(typename lcp_trait::event::after_building_lcp{text, lcpa});
+}
+
+template <typename TI, typename T, template <typename, typename> class... UPs>
+// NOLINTNEXTLINE(runtime/references)
+inline void with_lcp_impl<TI, T, UPs...>::save(std::ostream &os) const {
+    lcpa_.save(os);
+    updating_policies::save(os);
+}
+
+template <typename TI, typename T, template <typename, typename> class... UPs>
+inline void with_lcp_impl<TI, T, UPs...>::load(std::istream &is) {  // NOLINT(runtime/references)
+    lcpa_.load(is);
+    updating_policies::load(is);
+}
+
+template <typename TI, typename T, template <typename, typename> class... UPs>
+void with_lcp_impl<TI, T, UPs...>::swap(with_lcp_impl &other) {  // NOLINT(runtime/references)
+    updating_policies::swap(other);
+    lcpa_.swap(other.lcpa_);
+    std::swap(psi_lcp_, other.psi_lcp_);
+}
+
+template <typename TI, typename T, template <typename, typename> class... UPs>
+inline std::uint64_t with_lcp_impl<TI, T, UPs...>::tag() {
+    // "LCP", along with the tags of the policies kept on the lcp array
+    return updating_policies::tag() ^ 0x50434C;
+}
+
 }  // namespace internal
 
 }  // namespace dict
@@ -0,0 +1,241 @@
+/************************************************
+ *  sharded_text_index.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_SHARDED_TEXT_INDEX_HPP_
+#define DICT_SHARDED_TEXT_INDEX_HPP_
+
+#include <cstdint>
+
+#include <istream>
+#include <iterator>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "internal/serialization.hpp"
+#include "internal/thread_pool.hpp"
+#include "text_index.hpp"
+
+namespace dict {
+
+/************************************************
+ * Declaration: class basic_sharded_text_index<TI>
+ ************************************************/
+
+// Spreads the sequences round-robin over independent text indexes (shards),
+// so that batches are inserted and queries are answered by all shards in
+// parallel. A sequence is identified by id * num_shards() + k, where id is
+// its identifier in the k-th shard; like those, it is valid until the next
+// update of the shard. Patterns spanning the end of a sequence are matched
+// against the next sequence in the same shard only.
+//
+// Shards share no state (each tree allocates its nodes from a pool of its
+// own), so they are updated and queried without any locking.
+template <typename TextIndex>
+class basic_sharded_text_index {
+ public:  // Public Type(s)
+    using index_type = TextIndex;
+    using size_type = typename TextIndex::size_type;
+    using term_type = typename TextIndex::term_type;
+
+ public:  // Public Method(s)
+    explicit basic_sharded_text_index(size_type num_shards, size_type num_threads = 0);
+
+    template <typename Sequence>
+    void insert(Sequence const &s);
+    template <typename Sequences>
+    void insert_batch(Sequences const &seqs);
+    void erase(size_type id);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
+    bool empty() const;
+    size_type num_shards() const;
+    size_type num_seqs() const;
+    size_type num_terms() const;
+    TextIndex const &shard(size_type k) const;
+
+    template <typename Sequence>
+    size_type count(Sequence const &s) const;
+    template <typename Sequence, typename OutputIterator>
+    OutputIterator locate(Sequence const &s, OutputIterator it) const;
+    template <typename OutputIterator>
+    OutputIterator extract(size_type id, size_type from, size_type len, OutputIterator it) const;
+
+ private:  // Private Property(ies)
+    std::vector<TextIndex> shards_;
+    size_type next_shard_;
+    mutable internal::thread_pool pool_;
+};  // class basic_sharded_text_index<TI>
+
+/************************************************
+ * Declaration: type sharded_text_index<UPs...>
+ ************************************************/
+
+template <template <typename, typename> class... UpdatingPolicies>
+using sharded_text_index = basic_sharded_text_index<text_index<UpdatingPolicies...>>;
+
+/************************************************
+ * Implementation: class basic_sharded_text_index<TI>
+ ************************************************/
+
+template <typename TI>
+basic_sharded_text_index<TI>::basic_sharded_text_index(size_type num_shards,
+                                                       size_type num_threads)
+    : shards_(num_shards), next_shard_(0),
+      pool_(num_threads > 0 ? num_threads : std::thread::hardware_concurrency()) {
+    if (num_shards == 0) {
+        throw std::invalid_argument("number of shards must be positive");
+    }
+}
+
+template <typename TI>
+template <typename Sequence>
+inline void basic_sharded_text_index<TI>::insert(Sequence const &s) {
+    shards_[next_shard_].insert(s);
+    next_shard_ = (next_shard_ + 1) % shards_.size();
+}
+
+template <typename TI>
+template <typename Sequences>
+void basic_sharded_text_index<TI>::insert_batch(Sequences const &seqs) {
+    using sequence = typename std::iterator_traits<decltype(std::begin(seqs))>::value_type;
+
+    auto num_shards = shards_.size();
+    std::vector<std::vector<sequence>> batches(num_shards);
+    for (auto const &s : seqs) {
+        batches[next_shard_].push_back(s);
+        next_shard_ = (next_shard_ + 1) % num_shards;
+    }
+
+    // the shards share the pool with the levels they build
+    pool_.run(num_shards, [this, &batches](size_type k) {
+        if (!batches[k].empty()) {
+            shards_[k].insert_batch(batches[k], pool_);
+        }
+    });
+}
+
+template <typename TI>
+inline void basic_sharded_text_index<TI>::erase(size_type id) {
+    auto num_shards = shards_.size();
+    shards_[id % num_shards].erase(id / num_shards);
+}
+
+template <typename TI>
+void basic_sharded_text_index<TI>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    internal::write_value<std::uint64_t>(os, shards_.size());
+    internal::write_value<std::uint64_t>(os, next_shard_);
+    for (auto const &ti : shards_) {
+        ti.save(os);
+    }
+}
+
+template <typename TI>
+void basic_sharded_text_index<TI>::load(std::istream &is) {  // NOLINT(runtime/references)
+    auto num_shards = internal::read_value<std::uint64_t>(is);
+    auto next_shard = internal::read_value<std::uint64_t>(is);
+    if (num_shards == 0 || next_shard >= num_shards) {
+        throw std::runtime_error("invalid number of shards");
+    }
+
+    // each shard starts with a header of four words
+    internal::check_remaining(is, num_shards, 4 * sizeof(std::uint64_t));
+
+    std::vector<TI> shards(num_shards);
+    for (auto &ti : shards) {
+        ti.load(is);
+    }
+
+    shards_.swap(shards);
+    next_shard_ = next_shard;
+}
+
+template <typename TI>
+inline bool basic_sharded_text_index<TI>::empty() const {
+    return num_seqs() == 0;
+}
+
+template <typename TI>
+inline typename basic_sharded_text_index<TI>::size_type
+basic_sharded_text_index<TI>::num_shards() const {
+    return shards_.size();
+}
+
+template <typename TI>
+inline typename basic_sharded_text_index<TI>::size_type
+basic_sharded_text_index<TI>::num_seqs() const {
+    size_type n = 0;
+    for (auto const &ti : shards_) {
+        n += ti.num_seqs();
+    }
+
+    return n;
+}
+
+template <typename TI>
+inline typename basic_sharded_text_index<TI>::size_type
+basic_sharded_text_index<TI>::num_terms() const {
+    size_type n = 0;
+    for (auto const &ti : shards_) {
+        n += ti.num_terms();
+    }
+
+    return n;
+}
+
+template <typename TI>
+inline TI const &basic_sharded_text_index<TI>::shard(size_type k) const {
+    return shards_.at(k);
+}
+
+template <typename TI>
+template <typename Sequence>
+typename basic_sharded_text_index<TI>::size_type
+basic_sharded_text_index<TI>::count(Sequence const &s) const {
+    std::vector<size_type> counts(shards_.size());
+    pool_.run(shards_.size(), [this, &s, &counts](size_type k) {
+        counts[k] = shards_[k].count(s);
+    });
+
+    return std::accumulate(counts.begin(), counts.end(), static_cast<size_type>(0));
+}
+
+template <typename TI>
+template <typename Sequence, typename OutputIterator>
+OutputIterator basic_sharded_text_index<TI>::locate(Sequence const &s, OutputIterator it) const {
+    auto num_shards = shards_.size();
+    std::vector<std::vector<std::pair<size_type, size_type>>> results(num_shards);
+    pool_.run(num_shards, [this, &s, &results](size_type k) {
+        shards_[k].locate(s, std::back_inserter(results[k]));
+    });
+
+    for (size_type k = 0; k < num_shards; ++k) {
+        for (auto const &p : results[k]) {
+            *it++ = std::make_pair(p.first * num_shards + k, p.second);
+        }
+    }
+
+    return it;
+}
+
+template <typename TI>
+template <typename OutputIterator>
+inline OutputIterator basic_sharded_text_index<TI>::extract(
+        size_type id, size_type from, size_type len, OutputIterator it) const {
+    auto num_shards = shards_.size();
+    return shards_[id % num_shards].extract(id / num_shards, from, len, it);
+}
+
+}  // namespace dict
+
+#endif  // DICT_SHARDED_TEXT_INDEX_HPP_
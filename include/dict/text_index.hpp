@@ -10,44 +10,72 @@
 #define DICT_TEXT_INDEX_HPP_
 
 #include <cassert>
+#include <cstdint>
 
+#include <algorithm>
+#include <istream>
 #include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include "internal/chained_updater.hpp"
+#include "internal/serialization.hpp"
+#include "internal/suffix_sorter.hpp"
 #include "internal/text_index_trait.hpp"
+#include "internal/thread_pool.hpp"
 #include "internal/type_list.hpp"
 
 namespace dict {
 
 /************************************************
- * Declaration: class text_index<UPs...>
+ * Declaration: class basic_text_index<T, UPs...>
  ************************************************/
 
-template <template <typename, typename> class... UpdatingPolicies>
-class text_index : public internal::chained_updater<
+// Trait provides the term type, the allocator and the structures built on it (see
+// internal::text_index_trait<Term, WaveletMatrix>).
+template <typename Trait, template <typename, typename> class... UpdatingPolicies>
+class basic_text_index : public internal::chained_updater<
     internal::type_list<
-        text_index<UpdatingPolicies...>,
-        internal::text_index_trait
+        basic_text_index<Trait, UpdatingPolicies...>,
+        Trait
     >,
     UpdatingPolicies...
 > {
  public:  // Public Type(s)
-    using size_type = internal::text_index_trait::size_type;
-    using term_type = internal::text_index_trait::term_type;
-    using seq_type = internal::text_index_trait::seq_type;
+    using size_type = typename Trait::size_type;
+    using term_type = typename Trait::term_type;
+    using seq_type = typename Trait::seq_type;
+    using allocator_type = typename Trait::allocator_type;
 
  public:  // Public Method(s)
-    text_index();
+    explicit basic_text_index(allocator_type const &alloc = allocator_type());
+
+    allocator_type get_allocator() const;
+    void swap(basic_text_index &other);  // NOLINT(runtime/references)
 
     template <typename Sequence>
     void insert(Sequence const &s);
+    template <typename ForwardIterator>
+    void build(ForwardIterator first, ForwardIterator last);
+    template <typename ForwardIterator>
+    void build(ForwardIterator first, ForwardIterator last,
+               internal::thread_pool &pool);  // NOLINT(runtime/references)
+    template <typename Sequences>
+    void insert_batch(Sequences const &seqs);
+    template <typename Sequences>  // NOLINTNEXTLINE(runtime/references)
+    void insert_batch(Sequences const &seqs, internal::thread_pool &pool);
     size_type erase(size_type i);
 
     template <typename OutputIterator>
     std::pair<size_type, OutputIterator>
     reverse_recover(size_type i, OutputIterator it) const;
 
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+
     bool empty() const;
     size_type num_seqs() const;
     size_type num_terms() const;
@@ -57,20 +85,39 @@ class text_index : public internal::chained_updater<
     size_type psi(size_type i) const;
     size_type lf(size_type i) const;
 
+    template <typename Sequence>
+    std::pair<size_type, size_type> equal_range(Sequence const &s) const;
+    template <typename Sequence>
+    size_type count(Sequence const &s) const;
+
  private:  // Private Type(s)
-    friend internal::text_index_trait::helper;
+    friend typename Trait::helper;
 
-    using wm_type = internal::text_index_trait::wm_type;
-    using event = internal::text_index_trait::event;
+    using wm_type = typename Trait::wm_type;
+    using event = typename Trait::event;
     using updating_policies = internal::chained_updater<
             internal::type_list<
-                text_index<UpdatingPolicies...>,
-                internal::text_index_trait
+                basic_text_index<Trait, UpdatingPolicies...>,
+                Trait
             >,
             UpdatingPolicies...
         >;
 
+ private:  // Private Static Property(ies)
+    static constexpr std::uint64_t MAGIC = 0x58444E4954434944;  // "DICTINDX"
+    static constexpr std::uint64_t VERSION = 1;
+
+ private:  // Private Static Method(s)
+    template <typename ForwardIterator>
+    static std::pair<size_type, size_type> count_terms(ForwardIterator first,
+                                                       ForwardIterator last);
+    template <typename ForwardIterator>
+    static void place_sequences(ForwardIterator first, ForwardIterator last,
+                                seq_type &text, size_type pos);  // NOLINT(runtime/references)
+
  private:  // Private Method(s)
+    // NOLINTNEXTLINE(runtime/references)
+    void build_text(seq_type const &text, size_type num_seqs, internal::thread_pool &pool);
     size_type reorder(size_type actual, size_type expected);
 
  private:  // Private Property(ies)
@@ -78,21 +125,44 @@ class text_index : public internal::chained_updater<
     size_type sentinel_pos_;
     size_type sentinel_rank_;
     size_type num_seqs_;
-};  // class text_index<UPs...>
+};  // class basic_text_index<T, UPs...>
+
+/************************************************
+ * Declaration: alias basic_text_index<T, UPs...>
+ ************************************************/
+
+template <template <typename, typename> class... UpdatingPolicies>
+using text_index = basic_text_index<internal::text_index_trait<>, UpdatingPolicies...>;
 
 /************************************************
- * Implementation: class text_index<UPs...>
+ * Implementation: class basic_text_index<T, UPs...>
  ************************************************/
 
-template <template <typename, typename> class... UPs>
-inline text_index<UPs...>::text_index()
-    : updating_policies(), sentinel_pos_(0), sentinel_rank_(0), num_seqs_(0) {
+template <typename T, template <typename, typename> class... UPs>
+inline basic_text_index<T, UPs...>::basic_text_index(allocator_type const &alloc)
+    : updating_policies(alloc), wm_(alloc), sentinel_pos_(0), sentinel_rank_(0), num_seqs_(0) {
     // do nothing
 }
 
-template <template <typename, typename> class... UPs>
+template <typename T, template <typename, typename> class... UPs>
+inline typename basic_text_index<T, UPs...>::allocator_type
+basic_text_index<T, UPs...>::get_allocator() const {
+    return wm_.get_allocator();
+}
+
+template <typename T, template <typename, typename> class... UPs>
+// NOLINTNEXTLINE(runtime/references)
+void basic_text_index<T, UPs...>::swap(basic_text_index &other) {
+    updating_policies::swap(other);
+    wm_.swap(other.wm_);
+    std::swap(sentinel_pos_, other.sentinel_pos_);
+    std::swap(sentinel_rank_, other.sentinel_rank_);
+    std::swap(num_seqs_, other.num_seqs_);
+}
+
+template <typename T, template <typename, typename> class... UPs>
 template <typename Sequence>
-void text_index<UPs...>::insert(Sequence const &s) {
+void basic_text_index<T, UPs...>::insert(Sequence const &s) {
     auto seq_it = std::rbegin(s);
     auto seq_end = std::rend(s);
     if (seq_it == seq_end) { return; }
@@ -104,7 +174,8 @@ void text_index<UPs...>::insert(Sequence const &s) {
         assert(*seq_it != 0);
         wm_.insert(0, *seq_it);
 
-        updating_policies::update(event::after_inserting_first_term<Sequence>{s});
+        updating_policies::update(
+            typename event::template after_inserting_first_term<Sequence>{s});
 
         kp = 1;
         psi_kp = 0;
@@ -121,7 +192,7 @@ void text_index<UPs...>::insert(Sequence const &s) {
         wm_.insert(kp, *seq_it);
 
         auto lf_kp = wm_.lf(kp) + 1;
-        updating_policies::update(event::after_inserting_term<Sequence>{
+        updating_policies::update(typename event::template after_inserting_term<Sequence>{
             s, num_inserted++,
             kp, psi_kp, lf_kp
         });
@@ -135,7 +206,7 @@ void text_index<UPs...>::insert(Sequence const &s) {
 
     wm_.insert(kp, 0);
 
-    updating_policies::update(event::after_inserting_term<Sequence>{
+    updating_policies::update(typename event::template after_inserting_term<Sequence>{
         s, num_inserted++,
         kp, psi_kp, 0
     });
@@ -144,13 +215,139 @@ void text_index<UPs...>::insert(Sequence const &s) {
     sentinel_rank_ = wm_.rank(kp, 0);
     ++num_seqs_;
 
-    updating_policies::update(event::after_inserting_sequence<Sequence>{s});
+    updating_policies::update(typename event::template after_inserting_sequence<Sequence>{s});
+}
+
+template <typename T, template <typename, typename> class... UPs>
+template <typename ForwardIterator>
+inline void basic_text_index<T, UPs...>::build(ForwardIterator first, ForwardIterator last) {
+    internal::thread_pool pool(0);
+    build(first, last, pool);
+}
+
+template <typename T, template <typename, typename> class... UPs>
+template <typename ForwardIterator>
+void basic_text_index<T, UPs...>::build(ForwardIterator first, ForwardIterator last,
+                                        internal::thread_pool &pool) {  // NOLINT
+    // the pool builds the levels of the wavelet matrix in parallel
+    assert(empty());
+
+    size_type n, num_seqs;
+    std::tie(n, num_seqs) = count_terms(first, last);
+    if (n == 0) { return; }
+
+    seq_type text(n);
+    place_sequences(first, last, text, n);
+    build_text(text, num_seqs, pool);
+}
+
+template <typename T, template <typename, typename> class... UPs>
+template <typename Sequences>
+inline void basic_text_index<T, UPs...>::insert_batch(Sequences const &seqs) {
+    internal::thread_pool pool(0);
+    insert_batch(seqs, pool);
 }
 
-template <template <typename, typename> class... UPs>
+template <typename T, template <typename, typename> class... UPs>
+template <typename Sequences>
+void basic_text_index<T, UPs...>::insert_batch(Sequences const &seqs,
+                                               internal::thread_pool &pool) {  // NOLINT
+    // the pool builds or merges the levels of the wavelet matrix in parallel
+    auto first = std::begin(seqs);
+    auto last = std::end(seqs);
+    if (empty()) {
+        build(first, last, pool);
+        return;
+    }
+
+    size_type num_new_terms, num_new_seqs;
+    std::tie(num_new_terms, num_new_seqs) = count_terms(first, last);
+    if (num_new_terms == 0) { return; }
+
+    auto n = num_terms();
+    if (num_new_terms >= n) {
+        // decoding and rebuilding the whole index in linear time is cheaper
+        // than inserting this many terms one by one
+        seq_type text(num_new_terms + n);
+        text.back() = 0;
+        for (size_type i = 0, j = text.size() - 1; j > num_new_terms; --j) {
+            auto pair = wm_.access_and_lf(i);
+            text[j - 1] = pair.first;
+            i = (pair.first == 0 && i < sentinel_pos_) + pair.second;
+        }
+
+        place_sequences(first, last, text, num_new_terms);
+        build_text(text, num_seqs_ + num_new_seqs, pool);
+        return;
+    }
+
+    seq_type text(num_new_terms);
+    place_sequences(first, last, text, num_new_terms);
+    auto m = num_new_terms;
+
+    // rank the new suffixes among the old ones by backward search; the
+    // suffix at m is the old text itself
+    std::vector<size_type> ranks(m + 1);
+    ranks[m] = sentinel_pos_;
+    for (auto j = m; j > 0; --j) {
+        auto c = text[j - 1];
+        auto g = ranks[j];
+        ranks[j - 1] = wm_.sum(c) + (g > 0 ? wm_.rank(g - 1, c) : 0);
+        if (c == 0) {
+            // the sentinel has no preceding suffix, and the last terminator
+            // is less than all others
+            ranks[j - 1] += (g <= sentinel_pos_);
+        }
+    }
+
+    // new suffixes with the same rank are ordered by their terms and then
+    // by the ranks of the following suffixes, so they are sorted as the
+    // string of (rank, term) pairs; the old text comes right after the
+    // new suffixes of rank sentinel_pos_ among them
+    std::vector<std::pair<size_type, size_type>> keys(m + 1);
+    for (size_type j = 0; j < m; ++j) {
+        keys[j] = std::make_pair(2 * ranks[j], static_cast<size_type>(text[j]));
+    }
+
+    keys[m] = std::make_pair(2 * sentinel_pos_ + 1, 0);
+
+    std::vector<std::pair<size_type, size_type>> sorted_keys(keys);
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+    sorted_keys.erase(std::unique(sorted_keys.begin(), sorted_keys.end()), sorted_keys.end());
+
+    std::vector<size_type> s(m + 2, 0);
+    for (size_type j = 0; j <= m; ++j) {
+        auto key_it = std::lower_bound(sorted_keys.begin(), sorted_keys.end(), keys[j]);
+        s[j] = key_it - sorted_keys.begin() + 1;
+    }
+
+    auto key_sa = internal::suffix_sorter::sort(s, sorted_keys.size() + 1);
+
+    // the row of a new suffix adds the new suffixes before it to its rank
+    std::vector<size_type> rows(m), sa;
+    std::vector<std::pair<size_type, term_type>> bwt;
+    sa.reserve(m);
+    bwt.reserve(m);
+    for (auto j : key_sa) {
+        if (j >= m) { continue; }
+
+        rows[j] = ranks[j] + sa.size();
+        sa.push_back(j);
+        bwt.emplace_back(rows[j], j > 0 ? text[j - 1] : 0);
+    }
+
+    wm_.insert_batch(bwt, pool);
+    sentinel_pos_ = rows[0];
+    sentinel_rank_ = wm_.rank(sentinel_pos_, 0);
+    num_seqs_ += num_new_seqs;
+
+    updating_policies::update(typename event::after_inserting_batch{text, rows, sa});
+}
+
+template <typename T, template <typename, typename> class... UPs>
 template <typename OutputIterator>
-std::pair<typename text_index<UPs...>::size_type, OutputIterator>
-text_index<UPs...>::reverse_recover(size_type i, OutputIterator it) const {
+std::pair<typename basic_text_index<T, UPs...>::size_type, OutputIterator>
+basic_text_index<T, UPs...>::reverse_recover(size_type i, OutputIterator it) const {
     assert(f(i) == 0);
 
     i = lf(i);
@@ -164,19 +361,62 @@ text_index<UPs...>::reverse_recover(size_type i, OutputIterator it) const {
     return {i, it};
 }
 
-template <template <typename, typename> class... UPs>
-inline typename text_index<UPs...>::size_type text_index<UPs...>::erase(size_type k) {
+template <typename T, template <typename, typename> class... UPs>
+void basic_text_index<T, UPs...>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    internal::write_value<std::uint64_t>(os, MAGIC);
+    internal::write_value<std::uint64_t>(os, VERSION);
+    internal::write_value<std::uint64_t>(os, sizeof(term_type));
+    internal::write_value<std::uint64_t>(os, updating_policies::tag());
+
+    wm_.save(os);
+    internal::write_value<std::uint64_t>(os, sentinel_pos_);
+    internal::write_value<std::uint64_t>(os, sentinel_rank_);
+    internal::write_value<std::uint64_t>(os, num_seqs_);
+    updating_policies::save(os);
+}
+
+template <typename T, template <typename, typename> class... UPs>
+void basic_text_index<T, UPs...>::load(std::istream &is) {  // NOLINT(runtime/references)
+    if (internal::read_value<std::uint64_t>(is) != MAGIC) {
+        throw std::runtime_error("not a saved text_index");
+    }
+
+    if (internal::read_value<std::uint64_t>(is) != VERSION) {
+        throw std::runtime_error("unsupported version of saved text_index");
+    }
+
+    if (internal::read_value<std::uint64_t>(is) != sizeof(term_type)) {
+        throw std::runtime_error("mismatched term width of saved text_index");
+    }
+
+    if (internal::read_value<std::uint64_t>(is) != updating_policies::tag()) {
+        throw std::runtime_error("mismatched policies of saved text_index");
+    }
+
+    // load into a new index, so that this one is left as it was on errors
+    basic_text_index ti(get_allocator());
+    ti.wm_.load(is);
+    ti.sentinel_pos_ = internal::read_value<std::uint64_t>(is);
+    ti.sentinel_rank_ = internal::read_value<std::uint64_t>(is);
+    ti.num_seqs_ = internal::read_value<std::uint64_t>(is);
+    ti.updating_policies::load(is);
+    swap(ti);
+}
+
+template <typename T, template <typename, typename> class... UPs>
+inline typename basic_text_index<T, UPs...>::size_type
+basic_text_index<T, UPs...>::erase(size_type k) {
     auto i = psi(k);
     assert(wm_[i] == 0);
 
-    updating_policies::update(event::before_erasuring_sequence{k});
+    updating_policies::update(typename event::before_erasuring_sequence{k});
     seq_type s;
 
     decltype(wm_.access_and_lf(0)) c_lf_pair(0, wm_.lf(k));
     do {
         auto c = wm_.erase(k);
         s.push_back(c);
-        updating_policies::update(event::after_erasuring_term{s, k});
+        updating_policies::update(typename event::after_erasuring_term{s, k});
 
         assert(i != k);
         if (i > k) { --i; }
@@ -192,7 +432,7 @@ inline typename text_index<UPs...>::size_type text_index<UPs...>::erase(size_typ
     auto c = wm_.erase(k);
     assert(c == 0);
     s.push_back(c);
-    updating_policies::update(event::after_erasuring_term{s, k});
+    updating_policies::update(typename event::after_erasuring_term{s, k});
 
     if (wm_.size()) {
         assert(num_seqs_ > 1);
@@ -229,37 +469,42 @@ inline typename text_index<UPs...>::size_type text_index<UPs...>::erase(size_typ
 
     --num_seqs_;
 
-    updating_policies::update(event::after_erasuring_sequence{s});
+    updating_policies::update(typename event::after_erasuring_sequence{s});
     return i;
 }
 
-template <template <typename, typename> class... UPs>
-inline bool text_index<UPs...>::empty() const {
+template <typename T, template <typename, typename> class... UPs>
+inline bool basic_text_index<T, UPs...>::empty() const {
     return num_seqs_ == 0;
 }
 
-template <template <typename, typename> class... UPs>
-inline typename text_index<UPs...>::size_type text_index<UPs...>::num_seqs() const {
+template <typename T, template <typename, typename> class... UPs>
+inline typename basic_text_index<T, UPs...>::size_type
+basic_text_index<T, UPs...>::num_seqs() const {
     return num_seqs_;
 }
 
-template <template <typename, typename> class... UPs>
-inline typename text_index<UPs...>::size_type text_index<UPs...>::num_terms() const {
+template <typename T, template <typename, typename> class... UPs>
+inline typename basic_text_index<T, UPs...>::size_type
+basic_text_index<T, UPs...>::num_terms() const {
     return wm_.size();
 }
 
-template <template <typename, typename> class... UPs>
-inline typename text_index<UPs...>::term_type text_index<UPs...>::f(size_type i) const {
+template <typename T, template <typename, typename> class... UPs>
+inline typename basic_text_index<T, UPs...>::term_type
+basic_text_index<T, UPs...>::f(size_type i) const {
     return wm_.search(i + 1);
 }
 
-template <template <typename, typename> class... UPs>
-inline typename text_index<UPs...>::term_type text_index<UPs...>::bwt(size_type i) const {
+template <typename T, template <typename, typename> class... UPs>
+inline typename basic_text_index<T, UPs...>::term_type
+basic_text_index<T, UPs...>::bwt(size_type i) const {
     return wm_[i];
 }
 
-template <template <typename, typename> class... UPs>
-inline typename text_index<UPs...>::size_type text_index<UPs...>::psi(size_type i) const {
+template <typename T, template <typename, typename> class... UPs>
+inline typename basic_text_index<T, UPs...>::size_type
+basic_text_index<T, UPs...>::psi(size_type i) const {
     if (i == 0) { return sentinel_pos_; }
 
     return i < sentinel_rank_
@@ -267,17 +512,147 @@ inline typename text_index<UPs...>::size_type text_index<UPs...>::psi(size_type
         : wm_.psi(i);
 }
 
-template <template <typename, typename> class... UPs>
-inline typename text_index<UPs...>::size_type text_index<UPs...>::lf(size_type i) const {
+template <typename T, template <typename, typename> class... UPs>
+inline typename basic_text_index<T, UPs...>::size_type
+basic_text_index<T, UPs...>::lf(size_type i) const {
     if (i == sentinel_pos_) { return 0; }
 
     auto pair = wm_.access_and_lf(i);
     return (pair.first == 0 && i < sentinel_pos_) + pair.second;
 }
 
-template <template <typename, typename> class... UPs>
-typename text_index<UPs...>::size_type
-text_index<UPs...>::reorder(size_type actual, size_type expected) {
+template <typename T, template <typename, typename> class... UPs>
+template <typename Sequence>
+std::pair<
+    typename basic_text_index<T, UPs...>::size_type,
+    typename basic_text_index<T, UPs...>::size_type
+>
+basic_text_index<T, UPs...>::equal_range(Sequence const &s) const {
+    auto seq_it = std::rbegin(s);
+    auto seq_end = std::rend(s);
+
+    size_type first = 0, last = num_terms();
+    if (seq_it == seq_end || first == last) { return {first, last}; }
+
+    // the first step covers all rows, so every occurrence of the term
+    // (including the sentinel) is mapped to its bucket in F
+    std::tie(first, last) = wm_.lf_range(first, last, *seq_it);
+    ++seq_it;
+
+    while (seq_it != seq_end && first < last) {
+        auto c = *seq_it;
+        auto lf_pair = wm_.lf_range(first, last, c);
+        if (c == 0) {
+            // the sentinel has no preceding suffix, and rows of the other
+            // terminators are shifted depending on their side of it
+            lf_pair.first += (first <= sentinel_pos_);
+            lf_pair.second += (last <= sentinel_pos_);
+        }
+
+        std::tie(first, last) = lf_pair;
+        ++seq_it;
+    }
+
+    return {first, last < first ? first : last};
+}
+
+template <typename T, template <typename, typename> class... UPs>
+template <typename Sequence>
+inline typename basic_text_index<T, UPs...>::size_type
+basic_text_index<T, UPs...>::count(Sequence const &s) const {
+    auto range = equal_range(s);
+    return range.second - range.first;
+}
+
+template <typename T, template <typename, typename> class... UPs>
+template <typename ForwardIterator>
+std::pair<
+    typename basic_text_index<T, UPs...>::size_type,
+    typename basic_text_index<T, UPs...>::size_type
+>
+basic_text_index<T, UPs...>::count_terms(ForwardIterator first, ForwardIterator last) {
+    size_type num_terms = 0, num_seqs = 0;
+    for (; first != last; ++first) {
+        size_type len = std::distance(std::begin(*first), std::end(*first));
+        if (len > 0) {
+            num_terms += len + 1;
+            ++num_seqs;
+        }
+    }
+
+    return {num_terms, num_seqs};
+}
+
+template <typename T, template <typename, typename> class... UPs>
+template <typename ForwardIterator>
+void basic_text_index<T, UPs...>::place_sequences(ForwardIterator first, ForwardIterator last,
+                                                  seq_type &text, size_type pos) {
+    // later sequences are placed in front of earlier ones, which results in
+    // the same text as inserting them one by one
+    for (; first != last; ++first) {
+        auto seq_it = std::begin(*first);
+        auto seq_end = std::end(*first);
+        if (seq_it == seq_end) { continue; }
+
+        pos -= std::distance(seq_it, seq_end) + 1;
+        auto i = pos;
+        for (; seq_it != seq_end; ++seq_it, ++i) {
+            assert(*seq_it != 0);
+            text[i] = *seq_it;
+        }
+
+        text[i] = 0;
+    }
+}
+
+template <typename T, template <typename, typename> class... UPs>
+void basic_text_index<T, UPs...>::build_text(seq_type const &text, size_type num_seqs,
+                                             internal::thread_pool &pool) {  // NOLINT
+    auto n = text.size();
+
+    // terminators sort before all terms and the last one before all others
+    std::vector<size_type> s(n);
+    size_type sigma = 2;
+    for (size_type i = 0; i + 1 < n; ++i) {
+        s[i] = static_cast<size_type>(text[i]) + 1;
+        if (s[i] >= sigma) { sigma = s[i] + 1; }
+    }
+
+    s[n - 1] = 0;
+    if (sigma > n) {
+        // sparse terms of a wide alphabet are ranked first, which keeps their
+        // order but bounds the buckets of the sorter by the text length
+        std::vector<size_type> terms(s);
+        std::sort(terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        for (auto &x : s) {
+            x = std::lower_bound(terms.begin(), terms.end(), x) - terms.begin();
+        }
+
+        sigma = terms.size();
+    }
+    auto sa = internal::suffix_sorter::sort(s, sigma);
+
+    seq_type bwt(n);
+    for (size_type i = 0; i < n; ++i) {
+        if (sa[i] > 0) {
+            bwt[i] = text[sa[i] - 1];
+        } else {
+            bwt[i] = 0;
+            sentinel_pos_ = i;
+        }
+    }
+
+    wm_.assign(bwt.begin(), bwt.end(), pool);
+    sentinel_rank_ = wm_.rank(sentinel_pos_, 0);
+    num_seqs_ = num_seqs;
+
+    updating_policies::update(typename event::after_building{text, sa});
+}
+
+template <typename T, template <typename, typename> class... UPs>
+typename basic_text_index<T, UPs...>::size_type
+basic_text_index<T, UPs...>::reorder(size_type actual, size_type expected) {
     auto i = expected;
     while (actual != expected) {
         auto k = lf(actual);
@@ -300,7 +675,7 @@ text_index<UPs...>::reorder(size_type actual, size_type expected) {
             i = expected;
         }
 
-        updating_policies::update(event::after_moving_term{actual, expected});
+        updating_policies::update(typename event::after_moving_term{actual, expected});
 
         actual = k;
         expected = lf(expected);
@@ -0,0 +1,321 @@
+/************************************************
+ *  text_index_view.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_TEXT_INDEX_VIEW_HPP_
+#define DICT_TEXT_INDEX_VIEW_HPP_
+
+#include <cassert>
+#include <cstdint>
+
+#include <algorithm>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "internal/flat_bit_vector.hpp"
+#include "internal/flat_wavelet_matrix.hpp"
+#include "internal/mapped_file.hpp"
+#include "internal/serialization.hpp"
+#include "internal/text_index_trait.hpp"
+
+namespace dict {
+
+/************************************************
+ * Declaration: class text_index_view
+ ************************************************/
+
+// A frozen, read-only snapshot of a text_index. The snapshot is written once
+// by write() and then answered directly from the mapped words, so opening
+// a view never builds any tree nodes.
+class text_index_view {
+ public:  // Public Type(s)
+    using size_type = internal::text_index_trait<>::size_type;
+    using value_type = internal::text_index_trait<>::size_type;
+    using term_type = internal::text_index_trait<>::term_type;
+
+ public:  // Public Static Method(s)
+    template <typename TextIndex>
+    static void write(TextIndex const &ti, std::ostream &os,  // NOLINT(runtime/references)
+                      size_type sample_distance = DEFAULT_SAMPLE_DISTANCE);
+
+ public:  // Public Method(s)
+    text_index_view(void const *data, size_type size);
+    explicit text_index_view(std::string const &path);
+
+    bool empty() const;
+    bool has_lcp() const;
+    size_type num_seqs() const;
+    size_type num_terms() const;
+
+    term_type f(size_type i) const;
+    term_type bwt(size_type i) const;
+    size_type psi(size_type i) const;
+    size_type lf(size_type i) const;
+    value_type at(size_type i) const;
+    size_type rank(value_type j) const;
+    size_type lcp(size_type i) const;
+
+ private:  // Private Type(s)
+    using word_type = std::uint64_t;
+    using wm_type = internal::flat_wavelet_matrix<term_type>;
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type DEFAULT_SAMPLE_DISTANCE = 32;
+    static constexpr word_type MAGIC = 0x5745495654434944;  // "DICTVIEW"
+    static constexpr word_type VERSION = 1;
+    static constexpr size_type HEADER_SIZE = 7;
+
+ private:  // Private Static Method(s)
+    template <typename TextIndex>  // NOLINTNEXTLINE(runtime/references)
+    static auto write_lcp(TextIndex const &ti, std::ostream &os, int)
+        -> decltype(ti.lcp(0), void());
+    template <typename TextIndex>
+    static void write_lcp(TextIndex const &ti, std::ostream &os, long);  // NOLINT
+    // NOLINTNEXTLINE(runtime/references)
+    static void write_array(std::ostream &os, std::vector<size_type> const &values);
+    static word_type const *map_array(word_type const *first, word_type const *last,
+                                      word_type const **values, size_type *size);
+
+ private:  // Private Method(s)
+    void map(void const *data, size_type size);
+
+ private:  // Private Property(ies)
+    std::shared_ptr<internal::mapped_file> file_;
+    size_type num_terms_;
+    size_type num_seqs_;
+    size_type sentinel_pos_;
+    size_type sentinel_rank_;
+    size_type sample_distance_;
+    wm_type wm_;
+    internal::flat_bit_vector sa_samples_;
+    word_type const *sa_values_;
+    word_type const *isa_values_;
+    word_type const *lcpa_;
+    size_type num_sa_values_;
+    size_type num_isa_values_;
+    size_type num_lcps_;
+};  // class text_index_view
+
+/************************************************
+ * Implementation: class text_index_view
+ ************************************************/
+
+template <typename TextIndex>
+void text_index_view::write(TextIndex const &ti, std::ostream &os,  // NOLINT(runtime/references)
+                            size_type sample_distance) {
+    static_assert(sizeof(typename TextIndex::term_type) <= sizeof(term_type),
+                  "terms of the index are too wide for text_index_view");
+
+    if (sample_distance == 0) {
+        throw std::invalid_argument("sample distance must be positive");
+    }
+
+    auto n = ti.num_terms();
+    std::vector<term_type> bwt(n);
+    std::vector<size_type> sa(n);
+    size_type sentinel_pos = n > 0 ? ti.psi(0) : 0;
+    size_type sentinel_rank = 0;
+    for (size_type i = 0; i < n; ++i) {
+        bwt[i] = ti.bwt(i);
+        sentinel_rank += (bwt[i] == 0 && i <= sentinel_pos);
+    }
+
+    // row 0 is the last position; walking LF visits the text backward
+    for (size_type k = 0, i = 0; k < n; ++k) {
+        sa[i] = n - 1 - k;
+        i = ti.lf(i);
+    }
+
+    // sample every sample_distance-th position counted from the end, so
+    // that the last position is always sampled
+    std::vector<bool> sa_samples(n);
+    std::vector<size_type> sa_values, isa_values((n + sample_distance - 1) / sample_distance);
+    for (size_type i = 0; i < n; ++i) {
+        auto d = n - 1 - sa[i];
+        if (d % sample_distance == 0) {
+            sa_samples[i] = true;
+            sa_values.push_back(sa[i]);
+            isa_values[d / sample_distance] = i;
+        }
+    }
+
+    internal::write_value<word_type>(os, MAGIC);
+    internal::write_value<word_type>(os, VERSION);
+    internal::write_value<word_type>(os, n);
+    internal::write_value<word_type>(os, ti.num_seqs());
+    internal::write_value<word_type>(os, sentinel_pos);
+    internal::write_value<word_type>(os, sentinel_rank);
+    internal::write_value<word_type>(os, sample_distance);
+
+    wm_type::write(os, bwt.begin(), bwt.end());
+    internal::flat_bit_vector::write(os, sa_samples);
+    write_array(os, sa_values);
+    write_array(os, isa_values);
+    write_lcp(ti, os, 0);
+}
+
+inline text_index_view::text_index_view(void const *data, size_type size) {
+    map(data, size);
+}
+
+inline text_index_view::text_index_view(std::string const &path)
+    : file_(std::make_shared<internal::mapped_file>(path)) {
+    map(file_->data(), file_->size());
+}
+
+inline bool text_index_view::empty() const {
+    return num_terms_ == 0;
+}
+
+inline bool text_index_view::has_lcp() const {
+    return num_lcps_ == num_terms_;
+}
+
+inline text_index_view::size_type text_index_view::num_seqs() const {
+    return num_seqs_;
+}
+
+inline text_index_view::size_type text_index_view::num_terms() const {
+    return num_terms_;
+}
+
+inline text_index_view::term_type text_index_view::f(size_type i) const {
+    return wm_.search(i + 1);
+}
+
+inline text_index_view::term_type text_index_view::bwt(size_type i) const {
+    return wm_[i];
+}
+
+inline text_index_view::size_type text_index_view::psi(size_type i) const {
+    if (i == 0) { return sentinel_pos_; }
+
+    return i < sentinel_rank_
+        ? wm_.select(i - 1, 0)
+        : wm_.psi(i);
+}
+
+inline text_index_view::size_type text_index_view::lf(size_type i) const {
+    if (i == sentinel_pos_) { return 0; }
+
+    auto pair = wm_.access_and_lf(i);
+    return (pair.first == 0 && i < sentinel_pos_) + pair.second;
+}
+
+inline text_index_view::value_type text_index_view::at(size_type i) const {
+    size_type off = 0;
+    for (; !sa_samples_[i]; ++off) {
+        i = lf(i);
+    }
+
+    // walking past the first position wraps around to the last one
+    auto j = sa_values_[sa_samples_.rank(i, true) - 1] + off;
+    return j < num_terms_ ? j : j - num_terms_;
+}
+
+inline text_index_view::size_type text_index_view::rank(value_type j) const {
+    auto off = (num_terms_ - 1 - j) % sample_distance_;
+    auto i = isa_values_[(num_terms_ - 1 - j - off) / sample_distance_];
+    for (; off > 0; --off) {
+        i = lf(i);
+    }
+
+    return i;
+}
+
+inline text_index_view::size_type text_index_view::lcp(size_type i) const {
+    assert(has_lcp());
+    return lcpa_[i];
+}
+
+template <typename TextIndex>
+inline auto text_index_view::write_lcp(TextIndex const &ti, std::ostream &os, int)
+        -> decltype(ti.lcp(0), void()) {
+    std::vector<size_type> lcpa(ti.num_terms());
+    for (size_type i = 0; i < lcpa.size(); ++i) {
+        lcpa[i] = ti.lcp(i);
+    }
+
+    write_array(os, lcpa);
+}
+
+template <typename TextIndex>
+inline void text_index_view::write_lcp(TextIndex const &, std::ostream &os, long) {  // NOLINT
+    write_array(os, std::vector<size_type>());
+}
+
+// NOLINTNEXTLINE(runtime/references)
+inline void text_index_view::write_array(std::ostream &os, std::vector<size_type> const &values) {
+    internal::write_value<word_type>(os, values.size());
+    for (auto x : values) {
+        internal::write_value<word_type>(os, x);
+    }
+}
+
+inline text_index_view::word_type const *
+text_index_view::map_array(word_type const *first, word_type const *last,
+                           word_type const **values, size_type *size) {
+    if (first == last || static_cast<size_type>(last - first - 1) < *first) {
+        throw std::runtime_error("truncated text_index_view");
+    }
+
+    *size = *first;
+    *values = first + 1;
+    return first + 1 + *size;
+}
+
+inline void text_index_view::map(void const *data, size_type size) {
+    if (reinterpret_cast<std::uintptr_t>(data) % sizeof(word_type) != 0) {
+        throw std::invalid_argument("snapshot must be aligned to 64-bit words");
+    }
+
+    auto first = static_cast<word_type const *>(data);
+    auto last = first + size / sizeof(word_type);
+    if (static_cast<size_type>(last - first) < HEADER_SIZE ||
+            first[0] != MAGIC || first[1] != VERSION) {
+        throw std::runtime_error("invalid text_index_view snapshot");
+    }
+
+    num_terms_ = first[2];
+    num_seqs_ = first[3];
+    sentinel_pos_ = first[4];
+    sentinel_rank_ = first[5];
+    sample_distance_ = first[6];
+    first += HEADER_SIZE;
+
+    first = wm_.map(first, last);
+    first = sa_samples_.map(first, last);
+    first = map_array(first, last, &sa_values_, &num_sa_values_);
+    first = map_array(first, last, &isa_values_, &num_isa_values_);
+    map_array(first, last, &lcpa_, &num_lcps_);
+
+    if (wm_.size() != num_terms_ || sa_samples_.size() != num_terms_ ||
+            sa_samples_.count() != num_sa_values_ || sample_distance_ == 0 ||
+            num_isa_values_ != (num_terms_ + sample_distance_ - 1) / sample_distance_) {
+        throw std::runtime_error("invalid text_index_view snapshot");
+    }
+
+    // lf(), psi(), at() and rank() use the sentinel and the samples as rows
+    // and positions without checking them
+    auto in_range = [this](word_type const *values, size_type num_values) {
+        return std::all_of(values, values + num_values,
+                           [this](word_type x) { return x < num_terms_; });
+    };
+
+    if ((num_terms_ > 0 ? sentinel_pos_ >= num_terms_ : sentinel_pos_ > 0) ||
+            sentinel_rank_ > wm_.sum(1) ||
+            !in_range(sa_values_, num_sa_values_) || !in_range(isa_values_, num_isa_values_)) {
+        throw std::runtime_error("invalid text_index_view snapshot");
+    }
+}
+
+}  // namespace dict
+
+#endif  // DICT_TEXT_INDEX_VIEW_HPP_
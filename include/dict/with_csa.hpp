@@ -9,8 +9,18 @@
 #ifndef DICT_WITH_CSA_HPP_
 #define DICT_WITH_CSA_HPP_
 
-#include "internal/bit_vector.hpp"
-#include "internal/permutation.hpp"
+#include <cstdint>
+
+#include <atomic>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "internal/csa_base.hpp"
+#include "internal/serialization.hpp"
 
 namespace dict {
 
@@ -18,24 +28,40 @@ namespace dict {
  * Declaration: class with_csa<TI, T>
  ************************************************/
 
+// Samples the suffix array every sample_distance() + 1 text positions, so
+// at() and rank() take at most that many LF steps. resample() changes the
+// distance of an existing index; given a second, shorter distance, it also
+// counts the located positions until the next call, which then samples the
+// regions located more often than average at that shorter distance.
 template <typename TextIndex, typename Trait>
-class with_csa {
- public:  // Public Type(s)
-    using host_type = TextIndex;
-    using size_type = typename Trait::size_type;
-    using value_type = typename Trait::size_type;
-    using term_type = typename Trait::term_type;
-
+class with_csa : public internal::csa_base<with_csa<TextIndex, Trait>, Trait> {
  private:  // Private Types(s)
+    using base = internal::csa_base<with_csa<TextIndex, Trait>, Trait>;
     using helper = typename Trait::helper;
     using event = typename Trait::event;
 
+    friend base;
+
+ public:  // Public Type(s)
+    using host_type = TextIndex;
+    using size_type = typename base::size_type;
+    using value_type = typename base::value_type;
+    using term_type = typename base::term_type;
+    using allocator_type = typename base::allocator_type;
+
  public:  // Public Method(s)
-    value_type at(size_type i) const;
-    size_type rank(value_type j) const;
-    term_type term(value_type j) const;
+    explicit with_csa(allocator_type const &alloc = allocator_type());
+    with_csa(with_csa const &other);
+    with_csa(with_csa &&) = default;
+
+    with_csa &operator=(with_csa const &other);
+    with_csa &operator=(with_csa &&) = default;
 
-    value_type operator[](size_type i) const;
+    using base::at;
+    using base::rank;
+
+    void resample(size_type distance);
+    void resample(size_type distance, size_type hot_distance);
 
  protected:  // Protected Method(s)
     template <typename Sequence>
@@ -50,18 +76,43 @@ class with_csa {
     void update(typename event::after_moving_term const &info);
     void update(typename event::after_erasuring_sequence const &);
 
+    void update(typename event::after_inserting_batch const &info);
+    void update(typename event::after_building const &info);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+    void swap(with_csa &other);  // NOLINT(runtime/references)
+
+ protected:  // Protected Static Method(s)
+    static std::uint64_t tag();
+
  private:  // Private Method(s)
     void insert_term(size_type i, bool is_sampled);
     void add_samples(value_type j);
+    value_type sampled_value(size_type i, size_type off) const;
+    void assign_samples(std::vector<size_type> const &sa, std::vector<bool> const &sampled);
+    void count_locate(value_type j) const;
+
+ private:  // Private Type(s)
+    using locate_counts = std::vector<std::atomic<size_type>>;
+
+ private:  // Private Static Method(s)
+    static std::shared_ptr<locate_counts> copy_counts(locate_counts const *counts);
 
  private:  // Private Static Property(ies)
-    static constexpr size_type MAX_SAMPLE_DISTANCE = 100;
-    static constexpr size_type BIT_BLOCK_SIZE = 64;
+    static constexpr size_type NUM_REGIONS = 1024;
 
  private:  // Private Property(ies)
-    internal::bit_vector<BIT_BLOCK_SIZE> isa_samples_;
-    internal::bit_vector<BIT_BLOCK_SIZE> sa_samples_;
-    internal::permutation pi_;
+    using base::isa_samples_;
+    using base::sa_samples_;
+    using base::pi_;
+    using base::seq_ends_;
+    using base::sample_distance_;
+
+    // locates per region of region_size_ positions, counted from the end of
+    // the text as insertions happen at its front; a copy counts on its own
+    std::shared_ptr<locate_counts> locate_counts_;
+    size_type region_size_;
 
     size_type erased_isa_pos_;
 };  // class with_csa<TI, T>
@@ -71,52 +122,81 @@ class with_csa {
  ************************************************/
 
 template <typename TI, typename T>
-typename with_csa<TI, T>::value_type with_csa<TI, T>::at(size_type i) const {
-    size_type off = 0;
-    while (!sa_samples_[i]) {
-        i = helper::to_host(this)->lf(i);
-        ++off;
-    }
-
-    auto r = sa_samples_.rank(i, true);
-    auto j = pi_.at(r - 1);
-
-    auto sa = isa_samples_.select(j, true) + off;
-    auto n = helper::to_host(this)->num_terms();
-    return sa < n ? sa : sa - n;
+inline with_csa<TI, T>::with_csa(allocator_type const &alloc)
+    : base(alloc), region_size_(1), erased_isa_pos_(0) {
+    // do nothing
 }
 
 template <typename TI, typename T>
-typename with_csa<TI, T>::size_type with_csa<TI, T>::rank(value_type j) const {
-    auto br_pair = isa_samples_.access_and_rank(j, true);
-    auto b = br_pair.first;
-    auto r = br_pair.second;
-    if (b) {
-        // retrieve a value at a sampled position
-        auto i = pi_.rank(r - 1);
-        return sa_samples_.select(i, true);
-    } else {
-        // retrieve a value at a unsampled position
-        auto off = isa_samples_.select(r, true) - j;
-        auto i = pi_.rank(r);
-        auto v = sa_samples_.select(i, true);
-        for (decltype(off) t = 0; t < off; ++t) {
-            v = helper::to_host(this)->lf(v);
-        }
+inline with_csa<TI, T>::with_csa(with_csa const &other)
+    : base(other), locate_counts_(copy_counts(other.locate_counts_.get())),
+      region_size_(other.region_size_), erased_isa_pos_(other.erased_isa_pos_) {
+    // do nothing
+}
 
-        return v;
+template <typename TI, typename T>
+inline with_csa<TI, T> &with_csa<TI, T>::operator=(with_csa const &other) {
+    if (this != &other) {
+        base::operator=(other);
+        locate_counts_ = copy_counts(other.locate_counts_.get());
+        region_size_ = other.region_size_;
+        erased_isa_pos_ = other.erased_isa_pos_;
     }
+
+    return *this;
 }
 
 template <typename TI, typename T>
-inline typename with_csa<TI, T>::term_type with_csa<TI, T>::term(value_type j) const {
-    auto const &wm = helper::get_wm(this);
-    return wm.search(rank(j) + 1);
+inline void with_csa<TI, T>::resample(size_type distance) {
+    resample(distance, distance);
+    locate_counts_.reset();
 }
 
 template <typename TI, typename T>
-inline typename with_csa<TI, T>::value_type with_csa<TI, T>::operator[](size_type i) const {
-    return at(i);
+void with_csa<TI, T>::resample(size_type distance, size_type hot_distance) {
+    if (distance == 0 || hot_distance == 0) {
+        throw std::invalid_argument("sample distance must be positive");
+    }
+
+    auto const *host = helper::to_host(this);
+    auto n = host->num_terms();
+    if (n > 0) {
+        // regions located more often than average are hot
+        std::vector<bool> is_hot;
+        if (locate_counts_) {
+            size_type total = 0;
+            for (auto const &count : *locate_counts_) {
+                total += count.load(std::memory_order_relaxed);
+            }
+
+            for (auto const &count : *locate_counts_) {
+                is_hot.push_back(count.load(std::memory_order_relaxed) * NUM_REGIONS > total);
+            }
+        }
+
+        // row 0 is the last position; walking LF visits the text backward
+        std::vector<size_type> sa(n);
+        for (size_type k = 0, i = 0; k < n; ++k) {
+            sa[i] = n - 1 - k;
+            i = host->lf(i);
+        }
+
+        // sampled[d] tells whether the d-th position from the end is sampled
+        std::vector<bool> sampled(n);
+        for (size_type d = 0; d < n; ) {
+            sampled[d] = true;
+
+            auto region = d / region_size_;
+            auto hot = region < is_hot.size() && is_hot[region];
+            d += (hot ? hot_distance : distance) + 1;
+        }
+
+        assign_samples(sa, sampled);
+    }
+
+    sample_distance_ = distance;
+    region_size_ = n / NUM_REGIONS + 1;
+    locate_counts_.reset(new locate_counts(NUM_REGIONS));
 }
 
 template <typename TI, typename T>
@@ -124,6 +204,7 @@ template <typename Sequence>
 inline void with_csa<TI, T>::update(
         typename event::template after_inserting_first_term<Sequence> const &) {
     insert_term(0, true);
+    seq_ends_.insert(0, true);
     pi_.insert(0, 0);
 }
 
@@ -132,6 +213,7 @@ template <typename Sequence>
 inline void with_csa<TI, T>::update(
         typename event::template after_inserting_term<Sequence> const &info) {
     insert_term(info.pos, false);
+    seq_ends_.insert(0, info.num_inserted == 0);
 }
 
 template <typename TI, typename T>
@@ -150,6 +232,7 @@ template <typename TI, typename T>
 inline void with_csa<TI, T>::update(typename event::after_erasuring_term const &info) {
     auto pos = info.pos;
     sa_samples_.erase(pos);
+    seq_ends_.erase(erased_isa_pos_);
     auto b = isa_samples_.erase(erased_isa_pos_);
     if (b) {
         auto r = pos > 0 ? sa_samples_.rank(pos - 1, true) : 0;
@@ -184,12 +267,165 @@ inline void with_csa<TI, T>::update(typename event::after_erasuring_sequence con
     }
 }
 
+template <typename TI, typename T>
+void with_csa<TI, T>::update(typename event::after_inserting_batch const &info) {
+    auto const &text = info.text;
+    auto const &rows = info.rows;
+    auto m = text.size();
+
+    // the new positions are inserted unsampled in front of the text
+    for (auto j : info.sa) {
+        sa_samples_.insert(rows[j], false);
+    }
+
+    for (size_type j = 0; j < m; ++j) {
+        isa_samples_.insert(j, false);
+        seq_ends_.insert(j, text[j] == 0);
+    }
+
+    // then sampled backward from the first old sample as add_samples(0)
+    // does, except that the rows of the new positions are known
+    auto p = isa_samples_.select(0, true);
+    while (p > sample_distance_) {
+        p -= sample_distance_ + 1;
+
+        auto i = p < m ? rows[p] : rank(p);
+        auto k = i > 0 ? sa_samples_.rank(i - 1, true) : 0;
+        sa_samples_.set(i);
+        isa_samples_.set(p);
+        pi_.insert(k, 0);
+    }
+}
+
+template <typename TI, typename T>
+void with_csa<TI, T>::update(typename event::after_building const &info) {
+    auto const &text = info.text;
+    auto const &sa = info.sa;
+    auto n = sa.size();
+
+    // sample every (sample_distance_ + 1)-th position backward from the
+    // last one, as add_samples() does
+    std::vector<bool> sampled(n), end_bits(n);
+    for (size_type d = 0; d < n; d += sample_distance_ + 1) {
+        sampled[d] = true;
+    }
+
+    for (size_type i = 0; i < n; ++i) {
+        end_bits[i] = text[i] == 0;
+    }
+
+    assign_samples(sa, sampled);
+    seq_ends_.assign(end_bits.begin(), end_bits.end());
+}
+
+template <typename TI, typename T>
+void with_csa<TI, T>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    internal::write_value<std::uint64_t>(os, sample_distance_);
+    isa_samples_.save(os);
+    sa_samples_.save(os);
+    pi_.save(os);
+    seq_ends_.save(os);
+}
+
+template <typename TI, typename T>
+void with_csa<TI, T>::load(std::istream &is) {  // NOLINT(runtime/references)
+    sample_distance_ = internal::read_value<std::uint64_t>(is);
+    if (sample_distance_ == 0) {
+        throw std::runtime_error("invalid sample distance");
+    }
+
+    isa_samples_.load(is);
+    sa_samples_.load(is);
+    pi_.load(is);
+    seq_ends_.load(is);
+    locate_counts_.reset();
+}
+
+template <typename TI, typename T>
+void with_csa<TI, T>::swap(with_csa &other) {  // NOLINT(runtime/references)
+    base::swap(other);
+    locate_counts_.swap(other.locate_counts_);
+    std::swap(region_size_, other.region_size_);
+    std::swap(erased_isa_pos_, other.erased_isa_pos_);
+}
+
+template <typename TI, typename T>
+inline std::uint64_t with_csa<TI, T>::tag() {
+    return 0x415343;  // "CSA"
+}
+
+template <typename TI, typename T>
+std::shared_ptr<typename with_csa<TI, T>::locate_counts>
+with_csa<TI, T>::copy_counts(locate_counts const *counts) {
+    if (!counts) { return nullptr; }
+
+    std::shared_ptr<locate_counts> copy(new locate_counts(counts->size()));
+    for (size_type k = 0; k < counts->size(); ++k) {
+        (*copy)[k].store((*counts)[k].load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+    }
+
+    return copy;
+}
+
 template <typename TI, typename T>
 inline void with_csa<TI, T>::insert_term(size_type i, bool is_sampled) {
     sa_samples_.insert(i, is_sampled);
     isa_samples_.insert(0, is_sampled);
 }
 
+template <typename TI, typename T>
+inline typename with_csa<TI, T>::value_type
+with_csa<TI, T>::sampled_value(size_type i, size_type off) const {
+    auto r = sa_samples_.rank(i, true);
+    auto j = pi_.at(r - 1);
+
+    auto sa = isa_samples_.select(j, true) + off;
+    auto n = helper::to_host(this)->num_terms();
+    return sa < n ? sa : sa - n;
+}
+
+template <typename TI, typename T>
+void with_csa<TI, T>::assign_samples(std::vector<size_type> const &sa,
+                                     std::vector<bool> const &sampled) {
+    // samples are numbered in text order, i.e. from the one farthest from
+    // the end of the text
+    auto n = sa.size();
+    std::vector<size_type> isa_ranks(n);
+    size_type num_samples = 0;
+    for (auto d = n; d > 0; --d) {
+        if (sampled[d - 1]) { isa_ranks[d - 1] = num_samples++; }
+    }
+
+    std::vector<bool> isa_bits(n), sa_bits(n);
+    std::vector<size_type> pi;
+    pi.reserve(num_samples);
+    for (size_type i = 0; i < n; ++i) {
+        isa_bits[i] = sampled[n - 1 - i];
+
+        auto d = n - 1 - sa[i];
+        if (sampled[d]) {
+            sa_bits[i] = true;
+            pi.push_back(isa_ranks[d]);
+        }
+    }
+
+    isa_samples_.assign(isa_bits.begin(), isa_bits.end());
+    sa_samples_.assign(sa_bits.begin(), sa_bits.end());
+    pi_.assign(pi.begin(), pi.end());
+}
+
+template <typename TI, typename T>
+inline void with_csa<TI, T>::count_locate(value_type j) const {
+    if (!locate_counts_) { return; }
+
+    auto n = helper::to_host(this)->num_terms();
+    auto region = (n - 1 - j) / region_size_;
+    if (region < NUM_REGIONS) {
+        (*locate_counts_)[region].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
 template <typename TI, typename T>
 void with_csa<TI, T>::add_samples(value_type j) {
     auto n = helper::to_host(this)->num_terms();
@@ -209,8 +445,8 @@ void with_csa<TI, T>::add_samples(value_type j) {
     auto right_sample_pos = isa_samples_.select(r, true);
 
     auto p = right_sample_pos;
-    while (p > left_sample_pos + MAX_SAMPLE_DISTANCE) {
-        p -= MAX_SAMPLE_DISTANCE + 1;
+    while (p > left_sample_pos + sample_distance_) {
+        p -= sample_distance_ + 1;
 
         auto i = rank(p);
         auto k = i > 0 ? sa_samples_.rank(i - 1, true) : 0;
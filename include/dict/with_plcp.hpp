@@ -0,0 +1,418 @@
+/************************************************
+ *  with_plcp.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_WITH_PLCP_HPP_
+#define DICT_WITH_PLCP_HPP_
+
+#include <cstdint>
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "internal/bit_vector.hpp"
+
+namespace dict {
+
+/************************************************
+ * Declaration: class with_plcp<TI, T>
+ ************************************************/
+
+// Keeps the LCP values in text order (PLCP), where PLCP[j + 1] >= PLCP[j] - 1,
+// as a bit vector of about 2n bits: PLCP[j] - PLCP[j - 1] + 1 zeros and then
+// a one for each position j. lcp(i) looks up PLCP[at(i)], so this policy has
+// to come after the CSA policy.
+//
+// Updates mark the rows whose preceding row changes. Once the index is
+// consistent again, i.e. after a sequence (or a batch) is inserted or
+// erased, the values at the marked rows are recomputed, and only the runs
+// of text positions around them are re-encoded, each replacing its range
+// of the bit vector at once.
+template <typename TextIndex, typename Trait>
+class with_plcp {
+ public:  // Public Type(s)
+    using host_type = TextIndex;
+    using size_type = typename Trait::size_type;
+    using allocator_type = typename Trait::allocator_type;
+
+ private:  // Private Types(s)
+    using helper = typename Trait::helper;
+    using event = typename Trait::event;
+
+ public:  // Public Method(s)
+    explicit with_plcp(allocator_type const &alloc = allocator_type());
+
+    size_type lcp(size_type i) const;
+
+ protected:  // Protected Method(s)
+    template <typename Sequence>
+    void update(typename event::template after_inserting_first_term<Sequence> const &);
+    template <typename Sequence>
+    void update(typename event::template after_inserting_term<Sequence> const &info);
+    template <typename Sequence>
+    void update(typename event::template after_inserting_sequence<Sequence> const &);
+
+    void update(typename event::before_erasuring_sequence const &info);
+    void update(typename event::after_erasuring_term const &info);
+    void update(typename event::after_moving_term const &info);
+    void update(typename event::after_erasuring_sequence const &);
+
+    void update(typename event::after_inserting_batch const &info);
+    void update(typename event::after_building const &info);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+    void swap(with_plcp &other);  // NOLINT(runtime/references)
+
+ protected:  // Protected Static Method(s)
+    static std::uint64_t tag();
+
+ private:  // Private Method(s)
+    size_type plcp(size_type j) const;
+    size_type lcp_of_row(size_type i) const;
+    void mark(size_type i);
+    void apply_updates();
+    void replace_values(size_type first, size_type num_erased,
+                        std::vector<size_type> const &values);
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type BIT_BLOCK_SIZE = 256;
+
+ private:  // Private Property(ies)
+    internal::bit_vector<BIT_BLOCK_SIZE, allocator_type> plcp_bits_;
+
+    // rows whose values are to be recomputed, aligned with the rows
+    internal::bit_vector<BIT_BLOCK_SIZE, allocator_type> marked_rows_;
+
+    size_type num_inserted_;
+    size_type erased_pos_;
+    size_type num_erased_;
+};  // class with_plcp<TI, T>
+
+/************************************************
+ * Implementation: class with_plcp<TI, T>
+ ************************************************/
+
+template <typename TI, typename T>
+inline with_plcp<TI, T>::with_plcp(allocator_type const &alloc)
+    : plcp_bits_(alloc), marked_rows_(alloc), num_inserted_(0), erased_pos_(0), num_erased_(0) {
+    // do nothing
+}
+
+template <typename TI, typename T>
+inline typename with_plcp<TI, T>::size_type with_plcp<TI, T>::lcp(size_type i) const {
+    return plcp(helper::to_host(this)->at(i));
+}
+
+template <typename TI, typename T>
+template <typename Sequence>
+inline void with_plcp<TI, T>::update(
+        typename event::template after_inserting_first_term<Sequence> const &) {
+    marked_rows_.insert(0, true);
+    ++num_inserted_;
+}
+
+template <typename TI, typename T>
+template <typename Sequence>
+inline void with_plcp<TI, T>::update(
+        typename event::template after_inserting_term<Sequence> const &info) {
+    marked_rows_.insert(info.pos, true);
+    mark(info.pos + 1);
+    ++num_inserted_;
+}
+
+template <typename TI, typename T>
+template <typename Sequence>
+inline void with_plcp<TI, T>::update(
+        typename event::template after_inserting_sequence<Sequence> const &) {
+    apply_updates();
+}
+
+template <typename TI, typename T>
+inline void with_plcp<TI, T>::update(typename event::before_erasuring_sequence const &info) {
+    erased_pos_ = helper::to_host(this)->at(info.pos);
+    num_erased_ = 0;
+}
+
+template <typename TI, typename T>
+inline void with_plcp<TI, T>::update(typename event::after_erasuring_term const &info) {
+    marked_rows_.erase(info.pos);
+    mark(info.pos);
+    ++num_erased_;
+}
+
+template <typename TI, typename T>
+void with_plcp<TI, T>::update(typename event::after_moving_term const &info) {
+    auto from_pos = info.from_pos;
+    auto to_pos = info.to_pos;
+
+    // the rows after the old and the new places of the moved row, as well
+    // as the moved row itself, get new preceding rows
+    auto b = marked_rows_.erase(from_pos);
+    mark(from_pos);
+    marked_rows_.insert(to_pos, b);
+    mark(to_pos);
+    mark(to_pos + 1);
+}
+
+template <typename TI, typename T>
+inline void with_plcp<TI, T>::update(typename event::after_erasuring_sequence const &) {
+    apply_updates();
+}
+
+template <typename TI, typename T>
+void with_plcp<TI, T>::update(typename event::after_inserting_batch const &info) {
+    // mark the new rows once all of them are in place, and then the rows
+    // that follow them
+    for (auto j : info.sa) {
+        marked_rows_.insert(info.rows[j], true);
+    }
+
+    for (auto j : info.sa) {
+        mark(info.rows[j] + 1);
+    }
+
+    num_inserted_ += info.text.size();
+    apply_updates();
+}
+
+template <typename TI, typename T>
+void with_plcp<TI, T>::update(typename event::after_building const &info) {
+    auto const &text = info.text;
+    auto const &sa = info.sa;
+    auto n = sa.size();
+
+    std::vector<size_type> isa(n);
+    for (size_type i = 0; i < n; ++i) {
+        isa[sa[i]] = i;
+    }
+
+    // Kasai's algorithm, except that terminators never match each other;
+    // the values are encoded in text order as they are found
+    std::vector<bool> bits;
+    bits.reserve(2 * n);
+
+    size_type h = 0, prev_h = 0;
+    for (size_type j = 0; j < n; ++j) {
+        auto i = isa[j];
+        if (i == 0) {
+            h = 0;
+        } else {
+            auto k = sa[i - 1];
+            while (text[j + h] != 0 && text[j + h] == text[k + h]) {
+                ++h;
+            }
+        }
+
+        auto num_zeros = j > 0 ? h + 1 - prev_h : h;
+        bits.insert(bits.end(), num_zeros, false);
+        bits.push_back(true);
+
+        prev_h = h;
+        if (h > 0) { --h; }
+    }
+
+    std::vector<bool> no_marks(n);
+    plcp_bits_.assign(bits.begin(), bits.end());
+    marked_rows_.assign(no_marks.begin(), no_marks.end());
+}
+
+template <typename TI, typename T>
+inline void with_plcp<TI, T>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    plcp_bits_.save(os);
+}
+
+template <typename TI, typename T>
+inline void with_plcp<TI, T>::load(std::istream &is) {  // NOLINT(runtime/references)
+    plcp_bits_.load(is);
+
+    std::vector<bool> no_marks(plcp_bits_.count());
+    marked_rows_.assign(no_marks.begin(), no_marks.end());
+}
+
+template <typename TI, typename T>
+void with_plcp<TI, T>::swap(with_plcp &other) {  // NOLINT(runtime/references)
+    plcp_bits_.swap(other.plcp_bits_);
+    marked_rows_.swap(other.marked_rows_);
+    std::swap(num_inserted_, other.num_inserted_);
+    std::swap(erased_pos_, other.erased_pos_);
+    std::swap(num_erased_, other.num_erased_);
+}
+
+template <typename TI, typename T>
+inline std::uint64_t with_plcp<TI, T>::tag() {
+    return 0x50434C50;  // "PLCP"
+}
+
+template <typename TI, typename T>
+inline typename with_plcp<TI, T>::size_type with_plcp<TI, T>::plcp(size_type j) const {
+    return plcp_bits_.select(j, true) - 2 * j;
+}
+
+template <typename TI, typename T>
+typename with_plcp<TI, T>::size_type with_plcp<TI, T>::lcp_of_row(size_type i) const {
+    if (i == 0) { return 0; }
+
+    auto const *host = helper::to_host(this);
+    auto x = i - 1, y = i;
+    size_type h = 0;
+    while (true) {
+        auto c = host->f(x);
+        if (c == 0 || c != host->f(y)) { break; }
+
+        x = host->psi(x);
+        y = host->psi(y);
+        ++h;
+    }
+
+    return h;
+}
+
+template <typename TI, typename T>
+inline void with_plcp<TI, T>::mark(size_type i) {
+    if (i < marked_rows_.size()) { marked_rows_.set(i); }
+}
+
+template <typename TI, typename T>
+void with_plcp<TI, T>::apply_updates() {
+    auto const *host = helper::to_host(this);
+    auto n = host->num_terms();
+
+    // positions of the current text map to the encoded ones by skipping the
+    // inserted positions at the front and the erased ones at erased_pos_
+    auto num_inserted = num_inserted_;
+    auto erased_first = erased_pos_ + 1 - num_erased_;
+    auto num_erased = num_erased_;
+    num_inserted_ = num_erased_ = 0;
+
+    if (n == 0) {
+        std::vector<bool> no_bits;
+        plcp_bits_.assign(no_bits.begin(), no_bits.end());
+        return;
+    }
+
+    // the inserted positions are at the front of the text, so their rows
+    // are found by walking psi from the row of the first one
+    std::vector<size_type> front_rows;
+    front_rows.reserve(num_inserted);
+    for (size_type j = 0, i = num_inserted > 0 ? host->rank(0) : 0; j < num_inserted; ++j) {
+        front_rows.push_back(i);
+        marked_rows_.reset(i);
+        i = host->psi(i);
+    }
+
+    // resolve the other marked rows to text positions (of the current text)
+    std::vector<std::pair<size_type, size_type>> marks;
+    auto num_marks = marked_rows_.count();
+    marks.reserve(num_marks);
+    for (size_type r = 0; r < num_marks; ++r) {
+        auto i = marked_rows_.select(r, true);
+        marks.emplace_back(host->at(i), i);
+    }
+
+    for (auto const &m : marks) {
+        marked_rows_.reset(m.second);
+    }
+
+    std::sort(marks.begin(), marks.end());
+
+    // the inserted positions are re-encoded as the first run; the other
+    // marks are grouped into runs of adjacent positions, and re-encoded from
+    // the last one so that earlier runs keep their positions
+    struct run {
+        size_type first, last;
+        std::vector<size_type> values;
+    };
+
+    std::vector<run> runs;
+    if (num_inserted > 0) {
+        runs.push_back({0, num_inserted, {}});
+        for (auto i : front_rows) {
+            runs.back().values.push_back(lcp_of_row(i));
+        }
+    }
+
+    for (auto const &m : marks) {
+        auto j = m.first;
+        if (runs.empty() || runs.back().last != j) { runs.push_back({j, j, {}}); }
+
+        runs.back().values.push_back(lcp_of_row(m.second));
+        runs.back().last = j + 1;
+    }
+
+    auto erased_done = num_erased == 0;
+    for (auto run_it = runs.rbegin(); run_it != runs.rend(); ++run_it) {
+        auto first = run_it->first;
+        auto last = run_it->last;
+        if (!erased_done && erased_first > last) {
+            replace_values(erased_first, num_erased, {});
+            erased_done = true;
+        }
+
+        auto old_first = first - std::min(first, num_inserted);
+        auto old_last = last - num_inserted;
+        if (num_erased > 0 && first > erased_first) {
+            old_first += num_erased;
+            old_last += num_erased;
+        } else if (num_erased > 0 && last >= erased_first) {
+            // the erased positions are in (or next to) the run
+            old_last += num_erased;
+            erased_done = true;
+        }
+
+        replace_values(old_first, old_last - old_first, run_it->values);
+    }
+
+    if (!erased_done) {
+        replace_values(erased_first, num_erased, {});
+    }
+}
+
+template <typename TI, typename T>
+void with_plcp<TI, T>::replace_values(size_type first, size_type num_erased,
+                                      std::vector<size_type> const &values) {
+    // the encoded values before and after the replaced ones stay the same,
+    // but the gaps to them are re-encoded as well
+    auto n = plcp_bits_.count();
+    auto last = first + num_erased;
+    auto has_prev = first > 0;
+    auto has_next = last < n;
+    auto prev = has_prev ? plcp(first - 1) : 0;
+    auto next = has_next ? plcp(last) : 0;
+
+    auto begin = has_prev ? plcp_bits_.select(first - 1, true) + 1 : 0;
+    auto end = has_next ? plcp_bits_.select(last, true) : plcp_bits_.size();
+
+    // encode the values into words, whose bits are zeros until set, and
+    // then replace the old encoding at once
+    std::vector<std::uint64_t> words;
+    size_type num_bits = 0;
+    auto put = [&](size_type x) {
+        num_bits += has_prev ? x + 1 - prev : x;
+        has_prev = true;
+        prev = x;
+    };
+
+    for (auto x : values) {
+        put(x);
+        words.resize(num_bits / 64 + 1);
+        words[num_bits / 64] |= std::uint64_t(1) << (num_bits % 64);
+        ++num_bits;
+    }
+
+    if (has_next) { put(next); }
+
+    words.resize((num_bits + 63) / 64);
+    plcp_bits_.replace(begin, end, words, num_bits);
+}
+
+}  // namespace dict
+
+#endif  // DICT_WITH_PLCP_HPP_
@@ -0,0 +1,409 @@
+/************************************************
+ *  with_text_order_csa.hpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#ifndef DICT_WITH_TEXT_ORDER_CSA_HPP_
+#define DICT_WITH_TEXT_ORDER_CSA_HPP_
+
+#include <cstdint>
+
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "internal/csa_base.hpp"
+#include "internal/packed_array.hpp"
+#include "internal/partial_sum.hpp"
+#include "internal/serialization.hpp"
+
+namespace dict {
+
+/************************************************
+ * Declaration: class with_text_order_csa<TI, T>
+ ************************************************/
+
+// A variant of with_csa that samples every (sample_distance() + 1)-th
+// position of each sequence, counted from its terminator, and keeps the
+// sampled suffix array values next to the sampled rows. at() reads them
+// without going through the permutation; locate() goes through it once per
+// sequence, to resolve the terminator row that identifies the sequence.
+//
+// A sampled value is stored as the distance of its position from the end
+// of the text when its sequence was inserted, i.e. as the sum of an id of
+// the sequence and an offset in it. Insertions at the front of the text do
+// not change it; erasing a sequence shortens the distances of the
+// sequences inserted after it, which are corrected by the total length of
+// the erased sequences with smaller ids.
+template <typename TextIndex, typename Trait>
+class with_text_order_csa
+    : public internal::csa_base<with_text_order_csa<TextIndex, Trait>, Trait> {
+ private:  // Private Types(s)
+    using base = internal::csa_base<with_text_order_csa<TextIndex, Trait>, Trait>;
+    using helper = typename Trait::helper;
+    using event = typename Trait::event;
+
+    friend base;
+
+ public:  // Public Type(s)
+    using host_type = TextIndex;
+    using size_type = typename base::size_type;
+    using value_type = typename base::value_type;
+    using term_type = typename base::term_type;
+    using allocator_type = typename base::allocator_type;
+
+ public:  // Public Method(s)
+    explicit with_text_order_csa(allocator_type const &alloc = allocator_type());
+
+    using base::at;
+    using base::rank;
+
+    void resample(size_type distance);
+
+ protected:  // Protected Method(s)
+    template <typename Sequence>
+    void update(typename event::template after_inserting_first_term<Sequence> const &);
+    template <typename Sequence>
+    void update(typename event::template after_inserting_term<Sequence> const &info);
+    template <typename Sequence>
+    void update(typename event::template after_inserting_sequence<Sequence> const &);
+
+    void update(typename event::before_erasuring_sequence const &info);
+    void update(typename event::after_erasuring_term const &info);
+    void update(typename event::after_moving_term const &info);
+    void update(typename event::after_erasuring_sequence const &);
+
+    void update(typename event::after_inserting_batch const &info);
+    void update(typename event::after_building const &info);
+
+    void save(std::ostream &os) const;  // NOLINT(runtime/references)
+    void load(std::istream &is);        // NOLINT(runtime/references)
+    void swap(with_text_order_csa &other);  // NOLINT(runtime/references)
+
+ protected:  // Protected Static Method(s)
+    static std::uint64_t tag();
+
+ private:  // Private Method(s)
+    void insert_term(size_type i, size_type off);
+    value_type sampled_value(size_type i, size_type off) const;
+    void assign_samples(std::vector<size_type> const &sa, std::vector<bool> const &is_end);
+
+ private:  // Private Static Property(ies)
+    static constexpr size_type VALUE_BLOCK_SIZE = 32;
+
+ private:  // Private Property(ies)
+    using base::isa_samples_;
+    using base::sa_samples_;
+    using base::pi_;
+    using base::seq_ends_;
+    using base::sample_distance_;
+
+    internal::packed_array<VALUE_BLOCK_SIZE, internal::fixed_width_coding, allocator_type>
+        sa_values_;
+
+    // total lengths of the erased sequences by their ids
+    internal::partial_sum<std::uint64_t, std::uint64_t, allocator_type> erased_lengths_;
+    size_type num_erased_terms_;
+
+    size_type seq_id_;
+    size_type erased_isa_pos_;
+    size_type erased_seq_id_;
+    size_type erased_seq_len_;
+};  // class with_text_order_csa<TI, T>
+
+/************************************************
+ * Implementation: class with_text_order_csa<TI, T>
+ ************************************************/
+
+template <typename TI, typename T>
+inline with_text_order_csa<TI, T>::with_text_order_csa(allocator_type const &alloc)
+    : base(alloc), sa_values_(alloc), erased_lengths_(alloc), num_erased_terms_(0),
+      seq_id_(0), erased_isa_pos_(0), erased_seq_id_(0), erased_seq_len_(0) {
+    // do nothing
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::resample(size_type distance) {
+    if (distance == 0) {
+        throw std::invalid_argument("sample distance must be positive");
+    }
+
+    sample_distance_ = distance;
+
+    auto const *host = helper::to_host(this);
+    auto n = host->num_terms();
+    if (n == 0) { return; }
+
+    // row 0 is the last position; walking LF visits the text backward
+    std::vector<size_type> sa(n);
+    for (size_type k = 0, i = 0; k < n; ++k) {
+        sa[i] = n - 1 - k;
+        i = host->lf(i);
+    }
+
+    std::vector<bool> is_end(n);
+    for (size_type j = 0; j < n; ++j) {
+        is_end[j] = seq_ends_[j];
+    }
+
+    assign_samples(sa, is_end);
+}
+
+template <typename TI, typename T>
+template <typename Sequence>
+inline void with_text_order_csa<TI, T>::update(
+        typename event::template after_inserting_first_term<Sequence> const &) {
+    seq_id_ = num_erased_terms_;
+    insert_term(0, 0);
+    seq_ends_.insert(0, true);
+}
+
+template <typename TI, typename T>
+template <typename Sequence>
+inline void with_text_order_csa<TI, T>::update(
+        typename event::template after_inserting_term<Sequence> const &info) {
+    // the terminator is inserted first, at the front of the text
+    if (info.num_inserted == 0) {
+        seq_id_ = helper::to_host(this)->num_terms() - 1 + num_erased_terms_;
+    }
+
+    insert_term(info.pos, info.num_inserted);
+    seq_ends_.insert(0, info.num_inserted == 0);
+}
+
+template <typename TI, typename T>
+template <typename Sequence>
+inline void with_text_order_csa<TI, T>::update(
+        typename event::template after_inserting_sequence<Sequence> const &) {
+    // do nothing
+}
+
+template <typename TI, typename T>
+inline void with_text_order_csa<TI, T>::update(
+        typename event::before_erasuring_sequence const &info) {
+    erased_isa_pos_ = at(info.pos);
+    erased_seq_len_ = 0;
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::update(typename event::after_erasuring_term const &info) {
+    auto pos = info.pos;
+    auto b = sa_samples_.erase(pos);
+    seq_ends_.erase(erased_isa_pos_);
+    isa_samples_.erase(erased_isa_pos_);
+    if (b) {
+        auto r = pos > 0 ? sa_samples_.rank(pos - 1, true) : 0;
+        pi_.erase(r);
+
+        // the terminator comes first, and its value is the id
+        auto x = sa_values_.erase(r);
+        if (erased_seq_len_ == 0) { erased_seq_id_ = x; }
+    }
+
+    ++erased_seq_len_;
+    if (erased_isa_pos_) { --erased_isa_pos_; }
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::update(typename event::after_moving_term const &info) {
+    auto from_pos = info.from_pos;
+    auto to_pos = info.to_pos;
+
+    auto b = sa_samples_.erase(from_pos);
+    if (b) {
+        auto from_rank = from_pos > 0 ? sa_samples_.rank(from_pos - 1, true) : 0;
+        auto to_rank = to_pos > 0 ? sa_samples_.rank(to_pos - 1, true) : 0;
+        if (from_rank != to_rank) {
+            pi_.move(from_rank, to_rank);
+            sa_values_.insert(to_rank, sa_values_.erase(from_rank));
+        }
+    }
+
+    sa_samples_.insert(to_pos, b);
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::update(typename event::after_erasuring_sequence const &) {
+    auto const &wm = helper::get_wm(this);
+    if (wm.size()) {
+        erased_lengths_.increase(erased_seq_id_, erased_seq_len_);
+        num_erased_terms_ += erased_seq_len_;
+    } else {
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> no_lengths;
+        erased_lengths_.assign(no_lengths.begin(), no_lengths.end());
+        num_erased_terms_ = 0;
+    }
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::update(typename event::after_inserting_batch const &info) {
+    auto const &text = info.text;
+    auto const &rows = info.rows;
+    auto m = text.size();
+    auto n = helper::to_host(this)->num_terms();
+
+    // the new positions are inserted unsampled in front of the text
+    for (auto j : info.sa) {
+        sa_samples_.insert(rows[j], false);
+    }
+
+    for (size_type j = 0; j < m; ++j) {
+        isa_samples_.insert(j, false);
+        seq_ends_.insert(j, text[j] == 0);
+    }
+
+    // then sampled from the back as insert_term() does, so that each new
+    // sample is the first one in text order; its value is the distance
+    // from the end of the text, as when inserted sequence by sequence
+    size_type off = 0;
+    for (auto j = m; j > 0; --j) {
+        off = text[j - 1] == 0 ? 0 : off + 1;
+        if (off % (sample_distance_ + 1) != 0) { continue; }
+
+        auto i = rows[j - 1];
+        auto r = i > 0 ? sa_samples_.rank(i - 1, true) : 0;
+        sa_samples_.set(i);
+        isa_samples_.set(j - 1);
+        pi_.insert(r, 0);
+        sa_values_.insert(r, n - j + num_erased_terms_);
+    }
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::update(typename event::after_building const &info) {
+    auto const &text = info.text;
+    auto n = info.sa.size();
+
+    std::vector<bool> is_end(n);
+    for (size_type j = 0; j < n; ++j) {
+        is_end[j] = text[j] == 0;
+    }
+
+    assign_samples(info.sa, is_end);
+    seq_ends_.assign(is_end.begin(), is_end.end());
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::save(std::ostream &os) const {  // NOLINT(runtime/references)
+    internal::write_value<std::uint64_t>(os, sample_distance_);
+    internal::write_value<std::uint64_t>(os, num_erased_terms_);
+    isa_samples_.save(os);
+    sa_samples_.save(os);
+    sa_values_.save(os);
+    pi_.save(os);
+    seq_ends_.save(os);
+    erased_lengths_.save(os);
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::load(std::istream &is) {  // NOLINT(runtime/references)
+    sample_distance_ = internal::read_value<std::uint64_t>(is);
+    if (sample_distance_ == 0) {
+        throw std::runtime_error("invalid sample distance");
+    }
+
+    num_erased_terms_ = internal::read_value<std::uint64_t>(is);
+    isa_samples_.load(is);
+    sa_samples_.load(is);
+    sa_values_.load(is);
+    pi_.load(is);
+    seq_ends_.load(is);
+    erased_lengths_.load(is);
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::swap(with_text_order_csa &other) {  // NOLINT(runtime/references)
+    base::swap(other);
+    sa_values_.swap(other.sa_values_);
+    erased_lengths_.swap(other.erased_lengths_);
+    std::swap(num_erased_terms_, other.num_erased_terms_);
+    std::swap(seq_id_, other.seq_id_);
+    std::swap(erased_isa_pos_, other.erased_isa_pos_);
+    std::swap(erased_seq_id_, other.erased_seq_id_);
+    std::swap(erased_seq_len_, other.erased_seq_len_);
+}
+
+template <typename TI, typename T>
+inline std::uint64_t with_text_order_csa<TI, T>::tag() {
+    return 0x4153434F54;  // "TOCSA"
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::insert_term(size_type i, size_type off) {
+    // the new position is at the front of the text, `off` positions before
+    // the terminator of its sequence
+    auto b = off % (sample_distance_ + 1) == 0;
+    sa_samples_.insert(i, b);
+    isa_samples_.insert(0, b);
+    if (b) {
+        auto r = i > 0 ? sa_samples_.rank(i - 1, true) : 0;
+        pi_.insert(r, 0);
+        sa_values_.insert(r, seq_id_ + off);
+    }
+}
+
+template <typename TI, typename T>
+inline typename with_text_order_csa<TI, T>::value_type
+with_text_order_csa<TI, T>::sampled_value(size_type i, size_type off) const {
+    auto r = sa_samples_.rank(i, true);
+    auto x = sa_values_[r - 1];
+    if (num_erased_terms_ > 0) {
+        x -= erased_lengths_.sum(x);
+    }
+
+    auto n = helper::to_host(this)->num_terms();
+    auto sa = n - 1 - x + off;
+    return sa < n ? sa : sa - n;
+}
+
+template <typename TI, typename T>
+void with_text_order_csa<TI, T>::assign_samples(std::vector<size_type> const &sa,
+                                                std::vector<bool> const &is_end) {
+    // sample each position whose distance to the terminator of its sequence
+    // is a multiple of sample_distance_ + 1; the ids are the distances from
+    // the end of the text
+    auto n = sa.size();
+    std::vector<bool> sampled(n);
+    size_type off = 0;
+    for (auto j = n; j > 0; --j) {
+        off = is_end[j - 1] ? 0 : off + 1;
+        sampled[j - 1] = off % (sample_distance_ + 1) == 0;
+    }
+
+    // samples are numbered in text order
+    std::vector<size_type> isa_ranks(n);
+    size_type num_samples = 0;
+    for (size_type j = 0; j < n; ++j) {
+        if (sampled[j]) { isa_ranks[j] = num_samples++; }
+    }
+
+    std::vector<bool> sa_bits(n);
+    std::vector<size_type> pi, values;
+    pi.reserve(num_samples);
+    values.reserve(num_samples);
+    for (size_type i = 0; i < n; ++i) {
+        if (sampled[sa[i]]) {
+            sa_bits[i] = true;
+            pi.push_back(isa_ranks[sa[i]]);
+            values.push_back(n - 1 - sa[i]);
+        }
+    }
+
+    isa_samples_.assign(sampled.begin(), sampled.end());
+    sa_samples_.assign(sa_bits.begin(), sa_bits.end());
+    sa_values_.assign(values.begin(), values.end());
+    pi_.assign(pi.begin(), pi.end());
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> no_lengths;
+    erased_lengths_.assign(no_lengths.begin(), no_lengths.end());
+    num_erased_terms_ = 0;
+}
+
+}  // namespace dict
+
+#endif  // DICT_WITH_TEXT_ORDER_CSA_HPP_
@@ -0,0 +1,67 @@
+/************************************************
+ *  mapped_file.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <dict/internal/mapped_file.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Implementation: class mapped_file
+ ************************************************/
+
+mapped_file::mapped_file(std::string const &path)
+    : data_(nullptr), size_(0) {
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open " + path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+        ::close(fd);
+        throw std::runtime_error("failed to stat " + path);
+    }
+
+    size_ = static_cast<size_type>(st.st_size);
+    if (size_ > 0) {
+        data_ = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (data_ == MAP_FAILED) {
+            data_ = nullptr;
+            ::close(fd);
+            throw std::runtime_error("failed to map " + path);
+        }
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+mapped_file::~mapped_file() {
+    if (data_) { ::munmap(data_, size_); }
+}
+
+void const *mapped_file::data() const {
+    return data_;
+}
+
+mapped_file::size_type mapped_file::size() const {
+    return size_;
+}
+
+}  // namespace internal
+
+}  // namespace dict
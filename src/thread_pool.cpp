@@ -0,0 +1,71 @@
+/************************************************
+ *  thread_pool.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <dict/internal/thread_pool.hpp>
+
+namespace dict {
+
+namespace internal {
+
+/************************************************
+ * Implementation: class thread_pool
+ ************************************************/
+
+thread_pool::thread_pool(size_type num_threads)
+    : stopped_(false) {
+    threads_.reserve(num_threads);
+    for (size_type k = 0; k < num_threads; ++k) {
+        threads_.emplace_back(&thread_pool::work, this);
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+
+    cv_.notify_all();
+    for (auto &t : threads_) {
+        t.join();
+    }
+}
+
+void thread_pool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopped_ || !tasks_.empty(); });
+            if (tasks_.empty()) { return; }
+
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        task();
+    }
+}
+
+bool thread_pool::run_queued() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty()) { return false; }
+
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+    }
+
+    task();
+    return true;
+}
+
+}  // namespace internal
+
+}  // namespace dict
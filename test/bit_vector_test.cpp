@@ -6,7 +6,12 @@
  *  Distributed under The BSD 3-Clause License
  ************************************************/
 
+#include <cstdint>
+
+#include <sstream>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -210,3 +215,143 @@ TEST(BitVectorTest, SelectBits) {
     EXPECT_EQ(8, bits.select(4, false));
     EXPECT_EQ(11, bits.select(5, false));
 }
+
+TEST(BitVectorTest, EraseAllBits) {
+    bitmap bits;
+    for (std::size_t i = 0; i < 64; ++i) {
+        bits.insert(i, i % 3 == 0);
+    }
+
+    for (std::size_t i = 64; i > 0; --i) {
+        EXPECT_EQ((64 - i) % 3 == 0, bits.erase(0));
+        EXPECT_EQ(i - 1, bits.size());
+    }
+
+    EXPECT_EQ(0, bits.count());
+}
+
+TEST(BitVectorTest, SaveAndLoad) {
+    bitmap bits;
+    construct_bitmap(bits);
+
+    std::stringstream ss;
+    bits.save(ss);
+
+    bitmap loaded;
+    loaded.load(ss);
+    ASSERT_EQ(bits.size(), loaded.size());
+    EXPECT_EQ(bits.count(), loaded.count());
+    for (std::size_t i = 0; i < bits.size(); ++i) {
+        EXPECT_EQ(bits[i], loaded[i]);
+        EXPECT_EQ(bits.rank(i, true), loaded.rank(i, true));
+    }
+
+    loaded.insert(3, true);
+    EXPECT_EQ(bits.size() + 1, loaded.size());
+    EXPECT_TRUE(loaded[3]);
+
+    // a corrupt number of blocks is reported before anything is allocated
+    std::stringstream corrupt;
+    corrupt.write("\xff\xff\xff\xff\xff\xff\xff\x7f", sizeof(std::uint64_t));
+    bitmap broken;
+    EXPECT_THROW(broken.load(corrupt), std::runtime_error);
+}
+
+TEST(BitVectorTest, AssignWords) {
+    using wide_bitmap = dict::internal::bit_vector<64>;
+
+    std::vector<std::uint64_t> words = {0x0123456789abcdefULL, ~0ULL, 0, 0xf0f0f0f0f0f0f0f0ULL};
+    for (std::size_t n : {0, 1, 63, 64, 115, 200, 256}) {
+        wide_bitmap bits;
+        bits.assign_words(words, n);
+        ASSERT_EQ(n, bits.size());
+
+        std::size_t num_set_bits = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            bool b = (words[i / 64] >> (i % 64)) & 1;
+            num_set_bits += b;
+            EXPECT_EQ(b, bits[i]);
+            EXPECT_EQ(num_set_bits, bits.rank(i, true));
+        }
+
+        EXPECT_EQ(num_set_bits, bits.count());
+
+        // the bits are packed back without those beyond n
+        auto packed = bits.words();
+        ASSERT_EQ((n + 63) / 64, packed.size());
+        for (std::size_t k = 0; k < packed.size(); ++k) {
+            auto len = n - k * 64;
+            EXPECT_EQ(len < 64 ? words[k] & ((1ULL << len) - 1) : words[k], packed[k]);
+        }
+    }
+}
+
+TEST(BitVectorTest, ReplaceRanges) {
+    std::vector<bool> expected;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        expected.push_back(i % 3 == 0 || i % 7 == 0);
+    }
+
+    bitmap bits(expected.begin(), expected.end());
+    std::vector<std::uint64_t> words = {0x0123456789abcdefULL, ~0ULL, 0xf0f0f0f0f0f0f0f0ULL};
+
+    // (first, last, n): shrink, grow, erase, insert, append and replace all
+    std::vector<std::vector<std::size_t>> cases = {
+        {10, 20, 3}, {100, 101, 150}, {0, 7, 0}, {500, 500, 64}, {3, 400, 1},
+        {0, 0, 2}, {0, 0, 0}, {805, 805, 70}, {850, 875, 0}, {0, 850, 192}
+    };
+
+    for (auto const &c : cases) {
+        auto first = c[0], last = c[1], n = c[2];
+        ASSERT_LE(last, expected.size());
+
+        std::vector<bool> new_bits;
+        for (std::size_t i = 0; i < n; ++i) {
+            new_bits.push_back((words[i / 64] >> (i % 64)) & 1);
+        }
+
+        expected.erase(expected.begin() + first, expected.begin() + last);
+        expected.insert(expected.begin() + first, new_bits.begin(), new_bits.end());
+        bits.replace(first, last, words, n);
+        ASSERT_EQ(expected.size(), bits.size());
+
+        std::size_t num_set_bits = 0;
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            num_set_bits += expected[i];
+            EXPECT_EQ(expected[i], bits[i]);
+            EXPECT_EQ(num_set_bits, bits.rank(i, true));
+        }
+
+        EXPECT_EQ(num_set_bits, bits.count());
+    }
+
+    // the bit vector remains dynamic
+    bits.insert(0, true);
+    bits.erase(1);
+    EXPECT_TRUE(bits[0]);
+}
+
+TEST(BitVectorTest, ConstructFromRange) {
+    std::vector<bool> expected;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        expected.push_back(i % 3 == 0 || i % 7 == 0);
+    }
+
+    bitmap bits(expected.begin(), expected.end());
+    ASSERT_EQ(expected.size(), bits.size());
+
+    std::size_t num_set_bits = 0;
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        num_set_bits += expected[i];
+        EXPECT_EQ(expected[i], bits[i]);
+        EXPECT_EQ(num_set_bits, bits.rank(i, true));
+    }
+
+    EXPECT_EQ(num_set_bits, bits.count());
+
+    // the bit vector remains dynamic
+    bits.insert(500, true);
+    EXPECT_EQ(expected.size() + 1, bits.size());
+    EXPECT_TRUE(bits[500]);
+    EXPECT_EQ(num_set_bits + 1, bits.count());
+}
@@ -0,0 +1,83 @@
+/************************************************
+ *  broadword_test.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <cstdint>
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dict/internal/broadword.hpp>
+
+using dict::internal::broadword;
+
+std::vector<std::size_t> set_bits(std::uint64_t w) {
+    std::vector<std::size_t> positions;
+    for (std::size_t j = 0; j < 64; ++j) {
+        if ((w >> j) & 1) { positions.push_back(j); }
+    }
+
+    return positions;
+}
+
+void expect_select(std::uint64_t w) {
+    auto positions = set_bits(w);
+    EXPECT_EQ(positions.size(), broadword::popcount(w));
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        EXPECT_EQ(positions[i], broadword::select(w, i));
+        EXPECT_EQ(positions[i], broadword::select_broadword(w, i));
+#ifdef DICT_INTERNAL_BROADWORD_X86_64
+        if (broadword::has_bmi2()) {
+            EXPECT_EQ(positions[i], broadword::select_bmi2(w, i));
+        }
+#endif
+    }
+}
+
+TEST(BroadwordTest, SelectInSpecialWords) {
+    expect_select(0);
+    expect_select(1);
+    expect_select(~std::uint64_t(0));
+    expect_select(std::uint64_t(1) << 63);
+    expect_select(0x8000000000000001ULL);
+    expect_select(0x00FF00FF00FF00FFULL);
+    expect_select(0xAAAAAAAAAAAAAAAAULL);
+}
+
+TEST(BroadwordTest, SelectInRandomWords) {
+    std::mt19937_64 engine(0);
+    for (std::size_t t = 0; t < 1000; ++t) {
+        // vary the density so that sparse and dense words are both covered
+        auto w = engine();
+        for (std::size_t k = t % 4; k > 0; --k) {
+            w &= engine();
+        }
+
+        expect_select(w);
+        expect_select(~w);
+    }
+}
+
+TEST(BroadwordTest, SetAndGetBits) {
+    std::mt19937_64 engine(1);
+    for (std::size_t len : {1, 7, 31, 63, 64}) {
+        // fields cross word boundaries unless len divides 64
+        std::vector<std::uint64_t> words(len + 1, ~std::uint64_t(0));
+        std::vector<std::uint64_t> values(64);
+        auto mask = len < 64 ? (std::uint64_t(1) << len) - 1 : ~std::uint64_t(0);
+        for (std::size_t k = 0; k < values.size(); ++k) {
+            values[k] = engine() & mask;
+            broadword::set_bits(words.data(), k * len, len, values[k]);
+        }
+
+        for (std::size_t k = 0; k < values.size(); ++k) {
+            EXPECT_EQ(values[k], broadword::get_bits(words.data(), k * len, len));
+        }
+    }
+}
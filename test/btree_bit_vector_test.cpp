@@ -0,0 +1,178 @@
+/************************************************
+ *  btree_bit_vector_test.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <cstdint>
+
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dict/internal/btree_bit_vector.hpp>
+#include <dict/internal/wavelet_matrix.hpp>
+
+// small leaves and fanout to exercise splits and merges at every level
+using bitmap = dict::internal::btree_bit_vector<256, 4>;
+
+// NOLINTNEXTLINE(runtime/references)
+void expect_same_bits(std::vector<bool> const &expected, bitmap const &bits) {
+    ASSERT_EQ(expected.size(), bits.size());
+
+    std::size_t ranks[2] = {0, 0};
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        bool b = expected[i];
+        ++ranks[b];
+
+        using br_pair = decltype(bits.access_and_rank(i));
+        ASSERT_EQ(br_pair(b, ranks[b]), bits.access_and_rank(i));
+        ASSERT_EQ(ranks[!b], bits.rank(i, !b));
+        ASSERT_EQ(i, bits.select(ranks[b] - 1, b));
+    }
+
+    EXPECT_EQ(ranks[1], bits.count());
+}
+
+TEST(BTreeBitVectorTest, EmptyBitVector) {
+    bitmap bits;
+    EXPECT_EQ(0, bits.count());
+    EXPECT_EQ(0, bits.size());
+}
+
+TEST(BTreeBitVectorTest, InsertAndRank) {
+    bitmap bits;
+    bits.insert(0, true);                   // [1]
+    EXPECT_EQ(1, bits.insert(1, false));    //  1  [0]
+    EXPECT_EQ(1, bits.insert(0, false));    // [0]  1   0
+    EXPECT_EQ(2, bits.insert(1, false));    //  0  [0]  1   0
+    EXPECT_EQ(1, bits.insert(2, true));     //  0   0  [1]  1   0
+    EXPECT_EQ(3, bits.insert(5, true));     //  0   0   1   1   0  [1]
+
+    expect_same_bits({false, false, true, true, false, true}, bits);
+}
+
+TEST(BTreeBitVectorTest, InsertEraseAndSetRandomly) {
+    std::mt19937 gen(0);
+    std::vector<bool> expected;
+    bitmap bits;
+    for (std::size_t t = 0; t < 20000; ++t) {
+        auto op = gen() % 10;
+        if (op < 6 || expected.empty()) {
+            auto i = gen() % (expected.size() + 1);
+            auto b = gen() % 3 == 0;
+            expected.insert(expected.begin() + i, b);
+            bits.insert(i, b);
+        } else if (op < 9) {
+            auto i = gen() % expected.size();
+            EXPECT_EQ(expected[i], bits.erase(i));
+            expected.erase(expected.begin() + i);
+        } else {
+            auto i = gen() % expected.size();
+            auto b = gen() % 2 == 0;
+            expected[i] = b;
+            bits.set(i, b);
+        }
+
+        if (t % 1000 == 0) {
+            expect_same_bits(expected, bits);
+            if (HasFatalFailure()) { return; }
+        }
+    }
+
+    expect_same_bits(expected, bits);
+
+    while (!expected.empty()) {
+        auto i = gen() % expected.size();
+        EXPECT_EQ(expected[i], bits.erase(i));
+        expected.erase(expected.begin() + i);
+    }
+
+    expect_same_bits(expected, bits);
+}
+
+TEST(BTreeBitVectorTest, AssignSaveAndLoad) {
+    std::vector<bool> expected;
+    for (std::size_t i = 0; i < 5000; ++i) {
+        expected.push_back(i % 7 == 0 || i % 11 == 0);
+    }
+
+    bitmap bits;
+    bits.assign(expected.begin(), expected.end());
+    expect_same_bits(expected, bits);
+
+    std::stringstream ss;
+    bits.save(ss);
+
+    bitmap loaded;
+    loaded.load(ss);
+    expect_same_bits(expected, loaded);
+
+    // the loaded vector remains dynamic
+    expected.insert(expected.begin() + 3, true);
+    loaded.insert(3, true);
+    expected.erase(expected.begin() + 4000);
+    loaded.erase(4000);
+    expect_same_bits(expected, loaded);
+}
+
+TEST(BTreeBitVectorTest, AssignWords) {
+    std::vector<std::uint64_t> words;
+    std::vector<bool> expected;
+    for (std::size_t k = 0; k < 80; ++k) {
+        words.push_back(0x9e3779b97f4a7c15ULL * (k + 1));
+        for (std::size_t j = 0; j < 64; ++j) {
+            expected.push_back((words.back() >> j) & 1);
+        }
+    }
+
+    // the last word is only partly used
+    expected.resize(5000);
+
+    bitmap bits;
+    bits.assign_words(words, expected.size());
+    expect_same_bits(expected, bits);
+
+    bits.insert(4999, true);
+    expected.insert(expected.begin() + 4999, true);
+    expect_same_bits(expected, bits);
+
+    // the bits are packed back across the leaves
+    auto packed = bits.words();
+    ASSERT_EQ((expected.size() + 63) / 64, packed.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected[i], (packed[i / 64] >> (i % 64)) & 1);
+    }
+}
+
+TEST(BTreeBitVectorTest, WaveletMatrixLevels) {
+    using wm_t = dict::internal::wavelet_matrix<char>;
+    using btree_wm_t = dict::internal::wavelet_matrix<char, 8, bitmap>;
+
+    std::mt19937 gen(1);
+    wm_t expected;
+    btree_wm_t actual;
+    for (std::size_t i = 0; i < 3000; ++i) {
+        auto j = gen() % (i + 1);
+        auto c = static_cast<char>('a' + gen() % 26);
+        expected.insert(j, c);
+        actual.insert(j, c);
+    }
+
+    for (std::size_t i = 0; i < 1000; ++i) {
+        auto j = gen() % expected.size();
+        EXPECT_EQ(expected.erase(j), actual.erase(j));
+    }
+
+    ASSERT_EQ(expected.size(), actual.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i], actual[i]);
+        EXPECT_EQ(expected.lf(i), actual.lf(i));
+        EXPECT_EQ(expected.psi(i), actual.psi(i));
+    }
+}
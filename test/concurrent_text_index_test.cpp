@@ -0,0 +1,189 @@
+/************************************************
+ *  concurrent_text_index_test.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dict/concurrent_text_index.hpp>
+#include <dict/text_index.hpp>
+#include <dict/with_csa.hpp>
+#include <dict/with_lcp.hpp>
+
+using text_index = dict::text_index<
+    dict::with_csa,
+    dict::with_lcp<>::policy
+>;
+using concurrent_text_index = dict::concurrent_text_index<text_index>;
+using terms = std::vector<text_index::term_type>;
+
+void expect_same_index(text_index const &expected, text_index const &actual) {
+    ASSERT_EQ(expected.num_seqs(), actual.num_seqs());
+    ASSERT_EQ(expected.num_terms(), actual.num_terms());
+    for (text_index::size_type i = 0; i < expected.num_terms(); i++) {
+        EXPECT_EQ(expected.bwt(i), actual.bwt(i));
+        EXPECT_EQ(expected.at(i), actual.at(i));
+        EXPECT_EQ(expected.lcp(i), actual.lcp(i));
+    }
+}
+
+TEST(ConcurrentTextIndexTest, ApplyUpdatesToBothReplicas) {
+    text_index expected;
+    concurrent_text_index actual;
+
+    std::vector<terms> seqs = {{1, 3, 2}, {}, {2, 1}, {2, 1, 3}};
+    for (auto const &s : seqs) {
+        expected.insert(s);
+        actual.insert(s);
+    }
+
+    expected.insert_batch(seqs);
+    actual.insert_batch(seqs);
+    EXPECT_EQ(expected.erase(3), actual.erase(3));
+
+    // both replicas are read in turn as the writer switches between them
+    for (int k = 0; k < 2; ++k) {
+        expect_same_index(expected, *actual.read());
+        actual.modify([](text_index &) {});
+    }
+
+    std::stringstream ss;
+    actual.save(ss);
+
+    concurrent_text_index loaded;
+    loaded.load(ss);
+    for (int k = 0; k < 2; ++k) {
+        expect_same_index(expected, *loaded.read());
+        loaded.modify([](text_index &) {});
+    }
+
+    // a stream that fails to load leaves both replicas as they were
+    std::stringstream invalid("not an index");
+    EXPECT_THROW(loaded.load(invalid), std::runtime_error);
+    for (int k = 0; k < 2; ++k) {
+        expect_same_index(expected, *loaded.read());
+        loaded.modify([](text_index &) {});
+    }
+}
+
+TEST(ConcurrentTextIndexTest, RollBackFailedUpdate) {
+    text_index expected;
+    concurrent_text_index actual;
+
+    std::vector<terms> seqs = {{1, 3, 2}, {2, 1}, {2, 1, 3}};
+    expected.insert_batch(seqs);
+    actual.insert_batch(seqs);
+
+    EXPECT_THROW(actual.modify([&seqs](text_index &ti) {
+        ti.insert_batch(seqs);
+        ti.erase(0);
+        throw std::runtime_error("failed ingest");
+    }), std::runtime_error);
+
+    expect_same_index(expected, *actual.read());
+
+    expected.insert(terms{3, 3});
+    actual.insert(terms{3, 3});
+    for (int k = 0; k < 2; ++k) {
+        expect_same_index(expected, *actual.read());
+        actual.modify([](text_index &) {});
+    }
+}
+
+TEST(ConcurrentTextIndexTest, RethrowFailedReplay) {
+    text_index expected;
+    concurrent_text_index actual;
+
+    std::vector<terms> seqs = {{1, 3, 2}, {2, 1}, {2, 1, 3}};
+    expected.insert_batch(seqs);
+    actual.insert_batch(seqs);
+
+    // the update is published before it fails on the other replica
+    int num_calls = 0;
+    EXPECT_THROW(actual.modify([&num_calls](text_index &ti) {
+        ti.insert(terms{3, 1});
+        if (++num_calls == 2) { throw std::runtime_error("failed replay"); }
+    }), std::runtime_error);
+
+    expected.insert(terms{3, 1});
+    for (int k = 0; k < 2; ++k) {
+        expect_same_index(expected, *actual.read());
+        actual.modify([](text_index &) {});
+    }
+}
+
+TEST(ConcurrentTextIndexTest, WriteWhileHoldingSnapshots) {
+    text_index expected;
+    concurrent_text_index actual;
+
+    std::vector<terms> seqs = {{1, 3, 2}, {2, 1}, {2, 1, 3}};
+    expected.insert_batch(seqs);
+    actual.insert_batch(seqs);
+
+    // the writer holds snapshots of both replicas across its own updates
+    auto before = actual.read();
+    actual.insert(terms{3, 3});
+    auto between = actual.read();
+    actual.insert(terms{1, 1, 2});
+    actual.erase(1);
+
+    expect_same_index(expected, *before);
+
+    expected.insert(terms{3, 3});
+    expect_same_index(expected, *between);
+
+    expected.insert(terms{1, 1, 2});
+    expected.erase(1);
+    for (int k = 0; k < 3; ++k) {
+        expect_same_index(expected, *actual.read());
+        actual.modify([](text_index &) {});
+    }
+}
+
+TEST(ConcurrentTextIndexTest, ReadWhileWriting) {
+    constexpr text_index::size_type NUM_SEQS = 200;
+    constexpr text_index::size_type SEQ_SIZE = 20;
+
+    concurrent_text_index ti;
+    std::atomic<bool> done(false);
+    std::atomic<int> num_failures(0);
+
+    std::vector<std::thread> readers;
+    for (int k = 0; k < 4; ++k) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                auto s = ti.read();
+
+                // every snapshot holds only whole sequences of ones
+                auto n = s->num_terms();
+                auto num_seqs = s->num_seqs();
+                if (n != num_seqs * (SEQ_SIZE + 1) || s->count(terms{1}) != n - num_seqs) {
+                    ++num_failures;
+                }
+            }
+        });
+    }
+
+    terms seq(SEQ_SIZE, 1);
+    for (text_index::size_type k = 0; k < NUM_SEQS; ++k) {
+        ti.insert(seq);
+        if (k % 3 == 2) { ti.erase(0); }
+    }
+
+    done.store(true);
+    for (auto &t : readers) {
+        t.join();
+    }
+
+    EXPECT_EQ(0, num_failures.load());
+    EXPECT_EQ(NUM_SEQS - NUM_SEQS / 3, ti.read()->num_seqs());
+}
@@ -0,0 +1,105 @@
+/************************************************
+ *  flat_partial_sum_test.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <cstdint>
+
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dict/internal/flat_partial_sum.hpp>
+#include <dict/internal/partial_sum.hpp>
+
+using partial_sum = dict::internal::partial_sum<std::uint16_t, std::size_t>;
+using flat_partial_sum = dict::internal::flat_partial_sum<std::uint16_t, std::size_t>;
+
+// NOLINTNEXTLINE(runtime/references)
+void expect_same_sums(partial_sum const &expected, flat_partial_sum const &actual) {
+    ASSERT_EQ(expected.sum(), actual.sum());
+    for (std::uint16_t k = 0; k < 3000; ++k) {
+        ASSERT_EQ(expected.sum(k), actual.sum(k));
+    }
+
+    for (std::size_t x = 1; x <= expected.sum(); ++x) {
+        ASSERT_EQ(expected.search_and_sum(x), actual.search_and_sum(x));
+    }
+
+    EXPECT_THROW(actual.search(expected.sum() + 1), std::invalid_argument);
+}
+
+TEST(FlatPartialSumTest, PartialSumWithoutKey) {
+    flat_partial_sum ps;
+    EXPECT_EQ(0, ps.sum());
+    EXPECT_EQ(0, ps.sum(100));
+    EXPECT_THROW(ps.search(1), std::invalid_argument);
+}
+
+TEST(FlatPartialSumTest, GrowWithLargerKeys) {
+    flat_partial_sum ps;
+    ps.increase(3, 5);
+    ps.increase(0, 2);
+    ps.increase(1000, 4);
+    ps.decrease(3, 1);
+
+    EXPECT_EQ(2, ps.sum(0));
+    EXPECT_EQ(6, ps.sum(3));
+    EXPECT_EQ(6, ps.sum(999));
+    EXPECT_EQ(10, ps.sum(1000));
+    EXPECT_EQ(10, ps.sum());
+
+    EXPECT_EQ(0, ps.search(2));
+    EXPECT_EQ(3, ps.search(3));
+    EXPECT_EQ(1000, ps.search(7));
+}
+
+TEST(FlatPartialSumTest, UpdateRandomly) {
+    std::mt19937 gen(0);
+    std::vector<std::size_t> counts(3000, 0);
+    partial_sum expected;
+    flat_partial_sum actual;
+    for (std::size_t t = 0; t < 5000; ++t) {
+        auto k = static_cast<std::uint16_t>(gen() % (t < 2500 ? 300 : counts.size()));
+        if (counts[k] > 0 && gen() % 3 == 0) {
+            --counts[k];
+            expected.decrease(k, 1);
+            actual.decrease(k, 1);
+        } else {
+            ++counts[k];
+            expected.increase(k, 1);
+            actual.increase(k, 1);
+        }
+    }
+
+    expect_same_sums(expected, actual);
+}
+
+TEST(FlatPartialSumTest, SaveAndLoadAsPartialSum) {
+    std::mt19937 gen(0);
+    partial_sum expected;
+    for (std::size_t t = 0; t < 1000; ++t) {
+        expected.increase(static_cast<std::uint16_t>(gen() % 2000), gen() % 4);
+    }
+
+    // both are saved in the same format
+    std::stringstream stream;
+    expected.save(stream);
+
+    flat_partial_sum actual;
+    actual.load(stream);
+    expect_same_sums(expected, actual);
+
+    stream.str("");
+    actual.save(stream);
+
+    partial_sum reloaded;
+    reloaded.load(stream);
+    expect_same_sums(reloaded, actual);
+}
@@ -0,0 +1,207 @@
+/************************************************
+ *  huffman_wavelet_matrix_test.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <cstdint>
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dict/internal/huffman_wavelet_matrix.hpp>
+#include <dict/internal/thread_pool.hpp>
+#include <dict/internal/wavelet_matrix.hpp>
+
+// small blocks to exercise splits and merges
+using wm_t = dict::internal::wavelet_matrix<std::uint16_t, 11>;
+using huffman_wm_t = dict::internal::huffman_wavelet_matrix<std::uint16_t, 11, 2, 8>;
+
+// NOLINTNEXTLINE(runtime/references)
+void expect_same_matrix(wm_t const &expected, huffman_wm_t const &actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected.access_and_lf(i), actual.access_and_lf(i));
+        ASSERT_EQ(expected.psi_and_access(i), actual.psi_and_access(i));
+
+        auto c = expected[i];
+        ASSERT_EQ(expected.rank(i, c + 1), actual.rank(i, c + 1));
+        ASSERT_EQ(i, actual.select(expected.rank(i, c) - 1, c));
+    }
+}
+
+// mostly small values, with a rare one drawn from the whole alphabet
+std::uint16_t skewed_value(std::mt19937 &gen) {  // NOLINT(runtime/references)
+    if (gen() % 50 == 0) { return gen() % 2047; }
+
+    return std::geometric_distribution<std::uint16_t>(0.3)(gen);
+}
+
+TEST(HuffmanWaveletMatrixTest, AssignSkewedValues) {
+    std::mt19937 gen(0);
+    std::vector<std::uint16_t> values(5000);
+    for (auto &c : values) {
+        c = skewed_value(gen);
+    }
+
+    wm_t expected;
+    huffman_wm_t actual;
+    expected.assign(values.begin(), values.end());
+    actual.assign(values.begin(), values.end());
+    expect_same_matrix(expected, actual);
+
+    EXPECT_EQ(1, actual.code_length(0));
+    EXPECT_LT(actual.code_length(1), actual.code_length(2047));
+}
+
+TEST(HuffmanWaveletMatrixTest, InsertAndEraseRandomly) {
+    std::mt19937 gen(0);
+    wm_t expected;
+    huffman_wm_t actual;
+    for (std::size_t t = 0; t < 6000; ++t) {
+        // the distribution drifts halfway, which calls for new codes
+        auto c = skewed_value(gen);
+        if (t >= 3000) { c = 2046 - c; }
+
+        if (gen() % 4 < 3 || expected.size() == 0) {
+            auto i = gen() % (expected.size() + 1);
+            expected.insert(i, c);
+            actual.insert(i, c);
+        } else {
+            auto i = gen() % expected.size();
+            ASSERT_EQ(expected.erase(i), actual.erase(i));
+        }
+    }
+
+    expect_same_matrix(expected, actual);
+    EXPECT_GE(2, actual.code_length(2046));
+}
+
+TEST(HuffmanWaveletMatrixTest, EscapeUnknownValues) {
+    std::vector<std::uint16_t> values = {1, 1, 1, 2, 1, 3, 1, 2};
+
+    wm_t expected;
+    huffman_wm_t actual;
+    expected.assign(values.begin(), values.end());
+    actual.assign(values.begin(), values.end());
+
+    // values without codes of their own share the escape code
+    EXPECT_EQ(actual.code_length(0), actual.code_length(2047));
+    EXPECT_GT(actual.code_length(0), actual.code_length(3));
+    for (std::uint16_t c : {0, 2046, 5, 0}) {
+        expected.insert(3, c);
+        actual.insert(3, c);
+    }
+
+    expect_same_matrix(expected, actual);
+
+    actual.rebalance();
+    expect_same_matrix(expected, actual);
+    EXPECT_GT(actual.code_length(2046), actual.code_length(0));
+}
+
+TEST(HuffmanWaveletMatrixTest, SaveAndLoad) {
+    std::mt19937 gen(0);
+    std::vector<std::uint16_t> values(1000);
+    for (auto &c : values) {
+        c = skewed_value(gen);
+    }
+
+    wm_t expected;
+    huffman_wm_t saved;
+    expected.assign(values.begin(), values.end());
+    saved.assign(values.begin(), values.end());
+    for (std::uint16_t c : {2000, 2001}) {
+        expected.insert(0, c);
+        saved.insert(0, c);
+    }
+
+    std::stringstream stream;
+    saved.save(stream);
+
+    huffman_wm_t loaded;
+    loaded.load(stream);
+    expect_same_matrix(expected, loaded);
+    EXPECT_EQ(saved.num_levels(), loaded.num_levels());
+
+    expected.insert(500, 7);
+    loaded.insert(500, 7);
+    expect_same_matrix(expected, loaded);
+}
+
+TEST(HuffmanWaveletMatrixTest, InsertBatch) {
+    std::mt19937 gen(1);
+    wm_t expected;
+    huffman_wm_t actual;
+    std::vector<std::uint16_t> values(200);
+    for (auto &c : values) {
+        c = skewed_value(gen);
+    }
+
+    expected.assign(values.begin(), values.end());
+    actual.assign(values.begin(), values.end());
+
+    // batches bring values without codes, and the last one a new distribution
+    for (std::size_t k : {1, 30, 400, 2000}) {
+        std::vector<std::size_t> rows(expected.size() + k);
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            rows[i] = i;
+        }
+
+        std::shuffle(rows.begin(), rows.end(), gen);
+        rows.resize(k);
+        std::sort(rows.begin(), rows.end());
+
+        std::vector<std::pair<std::size_t, std::uint16_t>> batch;
+        for (auto i : rows) {
+            auto c = skewed_value(gen);
+            if (k == 2000) { c = 2046 - c; }
+
+            batch.emplace_back(i, c);
+            expected.insert(i, c);
+        }
+
+        actual.insert_batch(batch);
+        expect_same_matrix(expected, actual);
+    }
+}
+
+TEST(HuffmanWaveletMatrixTest, AssignAndInsertBatchInParallel) {
+    using wide_wm_t = dict::internal::huffman_wavelet_matrix<std::uint16_t, 11>;
+
+    // more than one chunk, the last of which is partial
+    std::mt19937 gen(7);
+    std::vector<std::uint16_t> values(150001);
+    for (auto &c : values) {
+        c = skewed_value(gen);
+    }
+
+    dict::internal::thread_pool pool(3);
+    wm_t expected;
+    wide_wm_t actual;
+    expected.assign(values.begin(), values.end());
+    actual.assign(values.begin(), values.end(), pool);
+
+    std::vector<std::pair<std::size_t, std::uint16_t>> batch;
+    for (std::size_t i = 0; i < 3 * values.size() / 2; i += 3) {
+        batch.emplace_back(i, skewed_value(gen));
+    }
+
+    expected.insert_batch(batch);
+    actual.insert_batch(batch, pool);
+
+    ASSERT_EQ(expected.size(), actual.size());
+    for (std::size_t i = 0; i < expected.size(); i += 97) {
+        auto c = expected[i];
+        EXPECT_EQ(c, actual[i]);
+        EXPECT_EQ(expected.rank(i, c), actual.rank(i, c));
+        EXPECT_EQ(expected.lf(i), actual.lf(i));
+        EXPECT_EQ(expected.psi(i), actual.psi(i));
+    }
+}
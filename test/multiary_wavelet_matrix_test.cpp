@@ -0,0 +1,243 @@
+/************************************************
+ *  multiary_wavelet_matrix_test.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <cstdint>
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dict/internal/multiary_wavelet_matrix.hpp>
+#include <dict/internal/symbol_vector.hpp>
+#include <dict/internal/thread_pool.hpp>
+#include <dict/internal/wavelet_matrix.hpp>
+
+// small blocks to exercise splits and merges
+using symbols = dict::internal::symbol_vector<2, 8>;
+using wm_t = dict::internal::wavelet_matrix<std::uint16_t, 11>;
+using multiary_wm_t = dict::internal::multiary_wavelet_matrix<std::uint16_t, 11, 2, 8>;
+
+// NOLINTNEXTLINE(runtime/references)
+void expect_same_symbols(std::vector<std::size_t> const &expected, symbols const &seq) {
+    ASSERT_EQ(expected.size(), seq.size());
+
+    std::size_t ranks[symbols::SIGMA] = {};
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        auto s = expected[i];
+        ++ranks[s];
+
+        using sr_pair = decltype(seq.access_and_rank(i));
+        ASSERT_EQ(sr_pair(s, ranks[s]), seq.access_and_rank(i));
+        ASSERT_EQ(ranks[(s + 1) % symbols::SIGMA], seq.rank(i, (s + 1) % symbols::SIGMA));
+        ASSERT_EQ(i, seq.select(ranks[s] - 1, s));
+    }
+
+    for (std::size_t s = 0; s < symbols::SIGMA; ++s) {
+        EXPECT_EQ(ranks[s], seq.count(s));
+    }
+}
+
+// NOLINTNEXTLINE(runtime/references)
+void expect_same_matrix(wm_t const &expected, multiary_wm_t const &actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected.access_and_lf(i), actual.access_and_lf(i));
+        ASSERT_EQ(expected.psi_and_access(i), actual.psi_and_access(i));
+
+        auto c = expected[i];
+        ASSERT_EQ(expected.rank(i, c + 1), actual.rank(i, c + 1));
+        ASSERT_EQ(i, actual.select(expected.rank(i, c) - 1, c));
+    }
+}
+
+TEST(SymbolVectorTest, InsertAndRank) {
+    symbols seq;
+    EXPECT_EQ(1, seq.insert(0, 2));     // [2]
+    EXPECT_EQ(1, seq.insert(1, 0));     //  2  [0]
+    EXPECT_EQ(1, seq.insert(0, 2));     // [2]  2   0
+    EXPECT_EQ(1, seq.insert(1, 3));     //  2  [3]  2   0
+    EXPECT_EQ(2, seq.insert(4, 0));     //  2   3   2   0  [0]
+
+    expect_same_symbols({2, 3, 2, 0, 0}, seq);
+}
+
+TEST(SymbolVectorTest, InsertAndEraseRandomly) {
+    std::mt19937 gen(0);
+    std::vector<std::size_t> expected;
+    symbols seq;
+    for (std::size_t t = 0; t < 10000; ++t) {
+        if (gen() % 3 < 2 || expected.empty()) {
+            auto i = gen() % (expected.size() + 1);
+            auto s = gen() % symbols::SIGMA;
+            expected.insert(expected.begin() + i, s);
+            seq.insert(i, s);
+        } else {
+            auto i = gen() % expected.size();
+            EXPECT_EQ(expected[i], seq.erase(i));
+            expected.erase(expected.begin() + i);
+        }
+
+        if (t % 1000 == 0) {
+            expect_same_symbols(expected, seq);
+            if (HasFatalFailure()) { return; }
+        }
+    }
+
+    expect_same_symbols(expected, seq);
+
+    std::stringstream ss;
+    seq.save(ss);
+
+    symbols loaded;
+    loaded.load(ss);
+    expect_same_symbols(expected, loaded);
+}
+
+TEST(MultiaryWaveletMatrixTest, SameAsBinaryWaveletMatrix) {
+    std::mt19937 gen(1);
+    std::vector<std::uint16_t> values;
+    for (std::size_t i = 0; i < 500; ++i) {
+        values.push_back(gen() % 2048);
+    }
+
+    wm_t expected;
+    multiary_wm_t actual;
+    expected.assign(values.begin(), values.end());
+    actual.assign(values.begin(), values.end());
+    expect_same_matrix(expected, actual);
+
+    for (std::size_t t = 0; t < 3000; ++t) {
+        if (gen() % 3 < 2) {
+            auto i = gen() % (expected.size() + 1);
+            auto c = static_cast<std::uint16_t>(gen() % 2048);
+            expected.insert(i, c);
+            actual.insert(i, c);
+        } else {
+            auto i = gen() % expected.size();
+            EXPECT_EQ(expected.erase(i), actual.erase(i));
+        }
+    }
+
+    expect_same_matrix(expected, actual);
+
+    // the ends of an empty range are unspecified
+    for (std::size_t t = 0; t < 100; ++t) {
+        auto i = gen() % expected.size(), j = i + gen() % (expected.size() - i);
+        auto c = expected[gen() % expected.size()];
+        auto r = expected.lf_range(i, j, c);
+        auto s = actual.lf_range(i, j, c);
+        EXPECT_EQ(r.second - r.first, s.second - s.first);
+        if (r.first < r.second) { EXPECT_EQ(r, s); }
+    }
+
+    std::stringstream ss;
+    actual.save(ss);
+
+    multiary_wm_t loaded;
+    loaded.load(ss);
+    expect_same_matrix(expected, loaded);
+}
+
+TEST(MultiaryWaveletMatrixTest, GrowLevelsOnDemand) {
+    std::mt19937 gen(2);
+    wm_t expected;
+    multiary_wm_t actual;
+    EXPECT_EQ(1, actual.num_levels());
+
+    // the levels follow the largest value seen so far: 4, 39, 399, 1999
+    std::size_t const maxima[] = {5, 40, 400, 2000};
+    std::size_t const num_levels[] = {2, 3, 5, 6};
+    for (std::size_t k = 0; k < 4; ++k) {
+        for (std::size_t t = 0; t < 300; ++t) {
+            auto i = gen() % (expected.size() + 1);
+            auto c = static_cast<std::uint16_t>(t == 0 ? maxima[k] - 1 : gen() % maxima[k]);
+            expected.insert(i, c);
+            actual.insert(i, c);
+        }
+
+        EXPECT_EQ(num_levels[k], actual.num_levels());
+        expect_same_matrix(expected, actual);
+        EXPECT_EQ(0, actual.rank(expected.size() - 1, 2047));
+    }
+
+    std::vector<std::uint16_t> values(100, 3);
+    actual.assign(values.begin(), values.end());
+    EXPECT_EQ(1, actual.num_levels());
+}
+
+TEST(MultiaryWaveletMatrixTest, InsertBatch) {
+    std::mt19937 gen(3);
+    wm_t expected, batched;
+    multiary_wm_t actual;
+
+    // a few values are inserted one by one, and many are merged into levels
+    for (std::size_t k : {0, 1, 5, 40, 300, 1000, 3}) {
+        std::vector<std::size_t> rows(expected.size() + k);
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            rows[i] = i;
+        }
+
+        std::shuffle(rows.begin(), rows.end(), gen);
+        rows.resize(k);
+        std::sort(rows.begin(), rows.end());
+
+        std::vector<std::pair<std::size_t, std::uint16_t>> values;
+        for (auto i : rows) {
+            auto c = static_cast<std::uint16_t>(gen() % (k < 300 ? 40 : 2048));
+            values.emplace_back(i, c);
+            expected.insert(i, c);
+        }
+
+        batched.insert_batch(values);
+        actual.insert_batch(values);
+        expect_same_matrix(expected, actual);
+        ASSERT_EQ(expected.size(), batched.size());
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQ(expected.access_and_lf(i), batched.access_and_lf(i));
+        }
+    }
+}
+
+TEST(MultiaryWaveletMatrixTest, AssignAndInsertBatchInParallel) {
+    using wide_wm_t = dict::internal::multiary_wavelet_matrix<std::uint16_t, 12>;
+
+    // more than one chunk, the last of which is partial
+    std::mt19937 gen(5);
+    std::vector<std::uint16_t> values(150001);
+    for (auto &c : values) {
+        c = static_cast<std::uint16_t>(gen() % 4096);
+    }
+
+    dict::internal::thread_pool pool(3);
+    wide_wm_t expected, actual;
+    expected.assign(values.begin(), values.end());
+    actual.assign(values.begin(), values.end(), pool);
+
+    // a large batch is merged into the levels and a small one is inserted
+    for (std::size_t k : {70000, 10}) {
+        std::vector<std::pair<std::size_t, std::uint16_t>> batch;
+        for (std::size_t i = 0; i < expected.size() + k; i += (expected.size() + k) / k) {
+            batch.emplace_back(i, static_cast<std::uint16_t>(gen() % 4096));
+        }
+
+        expected.insert_batch(batch);
+        actual.insert_batch(batch, pool);
+    }
+
+    ASSERT_EQ(expected.size(), actual.size());
+    for (std::size_t i = 0; i < expected.size(); i += 97) {
+        auto c = expected[i];
+        EXPECT_EQ(c, actual[i]);
+        EXPECT_EQ(expected.rank(i, c), actual.rank(i, c));
+        EXPECT_EQ(expected.lf(i), actual.lf(i));
+        EXPECT_EQ(expected.psi(i), actual.psi(i));
+    }
+}
@@ -0,0 +1,195 @@
+/************************************************
+ *  packed_array_test.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dict/internal/packed_array.hpp>
+
+using packed_array = dict::internal::packed_array<4>;
+using escaped_array = dict::internal::packed_array<4, dict::internal::byte_escape_coding>;
+
+template <typename Array>
+void expect_same_values(std::vector<typename Array::value_type> const &expected,
+                        Array const &actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i], actual[i]);
+    }
+}
+
+TEST(PackedArrayTest, EmptyArray) {
+    packed_array values;
+    EXPECT_EQ(0, values.size());
+    EXPECT_THROW(values.at(0), std::out_of_range);
+}
+
+TEST(PackedArrayTest, InsertValues) {
+    packed_array values;
+    std::vector<packed_array::value_type> expected;
+    for (packed_array::value_type x = 0; x < 50; ++x) {
+        // alternate between the front, the middle and the back
+        auto i = x % 3 == 0 ? 0 : x % 3 == 1 ? expected.size() / 2 : expected.size();
+        values.insert(i, x);
+        expected.insert(expected.begin() + i, x);
+    }
+
+    expect_same_values(expected, values);
+
+    values.set(7, 1000);
+    expected[7] = 1000;
+    expect_same_values(expected, values);
+}
+
+TEST(PackedArrayTest, WidenBlocks) {
+    // a block of zeros takes no bits until a wider value is stored
+    packed_array values;
+    std::vector<packed_array::value_type> expected(8, 0);
+    values.assign(expected.begin(), expected.end());
+    expect_same_values(expected, values);
+
+    for (std::size_t i : {5, 2, 7}) {
+        expected[i] = ~packed_array::value_type(0) >> i;
+        values.set(i, expected[i]);
+        expect_same_values(expected, values);
+    }
+
+    values.insert(0, 1);
+    expected.insert(expected.begin(), 1);
+    EXPECT_EQ(expected[6], values.erase(6));
+    expected.erase(expected.begin() + 6);
+    expect_same_values(expected, values);
+}
+
+TEST(PackedArrayTest, UpdateRandomly) {
+    std::mt19937 gen(17);
+    packed_array values;
+    std::vector<packed_array::value_type> expected;
+    for (std::size_t t = 0; t < 2000; ++t) {
+        if (expected.empty() || gen() % 3 != 0) {
+            auto i = gen() % (expected.size() + 1);
+            auto x = packed_array::value_type(gen()) >> (gen() % 32);
+            values.insert(i, x);
+            expected.insert(expected.begin() + i, x);
+        } else {
+            auto i = gen() % expected.size();
+            EXPECT_EQ(expected[i], values.erase(i));
+            expected.erase(expected.begin() + i);
+        }
+    }
+
+    expect_same_values(expected, values);
+
+    while (!expected.empty()) {
+        auto i = gen() % expected.size();
+        EXPECT_EQ(expected[i], values.erase(i));
+        expected.erase(expected.begin() + i);
+    }
+
+    EXPECT_EQ(0, values.size());
+}
+
+TEST(PackedArrayTest, AssignAndSave) {
+    std::vector<packed_array::value_type> expected;
+    for (packed_array::value_type x = 0; x < 30; ++x) {
+        expected.push_back(x * x);
+    }
+
+    packed_array values;
+    values.assign(expected.begin(), expected.end());
+    expect_same_values(expected, values);
+
+    values.insert(3, 7);
+    expected.insert(expected.begin() + 3, 7);
+
+    std::stringstream stream;
+    values.save(stream);
+
+    packed_array loaded;
+    loaded.load(stream);
+    expect_same_values(expected, loaded);
+}
+
+TEST(EscapedArrayTest, SetWideValues) {
+    escaped_array values;
+    std::vector<escaped_array::value_type> expected;
+    for (escaped_array::value_type x = 0; x < 20; ++x) {
+        values.insert(x, x);
+        expected.push_back(x);
+    }
+
+    // values that do not fit in a byte are escaped and kept in order
+    for (std::size_t i : {3, 1, 7, 2}) {
+        values.set(i, 1000 + i);
+        expected[i] = 1000 + i;
+    }
+
+    expect_same_values(expected, values);
+
+    values.set(1, 255).set(7, 5);
+    expected[1] = 255;
+    expected[7] = 5;
+    expect_same_values(expected, values);
+}
+
+TEST(EscapedArrayTest, UpdateRandomly) {
+    std::mt19937 gen(19);
+    escaped_array values;
+    std::vector<escaped_array::value_type> expected;
+    for (std::size_t t = 0; t < 3000; ++t) {
+        auto x = gen() % 4 == 0 ? gen() : gen() % 300;
+        if (expected.empty() || gen() % 3 != 0) {
+            auto i = gen() % (expected.size() + 1);
+            values.insert(i, x);
+            expected.insert(expected.begin() + i, x);
+        } else if (gen() % 2 == 0) {
+            auto i = gen() % expected.size();
+            values.set(i, x);
+            expected[i] = x;
+        } else {
+            auto i = gen() % expected.size();
+            EXPECT_EQ(expected[i], values.erase(i));
+            expected.erase(expected.begin() + i);
+        }
+    }
+
+    expect_same_values(expected, values);
+
+    while (!expected.empty()) {
+        auto i = gen() % expected.size();
+        EXPECT_EQ(expected[i], values.erase(i));
+        expected.erase(expected.begin() + i);
+    }
+
+    EXPECT_EQ(0, values.size());
+}
+
+TEST(EscapedArrayTest, AssignAndSave) {
+    std::vector<escaped_array::value_type> expected;
+    for (escaped_array::value_type x = 0; x < 30; ++x) {
+        expected.push_back(x * x);
+    }
+
+    escaped_array values;
+    values.assign(expected.begin(), expected.end());
+    expect_same_values(expected, values);
+
+    values.insert(3, 70000);
+    expected.insert(expected.begin() + 3, 70000);
+
+    std::stringstream stream;
+    values.save(stream);
+
+    escaped_array loaded;
+    loaded.load(stream);
+    expect_same_values(expected, loaded);
+}
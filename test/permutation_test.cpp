@@ -6,6 +6,14 @@
  *  Distributed under The BSD 3-Clause License
  ************************************************/
 
+#include <cstdint>
+
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <dict/internal/permutation.hpp>
@@ -104,3 +112,109 @@ TEST(PermutationTest, Move) {
     EXPECT_EQ(5, pi.rank(4));
     EXPECT_EQ(0, pi.rank(5));
 }
+
+TEST(PermutationTest, UpdateRandomly) {
+    std::mt19937 gen(0);
+    std::vector<std::size_t> expected;
+    permutation pi;
+    for (std::size_t t = 0; t < 3000; ++t) {
+        auto n = expected.size();
+        auto op = (n < 2) ? 0 : gen() % 3;
+        if (op == 0) {
+            auto i = gen() % (n + 1), j = gen() % (n + 1);
+            for (auto &x : expected) {
+                if (x >= j) { ++x; }
+            }
+
+            expected.insert(expected.begin() + i, j);
+            pi.insert(i, j);
+        } else if (op == 1) {
+            auto i = gen() % n, j = expected[i];
+            expected.erase(expected.begin() + i);
+            for (auto &x : expected) {
+                if (x > j) { --x; }
+            }
+
+            pi.erase(i);
+        } else {
+            auto from = gen() % n, to = gen() % n, j = expected[from];
+            expected.erase(expected.begin() + from);
+            expected.insert(expected.begin() + to, j);
+            pi.move(from, to);
+        }
+    }
+
+    ASSERT_EQ(expected.size(), pi.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i], pi[i]);
+        EXPECT_EQ(i, pi.rank(expected[i]));
+    }
+}
+
+TEST(PermutationTest, Copy) {
+    permutation pi;
+    construct_permutation(pi);
+
+    permutation copy(pi);
+    copy.erase(1);
+    copy.move(0, 3);
+    copy.insert(4, 0);
+
+    // [5]  2   3   0   1   4
+    std::vector<std::size_t> expected = {5, 2, 3, 0, 1, 4};
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i], pi[i]);
+        EXPECT_EQ(i, pi.rank(expected[i]));
+    }
+
+    //  3   1   2   5  [0]  4
+    expected = {3, 1, 2, 5, 0, 4};
+    ASSERT_EQ(expected.size(), copy.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i], copy[i]);
+        EXPECT_EQ(i, copy.rank(expected[i]));
+    }
+
+    copy = pi;
+    ASSERT_EQ(pi.size(), copy.size());
+    for (std::size_t i = 0; i < pi.size(); ++i) {
+        EXPECT_EQ(pi[i], copy[i]);
+        EXPECT_EQ(i, copy.rank(pi[i]));
+    }
+}
+
+TEST(PermutationTest, SwapAndLoad) {
+    permutation pi, other;
+    construct_permutation(pi);
+    other.insert(0, 0);
+
+    // the swapped and moved permutations remain updatable through their links
+    pi.swap(other);
+    permutation moved(std::move(other));
+    other = std::move(moved);
+    other.erase(1);
+    other.move(0, 3);
+    other.insert(4, 0);
+    ASSERT_EQ(1, pi.size());
+    EXPECT_EQ(0, pi[0]);
+
+    std::stringstream ss;
+    other.save(ss);
+
+    permutation loaded;
+    loaded.load(ss);
+
+    //  3   1   2   5  [0]  4
+    std::vector<std::size_t> expected = {3, 1, 2, 5, 0, 4};
+    ASSERT_EQ(expected.size(), loaded.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i], loaded[i]);
+        EXPECT_EQ(i, loaded.rank(expected[i]));
+    }
+
+    // a corrupt size is reported before anything is allocated for it
+    std::stringstream corrupt;
+    corrupt.write("\xff\xff\xff\xff\xff\xff\xff\x7f", sizeof(std::uint64_t));
+    EXPECT_THROW(loaded.load(corrupt), std::runtime_error);
+    EXPECT_EQ(expected.size(), loaded.size());
+}
@@ -6,8 +6,13 @@
  *  Distributed under The BSD 3-Clause License
  ************************************************/
 
+#include <iterator>
+#include <memory>
+#include <numeric>
 #include <sstream>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -238,3 +243,234 @@ TEST(RBTreeTest, EraseInShuffleOrder) {
     EXPECT_EQ(tree.end(), tree.begin());
     EXPECT_EQ(tree.end(), tree.begin());
 }
+
+TEST(RBTreeTest, AssignValues) {
+    for (std::size_t n = 0; n <= 20; ++n) {
+        std::ostringstream ss;
+        ss << "n = " << n;
+        SCOPED_TRACE(ss.str());
+
+        std::vector<int> values(n);
+        std::iota(values.begin(), values.end(), 0);
+
+        std::size_t num_visited = 0;
+        rbtree tree;
+        tree.assign(values.begin(), values.end(), [&num_visited](rbtree::iterator) {
+            ++num_visited;
+        });
+
+        EXPECT_EQ(n, num_visited);
+        EXPECT_EQ(n, tree.size());
+        check_rbtree_property(tree);
+
+        auto it = tree.begin();
+        for (auto v : values) {
+            EXPECT_EQ(v, *it++);
+        }
+
+        EXPECT_EQ(tree.end(), it);
+
+        // the tree must remain balanced after further insertions
+        INSERT_CHECK(tree, tree.begin(), it, -1);
+        INSERT_CHECK(tree, tree.end(), it, static_cast<int>(n));
+    }
+}
+
+TEST(RBTreeTest, CopyTree) {
+    rbtree tree;
+    for (int i = 0; i < 50; ++i) {
+        // insert in shuffled order, so that the tree has been rotated
+        auto it = tree.begin();
+        std::advance(it, (i * 7) % (i + 1));
+        tree.insert_before(it, i);
+    }
+
+    std::vector<int> values(tree.begin(), tree.end());
+
+    rbtree copy(tree);
+    EXPECT_EQ(tree.size(), copy.size());
+    check_rbtree_property(copy);
+    EXPECT_EQ(values, std::vector<int>(copy.begin(), copy.end()));
+
+    // nodes are linked to their parents within the copy
+    std::vector<int> reversed;
+    for (auto it = copy.end(); it != copy.begin(); ) {
+        reversed.push_back(*--it);
+    }
+
+    EXPECT_EQ(values, std::vector<int>(reversed.rbegin(), reversed.rend()));
+
+    // the copy is independent of the original tree
+    copy.erase(copy.begin());
+    copy.insert_before(copy.end(), 100);
+    check_rbtree_property(copy);
+    EXPECT_EQ(values, std::vector<int>(tree.begin(), tree.end()));
+
+    copy = tree;
+    check_rbtree_property(copy);
+    EXPECT_EQ(values, std::vector<int>(copy.begin(), copy.end()));
+
+    copy = rbtree();
+    EXPECT_EQ(0, copy.size());
+    EXPECT_EQ(copy.end(), copy.begin());
+}
+
+template <typename T>
+struct counting_allocator {
+    using value_type = T;
+
+    explicit counting_allocator(std::size_t *num_bytes) : num_bytes(num_bytes) {
+        // do nothing
+    }
+
+    template <typename U>
+    counting_allocator(counting_allocator<U> const &other)  // NOLINT(runtime/explicit)
+        : num_bytes(other.num_bytes) {
+        // do nothing
+    }
+
+    T *allocate(std::size_t n) {
+        *num_bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) {
+        *num_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    std::size_t *num_bytes;
+};  // struct counting_allocator<T>
+
+template <typename T, typename U>
+bool operator==(counting_allocator<T> const &lhs, counting_allocator<U> const &rhs) {
+    return lhs.num_bytes == rhs.num_bytes;
+}
+
+template <typename T, typename U>
+bool operator!=(counting_allocator<T> const &lhs, counting_allocator<U> const &rhs) {
+    return !(lhs == rhs);
+}
+
+// copies of a container allocate from a counter of their own, and an
+// assigned container takes the allocator of the other one
+template <typename T>
+struct forking_allocator : counting_allocator<T> {
+    using propagate_on_container_copy_assignment = std::true_type;
+
+    forking_allocator(std::size_t *num_bytes, std::size_t *num_copied_bytes)
+        : counting_allocator<T>(num_bytes), num_copied_bytes(num_copied_bytes) {
+        // do nothing
+    }
+
+    template <typename U>
+    forking_allocator(forking_allocator<U> const &other)  // NOLINT(runtime/explicit)
+        : counting_allocator<T>(other), num_copied_bytes(other.num_copied_bytes) {
+        // do nothing
+    }
+
+    forking_allocator select_on_container_copy_construction() const {
+        return forking_allocator(num_copied_bytes, num_copied_bytes);
+    }
+
+    std::size_t *num_copied_bytes;
+};  // struct forking_allocator<T>
+
+struct generic_noop {
+    template <typename Iterator>
+    void operator()(Iterator) const
+        { /* do nothing */ }
+};  // struct generic_noop
+
+TEST(RBTreeTest, ReleaseNodesToAllocator) {
+    using counted_rbtree = dict::internal::rbtree<int, generic_noop, counting_allocator<int>>;
+
+    std::size_t num_bytes = 0;
+    {
+        counting_allocator<int> alloc(&num_bytes);
+        counted_rbtree tree(alloc);
+        std::vector<counted_rbtree::iterator> its;
+        for (int i = 0; i < 100; ++i) {
+            its.push_back(tree.insert_before(tree.end(), i));
+        }
+
+        EXPECT_LT(0, num_bytes);
+
+        // the pool is released once the tree becomes empty
+        for (auto it : its) {
+            tree.erase(it);
+        }
+
+        EXPECT_EQ(0, tree.size());
+        EXPECT_EQ(0, num_bytes);
+
+        tree.insert_before(tree.end(), 0);
+        EXPECT_LT(0, num_bytes);
+    }
+
+    EXPECT_EQ(0, num_bytes);
+}
+
+TEST(RBTreeTest, CopyAllocatorPerAllocatorTraits) {
+    using forked_rbtree = dict::internal::rbtree<int, generic_noop, forking_allocator<int>>;
+
+    std::size_t num_bytes = 0, num_copied_bytes = 0, num_other_bytes = 0;
+    forked_rbtree tree(forking_allocator<int>(&num_bytes, &num_copied_bytes));
+    for (int i = 0; i < 10; ++i) {
+        tree.insert_before(tree.end(), i);
+    }
+
+    auto original_num_bytes = num_bytes;
+    {
+        forked_rbtree copy(tree);
+        EXPECT_EQ(&num_copied_bytes, copy.get_allocator().num_bytes);
+        EXPECT_LT(0, num_copied_bytes);
+        EXPECT_EQ(original_num_bytes, num_bytes);
+    }
+
+    EXPECT_EQ(0, num_copied_bytes);
+
+    forked_rbtree other(forking_allocator<int>(&num_other_bytes, &num_other_bytes));
+    other.insert_before(other.end(), 0);
+    EXPECT_LT(0, num_other_bytes);
+
+    other = tree;
+    EXPECT_EQ(&num_bytes, other.get_allocator().num_bytes);
+    EXPECT_EQ(0, num_other_bytes);
+    EXPECT_LT(original_num_bytes, num_bytes);
+    EXPECT_EQ(std::vector<int>(tree.begin(), tree.end()),
+              std::vector<int>(other.begin(), other.end()));
+}
+
+TEST(RBTreeTest, MoveTakesOverNodes) {
+    using counted_rbtree = dict::internal::rbtree<int, generic_noop, counting_allocator<int>>;
+    static_assert(std::is_nothrow_move_constructible<counted_rbtree>::value,
+                  "moving a tree must not throw");
+
+    std::size_t num_bytes = 0, num_other_bytes = 0;
+    counting_allocator<int> alloc(&num_bytes), other_alloc(&num_other_bytes);
+    counted_rbtree tree(alloc);
+    for (int i = 0; i < 10; ++i) {
+        tree.insert_before(tree.end(), i);
+    }
+
+    std::vector<int> values(tree.begin(), tree.end());
+    auto original_num_bytes = num_bytes;
+
+    counted_rbtree moved(std::move(tree));
+    EXPECT_EQ(original_num_bytes, num_bytes);
+    EXPECT_EQ(values, std::vector<int>(moved.begin(), moved.end()));
+    EXPECT_EQ(0, tree.size());
+
+    tree = std::move(moved);
+    EXPECT_EQ(original_num_bytes, num_bytes);
+    EXPECT_EQ(values, std::vector<int>(tree.begin(), tree.end()));
+    EXPECT_EQ(0, moved.size());
+
+    // nodes of an unequal allocator that does not propagate are copied
+    counted_rbtree other(other_alloc);
+    other = std::move(tree);
+    EXPECT_EQ(&num_other_bytes, other.get_allocator().num_bytes);
+    EXPECT_LT(0, num_other_bytes);
+    EXPECT_EQ(values, std::vector<int>(other.begin(), other.end()));
+}
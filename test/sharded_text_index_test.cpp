@@ -0,0 +1,156 @@
+/************************************************
+ *  sharded_text_index_test.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dict/sharded_text_index.hpp>
+#include <dict/text_index.hpp>
+#include <dict/with_csa.hpp>
+
+using text_index = dict::text_index<dict::with_csa>;
+using sharded_text_index = dict::sharded_text_index<dict::with_csa>;
+using terms = std::vector<text_index::term_type>;
+using occurrence = std::pair<text_index::size_type, text_index::size_type>;
+
+std::vector<terms> make_sequences(std::size_t n) {
+    std::vector<terms> seqs;
+    for (std::size_t k = 0; k < n; ++k) {
+        terms s;
+        for (std::size_t i = 0; i <= k % 9; ++i) {
+            s.push_back((k * 5 + i * i) % 4 + 1);
+        }
+
+        seqs.push_back(s);
+    }
+
+    return seqs;
+}
+
+std::vector<terms> extract_all(sharded_text_index const &ti) {
+    // each sequence has exactly one terminator, which is located at its end
+    std::vector<occurrence> ends;
+    ti.locate(terms{0}, std::back_inserter(ends));
+
+    std::vector<terms> seqs;
+    for (auto const &p : ends) {
+        terms s;
+        ti.extract(p.first, 0, p.second, std::back_inserter(s));
+        EXPECT_EQ(p.second, s.size());
+        seqs.push_back(s);
+    }
+
+    std::sort(seqs.begin(), seqs.end());
+    return seqs;
+}
+
+void expect_same_index(text_index const &expected, sharded_text_index const &actual) {
+    EXPECT_EQ(expected.num_seqs(), actual.num_seqs());
+    EXPECT_EQ(expected.num_terms(), actual.num_terms());
+
+    std::vector<terms> patterns = {{}, {0}, {1}, {2, 1}, {1, 3}, {4, 4}, {1, 2, 3}, {3, 0}};
+    for (auto const &p : patterns) {
+        EXPECT_EQ(expected.count(p), actual.count(p));
+
+        std::vector<occurrence> occs;
+        actual.locate(p, std::back_inserter(occs));
+        EXPECT_EQ(expected.count(p), occs.size());
+
+        if (!p.empty() && p.back() != 0) {
+            for (auto const &occ : occs) {
+                terms s;
+                actual.extract(occ.first, occ.second, p.size(), std::back_inserter(s));
+                EXPECT_EQ(p, s);
+            }
+        }
+    }
+}
+
+TEST(ShardedTextIndexTest, InsertSequences) {
+    auto seqs = make_sequences(40);
+
+    text_index expected;
+    sharded_text_index actual(3, 2);
+    EXPECT_EQ(3, actual.num_shards());
+    EXPECT_TRUE(actual.empty());
+
+    for (std::size_t k = 0; k < 10; ++k) {
+        expected.insert(seqs[k]);
+        actual.insert(seqs[k]);
+    }
+
+    std::vector<terms> batch(seqs.begin() + 10, seqs.end());
+    expected.insert_batch(batch);
+    actual.insert_batch(batch);
+
+    // sequences are spread evenly over the shards
+    for (std::size_t k = 0; k < actual.num_shards(); ++k) {
+        EXPECT_LE(13, actual.shard(k).num_seqs());
+    }
+
+    expect_same_index(expected, actual);
+
+    std::sort(seqs.begin(), seqs.end());
+    EXPECT_EQ(seqs, extract_all(actual));
+}
+
+TEST(ShardedTextIndexTest, EraseSequences) {
+    auto seqs = make_sequences(30);
+
+    sharded_text_index actual(4);
+    actual.insert_batch(seqs);
+
+    for (std::size_t t = 0; t < 10; ++t) {
+        std::vector<occurrence> ends;
+        actual.locate(terms{0}, std::back_inserter(ends));
+
+        auto const &p = ends[(t * 7) % ends.size()];
+        terms s;
+        actual.extract(p.first, 0, p.second, std::back_inserter(s));
+        actual.erase(p.first);
+
+        seqs.erase(std::find(seqs.begin(), seqs.end(), s));
+    }
+
+    text_index expected;
+    expected.insert_batch(seqs);
+    expect_same_index(expected, actual);
+
+    std::sort(seqs.begin(), seqs.end());
+    EXPECT_EQ(seqs, extract_all(actual));
+}
+
+TEST(ShardedTextIndexTest, SaveAndLoad) {
+    auto seqs = make_sequences(20);
+
+    sharded_text_index ti(3);
+    ti.insert_batch(seqs);
+
+    std::stringstream ss;
+    ti.save(ss);
+
+    sharded_text_index loaded(1);
+    loaded.load(ss);
+    EXPECT_EQ(3, loaded.num_shards());
+
+    text_index expected;
+    expected.insert_batch(seqs);
+    expect_same_index(expected, loaded);
+
+    // sequences keep being spread from the shard where they stopped
+    ti.insert(terms{1, 2});
+    loaded.insert(terms{1, 2});
+    for (std::size_t k = 0; k < ti.num_shards(); ++k) {
+        EXPECT_EQ(ti.shard(k).num_seqs(), loaded.shard(k).num_seqs());
+    }
+}
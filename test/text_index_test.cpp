@@ -6,17 +6,31 @@
  *  Distributed under The BSD 3-Clause License
  ************************************************/
 
+#include <cstdint>
+
+#include <algorithm>
 #include <initializer_list>
 #include <iterator>
+#include <memory>
+#include <random>
 #include <sstream>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <dict/internal/bit_vector.hpp>
+#include <dict/internal/huffman_wavelet_matrix.hpp>
+#include <dict/internal/multiary_wavelet_matrix.hpp>
+#include <dict/internal/thread_pool.hpp>
+#include <dict/internal/wavelet_matrix.hpp>
 #include <dict/text_index.hpp>
 #include <dict/with_csa.hpp>
 #include <dict/with_lcp.hpp>
+#include <dict/with_plcp.hpp>
+#include <dict/with_text_order_csa.hpp>
 
 using text_index = dict::text_index<
     dict::with_csa,
@@ -286,3 +300,841 @@ TEST(SuffixArrayTest, EraseAllSequences) {
         {},   // terms
         {});  // lcpa
 }
+
+TEST(SuffixArrayTest, CountPatterns) {
+    text_index ti;
+    EXPECT_EQ(0, ti.count(std::vector<text_index::term_type>({1})));
+
+    insert(ti, {1, 3, 2});
+    insert(ti, {2, 1});
+    insert(ti, {2, 1, 3});
+
+    using pattern = std::vector<text_index::term_type>;
+    EXPECT_EQ(11, ti.count(pattern({})));
+    EXPECT_EQ(3, ti.count(pattern({1})));
+    EXPECT_EQ(2, ti.count(pattern({2, 1})));
+    EXPECT_EQ(2, ti.count(pattern({1, 3})));
+    EXPECT_EQ(1, ti.count(pattern({2, 1, 3})));
+    EXPECT_EQ(0, ti.count(pattern({3, 3})));
+    EXPECT_EQ(0, ti.count(pattern({4})));
+
+    EXPECT_EQ(3, ti.count(pattern({0})));
+    EXPECT_EQ(1, ti.count(pattern({1, 0})));
+    EXPECT_EQ(1, ti.count(pattern({0, 1})));
+    EXPECT_EQ(1, ti.count(pattern({0, 2})));
+    EXPECT_EQ(1, ti.count(pattern({1, 3, 0, 2, 1})));
+    EXPECT_EQ(0, ti.count(pattern({3, 2, 0, 2, 1})));
+
+    auto range = ti.equal_range(pattern({2, 1}));
+    EXPECT_EQ(2, range.second - range.first);
+    for (auto i = range.first; i < range.second; ++i) {
+        EXPECT_EQ(2, ti.f(i));
+        EXPECT_EQ(1, ti.term(ti.at(i) + 1));
+    }
+}
+
+TEST(SuffixArrayTest, LocatePatterns) {
+    text_index ti;
+    insert(ti, {1, 3, 2});
+    insert(ti, {2, 1});
+    insert(ti, {2, 1, 3});
+
+    using pattern = std::vector<text_index::term_type>;
+    using occurrences = std::vector<std::pair<text_index::size_type, text_index::size_type>>;
+
+    occurrences occs;
+    ti.locate(pattern({2, 1}), std::back_inserter(occs));
+    EXPECT_THAT(occs, testing::ContainerEq(occurrences({{1, 0}, {2, 0}})));
+
+    occs.clear();
+    ti.locate(pattern({1}), std::back_inserter(occs));
+    EXPECT_THAT(occs, testing::ContainerEq(occurrences({{1, 1}, {2, 1}, {0, 0}})));
+
+    occs.clear();
+    ti.locate(pattern({3, 0}), std::back_inserter(occs));
+    EXPECT_THAT(occs, testing::ContainerEq(occurrences({{2, 2}})));
+
+    occs.clear();
+    ti.locate(pattern({3, 3}), std::back_inserter(occs));
+    EXPECT_TRUE(occs.empty());
+
+    ti.erase(2);
+
+    occs.clear();
+    ti.locate(pattern({2, 1}), std::back_inserter(occs));
+    EXPECT_THAT(occs, testing::ContainerEq(occurrences({{1, 0}})));
+}
+
+TEST(SuffixArrayTest, ExtractSubsequences) {
+    text_index ti;
+    insert(ti, {1, 3, 2});
+    insert(ti, {2, 1});
+    insert(ti, {2, 1, 3});
+
+    using terms = std::vector<text_index::term_type>;
+
+    terms s;
+    ti.extract(0, 0, 3, std::back_inserter(s));
+    EXPECT_THAT(s, testing::ContainerEq(terms({1, 3, 2})));
+
+    s.clear();
+    ti.extract(2, 1, 5, std::back_inserter(s));
+    EXPECT_THAT(s, testing::ContainerEq(terms({1, 3})));
+
+    s.clear();
+    ti.extract(1, 2, 1, std::back_inserter(s));
+    EXPECT_TRUE(s.empty());
+
+    // a sequence long enough to be sampled several times
+    terms long_seq;
+    for (std::size_t i = 0; i < 250; ++i) {
+        long_seq.push_back(i % 7 + 1);
+    }
+
+    ti.insert(long_seq);
+    auto k = ti.rank(250);
+    for (std::size_t from = 0; from < 250; from += 37) {
+        s.clear();
+        ti.extract(k, from, 40, std::back_inserter(s));
+
+        auto last = std::min<std::size_t>(from + 40, 250);
+        auto expected = terms(long_seq.begin() + from, long_seq.begin() + last);
+        EXPECT_THAT(s, testing::ContainerEq(expected));
+    }
+}
+
+void expect_same_index(text_index const &expected, text_index const &actual) {
+    ASSERT_EQ(expected.num_seqs(), actual.num_seqs());
+    ASSERT_EQ(expected.num_terms(), actual.num_terms());
+
+    for (text_index::size_type i = 0; i < expected.num_terms(); i++) {
+        std::ostringstream ss;
+        ss << "i = " << i;
+        SCOPED_TRACE(ss.str());
+
+        EXPECT_EQ(expected.f(i),     actual.f(i));
+        EXPECT_EQ(expected.bwt(i),   actual.bwt(i));
+        EXPECT_EQ(expected.psi(i),   actual.psi(i));
+        EXPECT_EQ(expected.lf(i),    actual.lf(i));
+        EXPECT_EQ(expected.at(i),    actual.at(i));
+        EXPECT_EQ(expected.rank(i),  actual.rank(i));
+        EXPECT_EQ(expected.term(i),  actual.term(i));
+        EXPECT_EQ(expected.lcp(i),   actual.lcp(i));
+    }
+}
+
+TEST(SuffixArrayTest, BuildFromSequences) {
+    using terms = std::vector<text_index::term_type>;
+    std::vector<terms> seqs = {{1, 3, 2}, {}, {2, 1}, {2, 1, 3}};
+
+    // long enough to be sampled several times
+    terms long_seq;
+    for (std::size_t i = 0; i < 250; ++i) {
+        long_seq.push_back(i % 7 + 1);
+    }
+
+    seqs.push_back(long_seq);
+
+    text_index expected, actual;
+    for (auto const &s : seqs) {
+        expected.insert(s);
+    }
+
+    actual.build(seqs.begin(), seqs.end());
+    expect_same_index(expected, actual);
+
+    // the index remains dynamic after building
+    insert(expected, {3, 2, 1});
+    insert(actual, {3, 2, 1});
+    expect_same_index(expected, actual);
+
+    expected.erase(1);
+    actual.erase(1);
+    expect_same_index(expected, actual);
+}
+
+TEST(SuffixArrayTest, ResampleIndex) {
+    using terms = std::vector<text_index::term_type>;
+    std::vector<terms> seqs = {{1, 3, 2}, {2, 1}};
+    for (std::size_t k = 0; k < 3; ++k) {
+        seqs.emplace_back();
+        for (std::size_t i = 0; i < 300; ++i) {
+            seqs.back().push_back((i * (k + 2)) % 11 + 1);
+        }
+    }
+
+    text_index expected, actual;
+    actual.resample(8);
+    for (auto const &s : seqs) {
+        expected.insert(s);
+        actual.insert(s);
+    }
+
+    EXPECT_EQ(100, expected.sample_distance());
+    EXPECT_EQ(8, actual.sample_distance());
+    expect_same_index(expected, actual);
+
+    for (text_index::size_type distance : {1, 512, 8}) {
+        actual.resample(distance);
+        EXPECT_EQ(distance, actual.sample_distance());
+        expect_same_index(expected, actual);
+    }
+
+    // locate one region often, so that it is sampled more densely
+    actual.resample(64, 4);
+    using occurrences = std::vector<std::pair<text_index::size_type, text_index::size_type>>;
+    for (std::size_t t = 0; t < 10; ++t) {
+        occurrences occs;
+        actual.locate(terms{1, 3, 2}, std::back_inserter(occs));
+    }
+
+    actual.resample(64, 4);
+    EXPECT_EQ(64, actual.sample_distance());
+    expect_same_index(expected, actual);
+
+    insert(expected, {3, 2, 1});
+    insert(actual, {3, 2, 1});
+    expected.erase(2);
+    actual.erase(2);
+    expect_same_index(expected, actual);
+
+    std::stringstream stream;
+    actual.save(stream);
+
+    text_index loaded;
+    loaded.load(stream);
+    EXPECT_EQ(64, loaded.sample_distance());
+    expect_same_index(expected, loaded);
+
+    EXPECT_THROW(actual.resample(0), std::invalid_argument);
+}
+
+TEST(SuffixArrayTest, ResampleCountsOnlyLocates) {
+    using terms = std::vector<text_index::term_type>;
+    text_index expected, actual;
+    for (std::size_t k = 0; k < 3; ++k) {
+        terms seq;
+        for (std::size_t i = 0; i < 300; ++i) {
+            seq.push_back((i * (k + 2)) % 11 + 1);
+        }
+
+        expected.insert(seq);
+        actual.insert(seq);
+    }
+
+    expected.resample(64, 4);
+    actual.resample(64, 4);
+
+    // a copy counts its locates on its own; locating every term makes all
+    // regions hot
+    auto copy = actual;
+    using occurrences = std::vector<std::pair<text_index::size_type, text_index::size_type>>;
+    for (text_index::term_type c = 1; c <= 11; ++c) {
+        occurrences occs;
+        copy.locate(terms{c}, std::back_inserter(occs));
+    }
+
+    // neither at() nor rank() is counted
+    for (text_index::size_type i = 0; i < actual.num_terms(); ++i) {
+        actual.rank(actual.at(i));
+    }
+
+    expected.resample(64, 4);
+    actual.resample(64, 4);
+    copy.resample(64, 4);
+    expect_same_index(expected, copy);
+
+    std::stringstream expected_ss, actual_ss, copy_ss;
+    expected.save(expected_ss);
+    actual.save(actual_ss);
+    copy.save(copy_ss);
+    EXPECT_EQ(expected_ss.str(), actual_ss.str());
+    EXPECT_NE(expected_ss.str(), copy_ss.str());
+}
+
+TEST(SuffixArrayTest, InsertBatch) {
+    using terms = std::vector<text_index::term_type>;
+    std::vector<terms> seqs = {{1, 3, 2}, {2, 1}, {2, 1, 3}};
+
+    text_index expected, actual;
+    for (auto const &s : seqs) {
+        expected.insert(s);
+    }
+
+    actual.insert_batch(seqs);
+    expect_same_index(expected, actual);
+
+    // a small batch is merged into the index
+    std::vector<terms> small_batch = {{3, 3}, {}, {1}};
+    for (auto const &s : small_batch) {
+        expected.insert(s);
+    }
+
+    actual.insert_batch(small_batch);
+    expect_same_index(expected, actual);
+
+    // a large batch rebuilds the whole index
+    std::vector<terms> large_batch = {{2, 2, 2, 1}, {1, 3, 1, 3, 1}, {3, 2, 1, 2, 3, 3}};
+    for (auto const &s : large_batch) {
+        expected.insert(s);
+    }
+
+    actual.insert_batch(large_batch);
+    expect_same_index(expected, actual);
+
+    expected.erase(2);
+    actual.erase(2);
+    expect_same_index(expected, actual);
+}
+
+TEST(SuffixArrayTest, InsertBatchesRandomly) {
+    using huffman_text_index = dict::basic_text_index<
+        dict::internal::text_index_trait<
+            text_index::term_type,
+            dict::internal::huffman_wavelet_matrix<text_index::term_type>
+        >,
+        dict::with_csa,
+        dict::with_lcp<>::policy
+    >;
+
+    using terms = std::vector<text_index::term_type>;
+    std::mt19937 gen(0);
+    text_index expected, actual;
+    huffman_text_index huffman;
+    actual.resample(3);
+    huffman.resample(5);
+    for (std::size_t t = 0; t < 40; ++t) {
+        // batches much smaller than the index, with terms not seen before
+        std::vector<terms> batch(1 + gen() % 4);
+        for (auto &s : batch) {
+            s.resize(gen() % 12);
+            for (auto &c : s) {
+                c = gen() % 8 == 0 ? 5 + t % 7 : 1 + gen() % 3;
+            }
+        }
+
+        for (auto const &s : batch) {
+            expected.insert(s);
+        }
+
+        actual.insert_batch(batch);
+        huffman.insert_batch(batch);
+        if (t % 5 == 0) {
+            auto k = gen() % expected.num_seqs();
+            expected.erase(k);
+            actual.erase(k);
+            huffman.erase(k);
+        }
+
+        expect_same_index(expected, actual);
+        if (HasFatalFailure()) { return; }
+
+        ASSERT_EQ(expected.num_terms(), huffman.num_terms());
+        for (text_index::size_type i = 0; i < expected.num_terms(); i++) {
+            ASSERT_EQ(expected.bwt(i),  huffman.bwt(i));
+            ASSERT_EQ(expected.at(i),   huffman.at(i));
+            ASSERT_EQ(expected.rank(i), huffman.rank(i));
+            ASSERT_EQ(expected.lcp(i),  huffman.lcp(i));
+        }
+    }
+}
+
+TEST(SuffixArrayTest, BuildAndInsertBatchInParallel) {
+    using terms = std::vector<text_index::term_type>;
+    std::mt19937 gen(2);
+    auto random_seqs = [&gen](std::size_t num_seqs) {
+        std::vector<terms> seqs(num_seqs);
+        for (auto &s : seqs) {
+            s.resize(1 + gen() % 40);
+            for (auto &c : s) {
+                c = 1 + gen() % 20;
+            }
+        }
+
+        return seqs;
+    };
+
+    // more terms than fit in a chunk of the levels
+    auto seqs = random_seqs(4000);
+    auto batch = random_seqs(300);
+
+    dict::internal::thread_pool pool(3);
+    text_index expected, actual;
+    expected.build(seqs.begin(), seqs.end());
+    actual.build(seqs.begin(), seqs.end(), pool);
+    expected.insert_batch(batch);
+    actual.insert_batch(batch, pool);
+
+    ASSERT_EQ(expected.num_seqs(), actual.num_seqs());
+    ASSERT_EQ(expected.num_terms(), actual.num_terms());
+    for (text_index::size_type i = 0; i < expected.num_terms(); i += 101) {
+        ASSERT_EQ(expected.bwt(i),  actual.bwt(i));
+        ASSERT_EQ(expected.psi(i),  actual.psi(i));
+        ASSERT_EQ(expected.at(i),   actual.at(i));
+        ASSERT_EQ(expected.rank(i), actual.rank(i));
+        ASSERT_EQ(expected.lcp(i),  actual.lcp(i));
+    }
+}
+
+TEST(SuffixArrayTest, SaveAndLoad) {
+    text_index expected;
+    insert(expected, {1, 3, 2});
+    insert(expected, {2, 1});
+    insert(expected, {2, 1, 3});
+
+    std::stringstream ss;
+    expected.save(ss);
+
+    text_index actual;
+    actual.load(ss);
+    expect_same_index(expected, actual);
+
+    // the loaded index remains dynamic
+    insert(expected, {3, 2, 1});
+    insert(actual, {3, 2, 1});
+    expect_same_index(expected, actual);
+
+    expected.erase(2);
+    actual.erase(2);
+    expect_same_index(expected, actual);
+
+    std::ostringstream out;
+    actual.save(out);
+    auto data = out.str();
+
+    // a failed load leaves the index as it was
+    std::istringstream truncated(data.substr(0, data.size() / 2));
+    EXPECT_THROW(expected.load(truncated), std::runtime_error);
+    expect_same_index(actual, expected);
+}
+
+TEST(SuffixArrayTest, Move) {
+    static_assert(std::is_nothrow_move_constructible<text_index>::value,
+                  "moving an index must not copy it");
+
+    text_index expected;
+    insert(expected, {1, 3, 2});
+    insert(expected, {2, 1});
+
+    text_index source(expected);
+    text_index moved(std::move(source));
+    expect_same_index(expected, moved);
+
+    source = std::move(moved);
+    insert(expected, {2, 1, 3});
+    insert(source, {2, 1, 3});
+    expect_same_index(expected, source);
+}
+
+TEST(SuffixArrayTest, RejectMismatchedSaves) {
+    text_index ti;
+    insert(ti, {1, 3, 2});
+    insert(ti, {2, 1});
+
+    std::ostringstream out;
+    ti.save(out);
+    auto data = out.str();
+
+    // the header holds the magic, the version, the term width and a tag of
+    // the policies, in words
+    for (std::size_t k = 0; k < 4; ++k) {
+        auto corrupt = data;
+        corrupt[k * sizeof(std::uint64_t)] ^= 1;
+
+        std::istringstream in(corrupt);
+        text_index loaded;
+        EXPECT_THROW(loaded.load(in), std::runtime_error);
+    }
+
+    using csa_only_index = dict::text_index<dict::with_csa>;
+    using plcp_index = dict::text_index<dict::with_csa, dict::with_plcp>;
+    using swapped_index = dict::text_index<dict::with_lcp<>::policy, dict::with_csa>;
+    using wide_text_index = dict::basic_text_index<
+        dict::internal::text_index_trait<std::uint32_t>,
+        dict::with_csa,
+        dict::with_lcp<>::policy
+    >;
+
+    std::istringstream in1(data), in2(data), in3(data), in4(data);
+    csa_only_index csa_only;
+    plcp_index plcp;
+    swapped_index swapped;
+    wide_text_index wide;
+    EXPECT_THROW(csa_only.load(in1), std::runtime_error);
+    EXPECT_THROW(plcp.load(in2), std::runtime_error);
+    EXPECT_THROW(swapped.load(in3), std::runtime_error);
+    EXPECT_THROW(wide.load(in4), std::runtime_error);
+}
+
+TEST(SuffixArrayTest, WideTerms) {
+    using wide_text_index = dict::basic_text_index<
+        dict::internal::text_index_trait<std::uint32_t>,
+        dict::with_csa,
+        dict::with_lcp<>::policy
+    >;
+
+    // wide terms are narrow ones shifted far apart, which keeps their order
+    auto widen = [](text_index::term_type c) -> std::uint32_t {
+        return c ? 4000000000u + c * 1000u : 0;
+    };
+
+    using terms = std::vector<text_index::term_type>;
+    std::vector<terms> seqs = {{1, 3, 2}, {2, 1}, {2, 1, 3}, {3, 3, 1, 2, 2}};
+    std::vector<std::vector<std::uint32_t>> wide_seqs;
+    for (auto const &s : seqs) {
+        wide_seqs.emplace_back();
+        std::transform(s.begin(), s.end(), std::back_inserter(wide_seqs.back()), widen);
+    }
+
+    text_index expected;
+    wide_text_index inserted, built;
+    for (std::size_t k = 0; k < seqs.size(); ++k) {
+        expected.insert(seqs[k]);
+        inserted.insert(wide_seqs[k]);
+    }
+
+    built.build(wide_seqs.begin(), wide_seqs.end());
+    for (auto const *actual : {&inserted, &built}) {
+        ASSERT_EQ(expected.num_terms(), actual->num_terms());
+        for (text_index::size_type i = 0; i < expected.num_terms(); i++) {
+            EXPECT_EQ(widen(expected.f(i)),     actual->f(i));
+            EXPECT_EQ(widen(expected.bwt(i)),   actual->bwt(i));
+            EXPECT_EQ(widen(expected.term(i)),  actual->term(i));
+            EXPECT_EQ(expected.psi(i),          actual->psi(i));
+            EXPECT_EQ(expected.lf(i),           actual->lf(i));
+            EXPECT_EQ(expected.at(i),           actual->at(i));
+            EXPECT_EQ(expected.lcp(i),          actual->lcp(i));
+        }
+
+        EXPECT_EQ(2, actual->count(std::vector<std::uint32_t>{widen(2), widen(1)}));
+    }
+}
+
+TEST(SuffixArrayTest, HuffmanShapedMatrix) {
+    using huffman_text_index = dict::basic_text_index<
+        dict::internal::text_index_trait<
+            text_index::term_type,
+            dict::internal::huffman_wavelet_matrix<text_index::term_type>
+        >,
+        dict::with_csa,
+        dict::with_lcp<>::policy
+    >;
+
+    using terms = std::vector<text_index::term_type>;
+    std::vector<terms> seqs = {{1, 1, 2}, {1, 1, 1, 3}, {2, 1, 500}, {1, 3, 1, 1, 1}};
+
+    text_index expected;
+    huffman_text_index inserted, built;
+    for (auto const &s : seqs) {
+        expected.insert(s);
+        inserted.insert(s);
+    }
+
+    built.build(seqs.begin(), seqs.end());
+    for (auto const *actual : {&inserted, &built}) {
+        ASSERT_EQ(expected.num_terms(), actual->num_terms());
+        for (text_index::size_type i = 0; i < expected.num_terms(); i++) {
+            EXPECT_EQ(expected.bwt(i),  actual->bwt(i));
+            EXPECT_EQ(expected.psi(i),  actual->psi(i));
+            EXPECT_EQ(expected.lf(i),   actual->lf(i));
+            EXPECT_EQ(expected.at(i),   actual->at(i));
+            EXPECT_EQ(expected.lcp(i),  actual->lcp(i));
+        }
+
+        EXPECT_EQ(expected.count(terms{1, 1, 1}), actual->count(terms{1, 1, 1}));
+    }
+}
+
+TEST(SuffixArrayTest, TextOrderSampling) {
+    using text_order_index = dict::text_index<
+        dict::with_text_order_csa,
+        dict::with_lcp<>::policy
+    >;
+
+    using terms = std::vector<text_index::term_type>;
+    std::vector<terms> seqs = {{1, 3, 2}, {2, 1}, {2, 1, 3}};
+    for (std::size_t k = 0; k < 3; ++k) {
+        seqs.emplace_back();
+        for (std::size_t i = 0; i < 40 + k * 30; ++i) {
+            seqs.back().push_back((i * (k + 2)) % 5 + 1);
+        }
+    }
+
+    text_index expected;
+    text_order_index inserted, built;
+    inserted.resample(4);
+    for (auto const &s : seqs) {
+        expected.insert(s);
+        inserted.insert(s);
+    }
+
+    built.build(seqs.begin(), seqs.end());
+    built.resample(4);
+
+    using occurrences = std::vector<std::pair<text_index::size_type, text_index::size_type>>;
+    auto expect_same = [&](text_order_index const &actual) {
+        ASSERT_EQ(expected.num_terms(), actual.num_terms());
+        for (text_index::size_type i = 0; i < expected.num_terms(); i++) {
+            EXPECT_EQ(expected.at(i),    actual.at(i));
+            EXPECT_EQ(expected.rank(i),  actual.rank(i));
+            EXPECT_EQ(expected.term(i),  actual.term(i));
+            EXPECT_EQ(expected.lcp(i),   actual.lcp(i));
+        }
+
+        for (auto const &s : {terms{2, 1}, terms{1, 3}, terms{3}}) {
+            occurrences expected_occs, actual_occs;
+            expected.locate(s, std::back_inserter(expected_occs));
+            actual.locate(s, std::back_inserter(actual_occs));
+            EXPECT_EQ(expected_occs, actual_occs);
+        }
+
+        for (text_index::size_type k = 0; k < expected.num_seqs(); ++k) {
+            terms expected_terms, actual_terms;
+            expected.extract(k, 1, 20, std::back_inserter(expected_terms));
+            actual.extract(k, 1, 20, std::back_inserter(actual_terms));
+            EXPECT_EQ(expected_terms, actual_terms);
+        }
+    };
+
+    expect_same(inserted);
+    expect_same(built);
+
+    // erasing sequences shortens the distances of the ones inserted later
+    for (auto *actual : {&inserted, &built}) {
+        actual->erase(3);
+        actual->erase(1);
+        actual->insert(terms{3, 2, 1});
+    }
+
+    expected.erase(3);
+    expected.erase(1);
+    insert(expected, {3, 2, 1});
+    expect_same(inserted);
+    expect_same(built);
+
+    // a batch is sampled as its sequences would be one by one
+    std::vector<terms> batch = {{2, 2, 1, 3}, {}, {3, 1, 2, 2, 1, 3, 1}, {1}};
+    for (auto const &s : batch) {
+        expected.insert(s);
+    }
+
+    for (auto *actual : {&inserted, &built}) {
+        actual->insert_batch(batch);
+    }
+
+    expect_same(inserted);
+    expect_same(built);
+
+    std::stringstream stream;
+    inserted.save(stream);
+
+    text_order_index loaded;
+    loaded.load(stream);
+    EXPECT_EQ(4, loaded.sample_distance());
+    expect_same(loaded);
+
+    loaded.resample(2);
+    expect_same(loaded);
+}
+
+TEST(SuffixArrayTest, PermutedLcp) {
+    using plcp_index = dict::text_index<
+        dict::with_csa,
+        dict::with_plcp
+    >;
+
+    using terms = std::vector<text_index::term_type>;
+    std::vector<terms> seqs = {{1, 3, 2}, {2, 1}, {2, 1, 3}, {1, 3, 2, 1, 3, 2}};
+    for (std::size_t k = 0; k < 3; ++k) {
+        seqs.emplace_back();
+        for (std::size_t i = 0; i < 30 + k * 20; ++i) {
+            seqs.back().push_back((i * (k + 2)) % 4 + 1);
+        }
+    }
+
+    text_index expected;
+    plcp_index inserted, built;
+    for (auto const &s : seqs) {
+        expected.insert(s);
+        inserted.insert(s);
+    }
+
+    built.build(seqs.begin(), seqs.end());
+
+    auto expect_same = [&](plcp_index const &actual) {
+        ASSERT_EQ(expected.num_terms(), actual.num_terms());
+        for (text_index::size_type i = 0; i < expected.num_terms(); i++) {
+            EXPECT_EQ(expected.lcp(i), actual.lcp(i));
+        }
+    };
+
+    expect_same(inserted);
+    expect_same(built);
+
+    std::vector<terms> batch = {{3, 2, 1}, {1, 3, 2, 1}};
+    expected.insert_batch(batch);
+    expected.erase(4);
+    expected.erase(0);
+    for (auto *actual : {&inserted, &built}) {
+        actual->insert_batch(batch);
+        actual->erase(4);
+        actual->erase(0);
+        expect_same(*actual);
+    }
+
+    std::stringstream stream;
+    inserted.save(stream);
+
+    plcp_index loaded;
+    loaded.load(stream);
+    expect_same(loaded);
+
+    expected.insert(terms{2, 1, 3, 2});
+    loaded.insert(terms{2, 1, 3, 2});
+    expect_same(loaded);
+}
+
+TEST(SuffixArrayTest, CopyIndex) {
+    using terms = std::vector<text_index::term_type>;
+    text_index ti;
+    ti.insert_batch(std::vector<terms>{{1, 3, 2}, {2, 1}, {2, 1, 3}, {3, 3, 1, 2}});
+
+    std::stringstream ss;
+    ti.save(ss);
+
+    // the copy is independent of the original, which is left untouched
+    auto copy = ti;
+    copy.erase(1);
+    copy.insert(terms{1, 1, 2});
+
+    text_index expected;
+    expected.load(ss);
+    ASSERT_EQ(expected.num_terms(), ti.num_terms());
+    for (text_index::size_type i = 0; i < expected.num_terms(); ++i) {
+        EXPECT_EQ(expected.bwt(i), ti.bwt(i));
+        EXPECT_EQ(expected.at(i), ti.at(i));
+        EXPECT_EQ(expected.rank(i), ti.rank(i));
+        EXPECT_EQ(expected.lcp(i), ti.lcp(i));
+    }
+
+    expected.erase(1);
+    expected.insert(terms{1, 1, 2});
+    ASSERT_EQ(expected.num_terms(), copy.num_terms());
+    for (text_index::size_type i = 0; i < expected.num_terms(); ++i) {
+        EXPECT_EQ(expected.bwt(i), copy.bwt(i));
+        EXPECT_EQ(expected.at(i), copy.at(i));
+        EXPECT_EQ(expected.rank(i), copy.rank(i));
+        EXPECT_EQ(expected.lcp(i), copy.lcp(i));
+    }
+}
+
+template <typename T>
+struct counting_allocator {
+    using value_type = T;
+
+    explicit counting_allocator(std::size_t *num_bytes) : num_bytes(num_bytes) {
+        // do nothing
+    }
+
+    template <typename U>
+    counting_allocator(counting_allocator<U> const &other)  // NOLINT(runtime/explicit)
+        : num_bytes(other.num_bytes) {
+        // do nothing
+    }
+
+    T *allocate(std::size_t n) {
+        *num_bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) {
+        *num_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    std::size_t *num_bytes;
+};  // struct counting_allocator<T>
+
+template <typename T, typename U>
+bool operator==(counting_allocator<T> const &lhs, counting_allocator<U> const &rhs) {
+    return lhs.num_bytes == rhs.num_bytes;
+}
+
+template <typename T, typename U>
+bool operator!=(counting_allocator<T> const &lhs, counting_allocator<U> const &rhs) {
+    return !(lhs == rhs);
+}
+
+template <typename TextIndex>
+void expect_allocated_from(std::size_t *num_bytes) {
+    using terms = std::vector<text_index::term_type>;
+    std::vector<terms> seqs = {{1, 3, 2}, {2, 1}, {2, 1, 3}, {3, 3, 1, 2}};
+
+    // the allocator has no default, so every structure has to be given one
+    typename TextIndex::allocator_type alloc(num_bytes);
+    {
+        text_index expected;
+        TextIndex ti(alloc);
+        for (auto const &s : seqs) {
+            expected.insert(s);
+            ti.insert(s);
+        }
+
+        ti.insert_batch(seqs);
+        expected.insert_batch(seqs);
+        EXPECT_LT(0, *num_bytes);
+
+        auto num_index_bytes = *num_bytes;
+        {
+            auto copy = ti;
+            EXPECT_EQ(num_bytes, copy.get_allocator().num_bytes);
+            EXPECT_LT(num_index_bytes, *num_bytes);
+        }
+
+        EXPECT_EQ(num_index_bytes, *num_bytes);
+        ASSERT_EQ(expected.num_terms(), ti.num_terms());
+        for (text_index::size_type i = 0; i < expected.num_terms(); ++i) {
+            EXPECT_EQ(expected.bwt(i), ti.bwt(i));
+            EXPECT_EQ(expected.at(i), ti.at(i));
+            EXPECT_EQ(expected.lcp(i), ti.lcp(i));
+        }
+    }
+
+    EXPECT_EQ(0, *num_bytes);
+}
+
+TEST(SuffixArrayTest, AllocateFromGivenAllocator) {
+    using term_type = text_index::term_type;
+    using allocator = counting_allocator<term_type>;
+    using multiary_index = dict::basic_text_index<
+        dict::internal::text_index_trait<
+            term_type,
+            dict::internal::multiary_wavelet_matrix<term_type, 16, 2, 64, allocator>
+        >,
+        dict::with_csa,
+        dict::with_lcp<>::policy
+    >;
+    using huffman_index = dict::basic_text_index<
+        dict::internal::text_index_trait<
+            term_type,
+            dict::internal::huffman_wavelet_matrix<term_type, 16, 2, 64, allocator>
+        >,
+        dict::with_text_order_csa,
+        dict::with_plcp
+    >;
+    using binary_index = dict::basic_text_index<
+        dict::internal::text_index_trait<
+            term_type,
+            dict::internal::wavelet_matrix<
+                term_type, 16, dict::internal::bit_vector<64, allocator>
+            >
+        >,
+        dict::with_csa,
+        dict::with_lcp<>::policy
+    >;
+
+    std::size_t num_bytes = 0;
+    expect_allocated_from<multiary_index>(&num_bytes);
+    expect_allocated_from<huffman_index>(&num_bytes);
+    expect_allocated_from<binary_index>(&num_bytes);
+}
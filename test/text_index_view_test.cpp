@@ -0,0 +1,151 @@
+/************************************************
+ *  text_index_view_test.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dict/text_index.hpp>
+#include <dict/text_index_view.hpp>
+#include <dict/with_csa.hpp>
+#include <dict/with_lcp.hpp>
+
+using text_index = dict::text_index<
+    dict::with_csa,
+    dict::with_lcp<>::policy
+>;
+
+void fill(text_index &ti) {  // NOLINT(runtime/references)
+    using terms = std::vector<text_index::term_type>;
+    std::vector<terms> seqs = {{1, 3, 2}, {}, {2, 1}, {2, 1, 3}};
+
+    terms long_seq;
+    for (std::size_t i = 0; i < 250; ++i) {
+        long_seq.push_back(i % 7 + 1);
+    }
+
+    seqs.push_back(long_seq);
+
+    for (auto const &s : seqs) {
+        ti.insert(s);
+    }
+
+    ti.erase(2);
+}
+
+std::vector<std::uint64_t> to_words(std::string const &s) {
+    std::vector<std::uint64_t> words(s.size() / sizeof(std::uint64_t));
+    std::memcpy(words.data(), s.data(), s.size());
+    return words;
+}
+
+void expect_same_index(text_index const &expected, dict::text_index_view const &actual) {
+    ASSERT_EQ(expected.num_seqs(), actual.num_seqs());
+    ASSERT_EQ(expected.num_terms(), actual.num_terms());
+    ASSERT_TRUE(actual.has_lcp());
+
+    for (text_index::size_type i = 0; i < expected.num_terms(); i++) {
+        std::ostringstream ss;
+        ss << "i = " << i;
+        SCOPED_TRACE(ss.str());
+
+        EXPECT_EQ(expected.f(i),     actual.f(i));
+        EXPECT_EQ(expected.bwt(i),   actual.bwt(i));
+        EXPECT_EQ(expected.psi(i),   actual.psi(i));
+        EXPECT_EQ(expected.lf(i),    actual.lf(i));
+        EXPECT_EQ(expected.at(i),    actual.at(i));
+        EXPECT_EQ(expected.rank(i),  actual.rank(i));
+        EXPECT_EQ(expected.lcp(i),   actual.lcp(i));
+    }
+}
+
+TEST(TextIndexViewTest, EmptyIndex) {
+    text_index ti;
+    std::ostringstream ss;
+    dict::text_index_view::write(ti, ss);
+
+    auto words = to_words(ss.str());
+    dict::text_index_view view(words.data(), words.size() * sizeof(std::uint64_t));
+    EXPECT_TRUE(view.empty());
+    EXPECT_EQ(0, view.num_seqs());
+}
+
+TEST(TextIndexViewTest, ViewMemory) {
+    text_index ti;
+    fill(ti);
+    for (auto d : {1, 3, 32}) {
+        std::ostringstream ss;
+        dict::text_index_view::write(ti, ss, d);
+
+        auto words = to_words(ss.str());
+        dict::text_index_view view(words.data(), words.size() * sizeof(std::uint64_t));
+        expect_same_index(ti, view);
+    }
+}
+
+TEST(TextIndexViewTest, MapFile) {
+    text_index ti;
+    fill(ti);
+    std::string path = testing::TempDir() + "text_index_view_test.bin";
+    {
+        std::ofstream os(path, std::ios::binary);
+        dict::text_index_view::write(ti, os);
+    }
+
+    dict::text_index_view view(path);
+    expect_same_index(ti, view);
+    std::remove(path.c_str());
+}
+
+TEST(TextIndexViewTest, RejectInvalidSnapshot) {
+    text_index ti;
+    fill(ti);
+    std::ostringstream ss;
+    dict::text_index_view::write(ti, ss);
+
+    auto words = to_words(ss.str());
+    EXPECT_THROW(dict::text_index_view(words.data(), words.size() * sizeof(std::uint64_t) / 2),
+                 std::runtime_error);
+
+    words[0] = 0;
+    EXPECT_THROW(dict::text_index_view(words.data(), words.size() * sizeof(std::uint64_t)),
+                 std::runtime_error);
+}
+
+TEST(TextIndexViewTest, RejectOutOfRangeRows) {
+    text_index ti;
+    fill(ti);
+    std::ostringstream ss;
+    dict::text_index_view::write(ti, ss, 4);
+
+    // the snapshot ends with the SA samples, the ISA samples and the LCP
+    // values, each preceded by its size
+    auto n = ti.num_terms();
+    auto num_isa_values = (n + 3) / 4;
+    auto last_isa_value = to_words(ss.str()).size() - (n + 1) - 1;
+    auto last_sa_value = last_isa_value - num_isa_values - 1;
+
+    // sentinel position, sentinel rank and one sample of each kind
+    for (auto k : {std::size_t(4), std::size_t(5), last_isa_value, last_sa_value}) {
+        auto words = to_words(ss.str());
+        words[k] = n + 1;
+        EXPECT_THROW(dict::text_index_view(words.data(), words.size() * sizeof(std::uint64_t)),
+                     std::runtime_error);
+    }
+
+    auto words = to_words(ss.str());
+    EXPECT_NO_THROW(dict::text_index_view(words.data(), words.size() * sizeof(std::uint64_t)));
+}
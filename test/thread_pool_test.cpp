@@ -0,0 +1,63 @@
+/************************************************
+ *  thread_pool_test.cpp
+ *  DICT
+ *
+ *  Copyright (c) 2015-2017, Chi-En Wu
+ *  Distributed under The BSD 3-Clause License
+ ************************************************/
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dict/internal/thread_pool.hpp>
+
+using dict::internal::thread_pool;
+
+TEST(ThreadPoolTest, RunTasks) {
+    for (std::size_t num_threads : {0, 1, 4}) {
+        thread_pool pool(num_threads);
+        EXPECT_EQ(num_threads, pool.size());
+
+        std::vector<int> values(100, 0);
+        pool.run(values.size(), [&values](std::size_t k) {
+            values[k] = static_cast<int>(k) + 1;
+        });
+
+        for (std::size_t k = 0; k < values.size(); ++k) {
+            EXPECT_EQ(static_cast<int>(k) + 1, values[k]);
+        }
+
+        // the pool can be reused
+        std::atomic<std::size_t> num_runs(0);
+        pool.run(10, [&num_runs](std::size_t) { ++num_runs; });
+        EXPECT_EQ(10, num_runs.load());
+    }
+}
+
+TEST(ThreadPoolTest, RethrowException) {
+    thread_pool pool(3);
+
+    std::atomic<std::size_t> num_runs(0);
+    EXPECT_THROW(pool.run(8, [&num_runs](std::size_t k) {
+        ++num_runs;
+        if (k % 3 == 1) { throw std::runtime_error("failed task"); }
+    }), std::runtime_error);
+
+    // every task has finished before the exception is rethrown
+    EXPECT_EQ(8, num_runs.load());
+}
+
+TEST(ThreadPoolTest, RunNestedTasks) {
+    // more tasks wait for nested ones than there are workers
+    thread_pool pool(2);
+
+    std::atomic<std::size_t> num_runs(0);
+    pool.run(4, [&pool, &num_runs](std::size_t) {
+        pool.run(4, [&num_runs](std::size_t) { ++num_runs; });
+    });
+
+    EXPECT_EQ(16, num_runs.load());
+}
@@ -6,6 +6,8 @@
  *  Distributed under The BSD 3-Clause License
  ************************************************/
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <dict/internal/tree_list.hpp>
@@ -105,3 +107,22 @@ TEST(LcpArrayTest, EraseValues) {
     EXPECT_EQ(5, tree[3]);
     EXPECT_EQ(7, tree[4]);
 }
+
+TEST(LcpArrayTest, ConstructFromRange) {
+    std::vector<tree_list::value_type> values(1000);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = i * 7 % 13;
+    }
+
+    tree_list tree(values.begin(), values.end());
+    ASSERT_EQ(values.size(), tree.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(values[i], tree[i]);
+    }
+
+    tree.insert(tree.find(500), 99);
+    tree.erase(tree.begin());
+    EXPECT_EQ(values.size(), tree.size());
+    EXPECT_EQ(99, tree[499]);
+    EXPECT_EQ(values[1], tree[0]);
+}
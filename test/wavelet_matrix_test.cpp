@@ -6,8 +6,13 @@
  *  Distributed under The BSD 3-Clause License
  ************************************************/
 
+#include <cstdint>
+
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include <dict/internal/thread_pool.hpp>
 #include <dict/internal/wavelet_matrix.hpp>
 
 using wm_t = dict::internal::wavelet_matrix<char>;
@@ -166,3 +171,43 @@ TEST(WaveletTreeTest, Sum) {
     EXPECT_EQ(7, wt.sum('s'));
     EXPECT_EQ(11, wt.sum('t'));
 }
+
+TEST(WaveletTreeTest, LfRange) {
+    wm_t wt;
+    construct_wavelet_matrix(wt);
+
+    using range = decltype(wt.lf_range(0, 0, 'i'));
+    EXPECT_EQ(range(0, 4), wt.lf_range(0, 11, 'i'));
+    EXPECT_EQ(range(1, 3), wt.lf_range(2, 9, 'i'));
+    EXPECT_EQ(range(8, 10), wt.lf_range(3, 6, 's'));
+    EXPECT_EQ(range(5, 7), wt.lf_range(0, 11, 'p'));
+    EXPECT_EQ(range(4, 5), wt.lf_range(0, 1, 'm'));
+    EXPECT_EQ(0, wt.lf_range(1, 8, 'p').second - wt.lf_range(1, 8, 'p').first);
+    EXPECT_EQ(0, wt.lf_range(0, 11, 'x').second - wt.lf_range(0, 11, 'x').first);
+}
+
+TEST(WaveletTreeTest, AssignInParallel) {
+    using wide_wm_t = dict::internal::wavelet_matrix<std::uint16_t, 12>;
+
+    // more than one chunk, the last of which is partial
+    std::vector<std::uint16_t> values(150001);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<std::uint16_t>(((i * 2654435761u) >> 20) & 0xfff);
+    }
+
+    wide_wm_t expected;
+    expected.assign(values.begin(), values.end());
+
+    dict::internal::thread_pool pool(3);
+    wide_wm_t actual;
+    actual.assign(values.begin(), values.end(), pool);
+
+    ASSERT_EQ(values.size(), actual.size());
+    for (std::size_t i = 0; i < values.size(); i += 97) {
+        EXPECT_EQ(values[i], actual[i]);
+        EXPECT_EQ(expected.rank(i, values[i]), actual.rank(i, values[i]));
+        EXPECT_EQ(expected.lf(i), actual.lf(i));
+    }
+
+    EXPECT_EQ(expected.sum(1000), actual.sum(1000));
+}